@@ -74,15 +74,10 @@ namespace KCL_rosplan {
 		// Determine whether this is a simulation or not.
 		bool simulated;
 		
-		// Expect s to be "(f,f,f)"
-		geometry_msgs::Pose transformToPose(const std::string& s);
-		
 		// Publisher to the visualiser.
 		ros::Publisher vis_pub;
 		
 		void sendMarker(const geometry_msgs::Pose& pose, const std::string& name, float size);
-
-		void tokenise(const std::string& s, std::vector<std::string>& tokens);
 		
 	public:
 
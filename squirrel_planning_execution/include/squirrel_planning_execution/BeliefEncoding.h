@@ -0,0 +1,76 @@
+#ifndef KCL_ROSPLAN_BELIEFENCODING_H
+#define KCL_ROSPLAN_BELIEFENCODING_H
+
+#include <string>
+#include <vector>
+#include <ostream>
+
+/**
+ * The contingent generators factorise the belief state into knowledge bases, each containing a set of states. When the
+ * planner moves down (assume_knowledge) or up (shed_knowledge) the knowledge base hierarchy all state dependent facts
+ * are copied from the states of one knowledge base to the states of the other. This file contains the shared code to
+ * write those actions in a compact form.
+ */
+namespace KCL_rosplan {
+
+	/**
+	 * How the knowledge that is copied between knowledge bases is encoded in the domain.
+	 */
+	enum BeliefEncoding
+	{
+		EXPANDED_BELIEF_ENCODING, // One conditional effect per fact and pair of states, grounded by the generator.
+		LIFTED_BELIEF_ENCODING    // One quantified conditional effect per predicate, grounded by the planner.
+	};
+
+	/**
+	 * Parse the name of an encoding as used in the launch files.
+	 * @param name Either "expanded" or "lifted".
+	 * @param encoding The parsed encoding, left unchanged if the name is not known.
+	 * @return True if the name is known, false otherwise.
+	 */
+	bool parseBeliefEncoding(const std::string& name, BeliefEncoding& encoding);
+
+	/**
+	 * A predicate whose last parameter is a state, e.g. (holding ?v - robot ?o - object ?s - state).
+	 */
+	struct StateFact
+	{
+		/**
+		 * @param name The name of the predicate.
+		 * @param parameters The typed parameters of the predicate without the state, e.g. "?v - robot ?o - object".
+		 */
+		StateFact(const std::string& name, const std::string& parameters);
+
+		std::string name_;       // The name of the predicate.
+		std::string parameters_; // The typed parameters without the state.
+		std::string arguments_;  // The variables of the parameters, e.g. "?v ?o".
+	};
+
+	/**
+	 * Write the effects of assume_knowledge(?old_kb ?new_kb): the states of ?new_kb become active and every fact that
+	 * holds in a state of ?old_kb is moved, together with its R-predicate, to all states of ?new_kb.
+	 *
+	 * Instead of a conditional effect for every pair of states, a single universally quantified effect is written
+	 * per predicate. Because part-of is static the planner only instantiates the pairs of states that are part of
+	 * the knowledge bases the action is grounded with.
+	 * @param writer The writer of the domain file, positioned inside the (and ...) of the effects.
+	 * @param facts All facts that are copied.
+	 */
+	void writeLiftedAssumeKnowledgeEffects(std::ostream& writer, const std::vector<StateFact>& facts);
+
+	/**
+	 * Write the preconditions of shed_knowledge(?old_kb ?new_kb) that are shared by all generators: no state of ?old_kb
+	 * may be on the stack and the robot must be at the same location in all states of ?old_kb.
+	 * @param writer The writer of the domain file, positioned inside the (and ...) of the preconditions.
+	 */
+	void writeLiftedShedKnowledgePreconditions(std::ostream& writer);
+
+	/**
+	 * Write the effects of shed_knowledge(?old_kb ?new_kb): the states of ?new_kb become active again and every fact that
+	 * holds in all states of ?old_kb is moved to the states of ?new_kb.
+	 * @param writer The writer of the domain file, positioned inside the (and ...) of the effects.
+	 * @param facts All facts that are copied.
+	 */
+	void writeLiftedShedKnowledgeEffects(std::ostream& writer, const std::vector<StateFact>& facts);
+};
+#endif
@@ -1,6 +1,8 @@
 #ifndef KCL_ROSPLAN_CONTINGENTSTRATEGICCLASSIFYPDDLGENERATOR_H
 #define KCL_ROSPLAN_CONTINGENTSTRATEGICCLASSIFYPDDLGENERATOR_H
 
+#include "squirrel_planning_execution/BeliefEncoding.h"
+
 /**
  * This file defines the RPSquirrelRecursion class.
  * RPSquirrelRecursion is used to execute strategic PDDL actions
@@ -107,7 +109,7 @@ namespace KCL_rosplan {
 		};
 		
 		static void generateProblemFile(const std::string& file_name, const KnowledgeBase& current_knowledge_base, const std::vector<const KnowledgeBase*>& knowledge_base, const Location& robot_location, const std::vector<Location*>& locations, const std::vector<Object*>& objects, unsigned int max_classification_attemps);
-		static void generateDomainFile(const std::string& file_name, const KnowledgeBase& current_knowledge_base, const std::vector<const KnowledgeBase*>& knowledge_bases, const Location& robot_location, const std::vector<Location*>& locations, const std::vector<Object*>& objects, unsigned int max_classification_attemps);
+		static void generateDomainFile(const std::string& file_name, const KnowledgeBase& current_knowledge_base, const std::vector<const KnowledgeBase*>& knowledge_bases, const Location& robot_location, const std::vector<Location*>& locations, const std::vector<Object*>& objects, unsigned int max_classification_attemps, BeliefEncoding belief_encoding);
 
 	public:
 
@@ -121,8 +123,10 @@ namespace KCL_rosplan {
 		 * @param object_location_predicates A mapping from the predicates of each object to the predicate of the waypoint where it is located.
 		 * @param near_waypoint_mapping Mapping of waypoints to waypoint that are near each other, allowing grasping, dropping, and pushing operations.
 		 * @param max_classification_attemps The maximum number of classification attemps we allow per object before giving up.
+		 * @param belief_encoding How knowledge is moved between knowledge bases, the lifted encoding keeps the size of 
+		 * the domain independent of the number of states and is needed to plan for more than a handful of objects.
 		 */
-		static void createPDDL(const std::string& path, const std::string& domain_file, const std::string& problem_file, const std::string& robot_location_predicate, const std::map<std::string, std::string>& object_location_predicates, const std::map<std::string, std::vector<std::string> >& near_waypoint_mapping, unsigned int max_classification_attemps);
+		static void createPDDL(const std::string& path, const std::string& domain_file, const std::string& problem_file, const std::string& robot_location_predicate, const std::map<std::string, std::string>& object_location_predicates, const std::map<std::string, std::vector<std::string> >& near_waypoint_mapping, unsigned int max_classification_attemps, BeliefEncoding belief_encoding = EXPANDED_BELIEF_ENCODING);
 	};
 }
 #endif
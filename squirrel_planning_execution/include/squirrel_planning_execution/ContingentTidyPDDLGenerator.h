@@ -1,6 +1,8 @@
 #ifndef KCL_ROSPLAN_CONTINGENTTIDIPDDLGENERATOR_H
 #define KCL_ROSPLAN_CONTINGENTTIDIPDDLGENERATOR_H
 
+#include "squirrel_planning_execution/BeliefEncoding.h"
+
 /**
  * Creates a PDDL domain and problem file that models the classification task on the tactical level. This 
  * means that a single object has been selected for classification, that the area around that object is 
@@ -163,8 +165,9 @@ namespace KCL_rosplan {
 		 * @param objects All the objects that exist in the domain that must be classified.
 		 * @param boxes All the boxes that exist in the domain.
 		 * @param types All the types that exist in the domain.
+		 * @param belief_encoding How knowledge is moved between knowledge bases.
 		 */
-		static void generateDomainFile(const std::string& file_name, const KnowledgeBase& current_knowledge_base, const std::vector<const KnowledgeBase*>& knowledge_bases, const Location& robot_location, const std::vector<const Location*>& locations, const std::vector<const Object*>& objects, const std::vector<const Box*>& boxes, const std::vector<const Type*>& types);
+		static void generateDomainFile(const std::string& file_name, const KnowledgeBase& current_knowledge_base, const std::vector<const KnowledgeBase*>& knowledge_bases, const Location& robot_location, const std::vector<const Location*>& locations, const std::vector<const Object*>& objects, const std::vector<const Box*>& boxes, const std::vector<const Type*>& types, BeliefEncoding belief_encoding);
 
 	public:
 		
@@ -179,9 +182,10 @@ namespace KCL_rosplan {
 		 * @param object_to_type_mapping A mapping for each object predicate to the type predicate 
 		 * @param box_to_location_mapping A mapping for each box to its location predicate.
 		 * @param box_to_type_mapping A mapping for each box to the type predicate of each object type it can contain.
-		 * @param near_box_location_mapping A mapping from box location to location near it.
+		 * @param belief_encoding How knowledge is moved between knowledge bases, the lifted encoding keeps the size of 
+		 * the domain independent of the number of states and is needed to plan for more than a handful of objects.
 		 */
-		static void createPDDL(const std::string& path, const std::string& domain_file, const std::string& problem_file, const std::string& robot_location_predicate, const std::map<std::string, std::string>& object_to_location_mapping, std::map<std::string, std::vector<std::string> >& near_waypoint_mappings, const std::map<std::string, std::string>& object_to_type_mapping, const std::map<std::string, std::string>& box_to_location_mapping, const std::map<std::string, std::string>& box_to_type_mapping, const std::map<std::string, std::vector<std::string> >& near_box_location_mapping);
+		static void createPDDL(const std::string& path, const std::string& domain_file, const std::string& problem_file, const std::string& robot_location_predicate, const std::map<std::string, std::string>& object_to_location_mapping, std::map<std::string, std::vector<std::string> >& near_waypoint_mappings, const std::map<std::string, std::string>& object_to_type_mapping, const std::map<std::string, std::string>& box_to_location_mapping, const std::map<std::string, std::string>& box_to_type_mapping, BeliefEncoding belief_encoding = EXPANDED_BELIEF_ENCODING);
 	};
 }
 #endif
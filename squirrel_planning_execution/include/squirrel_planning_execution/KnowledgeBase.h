@@ -2,7 +2,10 @@
 #define SQUIRREL_PLANNING_EXECUTION_KNOWLEDGEBASE_H
 
 #include <string>
+#include <vector>
+#include <map>
 #include <boost/concept_check.hpp>
+#include <boost/thread/mutex.hpp>
 
 #include <ros/ros.h>
 #include <mongodb_store/message_store.h>
@@ -28,6 +31,143 @@ public:
 		KB_REMOVE_KNOWLEDGE = rosplan_knowledge_msgs::KnowledgeUpdateService::Request::REMOVE_KNOWLEDGE
 	};
 	
+	/**
+	 * A batch of updates to the knowledge base. Updates are only recorded when they are added to the 
+	 * transaction, nothing is sent to ROSPlan until @ref{commit} is called. All updates are then sent 
+	 * in order over a single persistent connection, instead of setting up a new connection for every 
+	 * update. Failures do not stop the commit, instead all of them are collected in one report.
+	 */
+	class Transaction
+	{
+	public:
+		/**
+		 * Constructor.
+		 * @param knowledge_base The knowledge base this transaction is committed to.
+		 */
+		Transaction(KnowledgeBase& knowledge_base);
+		
+		/**
+		 * Add instance.
+		 * @param type The type of the instance.
+		 * @param name The name of the instance.
+		 */
+		void addInstance(const std::string& type, const std::string& name);
+		
+		/**
+		 * Remove instance.
+		 * @param type The type of the instance.
+		 * @param name The name of the instance.
+		 */
+		void removeInstance(const std::string& type, const std::string& name);
+		
+		/**
+		 * Add a fact to the knowledge base.
+		 * @param predicate The predicate of the new fact.
+		 * @param parameters The parameters of the new fact, they need to match the parameters in the PDDL domain.
+		 * @param is_true Whether the fact is true or false.
+		 * @param target Determines whether this fact is a goal or regular knowledge.
+		 */
+		void addFact(const std::string& predicate, const std::map<std::string, std::string>& parameters, bool is_true, AddUpdateTarget target);
+		
+		/**
+		 * Add a fact to the knowledge base.
+		 * @param fact The fact to add.
+		 * @param target Determines whether this fact is a goal or regular knowledge.
+		 */
+		void addFact(const rosplan_knowledge_msgs::KnowledgeItem& fact, AddUpdateTarget target);
+		
+		/**
+		 * Add an instance, fact or function to the knowledge base.
+		 * @param knowledge_item The item to add.
+		 * @param target Determines whether this item is a goal or regular knowledge.
+		 */
+		void addKnowledgeItem(const rosplan_knowledge_msgs::KnowledgeItem& knowledge_item, AddUpdateTarget target);
+		
+		/**
+		 * Remove an instance, fact or function from the knowledge base.
+		 * @param knowledge_item The item to remove.
+		 * @param target Determines whether this item is a goal or regular knowledge.
+		 */
+		void removeKnowledgeItem(const rosplan_knowledge_msgs::KnowledgeItem& knowledge_item, RemoveUpdateTarget target);
+		
+		/**
+		 * Remove a fact from the knowledge base.
+		 * @param predicate The predicate of the fact to be removed.
+		 * @param parameters The parameters of the fact to be removed, they need to match the parameters in the PDDL domain.
+		 * @param is_true Whether the fact is true or false.
+		 * @param target Determines whether this fact is a goal or regular knowledge.
+		 */
+		void removeFact(const std::string& predicate, const std::map<std::string, std::string>& parameters, bool is_true, RemoveUpdateTarget target);
+		
+		/**
+		 * Remove a fact from the knowledge base.
+		 * @param fact The fact to remove.
+		 * @param target Determines whether this fact is a goal or regular knowledge.
+		 */
+		void removeFact(const rosplan_knowledge_msgs::KnowledgeItem& fact, RemoveUpdateTarget target);
+		
+		/**
+		 * Add a function to the knowledge base.
+		 * @param predicate The predicate of the new function.
+		 * @param parameters The parameters of the new function, they need to match the parameters in the PDDL domain.
+		 * @param value The value of this fluent.
+		 * @param target Determines whether this fact is a goal or regular knowledge.
+		 */
+		void addFunction(const std::string& predicate, const std::map<std::string, std::string>& parameters, float value, AddUpdateTarget target);
+		
+		/**
+		 * Remove a function from the knowledge base.
+		 * @param predicate The predicate of the function to be removed.
+		 * @param parameters The parameters of the function to be removed, they need to match the parameters in the PDDL domain.
+		 * @param target Determines whether this fact is a goal or regular knowledge.
+		 */
+		void removeFunction(const std::string& predicate, const std::map<std::string, std::string>& parameters, RemoveUpdateTarget target);
+		
+		/**
+		 * Send all recorded updates to the knowledge base. The transaction is empty afterwards.
+		 * @return True if all updates were accepted, false otherwise. See @ref{getErrors} for the updates that failed.
+		 */
+		bool commit();
+		
+		/**
+		 * Forget all updates that have not been committed yet.
+		 */
+		void clear();
+		
+		/**
+		 * @return The number of updates that have not been committed yet.
+		 */
+		size_t size() const { return updates_.size(); }
+		
+		/**
+		 * @return A description of every update that failed during the last commit.
+		 */
+		const std::vector<std::string>& getErrors() const { return errors_; }
+		
+	private:
+		
+		/**
+		 * Record a single update.
+		 * @param update_type The rosplan update type (add / remove, knowledge / goal).
+		 * @param knowledge_item The item to update.
+		 */
+		void record(unsigned char update_type, const rosplan_knowledge_msgs::KnowledgeItem& knowledge_item);
+		
+		KnowledgeBase* knowledge_base_;                                   // The knowledge base to commit to.
+		std::vector<rosplan_knowledge_msgs::KnowledgeUpdateService> updates_; // All updates that are not yet committed.
+		std::vector<std::string> errors_;                                 // The updates that failed during the last commit.
+	};
+	
+	/**
+	 * Time spent on each query while taking a snapshot with @ref{getAllFacts} or @ref{getAllInstances}.
+	 */
+	struct SnapshotTiming
+	{
+		double domain_query_time_;                                 // Time to fetch the predicates or types of the domain (seconds).
+		double total_time_;                                        // Wall time of the whole snapshot (seconds).
+		std::vector<std::pair<std::string, double> > query_times_; // Time of the query of each predicate or type, in domain order (seconds).
+	};
+	
 	/**
 	 * Constructor.
 	 * @param nh The node handle.
@@ -35,6 +175,26 @@ public:
 	 */
 	KnowledgeBase(ros::NodeHandle& nh, mongodb_store::MessageStoreProxy& message_store);
 	
+	/**
+	 * Keep a local mirror of the facts and instances that are queried through this object. Repeated queries 
+	 * are answered from the mirror. Every update made through any KnowledgeBase object is announced on 
+	 * /kcl_rosplan/knowledge_base_changed, which invalidates the affected predicate or type in all mirrors, 
+	 * including the one that made the update. Updates made without this class are not announced, for those 
+	 * set @ref{max_age} so stale entries are fetched again eventually.
+	 * @param max_age Time in seconds after which a cached entry is fetched again, 0 to keep entries until invalidated.
+	 */
+	void enableCache(double max_age = 0);
+	
+	/**
+	 * Stop mirroring the knowledge base, all queries go to ROSPlan again.
+	 */
+	void disableCache();
+	
+	/**
+	 * Drop everything that is mirrored so far.
+	 */
+	void invalidateCache();
+	
 	/**
 	 * Add instance.
 	 * @param type The type of the instance.
@@ -52,11 +212,28 @@ public:
 	bool removeInstance(const std::string& type, const std::string& name);
 	
 	/**
-	 * Get all instances.
+	 * Set how many queries @ref{getAllFacts} and @ref{getAllInstances} may have in flight at the same time.
+	 * @param max_concurrent_queries The maximum number of queries, 1 queries one predicate or type at a time.
+	 */
+	void setMaxConcurrentQueries(unsigned int max_concurrent_queries);
+	
+	/**
+	 * Get all instances. The instances of each type are queried concurrently, and merged in the order 
+	 * the types are declared in the domain.
 	 * @param store Place to store all found instances.
+	 * @param timing If not NULL, the time spent on each query is stored here.
 	 * @return True if all instances could be found, false otherwise.
 	 */
-	bool getAllInstances(std::vector<std::string>& store);
+	bool getAllInstances(std::vector<std::string>& store, SnapshotTiming* timing = NULL);
+	
+	/**
+	 * Get all instances together with their type. An instance is returned once, with the most specific type it 
+	 * was found under, in the order the types are declared in the domain.
+	 * @param store All instances are added to this vector as INSTANCE knowledge items.
+	 * @param timing If not NULL, the time spent on each query is stored here.
+	 * @return True if all instances could be found, false otherwise.
+	 */
+	bool getAllInstances(std::vector<rosplan_knowledge_msgs::KnowledgeItem>& store, SnapshotTiming* timing = NULL);
 	
 	/**
 	 * Get all instances of the given type.
@@ -127,11 +304,29 @@ public:
 	bool removeAllGoals();
 	
 	/**
-	 * Get all facts that are in the knowledge base.
+	 * Get all facts that are in the knowledge base. The facts of each predicate are queried concurrently, and 
+	 * merged in the order the predicates are declared in the domain.
 	 * @param store All retreived facts are added to this vector.
+	 * @param timing If not NULL, the time spent on each query is stored here.
 	 * @return True if the facts could be retreived, false if something went wrong.
 	 */
-	bool getAllFacts(std::vector<rosplan_knowledge_msgs::KnowledgeItem>& store);
+	bool getAllFacts(std::vector<rosplan_knowledge_msgs::KnowledgeItem>& store, SnapshotTiming* timing = NULL);
+	
+	/**
+	 * Get all functions that are in the knowledge base. The functions are queried concurrently, and merged in 
+	 * the order they are declared in the domain.
+	 * @param store All retreived functions are added to this vector.
+	 * @param timing If not NULL, the time spent on each query is stored here.
+	 * @return True if the functions could be retreived, false if something went wrong.
+	 */
+	bool getAllFunctions(std::vector<rosplan_knowledge_msgs::KnowledgeItem>& store, SnapshotTiming* timing = NULL);
+	
+	/**
+	 * Get all goals that are in the knowledge base.
+	 * @param store All retreived goals are added to this vector.
+	 * @return True if the goals could be retreived, false if something went wrong.
+	 */
+	bool getAllGoals(std::vector<rosplan_knowledge_msgs::KnowledgeItem>& store);
 	
 	/**
 	 * Get all facts of the given predicate that are in the knowledge base.
@@ -156,7 +351,13 @@ public:
 	 */
 	std::string toString(const rosplan_knowledge_msgs::KnowledgeItem& knowledge_item) const;
 	
-private:
+	/**
+	 * Create an instance using the rosplan knowledge message.
+	 * @param type The type of the instance.
+	 * @param name The name of the instance.
+	 * @return The rosplan representation of an instance.
+	 */
+	static rosplan_knowledge_msgs::KnowledgeItem createInstance(const std::string& type, const std::string& name);
 	
 	/**
 	 * Create a fact using the rosplan knowledge message.
@@ -165,7 +366,7 @@ private:
 	 * @param is_true Whether the fact is true or false.
 	 * @return The rosplan representation of a fact.
 	 */
-	rosplan_knowledge_msgs::KnowledgeItem createFact(const std::string& predicate, const std::map<std::string, std::string>& parameters, bool is_true);
+	static rosplan_knowledge_msgs::KnowledgeItem createFact(const std::string& predicate, const std::map<std::string, std::string>& parameters, bool is_true);
 	
 	/**
 	 * Create a function using the rosplan knowledge message.
@@ -174,7 +375,110 @@ private:
 	 * @param value The value of this function.
 	 * @return The rosplan representation of a function.
 	 */
-	rosplan_knowledge_msgs::KnowledgeItem createFunction(const std::string& predicate, const std::map<std::string, std::string>& parameters, float value);
+	static rosplan_knowledge_msgs::KnowledgeItem createFunction(const std::string& predicate, const std::map<std::string, std::string>& parameters, float value);
+	
+private:
+	
+	/**
+	 * All facts of a single predicate, indexed by whether they are negative and their parameters.
+	 */
+	struct CachedPredicate
+	{
+		typedef std::pair<bool, std::map<std::string, std::string> > Key;
+		
+		ros::Time fetched_;
+		std::map<Key, rosplan_knowledge_msgs::KnowledgeItem> facts_;
+	};
+	
+	/**
+	 * All instances of a single type.
+	 */
+	struct CachedType
+	{
+		ros::Time fetched_;
+		std::vector<std::string> instances_;
+	};
+	
+	/**
+	 * A single query of a snapshot, the result of querying the instances of one type or the facts of one predicate.
+	 */
+	struct SnapshotQuery
+	{
+		std::string name_;                                      // The name of the type or predicate.
+		bool is_type_;                                          // Whether the instances of a type are queried, or the facts of a predicate.
+		std::vector<std::string> instances_;                    // The instances found.
+		std::vector<rosplan_knowledge_msgs::KnowledgeItem> facts_; // The facts found.
+		bool success_;                                          // Whether the query succeeded.
+		double duration_;                                       // How long the query took (seconds).
+	};
+	
+	/**
+	 * Run all queries on at most @ref{max_concurrent_queries_} threads.
+	 * @param queries The queries to run, the results are stored in them.
+	 */
+	void runSnapshotQueries(std::vector<SnapshotQuery>& queries);
+	
+	/**
+	 * Keep running queries until none are left.
+	 * @param queries The queries to run.
+	 * @param next_query The index of the next query that has not been started.
+	 * @param next_query_mutex Guards @ref{next_query}.
+	 */
+	void snapshotWorker(std::vector<SnapshotQuery>& queries, unsigned int& next_query, boost::mutex& next_query_mutex);
+	
+	/**
+	 * Log the time spent on a snapshot and store it in @ref{timing}.
+	 * @param queries The queries of the snapshot.
+	 * @param start_time When the snapshot was started.
+	 * @param domain_time When the predicates or types of the domain were received.
+	 * @param timing If not NULL, the time spent on each query is stored here.
+	 */
+	void reportSnapshotTiming(const std::vector<SnapshotQuery>& queries, const ros::WallTime& start_time, const ros::WallTime& domain_time, SnapshotTiming* timing) const;
+	
+	/**
+	 * @param fetched The time an entry was put in the cache.
+	 * @return True if an entry fetched at the given time can still be used.
+	 */
+	bool isFresh(const ros::Time& fetched) const;
+	
+	/**
+	 * Make sure all facts of the given predicate are mirrored, fetching them if needed. The lock is released 
+	 * while ROSPlan is queried.
+	 * @param predicate The predicate to mirror.
+	 * @param lock The lock on @ref{cache_mutex_}, it is held when this method returns.
+	 * @param uncached Where the facts are stored if the cache was invalidated while they were fetched.
+	 * @return The mirrored facts, NULL if they could not be fetched.
+	 */
+	const CachedPredicate* fetchPredicate(const std::string& predicate, boost::mutex::scoped_lock& lock, CachedPredicate& uncached);
+	
+	/**
+	 * Called after an update to the knowledge base succeeded. Invalidates the affected part of the mirror and 
+	 * announces the update.
+	 * @param update_type The rosplan update type (add / remove, knowledge / goal).
+	 * @param knowledge_item The item that was updated.
+	 */
+	void updateSucceeded(unsigned char update_type, const rosplan_knowledge_msgs::KnowledgeItem& knowledge_item);
+	
+	/**
+	 * Callback for updates announced on /kcl_rosplan/knowledge_base_changed.
+	 * @param msg The item that was updated.
+	 */
+	void knowledgeChangedCallback(const rosplan_knowledge_msgs::KnowledgeItem::ConstPtr& msg);
+	
+	/**
+	 * @param knowledge_item A fact or function.
+	 * @return The parameters of the given item as a mapping from key to value.
+	 */
+	static std::map<std::string, std::string> getParameters(const rosplan_knowledge_msgs::KnowledgeItem& knowledge_item);
+	
+	/**
+	 * Query all facts or functions declared in the domain, see @ref{getAllFacts} and @ref{getAllFunctions}.
+	 * @param domain_client The service that returns the predicates or functions of the domain.
+	 * @param store All retreived facts or functions are added to this vector.
+	 * @param timing If not NULL, the time spent on each query is stored here.
+	 * @return True if everything could be retreived, false if something went wrong.
+	 */
+	bool getAllAttributes(ros::ServiceClient& domain_client, std::vector<rosplan_knowledge_msgs::KnowledgeItem>& store, SnapshotTiming* timing);
 	
 	ros::NodeHandle* nh_; // The node handle.
 	mongodb_store::MessageStoreProxy* message_store_; // The message store.
@@ -184,10 +488,24 @@ private:
 	ros::ServiceClient query_knowledge_client_;
 	
 	ros::ServiceClient get_domain_predicates_client_;
+	ros::ServiceClient get_domain_functions_client_;
 	ros::ServiceClient get_domain_types_client_;
 	ros::ServiceClient get_instance_client_;
 	ros::ServiceClient get_attribute_client_;
 	ros::ServiceClient get_current_goals_client_;
+	
+	unsigned int max_concurrent_queries_; // The maximum number of queries in flight while taking a snapshot.
+	
+	// Mirror of the knowledge base, see @ref{enableCache}.
+	bool cache_enabled_;
+	ros::Duration cache_max_age_;
+	std::map<std::string, CachedPredicate> cached_predicates_;
+	std::map<std::string, CachedType> cached_types_;
+	unsigned int cache_generation_; // Changes every time (part of) the cache is invalidated.
+	boost::mutex cache_mutex_;
+	
+	ros::Publisher knowledge_changed_pub_;
+	ros::Subscriber knowledge_changed_sub_;
 };
 };
 
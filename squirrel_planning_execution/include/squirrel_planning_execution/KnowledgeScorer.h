@@ -0,0 +1,44 @@
+#ifndef KCL_ROSPLAN_KNOWLEDGESCORER_H
+#define KCL_ROSPLAN_KNOWLEDGESCORER_H
+
+#include <vector>
+
+namespace KCL_rosplan {
+
+	/**
+	 * Sums the probabilities of a fixed set of facts. The facts are identified by their dense ids and marked in 
+	 * a mask with one weight per id, so scoring the probabilities of all facts (also indexed by id) is a single 
+	 * multiply-add over two contiguous arrays that the compiler can vectorise. A fact that is marked twice 
+	 * counts twice.
+	 */
+	class KnowledgeScorer
+	{
+	public:
+		/**
+		 * Constructor, no facts are marked.
+		 */
+		KnowledgeScorer();
+
+		/**
+		 * Mark a fact so its probability is part of the score.
+		 * @param fact_id The id of the fact.
+		 */
+		void addFact(unsigned int fact_id);
+
+		/**
+		 * Unmark all facts.
+		 */
+		void clear();
+
+		/**
+		 * @param probabilities The probability of every fact, indexed by id. Facts beyond the end count as 0.
+		 * @return The sum of the probabilities of the marked facts.
+		 */
+		float score(const std::vector<float>& probabilities) const;
+
+	private:
+		std::vector<float> weights_; // The number of times each fact is marked, indexed by id.
+	};
+};
+
+#endif
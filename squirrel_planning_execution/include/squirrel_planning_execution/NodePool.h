@@ -0,0 +1,124 @@
+#ifndef KCL_ROSPLAN_NODEPOOL_H
+#define KCL_ROSPLAN_NODEPOOL_H
+
+#include <new>
+#include <memory>
+#include <vector>
+#include <boost/noncopyable.hpp>
+
+namespace KCL_rosplan {
+
+	/**
+	 * Owns the nodes (locations, objects, states, etc.) that a PDDL generator creates while building the graph
+	 * for a single domain. Nodes are constructed in place in blocks of contiguous memory, so creating a node
+	 * rarely allocates, and all nodes are destroyed at once when the pool goes out of scope. Nodes never move:
+	 * pointers to them stay valid for the lifetime of the pool. Every node can also be looked up by the order
+	 * in which it was created.
+	 */
+	template <class T>
+	class NodePool : boost::noncopyable
+	{
+	public:
+		/**
+		 * Constructor.
+		 * @param block_size The number of nodes that is allocated in one go.
+		 */
+		NodePool(size_t block_size = 256)
+			: block_size_(block_size == 0 ? 1 : block_size), size_(0)
+		{
+
+		}
+
+		/**
+		 * Destructor, destroys all nodes in the reverse order of their creation.
+		 */
+		~NodePool()
+		{
+			while (size_ > 0)
+			{
+				--size_;
+				(*this)[size_].~T();
+			}
+			for (typename std::vector<T*>::const_iterator ci = blocks_.begin(); ci != blocks_.end(); ++ci)
+			{
+				allocator_.deallocate(*ci, block_size_);
+			}
+		}
+
+		/**
+		 * Create a new node, the arguments are passed to the constructor of T.
+		 * @return The new node, it is owned by this pool.
+		 */
+		template <class A1>
+		T* create(const A1& a1)
+		{
+			T* node = new (getFreeSlot()) T(a1);
+			++size_;
+			return node;
+		}
+
+		template <class A1, class A2>
+		T* create(const A1& a1, const A2& a2)
+		{
+			T* node = new (getFreeSlot()) T(a1, a2);
+			++size_;
+			return node;
+		}
+
+		template <class A1, class A2, class A3>
+		T* create(const A1& a1, const A2& a2, const A3& a3)
+		{
+			T* node = new (getFreeSlot()) T(a1, a2, a3);
+			++size_;
+			return node;
+		}
+
+		template <class A1, class A2, class A3, class A4>
+		T* create(const A1& a1, const A2& a2, const A3& a3, const A4& a4)
+		{
+			T* node = new (getFreeSlot()) T(a1, a2, a3, a4);
+			++size_;
+			return node;
+		}
+
+		template <class A1, class A2, class A3, class A4, class A5>
+		T* create(const A1& a1, const A2& a2, const A3& a3, const A4& a4, const A5& a5)
+		{
+			T* node = new (getFreeSlot()) T(a1, a2, a3, a4, a5);
+			++size_;
+			return node;
+		}
+
+		/**
+		 * @return The number of nodes in this pool.
+		 */
+		size_t size() const { return size_; }
+
+		/**
+		 * @param index The index of a node, nodes are indexed in the order they were created.
+		 * @return The node at @ref{index}.
+		 */
+		T& operator[](size_t index) { return blocks_[index / block_size_][index % block_size_]; }
+		const T& operator[](size_t index) const { return blocks_[index / block_size_][index % block_size_]; }
+
+	private:
+
+		/**
+		 * @return The memory where the next node is constructed, a new block is allocated if all blocks are full.
+		 */
+		T* getFreeSlot()
+		{
+			if (size_ == blocks_.size() * block_size_)
+			{
+				blocks_.push_back(allocator_.allocate(block_size_));
+			}
+			return blocks_[size_ / block_size_] + size_ % block_size_;
+		}
+
+		std::allocator<T> allocator_; // Allocates the blocks.
+		std::vector<T*> blocks_;      // Every block holds block_size_ nodes.
+		size_t block_size_;           // The number of nodes per block.
+		size_t size_;                 // The number of nodes that have been constructed.
+	};
+}
+#endif
@@ -0,0 +1,102 @@
+#ifndef KCL_ROSPLAN_PDDLCACHE_H
+#define KCL_ROSPLAN_PDDLCACHE_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+#include <boost/thread/mutex.hpp>
+
+namespace KCL_rosplan {
+
+	/**
+	 * Remembers which inputs the PDDL generators used to create a file, so the file does not have to be
+	 * generated again when a generator is called with the same inputs. The generators describe their inputs
+	 * with a @ref{Fingerprint}; if it matches the fingerprint of the stored file the file can be handed to
+	 * the planner as it is.
+	 *
+	 * Only files generated by this process are reused, a file left on disk by a previous run may have been
+	 * generated by different code. The text of every stored file is kept in memory, so a file that was removed
+	 * or changed by someone else is restored without generating it.
+	 */
+	class PDDLCache
+	{
+	public:
+
+		/**
+		 * A 64 bit FNV-1a hash of all inputs that determine the content of a file.
+		 */
+		class Fingerprint
+		{
+		public:
+			/**
+			 * Create the fingerprint of no inputs.
+			 */
+			Fingerprint();
+
+			/**
+			 * Add an input to the fingerprint, the order in which inputs are added matters.
+			 * @param value The input.
+			 * @return This fingerprint.
+			 */
+			Fingerprint& add(const std::string& value);
+			Fingerprint& add(unsigned int value);
+			Fingerprint& add(const std::vector<std::string>& values);
+			Fingerprint& add(const std::map<std::string, std::string>& values);
+			Fingerprint& add(const std::map<std::string, std::vector<std::string> >& values);
+
+			/**
+			 * @return The hash of all inputs added so far.
+			 */
+			boost::uint64_t getValue() const { return value_; }
+
+		private:
+
+			/**
+			 * Add raw bytes to the hash.
+			 */
+			void addBytes(const char* data, size_t size);
+
+			boost::uint64_t value_;
+		};
+
+		/**
+		 * Make sure @ref{file_name} contains what was stored for it earlier with the same fingerprint.
+		 * @param file_name The path and file name of the file.
+		 * @param fingerprint The inputs the file would be generated from.
+		 * @return True if the file on disk matches the fingerprint and can be used as it is, false if it has
+		 * to be generated.
+		 */
+		static bool restore(const std::string& file_name, const Fingerprint& fingerprint);
+
+		/**
+		 * Remember the file that was just generated from the inputs in @ref{fingerprint}.
+		 * @param file_name The path and file name of the generated file.
+		 * @param fingerprint The inputs the file was generated from.
+		 */
+		static void store(const std::string& file_name, const Fingerprint& fingerprint);
+
+	private:
+
+		/**
+		 * A file as it was stored.
+		 */
+		struct Entry
+		{
+			boost::uint64_t fingerprint_;
+			std::string text_;
+		};
+
+		/**
+		 * @param file_name The path and file name of a file.
+		 * @param text The expected content of the file.
+		 * @return True if the file exists and contains exactly @ref{text}.
+		 */
+		static bool hasContent(const std::string& file_name, const std::string& text);
+
+		static std::map<std::string, Entry> entries_; // The stored files, indexed by their file name.
+		static boost::mutex entries_mutex_;           // Guards entries_.
+	};
+}
+#endif
@@ -0,0 +1,104 @@
+#ifndef KCL_ROSPLAN_PDDLWRITER_H
+#define KCL_ROSPLAN_PDDLWRITER_H
+
+#include <string>
+#include <ostream>
+#include <streambuf>
+
+namespace KCL_rosplan {
+
+	/**
+	 * Output stream used by the PDDL generators to write domain and problem files. Everything that is 
+	 * written is kept in memory and only written to disk when the writer is closed, so the cost of 
+	 * generating a file depends on the number of bytes and not on the number of lines. Flushing the 
+	 * stream (e.g. std::endl) does not touch the disk.
+	 * 
+	 * Besides the usual stream operators it offers a couple of helpers to write s-expressions that are 
+	 * indented according to how deeply they are nested:
+	 * 
+	 *   writer.begin(":init");
+	 *   writer.line("(gripper_empty kenny)");
+	 *   writer.indent() << "(robot_at kenny " << waypoint << ")" << std::endl;
+	 *   writer.end();
+	 */
+	class PDDLWriter : public std::ostream
+	{
+	public:
+		
+		/**
+		 * Create a writer that is not associated with a file yet.
+		 */
+		PDDLWriter();
+		
+		/**
+		 * Create a writer for the given file.
+		 * @param file_name The path and file name of the file to write.
+		 */
+		PDDLWriter(const std::string& file_name);
+		
+		/**
+		 * Destructor, writes the file if that has not happened yet.
+		 */
+		~PDDLWriter();
+		
+		/**
+		 * Start a new file, anything that was not written yet is discarded.
+		 * @param file_name The path and file name of the file to write.
+		 */
+		void open(const std::string& file_name);
+		
+		/**
+		 * @return True if a file is associated with this writer and it has not been written yet.
+		 */
+		bool is_open() const { return !file_name_.empty(); }
+		
+		/**
+		 * Write the buffer to disk.
+		 * @return True if the file was written, false otherwise.
+		 */
+		bool close();
+		
+		/**
+		 * Write the indentation followed by "(head" and a new line, the lines after it are indented one level deeper.
+		 * @param head The first element of the s-expression, e.g. ":action goto".
+		 */
+		PDDLWriter& begin(const std::string& head);
+		
+		/**
+		 * Close the last s-expression opened by @ref{begin}.
+		 */
+		PDDLWriter& end();
+		
+		/**
+		 * Write a single line at the current indentation.
+		 * @param text The line to write, without the new line.
+		 */
+		PDDLWriter& line(const std::string& text);
+		
+		/**
+		 * Write the indentation of the current nesting level, so a line can be composed with the stream operators.
+		 */
+		PDDLWriter& indent();
+		
+	private:
+		
+		/**
+		 * Stream buffer that appends to a string and never flushes.
+		 */
+		struct Buffer : public std::streambuf
+		{
+			Buffer();
+			
+			int_type overflow(int_type c);
+			std::streamsize xsputn(const char* s, std::streamsize n);
+			int sync() { return 0; }
+			
+			std::string data_;
+		};
+		
+		Buffer buffer_;         // All data written since the file was opened.
+		std::string file_name_; // The file to write to, empty if there is none.
+		unsigned int depth_;    // How deeply the current s-expression is nested.
+	};
+}
+#endif
@@ -14,6 +14,8 @@
 #include "rosplan_knowledge_msgs/CreatePRM.h"
 #include "rosplan_knowledge_msgs/AddWaypoint.h"
 #include <tf/transform_datatypes.h>
+#include <boost/thread.hpp>
+#include "squirrel_planning_execution/KnowledgeBase.h"
 #include <sstream>
 #include <string>
 #include <ctime>
@@ -42,6 +44,18 @@ namespace KCL_rosplan {
 		std::vector<std::string> neighbours;
 	};
 
+	/* the manipulation waypoints of a single object, as returned by the manipulation service */
+	struct ObjectTaskPoses
+	{
+		ObjectTaskPoses(const std::string &id)
+			: obID(id), success(false) {}
+
+		std::string obID;
+		bool success;
+		std::string error;
+		std::vector<geometry_msgs::Point> poses;
+	};
+
 	class RPSquirrelRoadmap
 	{
 
@@ -56,7 +70,7 @@ namespace KCL_rosplan {
 		mongodb_store::MessageStoreProxy message_store;
 
 		// Knowledge base
-		ros::ServiceClient update_knowledge_client;
+		KnowledgeBase knowledge_base;
 		ros::ServiceClient get_instance_client;
 
 		// map
@@ -74,7 +88,21 @@ namespace KCL_rosplan {
 		void clearMarkerArrays(ros::NodeHandle nh);
 
 		// waypoint request services
-		ros::ServiceClient manipulation_client;
+		ros::NodeHandle node_handle;
+		std::string manipulation_service_topic;
+		int max_concurrent_requests;
+		boost::mutex message_store_mutex;
+
+		/* request the manipulation waypoints of objects until none are left, one worker per in-flight request */
+		void requestTaskPosesWorker(std::vector<ObjectTaskPoses> &requests, size_t &next_request, boost::mutex &next_request_mutex);
+		void requestTaskPoses(ros::ServiceClient &manipulation_client, ObjectTaskPoses &request);
+
+		/* compute phase: request the manipulation waypoints of all objects and drop those in collision */
+		bool computeRoadmap(const nav_msgs::OccupancyGrid &map, std::map<std::string, Waypoint*> &new_waypoints);
+		bool isInCollision(const nav_msgs::OccupancyGrid &map, const tf::Transform &world_to_map, const geometry_msgs::Point &p) const;
+
+		/* commit phase: replace the old roadmap in the knowledge base, scene database and visualisation */
+		bool commitRoadmap(std::map<std::string, Waypoint*> &new_waypoints, std::vector<std::string> &committed_waypoints);
 
 	public:
 
@@ -1,4 +1,5 @@
 #include <map>
+#include <list>
 #include <vector>
 #include <string>
 #include <algorithm> 
@@ -6,11 +7,19 @@
 #include <cctype>
 #include <locale>
 #include <iostream>
+#include <stdint.h>
+
+#include <boost/unordered_map.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/function.hpp>
+#include <boost/random/mersenne_twister.hpp>
 
 #include <ros/ros.h>
 #include <mongodb_store/message_store.h>
 
 #include "squirrel_planning_execution/StringUtilityFunctions.h"
+#include "squirrel_planning_execution/KnowledgeScorer.h"
 
 #ifndef SQUIRREL_PLANNING_EXECUTION_RECOMMENDER_SYSTEM_H
 #define SQUIRREL_PLANNING_EXECUTION_RECOMMENDER_SYSTEM_H
@@ -29,14 +38,15 @@ namespace KCL_rosplan {
 	class Type
 	{
 	private:
-		Type(const std::string& name, const Type* parent)
-			: name_(name), parent_(parent)
+		Type(const std::string& name, const Type* parent, unsigned int id)
+			: name_(name), parent_(parent), id_(id)
 		{
 			
 		}
 		
 		std::string name_;
 		const Type* parent_;
+		unsigned int id_;
 		static std::map<std::string, const Type*> generated_types_;
 	public:
 		/**
@@ -63,6 +73,9 @@ namespace KCL_rosplan {
 		/** @return The parent. */
 		inline const Type* getParent() const { return parent_; }
 		
+		/** @return A dense id, types are numbered in the order they are created. */
+		inline unsigned int getId() const { return id_; }
+		
 		/** 
 		 * Check if @ref{type} is a super type of this type.
 		 * @param type The type to check against.
@@ -94,15 +107,21 @@ namespace KCL_rosplan {
 	class Object
 	{
 	private:
-		Object(const std::string& name, const Type& type)
-			: name_(name), type_(&type)
+		Object(const std::string& name, const Type& type, unsigned int id)
+			: name_(name), type_(&type), id_(id)
 		{
 			
 		}
 		
 		std::string name_;
 		const Type* type_;
+		unsigned int id_;
 		static std::map<std::string, const Object*> generated_objects_;
+		static std::map<const Type*, std::vector<const Object*> > objects_by_type_; // The objects of a type and its subtypes.
+		static boost::mutex objects_by_type_mutex_;                                 // Guards objects_by_type_ and nr_grounding_iterators_.
+		static unsigned int nr_grounding_iterators_;                                // The number of grounding iterators that are alive.
+		
+		friend class GroundingIterator;
 	public:
 		/**
 		 * Create an object, all objects are stored in a global cache.
@@ -125,11 +144,27 @@ namespace KCL_rosplan {
 		/** @return The type. */
 		inline const Type& getType() const { return *type_; }
 		
+		/** @return A dense id, objects are numbered in the order they are created. */
+		inline unsigned int getId() const { return id_; }
+		
 		/**
 		 * @return All objects of a certain type.
 		 */
 		static void getObjects(const Type& type, std::vector<const Object*>& objects);
 		
+		/**
+		 * @param type A type.
+		 * @return All objects of @ref{type} or one of its subtypes, ordered by name. The list remains valid until 
+		 * the next object is created.
+		 */
+		static const std::vector<const Object*>& getObjects(const Type& type);
+		
+		/**
+		 * Index the objects of every type, call it once all objects are created and before the objects are 
+		 * grounded (in particular before any worker threads are started).
+		 */
+		static void buildTypeIndex();
+		
 		/**
 		 * Delete all objects ever created.
 		 */
@@ -142,14 +177,15 @@ namespace KCL_rosplan {
 	class Predicate
 	{
 	private:
-		Predicate(const std::string& name, const std::vector<const Type*>& types)
-			: name_(name), types_(types)
+		Predicate(const std::string& name, const std::vector<const Type*>& types, unsigned int id)
+			: name_(name), types_(types), id_(id)
 		{
 			
 		}
 		
 		std::string name_;
 		std::vector<const Type*> types_;
+		unsigned int id_;
 		static std::map<std::string, const Predicate*> generated_predicates_;
 	public:
 		/**
@@ -171,8 +207,11 @@ namespace KCL_rosplan {
 		/** @return The types. */
 		inline const std::vector<const Type*>& getTypes() const { return types_; }
 		
+		/** @return A dense id, predicates are numbered in the order they are created. */
+		inline unsigned int getId() const { return id_; }
+		
 		/**
-		 * Ground this predicate.
+		 * Ground this predicate, use a GroundingIterator to avoid creating all facts at once.
 		 * @param facts All grounded facts.
 		 */
 		void ground(std::vector<const Fact*>& facts) const;
@@ -183,62 +222,37 @@ namespace KCL_rosplan {
 		static void cleanup();
 	};
 
-	/**
-	 * Fact prototype.
-	 */
-	struct FactProto : public std::binary_function<FactProto, FactProto, bool>
-	{
-		FactProto()
-			: p_(NULL), is_false_(true)
-		{
-
-		}
-
-		FactProto(const Predicate& p, const std::vector<const Object*>& objects, bool is_false)
-			: p_(&p), objects_(objects), is_false_(is_false)
-		{
-
-		}
-
-		const Predicate* p_;
-		std::vector<const Object*> objects_;
-		bool is_false_;
-
-		std::string toString() const
-		{
-			std::stringstream ss;
-			if (p_ != NULL)
-				ss << p_->getName() << " ";
-			for (std::vector<const Object*>::const_iterator ci = objects_.begin(); ci != objects_.end(); ++ci)
-			{
-				ss << (*ci)->getName() << " ";
-			}
-			ss << is_false_;
-			return ss.str();
-		}
-
-		bool operator()(const FactProto& a, const FactProto& b) const
-		{
-			return a.toString() < b.toString();
-		}
-	};
-	
 	/**
 	 * A fact.
 	 */
 	class Fact
 	{
 	private:
-		Fact(const Predicate& predicate, const std::vector<const Object*>& objects, bool is_negative = false)
-			: predicate_(&predicate), objects_(objects), is_negative_(is_negative)
+		Fact(const Predicate& predicate, const std::vector<const Object*>& objects, bool is_negative, unsigned int id)
+			: predicate_(&predicate), objects_(objects), is_negative_(is_negative), id_(id)
 		{
 			
 		}
 		
+		/**
+		 * Pack the ids of a fact in a single integer: 15 bits for the predicate, 1 bit for the negation, and 16 bits
+		 * for each of at most three objects.
+		 * @param predicate The predicate.
+		 * @param objects The set of objects.
+		 * @param is_negative Whether the fact is negative.
+		 * @param key The packed key.
+		 * @return True if the fact fits in a key, false if it has too many objects or its ids are too large.
+		 */
+		static bool getKey(const Predicate& predicate, const std::vector<const Object*>& objects, bool is_negative, uint64_t& key);
+		
 		const Predicate* predicate_;
 		std::vector<const Object*> objects_;
 		bool is_negative_;
-		static std::map<FactProto, const Fact*, FactProto> generated_facts_;
+		unsigned int id_;
+		static boost::unordered_map<uint64_t, const Fact*> generated_facts_;            // All facts that fit in a packed key.
+		static std::map<std::vector<unsigned int>, const Fact*> generated_wide_facts_;  // All other facts, keyed by their ids.
+		static std::vector<const Fact*> all_facts_;                                    // All facts, indexed by their id.
+		static boost::mutex generated_facts_mutex_;                                   // Guards the tables above, facts are created by multiple threads.
 	public:
 		
 		/**
@@ -262,6 +276,9 @@ namespace KCL_rosplan {
 		/** @return Whether this fact is negative. */
 		inline bool isNegative() const { return is_negative_; }
 		
+		/** @return A dense id, facts are numbered in the order they are created. */
+		inline unsigned int getId() const { return id_; }
+		
 		/** @return The fact as a string as it would be represented in an PDDL domain. **/
 		std::string getFullForm() const;
 		
@@ -273,6 +290,61 @@ namespace KCL_rosplan {
 	
 	std::ostream& operator<<(std::ostream& os, const Fact& fact);
 	
+	/**
+	 * Enumerates the groundings of a predicate one at a time, so the caller can stop at any point and no fact is 
+	 * created unless it is asked for. The arguments are assigned from first to last; a filter can reject a 
+	 * partial assignment (e.g. because a static fact does not hold), which skips all groundings that start 
+	 * with it. Usage:
+	 *
+	 *   GroundingIterator grounding(predicate);
+	 *   while (grounding.next()) { ... grounding.getObjects() ... grounding.getFact() ... }
+	 */
+	class GroundingIterator
+	{
+	public:
+		/**
+		 * Called with the objects assigned to the first arguments, return false to skip all groundings that
+		 * start with these objects.
+		 */
+		typedef boost::function<bool (const std::vector<const Object*>&)> Filter;
+		
+		/**
+		 * @param predicate The predicate to ground, the objects must not change while it is grounded.
+		 * @param filter Prunes partial assignments, if it is empty all groundings are enumerated.
+		 */
+		GroundingIterator(const Predicate& predicate, const Filter& filter = Filter());
+		
+		GroundingIterator(const GroundingIterator& other);
+		
+		~GroundingIterator();
+		
+		/**
+		 * Move to the next grounding, it must be called before the first grounding is accessed.
+		 * @return True if there is a grounding, false if all groundings have been enumerated.
+		 */
+		bool next();
+		
+		/** @return The objects of the current grounding. */
+		inline const std::vector<const Object*>& getObjects() const { return objects_; }
+		
+		/**
+		 * @param is_negative Whether the fact is negative.
+		 * @return The fact of the current grounding, it is created if it does not exist yet.
+		 */
+		inline const Fact& getFact(bool is_negative = false) const { return Fact::getFact(*predicate_, objects_, is_negative); }
+		
+	private:
+		const Predicate* predicate_;                             // The predicate that is grounded.
+		Filter filter_;                                          // Prunes partial assignments.
+		std::vector<const std::vector<const Object*>*> domains_; // The objects that can be assigned to each argument.
+		std::vector<unsigned int> counters_;                     // The index in the domain of each assigned argument.
+		std::vector<const Object*> objects_;                     // The objects assigned to the arguments.
+		bool started_;                                           // Whether next has been called.
+		bool done_;                                              // Whether all groundings have been enumerated.
+		
+		GroundingIterator& operator=(const GroundingIterator& other);
+	};
+	
 	/**
 	 * Class that gives the utility of a fact.
 	 */
@@ -361,6 +433,146 @@ namespace KCL_rosplan {
 		const FactObserveTree* true_branch_;
 		const FactObserveTree* false_branch_;
 	};
+
+	/**
+	 * The values of facts (0 = unknown, 1 = false, 2 = true) as a chain of overlays. The root refers to a map of 
+	 * facts that is not copied, every other level only stores the facts that it changes with respect to its 
+	 * parent. A hypothetical observation is therefore as cheap as the number of facts it changes. A parent must 
+	 * outlive its children and may not be changed while they are in use; reading is thread safe.
+	 */
+	class Evidence
+	{
+	public:
+		/**
+		 * Create the root of a chain, it is implicit so a map can be passed wherever evidence is expected.
+		 * @param weighted_facts The facts and their values, it must outlive this instance.
+		 */
+		Evidence(const std::map<const Fact*, float>& weighted_facts)
+			: parent_(NULL), weighted_facts_(&weighted_facts)
+		{
+			
+		}
+		
+		/**
+		 * Create an overlay that starts out with the same values as its parent.
+		 * @param parent The parent, it must outlive this instance.
+		 */
+		explicit Evidence(const Evidence* parent)
+			: parent_(parent), weighted_facts_(NULL)
+		{
+			
+		}
+		
+		/**
+		 * @param fact A fact.
+		 * @param value The value of @ref{fact}, if it is known.
+		 * @return True if a value is known for @ref{fact}, false otherwise.
+		 */
+		bool find(const Fact& fact, float& value) const;
+		
+		/**
+		 * @param fact A fact.
+		 * @return The value of @ref{fact}, 0 if it is not known.
+		 */
+		float get(const Fact& fact) const
+		{
+			float value;
+			return find(fact, value) ? value : 0.0f;
+		}
+		
+		/**
+		 * Change the value of a fact in this overlay, the parents are not changed.
+		 * @param fact A fact.
+		 * @param value The new value of @ref{fact}.
+		 */
+		void set(const Fact& fact, float value) { changes_[&fact] = value; }
+		
+		/**
+		 * Undo all changes made by this overlay.
+		 */
+		void clear() { changes_.clear(); }
+		
+		/**
+		 * @param weighted_facts All facts with a known value, including those of the parents, are added to this map.
+		 */
+		void flatten(std::map<const Fact*, float>& weighted_facts) const;
+		
+	private:
+		const Evidence* parent_;                             // The parent overlay, NULL for the root.
+		const std::map<const Fact*, float>* weighted_facts_; // The facts of the root, NULL for all other overlays.
+		std::map<const Fact*, float> changes_;               // The facts that are changed by this overlay.
+	};
+
+	/**
+	 * The data that is exchanged with the recommender, stored as a dense row-major matrix. There is a row for
+	 * every ordered pair of objects and a column for every predicate; the cell (row, column) holds the fact of
+	 * that predicate whose arguments are the first objects of the pair. The rows and columns are only described
+	 * by the objects and predicates, so the whole exchange can be carried as two lists of ids and a float array.
+	 */
+	struct RecommendationMatrix
+	{
+		/**
+		 * The input values of a cell, these are the values the recommender expects.
+		 */
+		enum CellValue
+		{
+			NOT_APPLICABLE = -1, // The objects of the row do not match the types of the predicate.
+			UNKNOWN = 0,         // The value of the fact has to be predicted.
+			KNOWN_FALSE = 1,     // The fact is known to be false.
+			KNOWN_TRUE = 2       // The fact is known to be true.
+		};
+
+		/**
+		 * @param objects The objects, row (i * objects.size() + j) is the pair (objects[i], objects[j]).
+		 * @param predicates The predicates, column k is predicates[k].
+		 */
+		void resize(const std::vector<const Object*>& objects, const std::vector<const Predicate*>& predicates);
+
+		/** @return The number of rows. */
+		inline unsigned int getNumberOfRows() const { return objects_.size() * objects_.size(); }
+
+		/** @return The number of columns. */
+		inline unsigned int getNumberOfColumns() const { return predicates_.size(); }
+
+		/** @return The index of the cell (row, column) in the value arrays. */
+		inline unsigned int getIndex(unsigned int row, unsigned int column) const { return row * predicates_.size() + column; }
+
+		/** @return The first object of the pair of @ref{row}. */
+		inline const Object& getFirstObject(unsigned int row) const { return *objects_[row / objects_.size()]; }
+
+		/** @return The second object of the pair of @ref{row}. */
+		inline const Object& getSecondObject(unsigned int row) const { return *objects_[row % objects_.size()]; }
+
+		std::vector<const Object*> objects_;       // The objects that make up the rows.
+		std::vector<const Predicate*> predicates_; // The predicates that make up the columns.
+		std::vector<float> values_;                // The input, a CellValue or the weight of the fact.
+		std::vector<char> predictions_;            // The output, non-zero if the fact is predicted to be true.
+		std::vector<float> confidences_;           // The output, the confidence of the prediction.
+	};
+
+	/**
+	 * The output of the recommender.
+	 */
+	struct RecommenderResults
+	{
+		std::map<const Fact*, float> facts_; // The confidence of every predicted fact.
+		std::vector<float> probabilities_;   // The same confidences indexed by fact id, 0 for facts that are not predicted.
+	};
+	
+	/**
+	 * A fact that might be sensed and the knowledge that is gained by sensing it.
+	 */
+	struct SensingCandidate
+	{
+		SensingCandidate(const Fact& fact)
+			: fact_(&fact), knowledge_gain_(0.0f, 0.0f)
+		{
+			
+		}
+		
+		const Fact* fact_;                       // The fact to sense.
+		std::pair<float, float> knowledge_gain_; // The knowledge gained if the fact is true, and if it is false.
+	};
 	
 	class RecommenderSystem
 	{
@@ -386,24 +598,72 @@ namespace KCL_rosplan {
 		std::string output_file;  // The file where we write the output file.
 		std::string absolute_input_file; // data_path/input_file
 		std::string absolute_output_file;// data_path/output_file
+		std::string backend;      // "service" to call the recommender through CSV files, "local" for the in-process stand-in.
+		unsigned int sample_size_;// The number of facts that are considered for sensing, 0 means all of them.
+		unsigned int nr_threads_; // The number of facts whose knowledge gain is calculated at the same time.
+		unsigned int cache_size_; // The maximum number of recommender results that are remembered.
 		
-		/* CSV functions. */
+		/* The results of the recommender, keyed by the ids of the objects and predicates followed by its input. When
+		 * the cache is full the result that was added first is evicted. */
+		typedef std::pair<std::vector<unsigned int>, std::vector<float> > RecommenderCacheKey;
+		typedef std::map<RecommenderCacheKey, boost::shared_ptr<const RecommenderResults> > RecommenderCache;
+		RecommenderCache recommender_cache_;
+		std::list<RecommenderCache::iterator> recommender_cache_order_; // The entries of recommender_cache_, oldest first.
+		boost::mutex recommender_cache_mutex_;                          // Guards recommender_cache_ and recommender_cache_order_.
+		
+		boost::mt19937 random_generator_; // Decides which facts are sampled, seeded with /squirrel_planning_execution/recommender/seed.
+		boost::mutex next_candidate_mutex_; // Guards the candidates that are shared by the workers of getBestSensingActions.
+		
+		/* Matrix functions. */
 		
 		/**
-		 * Write a CSV file given the set of objects, predicates, and a mapping from facts to their probability of being true. The 
-		 * data path we write to is: data_path/output_file.
+		 * Fill in the input of the recommender given the set of objects, predicates, and a mapping from facts to 
+		 * their probability of being true.
 		 * @param objects The list of objects.
 		 * @param predicates The list of predicates and their arity.
 		 * @param weighted_facts The list of facts and their probabilities.
+		 * @param matrix The matrix that is filled in.
 		 */
-		void writeCSV(const std::vector<const Object*>& objects, const std::vector<const Predicate*>& predicates, const std::map<const Fact*, float>& weighted_facts);
+		void writeMatrix(const std::vector<const Object*>& objects, const std::vector<const Predicate*>& predicates, const Evidence& weighted_facts, RecommendationMatrix& matrix) const;
 		
 		/**
-		 * Read a CSV file and return the probabilities. The data path we read from is: data_path/input_file.
+		 * Read the output of the recommender and return the probabilities, in the same format as @ref{readCSV}.
+		 * @param matrix The matrix whose predictions have been filled in.
+		 * @param results The map where the probabilities are stored in.
+		 */
+		void readMatrix(const RecommendationMatrix& matrix, std::map<const Fact*, float>& results) const;
+		
+		/**
+		 * A stand-in for the recommender that runs without any external services or files. An unknown fact is 
+		 * predicted from the known facts of the same predicate that share its second object, smoothed towards 
+		 * the predicate's mean; known facts are predicted with full confidence.
+		 * @param matrix The input of the recommender, the predictions are written to it.
+		 */
+		void runLocalRecommender(RecommendationMatrix& matrix) const;
+		
+		/* CSV functions. */
+		
+		/**
+		 * Write the input of the recommender to a CSV file.
+		 * @param matrix The input of the recommender.
+		 * @param file_name The file to write to.
+		 */
+		void writeCSV(const RecommendationMatrix& matrix, const std::string& file_name);
+		
+		/**
+		 * Read a CSV file and return the probabilities.
+		 * @param file_name The file to read from.
 		 * @param results The map where the probabilities are stored in.
 		 * @param predicates The predicates are not written by the recommender, so they need to be provided.
 		 */
-		void readCSV(std::map<const Fact*, float>& results, const std::vector<const Predicate*>& predicates);
+		void readCSV(const std::string& file_name, std::map<const Fact*, float>& results, const std::vector<const Predicate*>& predicates);
+		
+		/**
+		 * @param file_name The name of an input or output file of the recommender.
+		 * @param slot Calls that run at the same time must use different slots, so they do not share files.
+		 * @return The name of the file that is used by @ref{slot}, relative to the data path.
+		 */
+		std::string getSlotFileName(const std::string& file_name, unsigned int slot) const;
 		
 		/**
 		 * Calculate the knowledge increase by performing @ref{sensing_action}.
@@ -411,27 +671,58 @@ namespace KCL_rosplan {
 		 * @param predicates The list of predicates and their arity.
 		 * @param weighted_facts The list of facts and their probabilities.
 		 * @param interesting_facts The list of facts that we care to learn more about.
+		 * @param scorer The scorer of @ref{interesting_facts}, see @ref{getKnowledgeScorer}.
 		 * @param sensing_action The fact that is observed.
+		 * @param slot Calls that run at the same time must use different slots.
 		 * @return The pair increase if @ref{sensing_action} is true, and if @ref{sensing_action} is false.
 		 */
-		std::pair<float, float> calculateKnowledgeIncrease(const std::vector<const Object*>& objects, const std::vector<const Predicate*>& predicates, std::map<const Fact*, float> weighted_facts, const std::vector<const Fact*>& interesting_facts, const Fact& sensing_action);
+		std::pair<float, float> calculateKnowledgeIncrease(const std::vector<const Object*>& objects, const std::vector<const Predicate*>& predicates, const Evidence& weighted_facts, const std::vector<const Fact*>& interesting_facts, const KnowledgeScorer& scorer, const Fact& sensing_action, unsigned int slot = 0);
+		
+		/**
+		 * Calculate the knowledge increase of candidates until none are left, multiple workers can run at the same time.
+		 * @param objects The list of objects.
+		 * @param predicates The list of predicates and their arity.
+		 * @param weighted_facts The list of facts and their probabilities.
+		 * @param interesting_facts The list of facts that we care to learn more about.
+		 * @param scorer The scorer of @ref{interesting_facts}, see @ref{getKnowledgeScorer}.
+		 * @param candidates The candidates to evaluate.
+		 * @param next_candidate The index of the next candidate that is not taken by a worker, guarded by next_candidate_mutex_.
+		 * @param slot The slot of this worker.
+		 */
+		void calculateKnowledgeIncreaseWorker(const std::vector<const Object*>& objects, const std::vector<const Predicate*>& predicates, const Evidence& weighted_facts, const std::vector<const Fact*>& interesting_facts, const KnowledgeScorer& scorer, std::vector<SensingCandidate>& candidates, unsigned int& next_candidate, unsigned int slot);
 
 		/**
 		 * Calculate the knowledge increase by performing @ref{sensing_action}.
 		 * @param objects The list of objects.
 		 * @param predicates The list of predicates and their arity.
 		 * @param weighted_facts The list of facts and their probabilities.
-		 * @return The output of the recommender.
+		 * @param slot Calls that run at the same time must use different slots.
+		 * @return The output of the recommender, which is remembered for inputs that are seen again.
+		 */
+		boost::shared_ptr<const RecommenderResults> runRecommender(const std::vector<const Object*>& objects, const std::vector<const Predicate*>& predicates, const Evidence& weighted_facts, unsigned int slot = 0);
+		
+		/**
+		 * Mark the facts whose probabilities make up the knowledge value.
+		 * @param interesting_facts The list of facts that we care to learn more about.
+		 * @param scorer The scorer in which the facts are marked.
 		 */
-		std::map<const Fact*, float> runRecommender(const std::vector<const Object*>& objects, const std::vector<const Predicate*>& predicates, const std::map<const Fact*, float>& weighted_facts);
+		void getKnowledgeScorer(const std::vector<const Fact*>& interesting_facts, KnowledgeScorer& scorer) const;
 		
 		/**
 		 * Calculate the knowldge value of the output of the recommemder.
 		 * @param results The output values of the recommenderr.
+		 * @param scorer The scorer of the facts that we care to learn more about, see @ref{getKnowledgeScorer}.
+		 * @return The total knowledge given by the facts of @ref{scorer}.
+		 */
+		float calculateKnowledge(const RecommenderResults& results, const KnowledgeScorer& scorer) const;
+		
+		/**
+		 * Calculate the knowledge value of the known facts.
+		 * @param weighted_facts The list of facts and their probabilities.
 		 * @param interesting_facts The list of facts that we care to learn more about.
 		 * @return The total knowledge given by @ref{interesting_facts}.
 		 */
-		float calculateKnowledge(const std::map<const Fact*, float>& results, const std::vector<const Fact*>& interesting_facts) const;
+		float calculateKnowledge(const Evidence& weighted_facts, const std::vector<const Fact*>& interesting_facts) const;
 		
 		/**
 		 * Initialise the recommender system.
@@ -449,7 +740,7 @@ namespace KCL_rosplan {
 		 * Update @ref{weighted_facts_copy} by infering mutual exclusive pairs of actions and update their weights
 		 * accordingly.
 		 */
-		void processMutualExclusive(std::map<const Fact*, float>& weighted_facts_copy, const std::vector<const Fact*>& interesting_facts);
+		void processMutualExclusive(Evidence& weighted_facts_copy, const std::vector<const Fact*>& interesting_facts) const;
 		
 	public:
 
@@ -459,6 +750,12 @@ namespace KCL_rosplan {
 		/* destructor */
 		~RecommenderSystem();
 		
+		/**
+		 * Restart the sequence that decides which facts are sampled, the same seed and input give the same sensing actions.
+		 * @param seed The seed of the random generator.
+		 */
+		void setSeed(unsigned int seed);
+		
 		/**
 		 * Get the best sensing actions to perform given a data set and a weighted list of facts we care about.
 		 * @param objects The list of objects.
@@ -468,7 +765,7 @@ namespace KCL_rosplan {
 		 * @param max_depth The maximum depth of the tree of facts to observe.
 		 * @return A list of facts that give good information gain.
 		 */
-		std::vector<const Fact*> getBestSensingActions(const std::vector<const Object*>& objects, const std::vector<const Predicate*>& predicates, const std::map<const Fact*, float>& weighted_facts, const std::vector<const Fact*>& interesting_facts, unsigned int max_depth);
+		std::vector<const Fact*> getBestSensingActions(const std::vector<const Object*>& objects, const std::vector<const Predicate*>& predicates, const Evidence& weighted_facts, const std::vector<const Fact*>& interesting_facts, unsigned int max_depth);
 		
 		/**
 		 * Get the best sensing actions to perform given a data set and a weighted list of facts we care about and the last observed fact.
@@ -482,14 +779,15 @@ namespace KCL_rosplan {
 		 * @param interesting_facts The list of facts that we care to learn more about.
 		 * @param max_depth The maximum depth of the tree of facts to observe.
 		 */
-		void callRecogniser(FactObserveTree& node, const Fact& last_sensed_fact, unsigned int current_depth, unsigned int max_depth, const std::vector<const Object*>& objects, const std::vector<const Predicate*>& predicates, const std::map<const Fact*, float>& weighted_facts, const std::vector<const Fact*>& interesting_facts);
+		void callRecogniser(FactObserveTree& node, const Fact& last_sensed_fact, unsigned int current_depth, unsigned int max_depth, const std::vector<const Object*>& objects, const std::vector<const Predicate*>& predicates, const Evidence& weighted_facts, const std::vector<const Fact*>& interesting_facts);
 		
 		/**
 		 * Visualise the knowledge we have right now.
 		 * @param path The path where the output file will be saved.
 		 * @param objects The list of objects
 		 * @param predicates The list of predicates and their arity.
-		 * @param all_facts All the grounded facts.
+		 * @param all_facts All the facts that are true or uncertain, all other facts are false.
+		 * @param true_facts The facts that are true.
 		 */
 		void visualise(const std::string& path, const std::vector<const Object*>& objects, const std::vector<const Predicate*>& predicates, const std::vector<const KCL_rosplan::Fact*>& all_facts, const std::set<const KCL_rosplan::Fact*>& true_facts);
 	};
@@ -0,0 +1,205 @@
+#ifndef SQUIRREL_PLANNING_EXECUTION_SCENARIOLOADER_H
+#define SQUIRREL_PLANNING_EXECUTION_SCENARIOLOADER_H
+
+#include <string>
+#include <vector>
+
+#include <geometry_msgs/Pose.h>
+
+#include "squirrel_planning_execution/KnowledgeBase.h"
+#include "squirrel_planning_execution/ScenarioSnapshot.h"
+
+namespace KCL_rosplan
+{
+
+/**
+ * A box: b BOX_NAME (LOCATION) (NEAR LOCATION)
+ */
+struct ScenarioBox
+{
+	std::string name_;
+	geometry_msgs::Pose location_;
+	geometry_msgs::Pose near_;
+};
+
+/**
+ * A toy: t TOY_NAME [TYPE] [(LOCATION) [(NEAR LOCATION)]]
+ */
+struct ScenarioToy
+{
+	std::string name_;
+	std::string type_;             // Empty if no type is given.
+	bool has_location_;
+	geometry_msgs::Pose location_;
+	bool has_near_;
+	geometry_msgs::Pose near_;
+};
+
+/**
+ * A waypoint: w WAYPOINT_NAME (LOCATION)
+ */
+struct ScenarioWaypoint
+{
+	std::string name_;
+	geometry_msgs::Pose location_;
+};
+
+/**
+ * A child: c CHILD_NAME PLEASURE AROUSAL DOMINANCE RECIPROCITY
+ */
+struct ScenarioChild
+{
+	std::string name_;
+	float pleasure_;
+	float arousal_;
+	float dominance_;
+	float reciprocity_;
+};
+
+/**
+ * The box a toy belongs in: m TOY_ID BOX_NAME
+ */
+struct ScenarioMapping
+{
+	std::string object_;
+	std::string box_;
+};
+
+/**
+ * A function of the robot: f FUNCTION VALUE
+ */
+struct ScenarioFunction
+{
+	std::string name_;
+	float value_;
+};
+
+/**
+ * Everything declared in a scenario file, in the order it was read.
+ */
+struct Scenario
+{
+	std::vector<ScenarioBox> boxes_;
+	std::vector<ScenarioToy> toys_;
+	std::vector<ScenarioWaypoint> waypoints_;
+	std::vector<ScenarioChild> children_;
+	std::vector<ScenarioMapping> mappings_;
+	std::vector<ScenarioFunction> functions_;
+
+	/**
+	 * Forget everything that was read.
+	 */
+	void clear();
+};
+
+/**
+ * Reads the scenario files (boxes, toys, waypoints, children, ...) used by the different experiments. A file is
+ * parsed in full before anything is stored, so a malformed line is reported together with all other errors and
+ * with its line number. Lines are split in place; only the names and numbers that end up in the @ref{Scenario}
+ * are copied out of the file.
+ *
+ * The scenario is then stored in one go with @ref{store}: all knowledge is recorded in a single
+ * KnowledgeBase::Transaction, and the poses are only written to the message store by the caller once that
+ * transaction has been committed. A scenario can also be compiled into a
+ * ScenarioSnapshot with @ref{compile}, so it can be saved and restored later without parsing it again.
+ */
+class ScenarioLoader
+{
+public:
+
+	/**
+	 * A token of a line, it points into the text it was read from.
+	 */
+	struct Slice
+	{
+		Slice() : begin_(NULL), end_(NULL) { }
+		Slice(const char* begin, const char* end) : begin_(begin), end_(end) { }
+
+		size_t size() const { return end_ - begin_; }
+		bool empty() const { return begin_ == end_; }
+		std::string str() const { return std::string(begin_, end_); }
+
+		const char* begin_;
+		const char* end_;
+	};
+
+	/**
+	 * How a scenario is stored, the experiments differ in the predicates they use.
+	 */
+	struct StoreOptions
+	{
+		StoreOptions();
+
+		bool add_near_facts_;                           // Add (near near_BOX BOX_location) for every box (default true).
+		bool toys_as_scene_objects_;                    // Only store toys as scene objects in the message store (default false).
+		std::string mapping_predicate_;                 // The predicate of a toy to box mapping (default belongs_in).
+		KnowledgeBase::AddUpdateTarget mapping_target_; // Whether mappings are knowledge or goals (default knowledge).
+	};
+
+	/**
+	 * Read a scenario file.
+	 * @param file_name The path and file name of the scenario file.
+	 * @param scenario All correct lines are added to this scenario.
+	 * @param errors A description of every line that could not be read, including its line number.
+	 * @return True if the whole file was read without errors, false otherwise.
+	 */
+	static bool load(const std::string& file_name, Scenario& scenario, std::vector<std::string>& errors);
+
+	/**
+	 * Parse the text of a scenario file.
+	 * @param text The content of a scenario file.
+	 * @param scenario All correct lines are added to this scenario.
+	 * @param errors A description of every line that could not be read, including its line number.
+	 * @return True if the whole text was read without errors, false otherwise.
+	 */
+	static bool parse(const std::string& text, Scenario& scenario, std::vector<std::string>& errors);
+
+	/**
+	 * Convert a scenario into the knowledge and poses it puts in the knowledge base and the message store.
+	 * @param scenario The scenario.
+	 * @param snapshot Is replaced by the knowledge and poses of the scenario.
+	 * @param options How the scenario is stored.
+	 */
+	static void compile(const Scenario& scenario, ScenarioSnapshot& snapshot, const StoreOptions& options = StoreOptions());
+
+	/**
+	 * Record the knowledge of a scenario in @ref{transaction}. Nothing is sent to the knowledge base until the
+	 * transaction is committed and nothing is written to the message store; call ScenarioSnapshot::storePoses
+	 * on @ref{snapshot} after the commit succeeded, so a failed commit leaves no poses behind.
+	 * @param scenario The scenario.
+	 * @param transaction The transaction that records all knowledge of the scenario.
+	 * @param snapshot Is replaced by the knowledge and poses of the scenario.
+	 * @param options How the scenario is stored.
+	 */
+	static void store(const Scenario& scenario, KnowledgeBase::Transaction& transaction, ScenarioSnapshot& snapshot, const StoreOptions& options = StoreOptions());
+
+	/**
+	 * Split a line into tokens separated by white space. Text between parentheses is a single token, so
+	 * "(1, 2, 3)" is read as one pose.
+	 * @param begin The first character of the line.
+	 * @param end One past the last character of the line.
+	 * @param tokens All tokens are appended to this list.
+	 */
+	static void tokenise(const char* begin, const char* end, std::vector<Slice>& tokens);
+	static void tokenise(const std::string& line, std::vector<Slice>& tokens);
+
+	/**
+	 * Parse a position, the expected format is (f,f,f). Empty fields are skipped, so (1,2,,0) reads as (1,2,0).
+	 * @param token The token to parse.
+	 * @param pose The position of this pose is set, the orientation is the identity.
+	 * @return True if the token is a position, false otherwise.
+	 */
+	static bool parsePose(const Slice& token, geometry_msgs::Pose& pose);
+
+	/**
+	 * Parse a number.
+	 * @param token The token to parse.
+	 * @param value Is set to the number.
+	 * @return True if the whole token is a number, false otherwise.
+	 */
+	static bool parseFloat(const Slice& token, float& value);
+};
+
+};
+
+#endif
@@ -0,0 +1,106 @@
+#ifndef SQUIRREL_PLANNING_EXECUTION_SCENARIOSNAPSHOT_H
+#define SQUIRREL_PLANNING_EXECUTION_SCENARIOSNAPSHOT_H
+
+#include <string>
+#include <vector>
+
+#include <mongodb_store/message_store.h>
+#include <geometry_msgs/PoseStamped.h>
+#include <rosplan_knowledge_msgs/KnowledgeItem.h>
+#include <squirrel_object_perception_msgs/SceneObject.h>
+
+#include "squirrel_planning_execution/KnowledgeBase.h"
+
+namespace KCL_rosplan
+{
+
+/**
+ * Everything a scenario puts in the knowledge base and the message store: instances, facts, functions, goals
+ * and named poses. A snapshot is either compiled from a scenario file (see ScenarioLoader::compile) or dumped
+ * from a running knowledge base, and can be saved to a binary file. Restoring a snapshot does not parse
+ * anything, the old content of the knowledge base is replaced in a single KnowledgeBase::Transaction.
+ *
+ * The file holds the ROS serialisation of the messages, together with their md5sums. A snapshot is rejected
+ * if it was written with different message definitions, compile it again in that case.
+ */
+struct ScenarioSnapshot
+{
+	/**
+	 * A pose stored in the message store under its name.
+	 */
+	struct NamedPose
+	{
+		NamedPose() { }
+		NamedPose(const std::string& name, const geometry_msgs::PoseStamped& pose) : name_(name), pose_(pose) { }
+
+		std::string name_;
+		geometry_msgs::PoseStamped pose_;
+	};
+
+	std::vector<rosplan_knowledge_msgs::KnowledgeItem> knowledge_;           // Instances, facts and functions, an instance comes before the facts it is used in.
+	std::vector<rosplan_knowledge_msgs::KnowledgeItem> goals_;               // The goals.
+	std::vector<NamedPose> poses_;                                           // The poses of waypoints, boxes, ...
+	std::vector<squirrel_object_perception_msgs::SceneObject> scene_objects_; // Scene objects, stored under their id.
+
+	/**
+	 * Forget everything in this snapshot.
+	 */
+	void clear();
+
+	/**
+	 * Write this snapshot to a file.
+	 * @param file_name The path and file name of the snapshot.
+	 * @return True if the snapshot was written, false otherwise.
+	 */
+	bool save(const std::string& file_name) const;
+
+	/**
+	 * Read a snapshot from a file, this snapshot is cleared first.
+	 * @param file_name The path and file name of the snapshot.
+	 * @return True if the snapshot was read, false if the file could not be read or is not a valid snapshot.
+	 */
+	bool load(const std::string& file_name);
+
+	/**
+	 * @param file_name The path and file name of a file.
+	 * @return True if the file starts like a snapshot, false if it does not (e.g. it is a scenario file).
+	 */
+	static bool isSnapshot(const std::string& file_name);
+
+	/**
+	 * Record all knowledge of this snapshot in @ref{transaction}. Nothing is sent to the knowledge base until
+	 * the transaction is committed.
+	 * @param transaction The transaction that records all knowledge.
+	 */
+	void record(KnowledgeBase::Transaction& transaction) const;
+
+	/**
+	 * Write all poses and scene objects of this snapshot to the message store. Poses that are already in the
+	 * message store are overwritten.
+	 * @param message_store The message store the poses are written to.
+	 */
+	void storePoses(mongodb_store::MessageStoreProxy& message_store) const;
+
+	/**
+	 * Reset the knowledge base and the message store to this snapshot. All instances, facts, functions and
+	 * goals that are in the knowledge base are removed in the same transaction that adds the snapshot, the
+	 * poses are only written if the knowledge base accepted it.
+	 * @param knowledge_base The knowledge base.
+	 * @param message_store The message store the poses are written to.
+	 * @return True if the knowledge base was reset, false otherwise.
+	 */
+	bool restore(KnowledgeBase& knowledge_base, mongodb_store::MessageStoreProxy& message_store) const;
+
+	/**
+	 * Replace this snapshot with the current content of the knowledge base, the poses that are stored under
+	 * the name of an instance and all scene objects.
+	 * @param knowledge_base The knowledge base.
+	 * @param message_store The message store that holds the poses.
+	 * @return True if everything could be retreived, false otherwise.
+	 */
+	bool dump(KnowledgeBase& knowledge_base, mongodb_store::MessageStoreProxy& message_store);
+};
+
+};
+
+#endif
@@ -10,6 +10,8 @@
 #include <nav_msgs/OccupancyGrid.h>
 #include <occupancy_grid_utils/ray_tracer.h>
 #include <occupancy_grid_utils/coordinate_conversions.h>
+#include <boost/thread/mutex.hpp>
+#include <squirrel_planning_execution/VisibilityField.h>
 
 namespace KCL_rosplan {
 
@@ -49,6 +51,42 @@ namespace KCL_rosplan {
 		bool hasReceivedOccupancyGrid() const { return has_received_occupancy_grid_; }
 	private:
 		
+		/**
+		 * A randomly sampled view cone and the cells that can be seen from it.
+		 */
+		struct ViewConeCandidate
+		{
+			geometry_msgs::Point position;                          // The sampled position.
+			float yaw;                                              // The sampled viewing direction.
+			geometry_msgs::Pose pose;                               // The pose of the view cone, set when it is scored.
+			std::vector<occupancy_grid_utils::Cell> visible_cells;  // The unobserved cells that are visible, empty if the position is blocked.
+		};
+		
+		/**
+		 * Score candidates until none are left, multiple workers can run at the same time.
+		 * @param candidates The candidates to score.
+		 * @param next_candidate The index of the next candidate that is not taken by a worker.
+		 * @param next_candidate_mutex Guards @ref{next_candidate}.
+		 * @param processed_cells The cells that are already observed or occupied.
+		 * @param occupancy_threshold The threshold at which a point in the grid is considered occupied.
+		 * @param fov Field of view.
+		 * @param view_distance The maximum viewing distance (straight in front).
+		 * @param safe_distance Candidates within this distance of an obstacle are not scored.
+		 */
+		void scoreViewConesWorker(std::vector<ViewConeCandidate>& candidates, unsigned int& next_candidate, boost::mutex& next_candidate_mutex, const std::vector<bool>& processed_cells, int occupancy_threshold, float fov, float view_distance, float safe_distance) const;
+		
+		/**
+		 * Determine which unobserved cells are visible from a candidate.
+		 * @param candidate The candidate, its pose and visible cells are set.
+		 * @param visibility_field The visibility field of the calling thread, it is recomputed for the candidate.
+		 * @param processed_cells The cells that are already observed or occupied.
+		 * @param occupancy_threshold The threshold at which a point in the grid is considered occupied.
+		 * @param fov Field of view.
+		 * @param view_distance The maximum viewing distance (straight in front).
+		 * @param safe_distance Candidates within this distance of an obstacle are not scored.
+		 */
+		void scoreViewCone(ViewConeCandidate& candidate, VisibilityField& visibility_field, const std::vector<bool>& processed_cells, int occupancy_threshold, float fov, float view_distance, float safe_distance) const;
+		
 		/**
 		 * Publish the generated viewcones to RViz.
 		 * @param poses The found poses.
@@ -58,15 +96,32 @@ namespace KCL_rosplan {
 		void visualiseViewCones(const std::vector<geometry_msgs::Pose>& poses, float view_distance, float fov) const;
 		
 		/**
-		 * Check if two waypoints can be connected without colliding with any known scenery. The line is assumed
-		 * to have an effective width of 0.
-		 * @param w1 The first waypoint.
-		 * @param w2 The second waypoint.
-		 * @param occupancy_threshold The threshold at which a point in the grid is considered occupied. The
-		 * accepted range is [0,100].
-		 * @return True if the waypoints can be connected, false otherwise.
+		 * Rasterise a view cone onto the occupancy grid, the cost is linear in the number of cells covered.
+		 * @param view_point The position of the viewer, the apex of the triangle.
+		 * @param v1 The second corner of the triangle.
+		 * @param v2 The third corner of the triangle.
+		 * @param view_cell The cell of @ref{view_point}, it is always part of the view cone.
+		 * @param cells All cells whose centre lies inside the triangle are added to this list.
+		 */
+		void getViewConeCells(const tf::Vector3& view_point, const tf::Vector3& v1, const tf::Vector3& v2, const occupancy_grid_utils::Cell& view_cell, std::vector<occupancy_grid_utils::Cell>& cells) const;
+		
+		/**
+		 * Update the distance from every cell to the nearest obstacle after the cells in the columns
+		 * [@ref{min_x}, @ref{max_x}] changed. Only the rows whose distances are affected are processed again.
+		 * @param min_x The first column that changed.
+		 * @param max_x The last column that changed.
+		 */
+		void updateDistanceTransform(unsigned int min_x, unsigned int max_x);
+		
+		/**
+		 * One dimensional squared Euclidean distance transform, runs in linear time.
+		 * @param f The squared distance of every cell, 0 for obstacles and a large value for free cells.
+		 * @param n The number of cells.
+		 * @param d The squared distance of every cell to the nearest obstacle.
+		 * @param v Scratch space for @ref{n} elements.
+		 * @param z Scratch space for @ref{n} + 1 elements.
 		 */
-		bool canConnect(const geometry_msgs::Point& w1, const geometry_msgs::Point& w2, int occupancy_threshold);
+		void distanceTransform(const std::vector<float>& f, unsigned int n, std::vector<float>& d, std::vector<int>& v, std::vector<float>& z) const;
 		
 		/**
 		* Check if the area around @ref{point} is free, the radiance of the circle is @ref{min_distance}.
@@ -88,6 +143,10 @@ namespace KCL_rosplan {
 		ros::Subscriber navigation_grid_sub_;
 		nav_msgs::OccupancyGrid last_received_occupancy_grid_msgs_;
 		bool has_received_occupancy_grid_;
+		std::vector<float> column_distance_;    // The squared distance in cells to the nearest obstacle in the same column.
+		std::vector<float> obstacle_distance_;  // The squared distance in cells to the nearest obstacle.
+		unsigned int random_state_;             // The state of the random generator that samples the view cones.
+		unsigned int nr_threads_;               // The number of threads that score view cones.
 	};
 };
 
@@ -0,0 +1,84 @@
+#ifndef KCL_ROSPLAN_VISIBILITYFIELD_H
+#define KCL_ROSPLAN_VISIBILITYFIELD_H
+
+#include <vector>
+#include <cmath>
+#include <nav_msgs/OccupancyGrid.h>
+#include <geometry_msgs/Point.h>
+#include <occupancy_grid_utils/coordinate_conversions.h>
+
+namespace KCL_rosplan {
+
+	/**
+	 * Determines which cells of an occupancy grid can be seen from a single cell, using recursive shadowcasting.
+	 * A cell is visible if its centre is not in the shadow of an occupied cell, which is a slightly conservative
+	 * version of tracing a ray between the two cell centres. Computing the field is linear in the number of cells
+	 * it covers; afterwards every visibility query is a single lookup. An instance can be reused for many
+	 * viewpoints without reallocating, but it is not thread safe: use one instance per thread.
+	 */
+	class VisibilityField {
+	public:
+		/**
+		 * Constructor.
+		 */
+		VisibilityField();
+
+		/**
+		 * Compute which cells are visible from @ref{origin}. Occupied cells block the view but are visible
+		 * themselves; cells outside the grid are never visible.
+		 * @param grid The occupancy grid, it must outlive all queries on this field.
+		 * @param origin The cell of the viewer.
+		 * @param radius The maximum viewing distance in cells.
+		 * @param occupancy_threshold The threshold at which a point in the grid is considered occupied. The
+		 * accepted range is [0,100].
+		 * @param direction The viewing direction in radians, only used if @ref{fov} is smaller than 2 PI.
+		 * @param fov Field of view in radians, cells outside it are not guaranteed to be labelled.
+		 */
+		void compute(const nav_msgs::OccupancyGrid& grid, const occupancy_grid_utils::Cell& origin, unsigned int radius, int occupancy_threshold, float direction = 0.0f, float fov = 2 * M_PI);
+
+		/**
+		 * @param cell A cell of the grid.
+		 * @return True if @ref{cell} is visible from the origin of the last computed field, false otherwise.
+		 */
+		bool isVisible(const occupancy_grid_utils::Cell& cell) const;
+
+		/**
+		 * @param point A point in the frame of the grid.
+		 * @return True if the cell of @ref{point} is visible from the origin of the last computed field, false otherwise.
+		 */
+		bool isVisible(const geometry_msgs::Point& point) const;
+
+	private:
+
+		/**
+		 * Scan one octant row by row, starting a new scan whenever a blocking cell splits the view.
+		 * @param row The distance of the row from the origin.
+		 * @param start_slope The slope at which the scan starts.
+		 * @param end_slope The slope at which the scan ends.
+		 * @param xx Maps the column offset to the x offset in the grid.
+		 * @param xy Maps the row offset to the x offset in the grid.
+		 * @param yx Maps the column offset to the y offset in the grid.
+		 * @param yy Maps the row offset to the y offset in the grid.
+		 */
+		void castLight(int row, float start_slope, float end_slope, int xx, int xy, int yx, int yy);
+
+		/**
+		 * @return True if the cell (x, y) is outside the grid or occupied.
+		 */
+		bool isOpaque(int x, int y) const;
+
+		/**
+		 * @return The index of the cell (x, y) in the window around the origin, -1 if it is outside.
+		 */
+		int getWindowIndex(int x, int y) const;
+
+		const nav_msgs::OccupancyGrid* grid_;  // The grid of the last computed field.
+		occupancy_grid_utils::Cell origin_;    // The viewer of the last computed field.
+		int radius_;                           // The maximum viewing distance in cells.
+		int occupancy_threshold_;              // Cells above this value block the view.
+		std::vector<unsigned int> visible_;    // A cell is visible if its entry equals generation_.
+		unsigned int generation_;              // Incremented for every field, so visible_ never has to be cleared.
+	};
+};
+
+#endif
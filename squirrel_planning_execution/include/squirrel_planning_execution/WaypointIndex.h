@@ -0,0 +1,182 @@
+#ifndef SQUIRREL_PLANNING_EXECUTION_WAYPOINTINDEX_H
+#define SQUIRREL_PLANNING_EXECUTION_WAYPOINTINDEX_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <utility>
+#include <boost/thread/mutex.hpp>
+
+#include <ros/ros.h>
+#include <mongodb_store/message_store.h>
+#include <geometry_msgs/Point.h>
+#include <geometry_msgs/PoseStamped.h>
+#include <rosplan_knowledge_msgs/KnowledgeItem.h>
+#include <squirrel_object_perception_msgs/SceneObject.h>
+
+namespace KCL_rosplan
+{
+
+/**
+ * In memory index over the positions of the named poses (waypoints, boxes, objects, ...) stored in the message
+ * store, so the closest box or all objects around a waypoint can be found without querying the message store
+ * for every candidate. The positions are stored in a uniform grid on the x-y plane.
+ *
+ * Every pose is fetched from the message store at most once. Poses that are written through this index are
+ * stored in the message store and updated in the index at the same time; poses that are changed by other
+ * nodes are only seen after they have been removed from the index, either with @ref{remove} or because a
+ * change to the knowledge base named them (see @ref{watchKnowledgeBase}). Each pose belongs to a category
+ * (e.g. "box" or "object"), queries only return poses of the requested category.
+ */
+class WaypointIndex
+{
+public:
+
+	/**
+	 * Constructor.
+	 * @param message_store The message store that holds all named poses.
+	 * @param cell_size The size of the grid cells in meters.
+	 */
+	WaypointIndex(mongodb_store::MessageStoreProxy& message_store, float cell_size = 1.0f);
+
+	/**
+	 * Store a pose in the message store and add it to the index.
+	 * @param name The name of the pose.
+	 * @param pose The pose.
+	 * @param category The category of the pose.
+	 * @return The id of the pose in the message store.
+	 */
+	std::string insertNamed(const std::string& name, const geometry_msgs::PoseStamped& pose, const std::string& category);
+	std::string insertNamed(const std::string& name, const squirrel_object_perception_msgs::SceneObject& scene_object, const std::string& category);
+
+	/**
+	 * Update a pose in the message store and in the index.
+	 * @param name The name of the pose.
+	 * @param pose The new pose.
+	 * @param category The category of the pose.
+	 * @return True if the message store was updated, false otherwise.
+	 */
+	bool updateNamed(const std::string& name, const geometry_msgs::PoseStamped& pose, const std::string& category);
+	bool updateNamed(const std::string& name, const squirrel_object_perception_msgs::SceneObject& scene_object, const std::string& category);
+
+	/**
+	 * Make sure a pose stored in the message store is in the index, the message store is only queried if it
+	 * is not.
+	 * @param name The name of the pose, it is stored as a geometry_msgs::PoseStamped.
+	 * @param category The category of the pose.
+	 * @return True if the pose is in the index, false if it could not be found.
+	 */
+	bool loadPose(const std::string& name, const std::string& category);
+
+	/**
+	 * Make sure the pose of a scene object stored in the message store is in the index, the message store is
+	 * only queried if it is not.
+	 * @param name The name of the scene object.
+	 * @param category The category of the pose.
+	 * @return True if the pose is in the index, false if it could not be found.
+	 */
+	bool loadSceneObject(const std::string& name, const std::string& category);
+
+	/**
+	 * Remove the poses of a category from the index whenever a change to the knowledge base names them, so
+	 * they are fetched again from the message store the next time they are loaded.
+	 * @param node_handle The node handle used to subscribe to /kcl_rosplan/knowledge_base_changed.
+	 * @param category The category of the poses that are moved by other nodes (e.g. "object").
+	 */
+	void watchKnowledgeBase(ros::NodeHandle& node_handle, const std::string& category);
+
+	/**
+	 * Remove a pose from the index, the message store is not changed.
+	 * @param name The name of the pose.
+	 */
+	void remove(const std::string& name);
+
+	/**
+	 * Remove all poses from the index, the message store is not changed.
+	 */
+	void clear();
+
+	/**
+	 * @param name The name of the pose.
+	 * @param position Is set to the position of the pose.
+	 * @return True if the pose is in the index, false otherwise.
+	 */
+	bool getPosition(const std::string& name, geometry_msgs::Point& position) const;
+
+	/**
+	 * Find the poses closest to a position, only the x and y coordinates are considered.
+	 * @param position The position to search from.
+	 * @param k The maximum number of poses to find.
+	 * @param category Only poses of this category are considered.
+	 * @param names Is filled with the names of at most k poses, closest first.
+	 */
+	void findNearest(const geometry_msgs::Point& position, unsigned int k, const std::string& category, std::vector<std::string>& names) const;
+
+	/**
+	 * Find all poses within a radius of a position, only the x and y coordinates are considered.
+	 * @param position The position to search from.
+	 * @param radius The radius in meters.
+	 * @param category Only poses of this category are considered.
+	 * @param names Is filled with the names of the poses, closest first.
+	 */
+	void findWithinRadius(const geometry_msgs::Point& position, float radius, const std::string& category, std::vector<std::string>& names) const;
+
+private:
+
+	typedef std::pair<int, int> Cell;
+
+	/**
+	 * A pose in the index.
+	 */
+	struct Entry
+	{
+		geometry_msgs::Point position_;
+		std::string category_;
+		Cell cell_;
+	};
+
+	/**
+	 * Callback for the changes announced on /kcl_rosplan/knowledge_base_changed.
+	 */
+	void knowledgeChangedCallback(const rosplan_knowledge_msgs::KnowledgeItem::ConstPtr& msg);
+
+	/**
+	 * Remove a pose from the index if it belongs to the watched category, entries_mutex_ must be held.
+	 */
+	void eraseWatched(const std::string& name);
+
+	/**
+	 * Add or move a pose in the index, entries_mutex_ must be held.
+	 */
+	void set(const std::string& name, const geometry_msgs::Point& position, const std::string& category);
+
+	/**
+	 * Remove a pose from the index, entries_mutex_ must be held.
+	 */
+	void erase(const std::string& name);
+
+	/**
+	 * @return The cell that contains @ref{position}.
+	 */
+	Cell getCell(const geometry_msgs::Point& position) const;
+
+	/**
+	 * Add all poses of @ref{category} in @ref{cell} to @ref{candidates}, with their squared distance to @ref{position}.
+	 */
+	void addCandidates(const Cell& cell, const geometry_msgs::Point& position, const std::string& category, std::vector<std::pair<float, std::string> >& candidates) const;
+
+	mongodb_store::MessageStoreProxy* message_store_;       // The message store that holds all named poses.
+	float cell_size_;                                       // The size of the grid cells in meters.
+
+	std::map<std::string, Entry> entries_;                  // The poses, indexed by their name.
+	std::map<Cell, std::vector<std::string> > cells_;       // The names of the poses in each non empty cell.
+	Cell min_cell_, max_cell_;                              // All non empty cells are within these bounds.
+	mutable boost::mutex entries_mutex_;                    // Guards entries_, cells_, min_cell_, max_cell_ and watched_category_.
+
+	ros::Subscriber knowledge_changed_sub_;                 // Listens to the changes made to the knowledge base.
+	std::string watched_category_;                          // The category of the poses that are removed when the knowledge base names them.
+};
+
+};
+
+#endif
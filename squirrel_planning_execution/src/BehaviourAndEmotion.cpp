@@ -9,6 +9,8 @@
 #include <tf/tf.h>
 #include <squirrel_vad_msgs/vad.h>
 #include "squirrel_planning_execution/BehaviourAndEmotion.h"
+#include "squirrel_planning_execution/KnowledgeBase.h"
+#include "squirrel_planning_execution/ScenarioLoader.h"
 #include "pddl_actions/ShedKnowledgePDDLAction.h"
 #include "pddl_actions/FinaliseClassificationPDDLAction.h"
 #include "pddl_actions/PlannerInstance.h"
@@ -66,520 +68,76 @@ namespace KCL_rosplan {
 		vis_pub.publish( marker );
 	}
 	
-	void BehaviourAndEmotion::tokenise(const std::string& s, std::vector<std::string>& tokens)
-	{
-		size_t current;
-		size_t next = -1;
-
-		do
-		{
-			current = next + 1;
-			next = s.find_first_of(" ", current);
-			tokens.push_back(s.substr(current, next - current));
-		} 
-		while (next != std::string::npos);
-	}
-
-	
 	void BehaviourAndEmotion::setupSimulation(const std::string& config_file)
 	{
 		ROS_INFO("KCL: (BehaviourAndEmotion) Load scenarion from file: %s.\n", config_file.c_str());
-		std::ifstream f(config_file.c_str());
-		std::string line;
-
-		rosplan_knowledge_msgs::KnowledgeUpdateService knowledge_update_service;
-
-		if (f.is_open())
+		
+		// The whole file is validated before anything is stored.
+		Scenario scenario;
+		std::vector<std::string> errors;
+		if (!ScenarioLoader::load(config_file, scenario, errors))
 		{
-			while (getline(f, line))
+			for (std::vector<std::string>::const_iterator ci = errors.begin(); ci != errors.end(); ++ci)
 			{
-
-				std::cout << line << std::endl;
-				if (line.size() == 0) continue;
-
-				std::vector<std::string> tokens;
-				tokenise(line, tokens);
-
-				// Boxes.
-				if (line[0] == 'b')
-				{
-					if (tokens.size() != 4)
-					{
-						ROS_ERROR("KCL (BehaviourAndEmotion) Malformed line, expected b BOX_NAME (f,f,f) (f,f,f). Read %s\n", line.c_str());
-						exit(0);
-					}
-					
-					knowledge_update_service.request.update_type = rosplan_knowledge_msgs::KnowledgeUpdateService::Request::ADD_KNOWLEDGE;
-					
-					std::string box_predicate = tokens[1];
-					geometry_msgs::Pose box_location = transformToPose(tokens[2]);
-					geometry_msgs::Pose near_box = transformToPose(tokens[3]);
-					sendMarker(box_location, box_predicate, 0.25f);
-					{
-						std::stringstream ss;
-						ss << "near_" << box_predicate;
-						sendMarker(near_box, ss.str(), 0.1f);
-					}
-					
-					// Add the box predicate to the knowledge base.
-					rosplan_knowledge_msgs::KnowledgeItem knowledge_item;
-					
-					knowledge_item.instance_type = "box";
-					knowledge_item.instance_name = box_predicate;
-					
-					knowledge_update_service.request.knowledge = knowledge_item;knowledge_item.knowledge_type = rosplan_knowledge_msgs::KnowledgeItem::INSTANCE;
-					if (!update_knowledge_client.call(knowledge_update_service)) {
-						ROS_ERROR("KCL: (BehaviourAndEmotion) Could not add the box %s to the knowledge base.", box_predicate.c_str());
-						exit(-1);
-					}
-					ROS_INFO("KCL: (BehaviourAndEmotion) Added %s to the knowledge base.", box_predicate.c_str());
-
-					// Add waypoints for these boxes.
-					knowledge_item.instance_type = "waypoint";
-					std::stringstream ss;
-					ss << box_predicate << "_location";
-					knowledge_item.instance_name = ss.str();
-					
-					knowledge_update_service.request.knowledge = knowledge_item;
-					if (!update_knowledge_client.call(knowledge_update_service)) {
-						ROS_ERROR("KCL: (BehaviourAndEmotion) Could not add the waypoint %s to the knowledge base.", ss.str().c_str());
-						exit(-1);
-					}
-					ROS_INFO("KCL: (BehaviourAndEmotion) Added %s to the knowledge base.", ss.str().c_str());
-
-					// Set the actual location of the box waypoints in message store.
-					{
-					geometry_msgs::PoseStamped pose;
-					pose.header.seq = 0;
-					pose.header.stamp = ros::Time::now();
-					pose.header.frame_id = "/map";
-					pose.pose = box_location;
-					
-					pose.pose.orientation.x = 0.0f;
-					pose.pose.orientation.y = 0.0f;
-					pose.pose.orientation.z = 0.0f;
-					pose.pose.orientation.w = 1.0f;
-					std::string near_waypoint_mongodb_id3(message_store.insertNamed(ss.str(), pose));
-					ROS_INFO("KCL: (BehaviourAndEmotion) Added %s to the knowledge base.", ss.str().c_str());
-					}
-					
-					// Link the boxes to these waypoints.
-					knowledge_item.knowledge_type = rosplan_knowledge_msgs::KnowledgeItem::FACT;
-					knowledge_item.attribute_name = "box_at";
-					knowledge_item.is_negative = false;
-					
-					diagnostic_msgs::KeyValue kv;
-					kv.key = "b";
-					kv.value = box_predicate;
-					knowledge_item.values.push_back(kv);
-					
-					kv.key = "wp";
-					kv.value = ss.str();
-					knowledge_item.values.push_back(kv);
-					
-					knowledge_update_service.request.knowledge = knowledge_item;
-					if (!update_knowledge_client.call(knowledge_update_service)) {
-						ROS_ERROR("KCL: (BehaviourAndEmotion) Could not add the fact (box_at %s %s) to the knowledge base.", box_predicate.c_str(), ss.str().c_str());
-						exit(-1);
-					}
-					ROS_INFO("KCL: (BehaviourAndEmotion) Added the fact (box_at %s %s) to the knowledge base.", box_predicate.c_str(), ss.str().c_str());
-					knowledge_item.values.clear();
-					
-					knowledge_item.knowledge_type = rosplan_knowledge_msgs::KnowledgeItem::INSTANCE;
-					knowledge_item.instance_type = "waypoint";
-					ss.str(std::string());
-					ss << "near_" << box_predicate;
-					knowledge_item.instance_name = ss.str();
-					
-					knowledge_update_service.request.knowledge = knowledge_item;
-					if (!update_knowledge_client.call(knowledge_update_service)) {
-						ROS_ERROR("KCL: (BehaviourAndEmotion) Could not add the waypoint %s to the knowledge base.", ss.str().c_str());
-						exit(-1);
-					}
-					{
-					geometry_msgs::PoseStamped pose;
-					pose.header.seq = 0;
-					pose.header.stamp = ros::Time::now();
-					pose.header.frame_id = "/map";
-					pose.pose = near_box;
-					
-					float angle = atan2(box_location.position.y - near_box.position.y, box_location.position.x - near_box.position.x);
-					pose.pose.orientation = tf::createQuaternionMsgFromYaw(angle);
-					std::string near_waypoint_mongodb_id3(message_store.insertNamed(ss.str(), pose));
-					ROS_INFO("KCL: (BehaviourAndEmotion) Added %s to the knowledge base.", ss.str().c_str());
-					}
-				}
-				// toys.
-				else if (line[0] == 't')
-				{
-					if (tokens.size() != 4)
-					{
-						ROS_ERROR("KCL (BehaviourAndEmotion) Malformed line, expected t OBJECT_NAME (f,f,f) (f,f,f). Read %s\n", line.c_str());
-						exit(0);
-					}
-					
-					knowledge_update_service.request.update_type = rosplan_knowledge_msgs::KnowledgeUpdateService::Request::ADD_KNOWLEDGE;
-					
-					std::string toy_predicate = tokens[1];
-					geometry_msgs::Pose toy_location = transformToPose(tokens[2]);
-					geometry_msgs::Pose near_toy = transformToPose(tokens[3]);
-					sendMarker(toy_location, toy_predicate, 0.25f);
-					{
-						std::stringstream ss;
-						ss << "near_" << toy_predicate;
-						sendMarker(near_toy, ss.str(), 0.1f);
-					}
-					
-					// Add the box predicate to the knowledge base.
-					rosplan_knowledge_msgs::KnowledgeItem knowledge_item;
-					
-					knowledge_item.instance_type = "object";
-					knowledge_item.instance_name = toy_predicate;
-					
-					knowledge_update_service.request.knowledge = knowledge_item;
-					if (!update_knowledge_client.call(knowledge_update_service)) {
-						ROS_ERROR("KCL: (BehaviourAndEmotion) Could not add the object %s to the knowledge base.", toy_predicate.c_str());
-						exit(-1);
-					}
-					ROS_INFO("KCL: (BehaviourAndEmotion) Added %s to the knowledge base.", toy_predicate.c_str());
-
-					// Add waypoints for these boxes.
-					knowledge_item.instance_type = "waypoint";
-					std::stringstream ss;
-					ss << toy_predicate << "_location";
-					knowledge_item.instance_name = ss.str();
-					
-					knowledge_update_service.request.knowledge = knowledge_item;
-					if (!update_knowledge_client.call(knowledge_update_service)) {
-						ROS_ERROR("KCL: (BehaviourAndEmotion) Could not add the waypoint %s to the knowledge base.", ss.str().c_str());
-						exit(-1);
-					}
-					ROS_INFO("KCL: (BehaviourAndEmotion) Added %s to the knowledge base.", ss.str().c_str());
-
-					// Set the actual location of the toy waypoints in message store.
-					{
-					geometry_msgs::PoseStamped pose;
-					pose.header.seq = 0;
-					pose.header.stamp = ros::Time::now();
-					pose.header.frame_id = "/map";
-					pose.pose = toy_location;
-					
-					pose.pose.orientation.x = 0.0f;
-					pose.pose.orientation.y = 0.0f;
-					pose.pose.orientation.z = 0.0f;
-					pose.pose.orientation.w = 1.0f;
-					std::string near_waypoint_mongodb_id3(message_store.insertNamed(ss.str(), pose));
-					ROS_INFO("KCL: (BehaviourAndEmotion) Added %s to the knowledge base.", ss.str().c_str());
-					}
-					
-					// Link the boxes to these waypoints.
-					knowledge_item.knowledge_type = rosplan_knowledge_msgs::KnowledgeItem::FACT;
-					knowledge_item.attribute_name = "object_at";
-					knowledge_item.is_negative = false;
-					
-					diagnostic_msgs::KeyValue kv;
-					kv.key = "o";
-					kv.value = toy_predicate;
-					knowledge_item.values.push_back(kv);
-					
-					kv.key = "wp";
-					kv.value = ss.str();
-					knowledge_item.values.push_back(kv);
-					
-					knowledge_update_service.request.knowledge = knowledge_item;
-					if (!update_knowledge_client.call(knowledge_update_service)) {
-						ROS_ERROR("KCL: (BehaviourAndEmotion) Could not add the fact (object_at %s %s) to the knowledge base.", toy_predicate.c_str(), ss.str().c_str());
-						exit(-1);
-					}
-					ROS_INFO("KCL: (BehaviourAndEmotion) Added the fact (object_at %s %s) to the knowledge base.", toy_predicate.c_str(), ss.str().c_str());
-					knowledge_item.values.clear();
-					
-					knowledge_item.knowledge_type = rosplan_knowledge_msgs::KnowledgeItem::INSTANCE;
-					knowledge_item.instance_type = "waypoint";
-					ss.str(std::string());
-					ss << "near_" << toy_predicate;
-					knowledge_item.instance_name = ss.str();
-					
-					knowledge_update_service.request.knowledge = knowledge_item;
-					if (!update_knowledge_client.call(knowledge_update_service)) {
-						ROS_ERROR("KCL: (BehaviourAndEmotion) Could not add the waypoint %s to the knowledge base.", ss.str().c_str());
-						exit(-1);
-					}
-					{
-					geometry_msgs::PoseStamped pose;
-					pose.header.seq = 0;
-					pose.header.stamp = ros::Time::now();
-					pose.header.frame_id = "/map";
-					pose.pose = near_toy;
-					
-					float angle = atan2(toy_location.position.y - near_toy.position.y, toy_location.position.x - near_toy.position.x);
-					pose.pose.orientation = tf::createQuaternionMsgFromYaw(angle);
-					std::string near_waypoint_mongodb_id3(message_store.insertNamed(ss.str(), pose));
-					ROS_INFO("KCL: (BehaviourAndEmotion) Added %s to the knowledge base.", ss.str().c_str());
-					}
-				}
-				// Waypoints
-				else if (line[0] == 'w')
-				{
-					if (tokens.size() != 3)
-					{
-						ROS_ERROR("KCL (BehaviourAndEmotion) Malformed line, expected w WAYPOINT_NAME (f,f,f). Read %s\n", line.c_str());
-						exit(0);
-					}
-					
-					knowledge_update_service.request.update_type = rosplan_knowledge_msgs::KnowledgeUpdateService::Request::ADD_KNOWLEDGE;
-					
-					std::string wp_predicate = tokens[1];
-					geometry_msgs::Pose wp_location = transformToPose(tokens[2]);
-					sendMarker(wp_location, wp_predicate, 0.25f);
-					
-					// Add the toy predicate to the knowledge base.
-					rosplan_knowledge_msgs::KnowledgeItem knowledge_item;
-					
-					knowledge_item.instance_type = "waypoint";
-					knowledge_item.instance_name = wp_predicate;
-					
-					knowledge_update_service.request.knowledge = knowledge_item;
-					knowledge_item.knowledge_type = rosplan_knowledge_msgs::KnowledgeItem::INSTANCE;
-					if (!update_knowledge_client.call(knowledge_update_service)) {
-						ROS_ERROR("KCL: (BehaviourAndEmotion) Could not add the waypoint %s to the knowledge base.", wp_predicate.c_str());
-						exit(-1);
-					}
-					ROS_INFO("KCL: (BehaviourAndEmotion) Added %s to the knowledge base.", wp_predicate.c_str());
-
-					// Set the actual location of the toy waypoints in message store.
-					{
-					geometry_msgs::PoseStamped pose;
-					pose.header.seq = 0;
-					pose.header.stamp = ros::Time::now();
-					pose.header.frame_id = "/map";
-					pose.pose = wp_location;
-					
-					pose.pose.orientation.x = 0.0f;
-					pose.pose.orientation.y = 0.0f;
-					pose.pose.orientation.z = 0.0f;
-					pose.pose.orientation.w = 1.0f;
-					std::string near_waypoint_mongodb_id3(message_store.insertNamed(wp_predicate, pose));
-					ROS_INFO("KCL: (BehaviourAndEmotion) Added %s to the knowledge base.", wp_predicate.c_str());
-					}
-				}
-				// child predicates
-				else if (line[0] == 'c')
-				{
-					if (tokens.size() != 6)
-					{
-						ROS_ERROR("KCL (BehaviourAndEmotion) Malformed line, expected c CHILD_NAME P A D R. Read %s\n", line.c_str());
-						exit(0);
-					}
-					
-					knowledge_update_service.request.update_type = rosplan_knowledge_msgs::KnowledgeUpdateService::Request::ADD_KNOWLEDGE;
-					
-					std::string child_predicate = tokens[1];
-					float pleasure = ::atof(tokens[2].c_str());
-					float arousal = ::atof(tokens[3].c_str());
-					float dominance = ::atof(tokens[4].c_str());
-					float reciprocity = ::atof(tokens[5].c_str());
-					
-					// Add the toy predicate to the knowledge base.
-					rosplan_knowledge_msgs::KnowledgeItem knowledge_item;
-					
-					knowledge_item.instance_type = "child";
-					knowledge_item.instance_name = child_predicate;
-					
-					knowledge_update_service.request.knowledge = knowledge_item;
-					knowledge_item.knowledge_type = rosplan_knowledge_msgs::KnowledgeItem::INSTANCE;
-					if (!update_knowledge_client.call(knowledge_update_service)) {
-						ROS_ERROR("KCL: (BehaviourAndEmotion) Could not add the child %s to the knowledge base.", child_predicate.c_str());
-						exit(-1);
-					}
-					ROS_INFO("KCL: (BehaviourAndEmotion) Added %s to the knowledge base.", child_predicate.c_str());
-					
-					// Setup the functions.
-					diagnostic_msgs::KeyValue kv;
-					kv.key = "c";
-					kv.value = child_predicate;
-					knowledge_item.values.push_back(kv);
-					
-					// Pleasure.
-					knowledge_item.knowledge_type = rosplan_knowledge_msgs::KnowledgeItem::FUNCTION;
-					knowledge_item.attribute_name = "pleasure";
-					knowledge_item.function_value = pleasure;
-					
-					knowledge_update_service.request.knowledge = knowledge_item;
-					if (!update_knowledge_client.call(knowledge_update_service)) {
-						ROS_ERROR("KCL: (BehaviourAndEmotion) Could not add the function (pleasure %s) to the knowledge base.", child_predicate.c_str());
-						exit(-1);
-					}
-					ROS_INFO("KCL: (BehaviourAndEmotion) Added (pleasure %s) to the knowledge base.", child_predicate.c_str());
-					
-					// Arousal.
-					knowledge_item.knowledge_type = rosplan_knowledge_msgs::KnowledgeItem::FUNCTION;
-					knowledge_item.attribute_name = "arousal";
-					knowledge_item.function_value = arousal;
-					
-					knowledge_update_service.request.knowledge = knowledge_item;
-					if (!update_knowledge_client.call(knowledge_update_service)) {
-						ROS_ERROR("KCL: (BehaviourAndEmotion) Could not add the function (arousal %s) to the knowledge base.", child_predicate.c_str());
-						exit(-1);
-					}
-					ROS_INFO("KCL: (BehaviourAndEmotion) Added (arousal %s) to the knowledge base.", child_predicate.c_str());
-					
-					// Domain.
-					knowledge_item.knowledge_type = rosplan_knowledge_msgs::KnowledgeItem::FUNCTION;
-					knowledge_item.attribute_name = "dominance";
-					knowledge_item.function_value = dominance;
-					
-					knowledge_update_service.request.knowledge = knowledge_item;
-					if (!update_knowledge_client.call(knowledge_update_service)) {
-						ROS_ERROR("KCL: (BehaviourAndEmotion) Could not add the function (dominance %s) to the knowledge base.", child_predicate.c_str());
-						exit(-1);
-					}
-					ROS_INFO("KCL: (BehaviourAndEmotion) Added (dominance %s) to the knowledge base.", child_predicate.c_str());
-					
-					// Reciprocal.
-					knowledge_item.knowledge_type = rosplan_knowledge_msgs::KnowledgeItem::FUNCTION;
-					knowledge_item.attribute_name = "reciprocal";
-					knowledge_item.function_value = reciprocity;
-					
-					knowledge_update_service.request.knowledge = knowledge_item;
-					if (!update_knowledge_client.call(knowledge_update_service)) {
-						ROS_ERROR("KCL: (BehaviourAndEmotion) Could not add the function (reciprocal %s) to the knowledge base.", child_predicate.c_str());
-						exit(-1);
-					}
-					ROS_INFO("KCL: (BehaviourAndEmotion) Added (reciprocal %s) to the knowledge base.", child_predicate.c_str());
-				}
-				// belongs_in predicates
-				else if (line[0] == 'm')
-				{
-					if (tokens.size() != 3)
-					{
-						ROS_ERROR("KCL (BehaviourAndEmotion) Malformed line, expected m OBJECT_ID BOX_NAME. Read %s\n", line.c_str());
-						exit(0);
-					}
-					
-					knowledge_update_service.request.update_type = rosplan_knowledge_msgs::KnowledgeUpdateService::Request::ADD_GOAL;
-					
-					std::string object_id = tokens[1];
-					std::string box_name = tokens[2];
-					
-					rosplan_knowledge_msgs::KnowledgeItem knowledge_item;
-					knowledge_item.knowledge_type = rosplan_knowledge_msgs::KnowledgeItem::FACT;
-					knowledge_item.attribute_name = "in_box";
-					knowledge_item.is_negative = false;
-					
-					diagnostic_msgs::KeyValue kv;
-					kv.key = "b";
-					kv.value = box_name;
-					knowledge_item.values.push_back(kv);
-					
-					kv.key = "o";
-					kv.value = object_id;
-					knowledge_item.values.push_back(kv);
-					
-					knowledge_update_service.request.knowledge = knowledge_item;
-					if (!update_knowledge_client.call(knowledge_update_service)) {
-						ROS_ERROR("KCL: (BehaviourAndEmotion) Could not add the goal (in_box %s %s) to the knowledge base.", knowledge_item.values[0].value.c_str(),  object_id.c_str());
-						exit(-1);
-					}
-					ROS_INFO("KCL: (BehaviourAndEmotion) Added the goal (in_box %s %s) to the knowledge base.", knowledge_item.values[0].value.c_str(),  object_id.c_str());
-				}
+				ROS_ERROR("KCL (BehaviourAndEmotion) %s\n", ci->c_str());
 			}
+			exit(0);
 		}
-
-		// Set kenny at it's starting waypoint.
+		
+		for (std::vector<ScenarioBox>::const_iterator ci = scenario.boxes_.begin(); ci != scenario.boxes_.end(); ++ci)
 		{
-			rosplan_knowledge_msgs::KnowledgeItem knowledge_item;
-			knowledge_item.knowledge_type = rosplan_knowledge_msgs::KnowledgeItem::INSTANCE;
-			knowledge_item.instance_type = "robot";
-			knowledge_item.instance_name = "robot";
-			
-			knowledge_update_service.request.update_type = rosplan_knowledge_msgs::KnowledgeUpdateService::Request::ADD_KNOWLEDGE;
-			
-			knowledge_update_service.request.knowledge = knowledge_item;
-			if (!update_knowledge_client.call(knowledge_update_service)) {
-				ROS_ERROR("KCL: (BehaviourAndEmotion) Could not add the robot robot to the knowledge base.");
-				exit(-1);
-			}
-			ROS_INFO("KCL: (BehaviourAndEmotion) Added robot to the knowledge base.");
+			sendMarker(ci->location_, ci->name_, 0.25f);
+			sendMarker(ci->near_, "near_" + ci->name_, 0.1f);
 		}
+		for (std::vector<ScenarioToy>::const_iterator ci = scenario.toys_.begin(); ci != scenario.toys_.end(); ++ci)
 		{
-		rosplan_knowledge_msgs::KnowledgeItem knowledge_item;
-		knowledge_item.knowledge_type = rosplan_knowledge_msgs::KnowledgeItem::FACT;
-		knowledge_item.attribute_name = "robot_at";
-		knowledge_item.is_negative = false;
+			if (ci->has_location_) sendMarker(ci->location_, ci->name_, 0.25f);
+			if (ci->has_near_) sendMarker(ci->near_, "near_" + ci->name_, 0.1f);
+		}
+		for (std::vector<ScenarioWaypoint>::const_iterator ci = scenario.waypoints_.begin(); ci != scenario.waypoints_.end(); ++ci)
+		{
+			sendMarker(ci->location_, ci->name_, 0.25f);
+		}
 		
-		diagnostic_msgs::KeyValue kv;
-		kv.key = "v";
-		kv.value = "robot";
-		knowledge_item.values.push_back(kv);
+		// The toys have to be put in their boxes, these are goals.
+		ScenarioLoader::StoreOptions options;
+		options.add_near_facts_ = false;
+		options.mapping_predicate_ = "in_box";
+		options.mapping_target_ = KnowledgeBase::KB_ADD_GOAL;
 		
-		kv.key = "wp";
-		kv.value = "kenny_waypoint";
-		knowledge_item.values.push_back(kv);
+		KnowledgeBase knowledge_base(*node_handle, message_store);
+		KnowledgeBase::Transaction transaction(knowledge_base);
+		ScenarioSnapshot snapshot;
+		ScenarioLoader::store(scenario, transaction, snapshot, options);
 		
-		knowledge_update_service.request.update_type = rosplan_knowledge_msgs::KnowledgeUpdateService::Request::ADD_KNOWLEDGE;
-		knowledge_update_service.request.knowledge = knowledge_item;
-		if (!update_knowledge_client.call(knowledge_update_service)) {
-			ROS_ERROR("KCL: (BehaviourAndEmotion) Could not add the fact (robot_at robot kenny_waypoint) to the knowledge base.");
-			exit(-1);
-		}
-		ROS_INFO("KCL: (BehaviourAndEmotion) Added the fact (robot_at robot kenny_waypoint) to the knowledge base.");
-		}
+		// Set kenny at it's starting waypoint.
+		transaction.addInstance("robot", "robot");
+		
+		std::map<std::string, std::string> parameters;
+		parameters["v"] = "robot";
+		parameters["wp"] = "kenny_waypoint";
+		transaction.addFact("robot_at", parameters, true, KnowledgeBase::KB_ADD_KNOWLEDGE);
 		
 		// Add a dummy type -- just necessary to keep it consistent with previous domains.
-		{
-			rosplan_knowledge_msgs::KnowledgeItem knowledge_item;
-			knowledge_item.knowledge_type = rosplan_knowledge_msgs::KnowledgeItem::INSTANCE;
-			knowledge_item.instance_type = "type";
-			knowledge_item.instance_name = "dummy";
-			
-			knowledge_update_service.request.update_type = rosplan_knowledge_msgs::KnowledgeUpdateService::Request::ADD_KNOWLEDGE;
-			
-			knowledge_update_service.request.knowledge = knowledge_item;
-			if (!update_knowledge_client.call(knowledge_update_service)) {
-				ROS_ERROR("KCL: (BehaviourAndEmotion) Could not add the type dummy to the knowledge base.");
-				exit(-1);
-			}
-			ROS_INFO("KCL: (BehaviourAndEmotion) Added dummy to the knowledge base.");
-		}
+		transaction.addInstance("type", "dummy");
 		
 		// Robot is not busy initially.
-		{
-		rosplan_knowledge_msgs::KnowledgeItem knowledge_item;
-		knowledge_item.knowledge_type = rosplan_knowledge_msgs::KnowledgeItem::FACT;
-		knowledge_item.attribute_name = "not_busy";
-		knowledge_item.is_negative = false;
-		
-		knowledge_update_service.request.update_type = rosplan_knowledge_msgs::KnowledgeUpdateService::Request::ADD_KNOWLEDGE;
-		knowledge_update_service.request.knowledge = knowledge_item;
-		if (!update_knowledge_client.call(knowledge_update_service)) {
-			ROS_ERROR("KCL: (BehaviourAndEmotion) Could not add the fact (not_busy) to the knowledge base.");
-			exit(-1);
-		}
-		ROS_INFO("KCL: (BehaviourAndEmotion) Added the fact (not_busy) to the knowledge base.");
-		}
+		parameters.clear();
+		transaction.addFact("not_busy", parameters, true, KnowledgeBase::KB_ADD_KNOWLEDGE);
 		
 		// Gripper is empty.
-		{
-		rosplan_knowledge_msgs::KnowledgeItem knowledge_item;
-		knowledge_item.knowledge_type = rosplan_knowledge_msgs::KnowledgeItem::FACT;
-		knowledge_item.attribute_name = "gripper_empty";
-		knowledge_item.is_negative = false;
-		
-		diagnostic_msgs::KeyValue kv;
-		kv.key = "v";
-		kv.value = "robot";
-		knowledge_item.values.push_back(kv);
+		parameters["v"] = "robot";
+		transaction.addFact("gripper_empty", parameters, true, KnowledgeBase::KB_ADD_KNOWLEDGE);
 		
-		knowledge_update_service.request.update_type = rosplan_knowledge_msgs::KnowledgeUpdateService::Request::ADD_KNOWLEDGE;
-		knowledge_update_service.request.knowledge = knowledge_item;
-		if (!update_knowledge_client.call(knowledge_update_service)) {
-			ROS_ERROR("KCL: (BehaviourAndEmotion) Could not add the fact (gripper_empty robot) to the knowledge base.");
+		if (!transaction.commit())
+		{
+			ROS_ERROR("KCL: (BehaviourAndEmotion) Could not add the scenario to the knowledge base.");
 			exit(-1);
 		}
-		ROS_INFO("KCL: (BehaviourAndEmotion) Added the fact (gripper_empty robot) to the knowledge base.");
-		}
-		f.close();
+		ROS_INFO("KCL: (BehaviourAndEmotion) Added the scenario to the knowledge base.");
+		
+		// Only now that the knowledge is in, the poses it refers to are written.
+		snapshot.storePoses(message_store);
 		
 		// Set the initial arrousal level.
 		squirrel_vad_msgs::vad vad;
@@ -590,21 +148,6 @@ namespace KCL_rosplan {
 		vad.duration = 10.0;
 		message_store.insertNamed<squirrel_vad_msgs::vad>("vad", vad);
 	}
-	
-	// Expect s to be "(f,f,f)"
-	geometry_msgs::Pose BehaviourAndEmotion::transformToPose(const std::string& s)
-	{
-		std::cout << "Tranform to pose: " << s << std::endl;
-		geometry_msgs::Pose p;
-		int first_break = s.find(',');
-		int second_break = s.find(',', first_break + 1);
-
-		p.position.x = ::atof(s.substr(1, first_break - 1).c_str());
-		p.position.y = ::atof(s.substr(first_break + 1, second_break - (first_break + 1)).c_str());
-		p.position.z = ::atof(s.substr(second_break + 1, s.size() - (second_break + 2)).c_str());
-
-		return p;
-	}
 } // close namespace
 
 	/*-------------*/
@@ -0,0 +1,116 @@
+#include <sstream>
+
+#include "squirrel_planning_execution/BeliefEncoding.h"
+
+namespace KCL_rosplan {
+
+bool parseBeliefEncoding(const std::string& name, BeliefEncoding& encoding)
+{
+	if (name == "expanded")
+	{
+		encoding = EXPANDED_BELIEF_ENCODING;
+		return true;
+	}
+	if (name == "lifted")
+	{
+		encoding = LIFTED_BELIEF_ENCODING;
+		return true;
+	}
+	return false;
+}
+
+StateFact::StateFact(const std::string& name, const std::string& parameters)
+	: name_(name), parameters_(parameters)
+{
+	// Strip the types, only the variables remain.
+	std::istringstream iss(parameters);
+	std::string token;
+	while (iss >> token)
+	{
+		if (token[0] != '?') continue;
+		if (!arguments_.empty()) arguments_ += " ";
+		arguments_ += token;
+	}
+}
+
+void writeLiftedAssumeKnowledgeEffects(std::ostream& writer, const std::vector<StateFact>& facts)
+{
+	writer << "\t\t;; Activate the states of ?new_kb and deactivate all others." << std::endl;
+	writer << "\t\t(forall (?s - state)" << std::endl;
+	writer << "\t\t\t(when (and (m ?s) (not (part-of ?s ?new_kb)))" << std::endl;
+	writer << "\t\t\t\t(not (m ?s))" << std::endl;
+	writer << "\t\t\t)" << std::endl;
+	writer << "\t\t)" << std::endl;
+	writer << "\t\t(forall (?s - state)" << std::endl;
+	writer << "\t\t\t(when (part-of ?s ?new_kb)" << std::endl;
+	writer << "\t\t\t\t(m ?s)" << std::endl;
+	writer << "\t\t\t)" << std::endl;
+	writer << "\t\t)" << std::endl;
+
+	writer << "\t\t;; Move all knowledge from the states ?s of ?old_kb to the states ?s2 of ?new_kb." << std::endl;
+	for (std::vector<StateFact>::const_iterator ci = facts.begin(); ci != facts.end(); ++ci)
+	{
+		const StateFact& fact = *ci;
+		writer << "\t\t(forall (?s ?s2 - state " << fact.parameters_ << ")" << std::endl;
+		writer << "\t\t\t(when (and (part-of ?s ?old_kb) (" << fact.name_ << " " << fact.arguments_ << " ?s) (part-of ?s2 ?new_kb))" << std::endl;
+		writer << "\t\t\t\t(and" << std::endl;
+		writer << "\t\t\t\t\t(not (R" << fact.name_ << " " << fact.arguments_ << " ?s))" << std::endl;
+		writer << "\t\t\t\t\t(not (" << fact.name_ << " " << fact.arguments_ << " ?s))" << std::endl;
+		writer << "\t\t\t\t\t(R" << fact.name_ << " " << fact.arguments_ << " ?s2)" << std::endl;
+		writer << "\t\t\t\t\t(" << fact.name_ << " " << fact.arguments_ << " ?s2)" << std::endl;
+		writer << "\t\t\t\t)" << std::endl;
+		writer << "\t\t\t)" << std::endl;
+		writer << "\t\t)" << std::endl;
+	}
+}
+
+void writeLiftedShedKnowledgePreconditions(std::ostream& writer)
+{
+	// We can only move back up the knowledge base if there are not states that belong to this knowledge base.
+	writer << "\t\t(forall (?s - state)" << std::endl;
+	writer << "\t\t\t(or (not (part-of ?s ?old_kb)) (not (exists (?l - level) (stack ?s ?l))))" << std::endl;
+	writer << "\t\t)" << std::endl;
+
+	// Make sure the robot is in the same location.
+	writer << "\t\t(exists (?wp - waypoint)" << std::endl;
+	writer << "\t\t\t(forall (?s - state)" << std::endl;
+	writer << "\t\t\t\t(or (not (part-of ?s ?old_kb)) (robot_at robot ?wp ?s))" << std::endl;
+	writer << "\t\t\t)" << std::endl;
+	writer << "\t\t)" << std::endl;
+}
+
+void writeLiftedShedKnowledgeEffects(std::ostream& writer, const std::vector<StateFact>& facts)
+{
+	writer << "\t\t;; Make the states that were held in suspension active again, and those that were active, inactive." << std::endl;
+	writer << "\t\t(forall (?s - state)" << std::endl;
+	writer << "\t\t\t(when (part-of ?s ?new_kb)" << std::endl;
+	writer << "\t\t\t\t(m ?s)" << std::endl;
+	writer << "\t\t\t)" << std::endl;
+	writer << "\t\t)" << std::endl;
+	writer << "\t\t(forall (?s - state)" << std::endl;
+	writer << "\t\t\t(when (not (part-of ?s ?new_kb))" << std::endl;
+	writer << "\t\t\t\t(not (m ?s))" << std::endl;
+	writer << "\t\t\t)" << std::endl;
+	writer << "\t\t)" << std::endl;
+
+	// A fact that holds in every state ?s3 of ?old_kb is removed from all states ?s2 and added to the states ?s
+	// of ?new_kb. Deletes are applied before adds, so the fact survives in the states of ?new_kb.
+	writer << "\t\t;; Push all knowledge that is true for all states of ?old_kb up to ?new_kb." << std::endl;
+	for (std::vector<StateFact>::const_iterator ci = facts.begin(); ci != facts.end(); ++ci)
+	{
+		const StateFact& fact = *ci;
+		writer << "\t\t(forall (?s ?s2 - state " << fact.parameters_ << ")" << std::endl;
+		writer << "\t\t\t(when (and" << std::endl;
+		writer << "\t\t\t\t\t(part-of ?s ?new_kb)" << std::endl;
+		writer << "\t\t\t\t\t(forall (?s3 - state) (or (not (part-of ?s3 ?old_kb)) (" << fact.name_ << " " << fact.arguments_ << " ?s3)))" << std::endl;
+		writer << "\t\t\t\t)" << std::endl;
+		writer << "\t\t\t\t(and" << std::endl;
+		writer << "\t\t\t\t\t(not (" << fact.name_ << " " << fact.arguments_ << " ?s2))" << std::endl;
+		writer << "\t\t\t\t\t(" << fact.name_ << " " << fact.arguments_ << " ?s)" << std::endl;
+		writer << "\t\t\t\t)" << std::endl;
+		writer << "\t\t\t)" << std::endl;
+		writer << "\t\t)" << std::endl;
+	}
+}
+
+};
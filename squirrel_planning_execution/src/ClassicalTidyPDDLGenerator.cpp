@@ -10,19 +10,19 @@
 #include <ros/ros.h>
 
 #include "squirrel_planning_execution/ClassicalTidyPDDLGenerator.h"
+#include "squirrel_planning_execution/PDDLWriter.h"
 
 namespace KCL_rosplan {
 
 void ClassicalTidyPDDLGenerator::generateProblemFile(const std::string& file_name, const std::string& robot_location_predicate, const std::map<std::string, std::string>& object_to_location_mapping, const std::map<std::string, std::vector<std::string > >& grasping_location_mapping, const std::map<std::string, std::vector<std::string > >& pushing_location_mapping, const std::map<std::string, std::string>& object_to_type_mapping, const std::map<std::string, std::string>& box_to_location_mapping, const std::map<std::string, std::string>& box_to_type_mapping, const std::map<std::string, std::vector<std::string> >& near_box_location_mapping)
 {
-	std::ofstream myfile;
-	myfile.open(file_name.c_str());
-	myfile << "(define (problem Keys-0)" << std::endl;
-	myfile << "(:domain find_key)" << std::endl;
-	myfile << "(:objects" << std::endl;
+	PDDLWriter myfile(file_name);
+	myfile.begin("define (problem Keys-0)");
+	myfile.line("(:domain find_key)");
+	myfile.begin(":objects");
 	
 	// Waypoints.
-	myfile << robot_location_predicate << " ";
+	myfile.indent() << robot_location_predicate << " ";
 	for (std::map<std::string, std::string>::const_iterator ci = object_to_location_mapping.begin(); ci != object_to_location_mapping.end(); ++ci)
 	{
 		myfile << (*ci).second << " ";
@@ -58,6 +58,7 @@ void ClassicalTidyPDDLGenerator::generateProblemFile(const std::string& file_nam
 	myfile << " - waypoint" << std::endl;
 	
 	// Objects.
+	myfile.indent();
 	for (std::map<std::string, std::string>::const_iterator ci = object_to_location_mapping.begin(); ci != object_to_location_mapping.end(); ++ci)
 	{
 		myfile << (*ci).first << " ";
@@ -65,9 +66,10 @@ void ClassicalTidyPDDLGenerator::generateProblemFile(const std::string& file_nam
 	myfile << " - object" << std::endl;
 	
 	// Robot
-	myfile << "kenny - robot" << std::endl;
+	myfile.line("kenny - robot");
 	
 	// Types.
+	myfile.indent();
 	for (std::map<std::string, std::string>::const_iterator ci = box_to_type_mapping.begin(); ci != box_to_type_mapping.end(); ++ci)
 	{
 		myfile << (*ci).second << " ";
@@ -75,25 +77,26 @@ void ClassicalTidyPDDLGenerator::generateProblemFile(const std::string& file_nam
 	myfile << " - type" << std::endl;
 	
 	// Boxes.
+	myfile.indent();
 	for (std::map<std::string, std::string>::const_iterator ci = box_to_location_mapping.begin(); ci != box_to_location_mapping.end(); ++ci)
 	{
 		myfile << (*ci).first << " ";
 	}
 	myfile << " - box" << std::endl;
-	myfile << ")" << std::endl;
+	myfile.end();
 	myfile << std::endl;
 	
-	myfile << "(:init" << std::endl;
+	myfile.begin(":init");
 	
-	myfile << "(robot_at kenny " << robot_location_predicate << ")" << std::endl;
-	myfile << "(gripper_empty kenny)" << std::endl;
+	myfile.indent() << "(robot_at kenny " << robot_location_predicate << ")" << std::endl;
+	myfile.line("(gripper_empty kenny)");
 	for (std::map<std::string, std::string>::const_iterator ci = object_to_location_mapping.begin(); ci != object_to_location_mapping.end(); ++ci)
 	{
-		myfile << "(object_at " << (*ci).first << " " << (*ci).second << ")" << std::endl;
+		myfile.indent() << "(object_at " << (*ci).first << " " << (*ci).second << ")" << std::endl;
 	}
 	for (std::map<std::string, std::string>::const_iterator ci = box_to_location_mapping.begin(); ci != box_to_location_mapping.end(); ++ci)
 	{
-		myfile << "(box_at " << (*ci).first << " " << (*ci).second << ")" << std::endl;
+		myfile.indent() << "(box_at " << (*ci).first << " " << (*ci).second << ")" << std::endl;
 	}
 	for (std::map<std::string, std::vector<std::string> >::const_iterator ci = grasping_location_mapping.begin(); ci != grasping_location_mapping.end(); ++ci)
 	{
@@ -101,7 +104,7 @@ void ClassicalTidyPDDLGenerator::generateProblemFile(const std::string& file_nam
 		const std::vector<std::string>& near_locations = (*ci).second;
 		for (std::vector<std::string>::const_iterator ci = near_locations.begin(); ci != near_locations.end(); ++ci)
 		{
-			myfile << "(near_for_grasping " << (*ci) << " " << near_loc << ")" << std::endl;
+			myfile.indent() << "(near_for_grasping " << (*ci) << " " << near_loc << ")" << std::endl;
 		}
 	}
 	for (std::map<std::string, std::vector<std::string> >::const_iterator ci = pushing_location_mapping.begin(); ci != pushing_location_mapping.end(); ++ci)
@@ -110,7 +113,7 @@ void ClassicalTidyPDDLGenerator::generateProblemFile(const std::string& file_nam
 		const std::vector<std::string>& near_locations = (*ci).second;
 		for (std::vector<std::string>::const_iterator ci = near_locations.begin(); ci != near_locations.end(); ++ci)
 		{
-			myfile << "(near_for_pushing " << (*ci) << " " << near_loc << ")" << std::endl;
+			myfile.indent() << "(near_for_pushing " << (*ci) << " " << near_loc << ")" << std::endl;
 		}
 	}
 	
@@ -120,39 +123,39 @@ void ClassicalTidyPDDLGenerator::generateProblemFile(const std::string& file_nam
 		const std::vector<std::string>& near_locations = (*ci).second;
 		for (std::vector<std::string>::const_iterator ci = near_locations.begin(); ci != near_locations.end(); ++ci)
 		{
-			myfile << "(near_for_grasping " << (*ci) << " " << near_loc << ")" << std::endl;
+			myfile.indent() << "(near_for_grasping " << (*ci) << " " << near_loc << ")" << std::endl;
 		}
 	}
 	
 	for (std::map<std::string, std::string>::const_iterator ci = box_to_type_mapping.begin(); ci != box_to_type_mapping.end(); ++ci)
 	{
-		myfile << "(can_fit_inside " << (*ci).second << " " << (*ci).first << ")" << std::endl;
+		myfile.indent() << "(can_fit_inside " << (*ci).second << " " << (*ci).first << ")" << std::endl;
 		
-		myfile << "\t(can_push kenny " << (*ci).second << ")" << std::endl;
+		myfile.indent() << "(can_push kenny " << (*ci).second << ")" << std::endl;
 		
-		myfile << "\t(can_pickup kenny " << (*ci).second << ")" << std::endl;
+		myfile.indent() << "(can_pickup kenny " << (*ci).second << ")" << std::endl;
 	}
 	
 	for (std::map<std::string, std::string>::const_iterator ci = object_to_type_mapping.begin(); ci != object_to_type_mapping.end(); ++ci)
 	{
-		myfile << "(is_of_type " << (*ci).first << " " << (*ci).second << ")" << std::endl;
+		myfile.indent() << "(is_of_type " << (*ci).first << " " << (*ci).second << ")" << std::endl;
 	}
-	myfile << ")" << std::endl;
-	myfile << "(:goal (and" << std::endl;
+	myfile.end();
+	myfile.begin(":goal");
+	myfile.begin("and");
 	for (std::map<std::string, std::string>::const_iterator ci = object_to_location_mapping.begin(); ci != object_to_location_mapping.end(); ++ci)
 	{
-		myfile << "(tidy " << (*ci).first << ")" << std::endl;
+		myfile.indent() << "(tidy " << (*ci).first << ")" << std::endl;
 	}
-	myfile << ")" << std::endl;
-	myfile << ")" << std::endl;
-	myfile << ")" << std::endl;
+	myfile.end();
+	myfile.end();
+	myfile.end();
 	myfile.close();
 }
 
 void ClassicalTidyPDDLGenerator::generateDomainFile(const std::string& file_name, const std::string& robot_location_predicate, const std::map<std::string, std::string>& object_to_location_mapping, const std::map<std::string, std::vector<std::string > >& grasping_location_mapping, const std::map<std::string, std::vector<std::string > >& pushing_location_mapping, const std::map<std::string, std::string>& object_to_type_mapping, const std::map<std::string, std::string>& box_to_location_mapping, const std::map<std::string, std::string>& box_to_type_mapping, const std::map<std::string, std::vector<std::string> >& near_box_location_mapping)
 {
-	std::ofstream myfile;
-	myfile.open (file_name.c_str());
+	PDDLWriter myfile(file_name);
 	myfile << "(define (domain find_key)" << std::endl;
 	myfile << "(:requirements :typing :conditional-effects :negative-preconditions :disjunctive-preconditions)" << std::endl;
 	myfile << std::endl;
@@ -10,6 +10,9 @@
 #include <ros/ros.h>
 
 #include "squirrel_planning_execution/ContingentStrategicClassifyPDDLGenerator.h"
+#include "squirrel_planning_execution/PDDLWriter.h"
+#include "squirrel_planning_execution/PDDLCache.h"
+#include "squirrel_planning_execution/NodePool.h"
 
 namespace KCL_rosplan {
 
@@ -26,24 +29,23 @@ void ContingentStrategicClassifyPDDLGenerator::generateProblemFile(const std::st
 		}
 	}
 	
-	std::ofstream myfile;
-	myfile.open(file_name.c_str());
-	myfile << "(define (problem squirrel)" << std::endl;
-	myfile << "(:domain classify_objects)" << std::endl;
+	PDDLWriter myfile(file_name);
+	myfile.begin("define (problem squirrel)");
+	myfile.line("(:domain classify_objects)");
 	myfile << std::endl;
 	
-	myfile << "(:init" << std::endl;
-	myfile << "\t(resolve-axioms)" << std::endl;
-	myfile << "\t(lev l0)" << std::endl;
-	myfile << "\t(next l0 l1)" << std::endl;
+	myfile.begin(":init");
+	myfile.line("(resolve-axioms)");
+	myfile.line("(lev l0)");
+	myfile.line("(next l0 l1)");
 	//myfile << "\t(next l1 l2)" << std::endl;
 	
 	for (unsigned int i = 0; i < max_classification_attemps; ++i)
 	{
-		myfile << "\t(plus c" << i << " c" << (i + 1) << ")" << std::endl;
+		myfile.indent() << "(plus c" << i << " c" << (i + 1) << ")" << std::endl;
 	}
 	
-	myfile << "\t(current_kb " << current_knowledge_base.name_ << ")" << std::endl;
+	myfile.indent() << "(current_kb " << current_knowledge_base.name_ << ")" << std::endl;
 	
 	const Location* clear_location = NULL;
 	for (std::vector<Location*>::const_iterator ci = locations.begin(); ci != locations.end(); ++ci)
@@ -59,15 +61,15 @@ void ContingentStrategicClassifyPDDLGenerator::generateProblemFile(const std::st
 	{
 		const State* state = *ci;
 		//myfile << "\t(part-of " << state->state_name_ << " " << current_knowledge_base.name_ << ")" << std::endl;
-		myfile << "\t(m " << state->state_name_ << ")" << std::endl;
-		myfile << "\t(robot_at robot " << robot_location.name_ << " " << state->state_name_ << ")" << std::endl;
-		myfile << "\t(gripper_empty robot " << " " << state->state_name_ << ")" << std::endl;
+		myfile.indent() << "(m " << state->state_name_ << ")" << std::endl;
+		myfile.indent() << "(robot_at robot " << robot_location.name_ << " " << state->state_name_ << ")" << std::endl;
+		myfile.indent() << "(gripper_empty robot " << " " << state->state_name_ << ")" << std::endl;
 		
 		// All the objects are clear inially.
 		for (std::vector<Object*>::const_iterator ci = objects.begin(); ci != objects.end(); ++ci)
 		{
 			const Object* object = *ci;
-			myfile << "\t(object_at " << object->name_ << " " << object->location_->name_ << " " << state->state_name_ << ")" << std::endl;
+			myfile.indent() << "(object_at " << object->name_ << " " << object->location_->name_ << " " << state->state_name_ << ")" << std::endl;
 			//myfile << "\t(remaining_examination_attempts " << object->name_ << " c" << max_counter << " " << state->state_name_ << ")" << std::endl;
 		}
 	}
@@ -79,19 +81,19 @@ void ContingentStrategicClassifyPDDLGenerator::generateProblemFile(const std::st
 		{
 			const Location* location2 = *ci;
 			if (location == location2) continue;
-			myfile << "\t(connected " << location->name_ << " " << location2->name_ << ")" << std::endl;
+			myfile.indent() << "(connected " << location->name_ << " " << location2->name_ << ")" << std::endl;
 		}
 		
 		for (std::vector<const Location*>::const_iterator ci = location->near_locations_.begin(); ci != location->near_locations_.end(); ++ci)
 		{
 			const Location* location2 = *ci;
 			if (location == location2) continue;
-			myfile << "\t(near " << location->name_ << " " << location2->name_ << ")" << std::endl;
+			myfile.indent() << "(near " << location->name_ << " " << location2->name_ << ")" << std::endl;
 		}
 		
 		if (location->is_clear_)
 		{
-			myfile << "\t(clear_area " << location->name_ << ")" << std::endl;
+			myfile.indent() << "(clear_area " << location->name_ << ")" << std::endl;
 		}
 	}
 	
@@ -102,41 +104,42 @@ void ContingentStrategicClassifyPDDLGenerator::generateProblemFile(const std::st
 		for (std::vector<const State*>::const_iterator ci = knowledge_base->states_.begin(); ci != knowledge_base->states_.end(); ++ci)
 		{
 			const State* state = *ci;
-			myfile << "\t(part-of " << state->state_name_ << " " << knowledge_base->name_ << ")" << std::endl;
+			myfile.indent() << "(part-of " << state->state_name_ << " " << knowledge_base->name_ << ")" << std::endl;
 			
 			for (std::map<const Object*, unsigned int>::const_iterator ci = state->classifiable_at_attempt_.begin(); ci != state->classifiable_at_attempt_.end(); ++ci)
 			{
 				const Object* object = (*ci).first;
 				unsigned int classiable_on_attempt = (*ci).second;
 				
-				myfile << "\t(classifiable_on_attempt " << object->name_ << " c" << classiable_on_attempt << " " << state->state_name_ << ")" << std::endl;
-				myfile << "\t(current_counter " << object->name_ << " c0 " << state->state_name_ << ")" << std::endl;
-				myfile << "\t(contains " << object->name_ << " " << state->state_name_ << ")" << std::endl;
+				myfile.indent() << "(classifiable_on_attempt " << object->name_ << " c" << classiable_on_attempt << " " << state->state_name_ << ")" << std::endl;
+				myfile.indent() << "(current_counter " << object->name_ << " c0 " << state->state_name_ << ")" << std::endl;
+				myfile.indent() << "(contains " << object->name_ << " " << state->state_name_ << ")" << std::endl;
 			}
 		}
 		
 		for (std::vector<const KnowledgeBase*>::const_iterator ci = knowledge_base->children_.begin(); ci != knowledge_base->children_.end(); ++ci)
 		{
-			myfile << "\t(parent " << knowledge_base->name_ << " " << (*ci)->name_ << ")" << std::endl;
+			myfile.indent() << "(parent " << knowledge_base->name_ << " " << (*ci)->name_ << ")" << std::endl;
 		}
 	}
-	myfile << ")" << std::endl;
-	myfile << "(:goal (and" << std::endl;
+	myfile.end();
+	myfile.begin(":goal");
+	myfile.begin("and");
 	for (std::vector<Object*>::const_iterator ci = objects.begin(); ci != objects.end(); ++ci)
 	{
 		const Object* object = *ci;
 		for (std::vector<const State*>::const_iterator ci = current_knowledge_base.states_.begin(); ci != current_knowledge_base.states_.end(); ++ci)
 		{
-			myfile << "\t(classified " << object->name_ << " " << (*ci)->state_name_ << ")" << std::endl;
+			myfile.indent() << "(classified " << object->name_ << " " << (*ci)->state_name_ << ")" << std::endl;
 		}
 	}
-	myfile << ")" << std::endl;
-	myfile << ")" << std::endl;
-	myfile << ")" << std::endl;
+	myfile.end();
+	myfile.end();
+	myfile.end();
 	myfile.close();
 }
 
-void ContingentStrategicClassifyPDDLGenerator::generateDomainFile(const std::string& file_name, const KnowledgeBase& current_knowledge_base, const std::vector<const KnowledgeBase*>& knowledge_bases, const Location& robot_location, const std::vector<Location*>& locations, const std::vector<Object*>& objects, unsigned int max_classification_attemps)
+void ContingentStrategicClassifyPDDLGenerator::generateDomainFile(const std::string& file_name, const KnowledgeBase& current_knowledge_base, const std::vector<const KnowledgeBase*>& knowledge_bases, const Location& robot_location, const std::vector<Location*>& locations, const std::vector<Object*>& objects, unsigned int max_classification_attemps, BeliefEncoding belief_encoding)
 {
 	std::vector<const State*> states;
 	for (std::vector<const KnowledgeBase*>::const_iterator ci = knowledge_bases.begin(); ci != knowledge_bases.end(); ++ci)
@@ -149,10 +152,27 @@ void ContingentStrategicClassifyPDDLGenerator::generateDomainFile(const std::str
 		}
 	}
 	
-	std::ofstream myfile;
-	myfile.open (file_name.c_str());
+	// The facts that are moved between knowledge bases by assume_knowledge and shed_knowledge.
+	std::vector<StateFact> assume_facts;
+	assume_facts.push_back(StateFact("gripper_empty", "?v - robot"));
+	assume_facts.push_back(StateFact("holding", "?v - robot ?o - object"));
+	assume_facts.push_back(StateFact("cleared", "?o - object"));
+	assume_facts.push_back(StateFact("classified", "?o - object"));
+	assume_facts.push_back(StateFact("classifiable_on_attempt", "?o - object ?c - counter"));
+	assume_facts.push_back(StateFact("robot_at", "?v - robot ?wp - waypoint"));
+	assume_facts.push_back(StateFact("object_at", "?o - object ?wp - waypoint"));
+	const std::vector<StateFact>& shed_facts = assume_facts;
+	
+	PDDLWriter myfile(file_name);
 	myfile << "(define (domain classify_objects)" << std::endl;
-	myfile << "(:requirements :typing :conditional-effects :negative-preconditions :disjunctive-preconditions)" << std::endl;
+	if (belief_encoding == LIFTED_BELIEF_ENCODING)
+	{
+		myfile << "(:requirements :typing :conditional-effects :negative-preconditions :disjunctive-preconditions :quantified-preconditions)" << std::endl;
+	}
+	else
+	{
+		myfile << "(:requirements :typing :conditional-effects :negative-preconditions :disjunctive-preconditions)" << std::endl;
+	}
 	myfile << std::endl;
 	myfile << "(:types" << std::endl;
 	myfile << "\twaypoint robot object" << std::endl;
@@ -741,105 +761,112 @@ void ContingentStrategicClassifyPDDLGenerator::generateDomainFile(const std::str
 	myfile << "\t\t(resolve-axioms)" << std::endl;
 	myfile << std::endl;
 	
-	myfile << "\t\t;; Now we need to delete all knowledge from the old_kb and insert it to" << std::endl;
-	myfile << "\t\t;; the new_kb level." << std::endl;
-
-	myfile << "\t\t;; For every state ?s, ?s2" << std::endl;
-	for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
+	if (belief_encoding == LIFTED_BELIEF_ENCODING)
 	{
-		const State* state = *ci;
-		
-		// Get rid of all states that are not part of this knowledge base.
-		myfile << "\t\t(when (and (m " << state->state_name_ << ") (not (part-of " << state->state_name_ << " ?new_kb)))" << std::endl;
-		myfile << "\t\t\t(not (m " << state->state_name_ << "))" << std::endl;
-		myfile << "\t\t)" << std::endl;
-		
-		// Enable the states that are encapsulated in this knowledge base.
-		myfile << "\t\t(when (part-of " << state->state_name_ << " ?new_kb)" << std::endl;
-		myfile << "\t\t\t(and (m " << state->state_name_ << "))" << std::endl;
-		myfile << "\t\t)" << std::endl;
-		
-		// Copy all knowledge that is part of ?old_kb to all the new states.
+		writeLiftedAssumeKnowledgeEffects(myfile, assume_facts);
+	}
+	else
+	{
+		myfile << "\t\t;; Now we need to delete all knowledge from the old_kb and insert it to" << std::endl;
+		myfile << "\t\t;; the new_kb level." << std::endl;
+
+		myfile << "\t\t;; For every state ?s, ?s2" << std::endl;
 		for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
 		{
-			const State* state2 = *ci;
-			
-			myfile << "\t\t(when (and (part-of " << state->state_name_ << " ?old_kb) (gripper_empty robot " << state->state_name_ << ") (part-of " << state2->state_name_ << " ?new_kb))" << std::endl;
-			myfile << "\t\t\t(and " << std::endl;
-			myfile << "\t\t\t\t(not (Rgripper_empty robot " << state->state_name_ << "))" << std::endl;
-			myfile << "\t\t\t\t(not (gripper_empty robot " << state->state_name_ << "))" << std::endl;
-			myfile << "\t\t\t\t(Rgripper_empty robot " << state2->state_name_ << ")" << std::endl;
-			myfile << "\t\t\t\t(gripper_empty robot " << state2->state_name_ << ")" << std::endl;
-			myfile << "\t\t\t)" << std::endl;
+			const State* state = *ci;
+		
+			// Get rid of all states that are not part of this knowledge base.
+			myfile << "\t\t(when (and (m " << state->state_name_ << ") (not (part-of " << state->state_name_ << " ?new_kb)))" << std::endl;
+			myfile << "\t\t\t(not (m " << state->state_name_ << "))" << std::endl;
 			myfile << "\t\t)" << std::endl;
-			
-			for (std::vector<Object*>::const_iterator ci = objects.begin(); ci != objects.end(); ++ci)
+		
+			// Enable the states that are encapsulated in this knowledge base.
+			myfile << "\t\t(when (part-of " << state->state_name_ << " ?new_kb)" << std::endl;
+			myfile << "\t\t\t(and (m " << state->state_name_ << "))" << std::endl;
+			myfile << "\t\t)" << std::endl;
+		
+			// Copy all knowledge that is part of ?old_kb to all the new states.
+			for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
 			{
-				const Object* object = *ci;
-				myfile << "\t\t(when (and (part-of " << state->state_name_ << " ?old_kb) (holding robot " << object->name_ << " " << state->state_name_ << ") (part-of " << state2->state_name_ << " ?new_kb))" << std::endl;
-				myfile << "\t\t\t(and " << std::endl;
-				myfile << "\t\t\t\t(not (Rholding robot " << object->name_ << " " << state->state_name_ << "))" << std::endl;
-				myfile << "\t\t\t\t(not (holding robot " << object->name_ << " " << state->state_name_ << "))" << std::endl;
-				myfile << "\t\t\t\t(Rholding robot " << object->name_ << " " << state2->state_name_ << ")" << std::endl;
-				myfile << "\t\t\t\t(holding robot " << object->name_ << " " << state2->state_name_ << ")" << std::endl;
-				myfile << "\t\t\t)" << std::endl;
-				myfile << "\t\t)" << std::endl;
-				
-				myfile << "\t\t(when (and (part-of " << state->state_name_ << " ?old_kb) (cleared " << object->name_ << " " << state->state_name_ << ") (part-of " << state2->state_name_ << " ?new_kb))" << std::endl;
+				const State* state2 = *ci;
+			
+				myfile << "\t\t(when (and (part-of " << state->state_name_ << " ?old_kb) (gripper_empty robot " << state->state_name_ << ") (part-of " << state2->state_name_ << " ?new_kb))" << std::endl;
 				myfile << "\t\t\t(and " << std::endl;
-				myfile << "\t\t\t\t(not (Rcleared " << object->name_ << " " << state->state_name_ << "))" << std::endl;
-				myfile << "\t\t\t\t(not (cleared " << object->name_ << " " << state->state_name_ << "))" << std::endl;
-				myfile << "\t\t\t\t(Rcleared " << object->name_ << " " << state2->state_name_ << ")" << std::endl;
-				myfile << "\t\t\t\t(cleared " << object->name_ << " " << state2->state_name_ << ")" << std::endl;
+				myfile << "\t\t\t\t(not (Rgripper_empty robot " << state->state_name_ << "))" << std::endl;
+				myfile << "\t\t\t\t(not (gripper_empty robot " << state->state_name_ << "))" << std::endl;
+				myfile << "\t\t\t\t(Rgripper_empty robot " << state2->state_name_ << ")" << std::endl;
+				myfile << "\t\t\t\t(gripper_empty robot " << state2->state_name_ << ")" << std::endl;
 				myfile << "\t\t\t)" << std::endl;
 				myfile << "\t\t)" << std::endl;
+			
+				for (std::vector<Object*>::const_iterator ci = objects.begin(); ci != objects.end(); ++ci)
+				{
+					const Object* object = *ci;
+					myfile << "\t\t(when (and (part-of " << state->state_name_ << " ?old_kb) (holding robot " << object->name_ << " " << state->state_name_ << ") (part-of " << state2->state_name_ << " ?new_kb))" << std::endl;
+					myfile << "\t\t\t(and " << std::endl;
+					myfile << "\t\t\t\t(not (Rholding robot " << object->name_ << " " << state->state_name_ << "))" << std::endl;
+					myfile << "\t\t\t\t(not (holding robot " << object->name_ << " " << state->state_name_ << "))" << std::endl;
+					myfile << "\t\t\t\t(Rholding robot " << object->name_ << " " << state2->state_name_ << ")" << std::endl;
+					myfile << "\t\t\t\t(holding robot " << object->name_ << " " << state2->state_name_ << ")" << std::endl;
+					myfile << "\t\t\t)" << std::endl;
+					myfile << "\t\t)" << std::endl;
 				
-				myfile << "\t\t(when (and (part-of " << state->state_name_ << " ?old_kb) (classified " << object->name_ << " " << state->state_name_ << ") (part-of " << state2->state_name_ << " ?new_kb))" << std::endl;
-				myfile << "\t\t\t(and " << std::endl;
-				myfile << "\t\t\t\t(not (Rclassified " << object->name_ << " " << state->state_name_ << "))" << std::endl;
-				myfile << "\t\t\t\t(not (classified " << object->name_ << " " << state->state_name_ << "))" << std::endl;
-				myfile << "\t\t\t\t(Rclassified " << object->name_ << " " << state2->state_name_ << ")" << std::endl;
-				myfile << "\t\t\t\t(classified " << object->name_ << " " << state2->state_name_ << ")" << std::endl;
-				myfile << "\t\t\t)" << std::endl;
-				myfile << "\t\t)" << std::endl;
+					myfile << "\t\t(when (and (part-of " << state->state_name_ << " ?old_kb) (cleared " << object->name_ << " " << state->state_name_ << ") (part-of " << state2->state_name_ << " ?new_kb))" << std::endl;
+					myfile << "\t\t\t(and " << std::endl;
+					myfile << "\t\t\t\t(not (Rcleared " << object->name_ << " " << state->state_name_ << "))" << std::endl;
+					myfile << "\t\t\t\t(not (cleared " << object->name_ << " " << state->state_name_ << "))" << std::endl;
+					myfile << "\t\t\t\t(Rcleared " << object->name_ << " " << state2->state_name_ << ")" << std::endl;
+					myfile << "\t\t\t\t(cleared " << object->name_ << " " << state2->state_name_ << ")" << std::endl;
+					myfile << "\t\t\t)" << std::endl;
+					myfile << "\t\t)" << std::endl;
 				
-				for (unsigned int counter = 0; counter <= max_classification_attemps; ++counter)
-				{
-					myfile << "\t\t(when (and (part-of " << state->state_name_ << " ?old_kb) (classifiable_on_attempt " << object->name_ << " c" << counter << " " << state->state_name_ << ") (part-of " << state2->state_name_ << " ?new_kb))" << std::endl;
+					myfile << "\t\t(when (and (part-of " << state->state_name_ << " ?old_kb) (classified " << object->name_ << " " << state->state_name_ << ") (part-of " << state2->state_name_ << " ?new_kb))" << std::endl;
 					myfile << "\t\t\t(and " << std::endl;
-					myfile << "\t\t\t\t(not (Rclassifiable_on_attempt " << object->name_ << " c" << counter << " " << state->state_name_ << "))" << std::endl;
-					myfile << "\t\t\t\t(not (classifiable_on_attempt " << object->name_ << " c" << counter << " " << state->state_name_ << "))" << std::endl;
-					myfile << "\t\t\t\t(Rclassifiable_on_attempt " << object->name_ << " c" << counter << " " << state2->state_name_ << ")" << std::endl;
-					myfile << "\t\t\t\t(classifiable_on_attempt " << object->name_ << " c" << counter << " " << state2->state_name_ << ")" << std::endl;
+					myfile << "\t\t\t\t(not (Rclassified " << object->name_ << " " << state->state_name_ << "))" << std::endl;
+					myfile << "\t\t\t\t(not (classified " << object->name_ << " " << state->state_name_ << "))" << std::endl;
+					myfile << "\t\t\t\t(Rclassified " << object->name_ << " " << state2->state_name_ << ")" << std::endl;
+					myfile << "\t\t\t\t(classified " << object->name_ << " " << state2->state_name_ << ")" << std::endl;
 					myfile << "\t\t\t)" << std::endl;
 					myfile << "\t\t)" << std::endl;
+				
+					for (unsigned int counter = 0; counter <= max_classification_attemps; ++counter)
+					{
+						myfile << "\t\t(when (and (part-of " << state->state_name_ << " ?old_kb) (classifiable_on_attempt " << object->name_ << " c" << counter << " " << state->state_name_ << ") (part-of " << state2->state_name_ << " ?new_kb))" << std::endl;
+						myfile << "\t\t\t(and " << std::endl;
+						myfile << "\t\t\t\t(not (Rclassifiable_on_attempt " << object->name_ << " c" << counter << " " << state->state_name_ << "))" << std::endl;
+						myfile << "\t\t\t\t(not (classifiable_on_attempt " << object->name_ << " c" << counter << " " << state->state_name_ << "))" << std::endl;
+						myfile << "\t\t\t\t(Rclassifiable_on_attempt " << object->name_ << " c" << counter << " " << state2->state_name_ << ")" << std::endl;
+						myfile << "\t\t\t\t(classifiable_on_attempt " << object->name_ << " c" << counter << " " << state2->state_name_ << ")" << std::endl;
+						myfile << "\t\t\t)" << std::endl;
+						myfile << "\t\t)" << std::endl;
+					}
 				}
-			}
 			
-			for (std::vector<Location*>::const_iterator ci = locations.begin(); ci != locations.end(); ++ci)
-			{
-				const Location* location = *ci;
-				
-				myfile << "\t\t(when (and (part-of " << state->state_name_ << " ?old_kb) (robot_at robot " << location->name_ << " " << state->state_name_ << ") (part-of " << state2->state_name_ << " ?new_kb))" << std::endl;
-				myfile << "\t\t\t(and " << std::endl;
-				myfile << "\t\t\t\t(not (Rrobot_at robot " << location->name_ << " " << state->state_name_ << "))" << std::endl;
-				myfile << "\t\t\t\t(not (robot_at robot " << location->name_ << " " << state->state_name_ << "))" << std::endl;
-				myfile << "\t\t\t\t(Rrobot_at robot " << location->name_ << " " << state2->state_name_ << ")" << std::endl;
-				myfile << "\t\t\t\t(robot_at robot " << location->name_ << " " << state2->state_name_ << ")" << std::endl;
-				myfile << "\t\t\t)" << std::endl;
-				myfile << "\t\t)" << std::endl;
-				
-				for (std::vector<Object*>::const_iterator ci = objects.begin(); ci != objects.end(); ++ci)
+				for (std::vector<Location*>::const_iterator ci = locations.begin(); ci != locations.end(); ++ci)
 				{
-					const Object* object = *ci;
-					myfile << "\t\t(when (and (part-of " << state->state_name_ << " ?old_kb) (object_at " << object->name_ << " " << location->name_ << " " << state->state_name_ << ") (part-of " << state2->state_name_ << " ?new_kb))" << std::endl;
+					const Location* location = *ci;
+				
+					myfile << "\t\t(when (and (part-of " << state->state_name_ << " ?old_kb) (robot_at robot " << location->name_ << " " << state->state_name_ << ") (part-of " << state2->state_name_ << " ?new_kb))" << std::endl;
 					myfile << "\t\t\t(and " << std::endl;
-					myfile << "\t\t\t\t(not (Robject_at " << object->name_ << " " << location->name_ << " " << state->state_name_ << "))" << std::endl;
-					myfile << "\t\t\t\t(not (object_at " << object->name_ << " " << location->name_ << " " << state->state_name_ << "))" << std::endl;
-					myfile << "\t\t\t\t(Robject_at " << object->name_ << " " << location->name_ << " " << state2->state_name_ << ")" << std::endl;
-					myfile << "\t\t\t\t(object_at " << object->name_ << " " << location->name_ << " " << state2->state_name_ << ")" << std::endl;
+					myfile << "\t\t\t\t(not (Rrobot_at robot " << location->name_ << " " << state->state_name_ << "))" << std::endl;
+					myfile << "\t\t\t\t(not (robot_at robot " << location->name_ << " " << state->state_name_ << "))" << std::endl;
+					myfile << "\t\t\t\t(Rrobot_at robot " << location->name_ << " " << state2->state_name_ << ")" << std::endl;
+					myfile << "\t\t\t\t(robot_at robot " << location->name_ << " " << state2->state_name_ << ")" << std::endl;
 					myfile << "\t\t\t)" << std::endl;
 					myfile << "\t\t)" << std::endl;
+				
+					for (std::vector<Object*>::const_iterator ci = objects.begin(); ci != objects.end(); ++ci)
+					{
+						const Object* object = *ci;
+						myfile << "\t\t(when (and (part-of " << state->state_name_ << " ?old_kb) (object_at " << object->name_ << " " << location->name_ << " " << state->state_name_ << ") (part-of " << state2->state_name_ << " ?new_kb))" << std::endl;
+						myfile << "\t\t\t(and " << std::endl;
+						myfile << "\t\t\t\t(not (Robject_at " << object->name_ << " " << location->name_ << " " << state->state_name_ << "))" << std::endl;
+						myfile << "\t\t\t\t(not (object_at " << object->name_ << " " << location->name_ << " " << state->state_name_ << "))" << std::endl;
+						myfile << "\t\t\t\t(Robject_at " << object->name_ << " " << location->name_ << " " << state2->state_name_ << ")" << std::endl;
+						myfile << "\t\t\t\t(object_at " << object->name_ << " " << location->name_ << " " << state2->state_name_ << ")" << std::endl;
+						myfile << "\t\t\t)" << std::endl;
+						myfile << "\t\t)" << std::endl;
+					}
 				}
 			}
 		}
@@ -855,49 +882,61 @@ void ContingentStrategicClassifyPDDLGenerator::generateDomainFile(const std::str
 	myfile << "\t\t(current_kb ?old_kb)" << std::endl;
 	myfile << "\t\t(parent ?new_kb ?old_kb)" << std::endl;
 	
-	// We can only move back up the knowledge base if there are not states that belong to this knowledge base.
-	for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
+	if (belief_encoding == LIFTED_BELIEF_ENCODING)
 	{
-		myfile << "\t\t(or " << std::endl;
-		myfile << "\t\t\t(not (part-of " << (*ci)->state_name_ << " ?old_kb))" << std::endl;
-		myfile << "\t\t\t(not (exists (?l - level ) (stack " << (*ci)->state_name_ << " ?l)))" << std::endl;
+		writeLiftedShedKnowledgePreconditions(myfile);
+		
+		// Make sure the object is classified.
+		myfile << "\t\t(forall (?s - state ?o - object)" << std::endl;
+		myfile << "\t\t\t(or (not (part-of ?s ?old_kb)) (classified ?o ?s) (not (contains ?o ?s)))" << std::endl;
 		myfile << "\t\t)" << std::endl;
 	}
-	
-	// Make sure the robot is in the same location.
-	myfile << "\t\t(or" << std::endl;
-	for (std::vector<Location*>::const_iterator ci = locations.begin(); ci != locations.end(); ++ci)
+	else
 	{
-		const Location* location = *ci;
-		myfile << "\t\t\t(and" << std::endl;
+		// We can only move back up the knowledge base if there are not states that belong to this knowledge base.
 		for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
 		{
-			const State* state = *ci;
-			// Make sure the state of the toilets are the same.
-			myfile << "\t\t\t\t(or " << std::endl;
-			myfile << "\t\t\t\t\t(not (part-of " << (*ci)->state_name_ << " ?old_kb))" << std::endl;
-			myfile << "\t\t\t\t\t(robot_at robot " << location->name_ << " " << state->state_name_ << ")" << std::endl;
-			myfile << "\t\t\t\t)" << std::endl;
+			myfile << "\t\t(or " << std::endl;
+			myfile << "\t\t\t(not (part-of " << (*ci)->state_name_ << " ?old_kb))" << std::endl;
+			myfile << "\t\t\t(not (exists (?l - level ) (stack " << (*ci)->state_name_ << " ?l)))" << std::endl;
+			myfile << "\t\t)" << std::endl;
 		}
-		myfile << "\t\t\t)" << std::endl;
-	}
-	myfile << "\t\t)" << std::endl;
 	
-	// Make sure the object is classified.
-	//myfile << "\t\t(and" << std::endl;
-	for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
-	{
-		const State* state = *ci;
-		for (std::vector<Object*>::const_iterator ci = objects.begin(); ci != objects.end(); ++ci)
+		// Make sure the robot is in the same location.
+		myfile << "\t\t(or" << std::endl;
+		for (std::vector<Location*>::const_iterator ci = locations.begin(); ci != locations.end(); ++ci)
 		{
-			const Object* object = *ci;
-			// Make sure the state of the toilets are the same.
-			myfile << "\t\t\t(or " << std::endl;
-			myfile << "\t\t\t\t(not (part-of " << state->state_name_ << " ?old_kb))" << std::endl;
-			myfile << "\t\t\t\t(classified " << object->name_ << " " << state->state_name_ << ")" << std::endl;
-			myfile << "\t\t\t\t(not (contains " << object->name_ << " " << state->state_name_ << "))" << std::endl;
+			const Location* location = *ci;
+			myfile << "\t\t\t(and" << std::endl;
+			for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
+			{
+				const State* state = *ci;
+				// Make sure the state of the toilets are the same.
+				myfile << "\t\t\t\t(or " << std::endl;
+				myfile << "\t\t\t\t\t(not (part-of " << (*ci)->state_name_ << " ?old_kb))" << std::endl;
+				myfile << "\t\t\t\t\t(robot_at robot " << location->name_ << " " << state->state_name_ << ")" << std::endl;
+				myfile << "\t\t\t\t)" << std::endl;
+			}
 			myfile << "\t\t\t)" << std::endl;
 		}
+		myfile << "\t\t)" << std::endl;
+	
+		// Make sure the object is classified.
+		//myfile << "\t\t(and" << std::endl;
+		for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
+		{
+			const State* state = *ci;
+			for (std::vector<Object*>::const_iterator ci = objects.begin(); ci != objects.end(); ++ci)
+			{
+				const Object* object = *ci;
+				// Make sure the state of the toilets are the same.
+				myfile << "\t\t\t(or " << std::endl;
+				myfile << "\t\t\t\t(not (part-of " << state->state_name_ << " ?old_kb))" << std::endl;
+				myfile << "\t\t\t\t(classified " << object->name_ << " " << state->state_name_ << ")" << std::endl;
+				myfile << "\t\t\t\t(not (contains " << object->name_ << " " << state->state_name_ << "))" << std::endl;
+				myfile << "\t\t\t)" << std::endl;
+			}
+		}
 	}
 	//myfile << "\t\t)" << std::endl;
 	
@@ -908,71 +947,42 @@ void ContingentStrategicClassifyPDDLGenerator::generateDomainFile(const std::str
 	myfile << "\t\t(resolve-axioms)" << std::endl;
 	myfile << std::endl;
 	
-	myfile << "\t\t;; Now we need to push all knowledge that is true for all states part of " << std::endl;
-	myfile << "\t\t;; kb_old up to kb_new." << std::endl;
-	for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
+	if (belief_encoding == LIFTED_BELIEF_ENCODING)
 	{
-		const State* state = *ci;
-		
-		// Make the states that were held in suspection active again.
-		myfile << "\t\t(when (part-of " << state->state_name_ << " ?new_kb)" << std::endl;
-		myfile << "\t\t\t(and (m " << state->state_name_ << "))" << std::endl;
-		myfile << "\t\t)" << std::endl;
-		
-		// And those that were active, inactive.
-		myfile << "\t\t(when (not (part-of " << state->state_name_ << " ?new_kb))" << std::endl;
-		myfile << "\t\t\t(and (not (m " << state->state_name_ << ")))" << std::endl;
-		myfile << "\t\t)" << std::endl;
+		writeLiftedShedKnowledgeEffects(myfile, shed_facts);
 	}
-	
-	for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
+	else
 	{
-		const State* state = *ci;
-		myfile << "\t\t(when (and " << std::endl;
-		myfile << "\t\t\t\t;; For every state ?s, ?s2" << std::endl;
-	
+		myfile << "\t\t;; Now we need to push all knowledge that is true for all states part of " << std::endl;
+		myfile << "\t\t;; kb_old up to kb_new." << std::endl;
 		for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
 		{
-			const State* state2 = *ci;
-			myfile << "\t\t\t\t\t(or " << std::endl;
-			myfile << "\t\t\t\t\t\t(not (part-of " << state2->state_name_ << " ?old_kb))" << std::endl;
-			myfile << "\t\t\t\t\t\t(gripper_empty robot " << state2->state_name_ << ")" << std::endl;
-			myfile << "\t\t\t\t\t)" << std::endl;
-		}
-		myfile << "\t\t\t\t\t(part-of " << state->state_name_ << " ?new_kb)" << std::endl;
-		myfile << "\t\t\t)" << std::endl;
-
-		myfile << "\t\t\t;; Conditional effects" << std::endl;
-		myfile << "\t\t\t(and " << std::endl;
-		for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
-		{
-			const State* state2 = *ci;
-			myfile << "\t\t\t\t(not (gripper_empty robot " << state2->state_name_ << "))" << std::endl;
+			const State* state = *ci;
+		
+			// Make the states that were held in suspection active again.
+			myfile << "\t\t(when (part-of " << state->state_name_ << " ?new_kb)" << std::endl;
+			myfile << "\t\t\t(and (m " << state->state_name_ << "))" << std::endl;
+			myfile << "\t\t)" << std::endl;
+		
+			// And those that were active, inactive.
+			myfile << "\t\t(when (not (part-of " << state->state_name_ << " ?new_kb))" << std::endl;
+			myfile << "\t\t\t(and (not (m " << state->state_name_ << ")))" << std::endl;
+			myfile << "\t\t)" << std::endl;
 		}
-		myfile << "\t\t\t\t(gripper_empty robot " << state->state_name_ << ")" << std::endl;
-		myfile << "\t\t\t)" << std::endl;
-		myfile << "\t\t)" << std::endl;
-	}
 	
-	for (std::vector<Object*>::const_iterator ci = objects.begin(); ci != objects.end(); ++ci)
-	{
-		const Object* object = *ci;
 		for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
 		{
-			// Deal with the location of the robot.
 			const State* state = *ci;
 			myfile << "\t\t(when (and " << std::endl;
 			myfile << "\t\t\t\t;; For every state ?s, ?s2" << std::endl;
-		
-			// Holding.
+	
 			for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
 			{
 				const State* state2 = *ci;
 				myfile << "\t\t\t\t\t(or " << std::endl;
 				myfile << "\t\t\t\t\t\t(not (part-of " << state2->state_name_ << " ?old_kb))" << std::endl;
-				myfile << "\t\t\t\t\t\t(holding robot " << object->name_ << " " << state2->state_name_ << ")" << std::endl;
+				myfile << "\t\t\t\t\t\t(gripper_empty robot " << state2->state_name_ << ")" << std::endl;
 				myfile << "\t\t\t\t\t)" << std::endl;
-				
 			}
 			myfile << "\t\t\t\t\t(part-of " << state->state_name_ << " ?new_kb)" << std::endl;
 			myfile << "\t\t\t)" << std::endl;
@@ -982,80 +992,86 @@ void ContingentStrategicClassifyPDDLGenerator::generateDomainFile(const std::str
 			for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
 			{
 				const State* state2 = *ci;
-				myfile << "\t\t\t\t(not (holding robot " << object->name_ << " " << state2->state_name_ << "))" << std::endl;
+				myfile << "\t\t\t\t(not (gripper_empty robot " << state2->state_name_ << "))" << std::endl;
 			}
-			myfile << "\t\t\t\t(holding robot " << object->name_ << " " << state->state_name_ << ")" << std::endl;
+			myfile << "\t\t\t\t(gripper_empty robot " << state->state_name_ << ")" << std::endl;
 			myfile << "\t\t\t)" << std::endl;
 			myfile << "\t\t)" << std::endl;
-			
-			// Classified.
-			myfile << "\t\t(when (and " << std::endl;
-			myfile << "\t\t\t\t;; For every state ?s, ?s2" << std::endl;
-		
+		}
+	
+		for (std::vector<Object*>::const_iterator ci = objects.begin(); ci != objects.end(); ++ci)
+		{
+			const Object* object = *ci;
 			for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
 			{
-				const State* state2 = *ci;
-				myfile << "\t\t\t\t\t(or " << std::endl;
-				myfile << "\t\t\t\t\t\t(not (part-of " << state2->state_name_ << " ?old_kb))" << std::endl;
-				myfile << "\t\t\t\t\t\t(classified " << object->name_ << " " << state2->state_name_ << ")" << std::endl;
-				myfile << "\t\t\t\t\t)" << std::endl;
+				// Deal with the location of the robot.
+				const State* state = *ci;
+				myfile << "\t\t(when (and " << std::endl;
+				myfile << "\t\t\t\t;; For every state ?s, ?s2" << std::endl;
+		
+				// Holding.
+				for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
+				{
+					const State* state2 = *ci;
+					myfile << "\t\t\t\t\t(or " << std::endl;
+					myfile << "\t\t\t\t\t\t(not (part-of " << state2->state_name_ << " ?old_kb))" << std::endl;
+					myfile << "\t\t\t\t\t\t(holding robot " << object->name_ << " " << state2->state_name_ << ")" << std::endl;
+					myfile << "\t\t\t\t\t)" << std::endl;
 				
-			}
-			myfile << "\t\t\t\t\t(part-of " << state->state_name_ << " ?new_kb)" << std::endl;
-			myfile << "\t\t\t)" << std::endl;
+				}
+				myfile << "\t\t\t\t\t(part-of " << state->state_name_ << " ?new_kb)" << std::endl;
+				myfile << "\t\t\t)" << std::endl;
 
-			myfile << "\t\t\t;; Conditional effects" << std::endl;
-			myfile << "\t\t\t(and " << std::endl;
-			for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
-			{
-				const State* state2 = *ci;
-				myfile << "\t\t\t\t(not (classified " << object->name_ << " " << state2->state_name_ << "))" << std::endl;
-			}
-			myfile << "\t\t\t\t(classified " << object->name_ << " " << state->state_name_ << ")" << std::endl;
-			myfile << "\t\t\t)" << std::endl;
-			myfile << "\t\t)" << std::endl;
+				myfile << "\t\t\t;; Conditional effects" << std::endl;
+				myfile << "\t\t\t(and " << std::endl;
+				for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
+				{
+					const State* state2 = *ci;
+					myfile << "\t\t\t\t(not (holding robot " << object->name_ << " " << state2->state_name_ << "))" << std::endl;
+				}
+				myfile << "\t\t\t\t(holding robot " << object->name_ << " " << state->state_name_ << ")" << std::endl;
+				myfile << "\t\t\t)" << std::endl;
+				myfile << "\t\t)" << std::endl;
 			
-			// Cleared.
-			myfile << "\t\t(when (and " << std::endl;
-			myfile << "\t\t\t\t;; For every state ?s, ?s2" << std::endl;
+				// Classified.
+				myfile << "\t\t(when (and " << std::endl;
+				myfile << "\t\t\t\t;; For every state ?s, ?s2" << std::endl;
 		
-			for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
-			{
-				const State* state2 = *ci;
-				myfile << "\t\t\t\t\t(or " << std::endl;
-				myfile << "\t\t\t\t\t\t(not (part-of " << state2->state_name_ << " ?old_kb))" << std::endl;
-				myfile << "\t\t\t\t\t\t(cleared " << object->name_ << " " << state2->state_name_ << ")" << std::endl;
-				myfile << "\t\t\t\t\t)" << std::endl;
+				for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
+				{
+					const State* state2 = *ci;
+					myfile << "\t\t\t\t\t(or " << std::endl;
+					myfile << "\t\t\t\t\t\t(not (part-of " << state2->state_name_ << " ?old_kb))" << std::endl;
+					myfile << "\t\t\t\t\t\t(classified " << object->name_ << " " << state2->state_name_ << ")" << std::endl;
+					myfile << "\t\t\t\t\t)" << std::endl;
 				
-			}
-			myfile << "\t\t\t\t\t(part-of " << state->state_name_ << " ?new_kb)" << std::endl;
-			myfile << "\t\t\t)" << std::endl;
+				}
+				myfile << "\t\t\t\t\t(part-of " << state->state_name_ << " ?new_kb)" << std::endl;
+				myfile << "\t\t\t)" << std::endl;
 
-			myfile << "\t\t\t;; Conditional effects" << std::endl;
-			myfile << "\t\t\t(and " << std::endl;
-			for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
-			{
-				const State* state2 = *ci;
-				myfile << "\t\t\t\t(not (cleared " << object->name_ << " " << state2->state_name_ << "))" << std::endl;
-			}
-			myfile << "\t\t\t\t(cleared " << object->name_ << " " << state->state_name_ << ")" << std::endl;
-			myfile << "\t\t\t)" << std::endl;
-			myfile << "\t\t)" << std::endl;
+				myfile << "\t\t\t;; Conditional effects" << std::endl;
+				myfile << "\t\t\t(and " << std::endl;
+				for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
+				{
+					const State* state2 = *ci;
+					myfile << "\t\t\t\t(not (classified " << object->name_ << " " << state2->state_name_ << "))" << std::endl;
+				}
+				myfile << "\t\t\t\t(classified " << object->name_ << " " << state->state_name_ << ")" << std::endl;
+				myfile << "\t\t\t)" << std::endl;
+				myfile << "\t\t)" << std::endl;
 			
-			// Deal with the classification attempts on an object.
-			for (unsigned int counter = 0; counter < max_classification_attemps; ++counter)
-			{
+				// Cleared.
 				myfile << "\t\t(when (and " << std::endl;
 				myfile << "\t\t\t\t;; For every state ?s, ?s2" << std::endl;
-			
+		
 				for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
 				{
 					const State* state2 = *ci;
 					myfile << "\t\t\t\t\t(or " << std::endl;
 					myfile << "\t\t\t\t\t\t(not (part-of " << state2->state_name_ << " ?old_kb))" << std::endl;
-					myfile << "\t\t\t\t\t\t(classifiable_on_attempt " << object->name_ << " c" << counter << " " << state2->state_name_ << ")" << std::endl;
+					myfile << "\t\t\t\t\t\t(cleared " << object->name_ << " " << state2->state_name_ << ")" << std::endl;
 					myfile << "\t\t\t\t\t)" << std::endl;
-					
+				
 				}
 				myfile << "\t\t\t\t\t(part-of " << state->state_name_ << " ?new_kb)" << std::endl;
 				myfile << "\t\t\t)" << std::endl;
@@ -1065,68 +1081,62 @@ void ContingentStrategicClassifyPDDLGenerator::generateDomainFile(const std::str
 				for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
 				{
 					const State* state2 = *ci;
-					myfile << "\t\t\t\t(not (classifiable_on_attempt " << object->name_ << " c" << counter << " " << state2->state_name_ << "))" << std::endl;
+					myfile << "\t\t\t\t(not (cleared " << object->name_ << " " << state2->state_name_ << "))" << std::endl;
 				}
-				myfile << "\t\t\t\t(classifiable_on_attempt " << object->name_ << " c" << counter << " " << state->state_name_ << ")" << std::endl;
+				myfile << "\t\t\t\t(cleared " << object->name_ << " " << state->state_name_ << ")" << std::endl;
 				myfile << "\t\t\t)" << std::endl;
 				myfile << "\t\t)" << std::endl;
+			
+				// Deal with the classification attempts on an object.
+				for (unsigned int counter = 0; counter < max_classification_attemps; ++counter)
+				{
+					myfile << "\t\t(when (and " << std::endl;
+					myfile << "\t\t\t\t;; For every state ?s, ?s2" << std::endl;
+			
+					for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
+					{
+						const State* state2 = *ci;
+						myfile << "\t\t\t\t\t(or " << std::endl;
+						myfile << "\t\t\t\t\t\t(not (part-of " << state2->state_name_ << " ?old_kb))" << std::endl;
+						myfile << "\t\t\t\t\t\t(classifiable_on_attempt " << object->name_ << " c" << counter << " " << state2->state_name_ << ")" << std::endl;
+						myfile << "\t\t\t\t\t)" << std::endl;
+					
+					}
+					myfile << "\t\t\t\t\t(part-of " << state->state_name_ << " ?new_kb)" << std::endl;
+					myfile << "\t\t\t)" << std::endl;
+
+					myfile << "\t\t\t;; Conditional effects" << std::endl;
+					myfile << "\t\t\t(and " << std::endl;
+					for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
+					{
+						const State* state2 = *ci;
+						myfile << "\t\t\t\t(not (classifiable_on_attempt " << object->name_ << " c" << counter << " " << state2->state_name_ << "))" << std::endl;
+					}
+					myfile << "\t\t\t\t(classifiable_on_attempt " << object->name_ << " c" << counter << " " << state->state_name_ << ")" << std::endl;
+					myfile << "\t\t\t)" << std::endl;
+					myfile << "\t\t)" << std::endl;
+				}
 			}
 		}
-	}
 	
-	// Location of the agent.
-	for (std::vector<Location*>::const_iterator ci = locations.begin(); ci != locations.end(); ++ci)
-	{
-		const Location* location = *ci;
-		for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
+		// Location of the agent.
+		for (std::vector<Location*>::const_iterator ci = locations.begin(); ci != locations.end(); ++ci)
 		{
-			// Deal with the location of the robot.
-			const State* state = *ci;
-			myfile << "\t\t(when (and " << std::endl;
-			myfile << "\t\t\t\t;; For every state ?s, ?s2" << std::endl;
-		
-			for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
-			{
-				const State* state2 = *ci;
-				myfile << "\t\t\t\t(and " << std::endl;
-				myfile << "\t\t\t\t\t(or " << std::endl;
-				myfile << "\t\t\t\t\t\t(not (part-of " << state2->state_name_ << " ?old_kb))" << std::endl;
-				myfile << "\t\t\t\t\t\t(robot_at robot " << location->name_ << " " << state2->state_name_ << ")" << std::endl;
-				myfile << "\t\t\t\t\t)" << std::endl;
-				myfile << "\t\t\t\t)" << std::endl;
-			}
-			myfile << "\t\t\t\t\t(part-of " << state->state_name_ << " ?new_kb)" << std::endl;
-			myfile << "\t\t\t)" << std::endl;
-
-			myfile << "\t\t\t;; Conditional effects" << std::endl;
-			myfile << "\t\t\t(and " << std::endl;
-			
+			const Location* location = *ci;
 			for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
 			{
-				const State* state2 = *ci;
-				myfile << "\t\t\t\t(not (robot_at robot " << location->name_ << " " << state2->state_name_ << "))" << std::endl;
-			}
-			myfile << "\t\t\t\t(robot_at robot " << location->name_ << " " << state->state_name_ << ")" << std::endl;
-			
-			myfile << "\t\t\t)" << std::endl;
-			myfile << "\t\t)" << std::endl;
-			
-			// The locations of the objects.
-			for (std::vector<Object*>::const_iterator ci = objects.begin(); ci != objects.end(); ++ci)
-			{
-				const Object* object = *ci;
-				
 				// Deal with the location of the robot.
+				const State* state = *ci;
 				myfile << "\t\t(when (and " << std::endl;
 				myfile << "\t\t\t\t;; For every state ?s, ?s2" << std::endl;
-			
+		
 				for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
 				{
 					const State* state2 = *ci;
 					myfile << "\t\t\t\t(and " << std::endl;
 					myfile << "\t\t\t\t\t(or " << std::endl;
 					myfile << "\t\t\t\t\t\t(not (part-of " << state2->state_name_ << " ?old_kb))" << std::endl;
-					myfile << "\t\t\t\t\t\t(object_at " << object->name_ << " " << location->name_ << " " << state2->state_name_ << ")" << std::endl;
+					myfile << "\t\t\t\t\t\t(robot_at robot " << location->name_ << " " << state2->state_name_ << ")" << std::endl;
 					myfile << "\t\t\t\t\t)" << std::endl;
 					myfile << "\t\t\t\t)" << std::endl;
 				}
@@ -1135,16 +1145,52 @@ void ContingentStrategicClassifyPDDLGenerator::generateDomainFile(const std::str
 
 				myfile << "\t\t\t;; Conditional effects" << std::endl;
 				myfile << "\t\t\t(and " << std::endl;
-				
+			
 				for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
 				{
 					const State* state2 = *ci;
-					myfile << "\t\t\t\t(not (object_at " << object->name_ << " " << location->name_ << " " << state2->state_name_ << "))" << std::endl;
+					myfile << "\t\t\t\t(not (robot_at robot " << location->name_ << " " << state2->state_name_ << "))" << std::endl;
 				}
-				myfile << "\t\t\t\t(object_at " << object->name_ << " " << location->name_ << " " << state->state_name_ << ")" << std::endl;
-				
+				myfile << "\t\t\t\t(robot_at robot " << location->name_ << " " << state->state_name_ << ")" << std::endl;
+			
 				myfile << "\t\t\t)" << std::endl;
 				myfile << "\t\t)" << std::endl;
+			
+				// The locations of the objects.
+				for (std::vector<Object*>::const_iterator ci = objects.begin(); ci != objects.end(); ++ci)
+				{
+					const Object* object = *ci;
+				
+					// Deal with the location of the robot.
+					myfile << "\t\t(when (and " << std::endl;
+					myfile << "\t\t\t\t;; For every state ?s, ?s2" << std::endl;
+			
+					for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
+					{
+						const State* state2 = *ci;
+						myfile << "\t\t\t\t(and " << std::endl;
+						myfile << "\t\t\t\t\t(or " << std::endl;
+						myfile << "\t\t\t\t\t\t(not (part-of " << state2->state_name_ << " ?old_kb))" << std::endl;
+						myfile << "\t\t\t\t\t\t(object_at " << object->name_ << " " << location->name_ << " " << state2->state_name_ << ")" << std::endl;
+						myfile << "\t\t\t\t\t)" << std::endl;
+						myfile << "\t\t\t\t)" << std::endl;
+					}
+					myfile << "\t\t\t\t\t(part-of " << state->state_name_ << " ?new_kb)" << std::endl;
+					myfile << "\t\t\t)" << std::endl;
+
+					myfile << "\t\t\t;; Conditional effects" << std::endl;
+					myfile << "\t\t\t(and " << std::endl;
+				
+					for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
+					{
+						const State* state2 = *ci;
+						myfile << "\t\t\t\t(not (object_at " << object->name_ << " " << location->name_ << " " << state2->state_name_ << "))" << std::endl;
+					}
+					myfile << "\t\t\t\t(object_at " << object->name_ << " " << location->name_ << " " << state->state_name_ << ")" << std::endl;
+				
+					myfile << "\t\t\t)" << std::endl;
+					myfile << "\t\t)" << std::endl;
+				}
 			}
 		}
 	}
@@ -1155,8 +1201,27 @@ void ContingentStrategicClassifyPDDLGenerator::generateDomainFile(const std::str
 	myfile.close();
 }
 
-void ContingentStrategicClassifyPDDLGenerator::createPDDL(const std::string& path, const std::string& domain_file, const std::string& problem_file, const std::string& robot_location_predicate, const std::map<std::string, std::string>& object_location_predicates, const std::map<std::string, std::vector<std::string> >& near_waypoint_mapping, unsigned int max_classification_attemps)
+void ContingentStrategicClassifyPDDLGenerator::createPDDL(const std::string& path, const std::string& domain_file, const std::string& problem_file, const std::string& robot_location_predicate, const std::map<std::string, std::string>& object_location_predicates, const std::map<std::string, std::vector<std::string> >& near_waypoint_mapping, unsigned int max_classification_attemps, BeliefEncoding belief_encoding)
 {
+	// Both files only depend on the inputs below, if none of them changed the files are reused before the graph is built.
+	std::string domain_path(path + domain_file);
+	std::string problem_path(path + problem_file);
+	PDDLCache::Fingerprint fingerprint;
+	fingerprint.add("ContingentStrategicClassifyPDDLGenerator").add(robot_location_predicate).add(object_location_predicates).add(near_waypoint_mapping).add(max_classification_attemps).add((unsigned int)belief_encoding);
+	bool domain_restored = PDDLCache::restore(domain_path, fingerprint);
+	bool problem_restored = PDDLCache::restore(problem_path, fingerprint);
+	if (domain_restored && problem_restored)
+	{
+		ROS_INFO("KCL: (ContingentStrategicClassifyPDDLGenerator) Reuse domain... %s and problem... %s", domain_path.c_str(), problem_path.c_str());
+		return;
+	}
+	
+	// All nodes of the graph are released when this function returns.
+	NodePool<Location> location_pool;
+	NodePool<Object> object_pool;
+	NodePool<State> state_pool;
+	NodePool<KnowledgeBase> knowledge_base_pool;
+	
 	std::vector<Location*> locations;
 	std::vector<Object*> objects;
 	std::map<std::string, Object*> predicate_to_object_mapping;
@@ -1167,8 +1232,8 @@ void ContingentStrategicClassifyPDDLGenerator::createPDDL(const std::string& pat
 		const std::string& object_predicate = (*ci).first;
 		const std::string& location_predicate = (*ci).second;
 		
-		Location* object_location = new Location(location_predicate, true);
-		Object* object = new Object(object_predicate, *object_location);
+		Location* object_location = location_pool.create(location_predicate, true);
+		Object* object = object_pool.create(object_predicate, *object_location);
 		
 		locations.push_back(object_location);
 		objects.push_back(object);
@@ -1183,14 +1248,14 @@ void ContingentStrategicClassifyPDDLGenerator::createPDDL(const std::string& pat
 			for (std::vector<std::string>::const_iterator ci = near_waypoints.begin(); ci != near_waypoints.end(); ++ci)
 			{
 				const std::string& near_location_predicate = *ci;
-				Location* near_location = new Location(near_location_predicate, false);
+				Location* near_location = location_pool.create(near_location_predicate, false);
 				locations.push_back(near_location);
 				near_location->near_locations_.push_back(object_location);
 			}
 		}
 	}
 	
-	Location* robot_location = new Location(robot_location_predicate, false);
+	Location* robot_location = location_pool.create(robot_location_predicate, false);
 	locations.push_back(robot_location);
 	
 	// Make all locations fully connected.
@@ -1224,7 +1289,7 @@ void ContingentStrategicClassifyPDDLGenerator::createPDDL(const std::string& pat
 		ss.str(std::string());
 		ss << "kb_" << object->name_;
 		
-		KnowledgeBase* kb_location = new KnowledgeBase(ss.str());
+		KnowledgeBase* kb_location = knowledge_base_pool.create(ss.str());
 		basis_kb.addChild(*kb_location);
 		knowledge_bases.push_back(kb_location);
 		
@@ -1236,20 +1301,24 @@ void ContingentStrategicClassifyPDDLGenerator::createPDDL(const std::string& pat
 			
 			ss.str(std::string());
 			ss << "s" << state_id;
-			State* state_pickupable = new State(ss.str(), classifiable_counter);
+			State* state_pickupable = state_pool.create(ss.str(), classifiable_counter);
 			kb_location->addState(*state_pickupable);
 			++state_id;
 		}
 	}
 	
-	ss.str(std::string());
-	ss << path << domain_file;
-	ROS_INFO("KCL: (ContingentStrategicClassifyPDDLGenerator) Generate domain... %s", ss.str().c_str());
-	generateDomainFile(ss.str(), basis_kb, knowledge_bases, *robot_location, locations, objects, max_classification_attemps);
-	ss.str(std::string());
-	ss << path	<< problem_file;
-	ROS_INFO("KCL: (ContingentStrategicClassifyPDDLGenerator) Generate problem... %s", ss.str().c_str());
-	generateProblemFile(ss.str(), basis_kb, knowledge_bases, *robot_location, locations, objects, max_classification_attemps);
+	if (!domain_restored)
+	{
+		ROS_INFO("KCL: (ContingentStrategicClassifyPDDLGenerator) Generate domain... %s", domain_path.c_str());
+		generateDomainFile(domain_path, basis_kb, knowledge_bases, *robot_location, locations, objects, max_classification_attemps, belief_encoding);
+		PDDLCache::store(domain_path, fingerprint);
+	}
+	if (!problem_restored)
+	{
+		ROS_INFO("KCL: (ContingentStrategicClassifyPDDLGenerator) Generate problem... %s", problem_path.c_str());
+		generateProblemFile(problem_path, basis_kb, knowledge_bases, *robot_location, locations, objects, max_classification_attemps);
+		PDDLCache::store(problem_path, fingerprint);
+	}
 }
 
 };
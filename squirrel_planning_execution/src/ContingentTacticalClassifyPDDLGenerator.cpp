@@ -10,6 +10,9 @@
 #include <ros/ros.h>
 
 #include "squirrel_planning_execution/ContingentTacticalClassifyPDDLGenerator.h"
+#include "squirrel_planning_execution/PDDLWriter.h"
+#include "squirrel_planning_execution/PDDLCache.h"
+#include "squirrel_planning_execution/NodePool.h"
 
 namespace KCL_rosplan {
 
@@ -26,32 +29,31 @@ void ContingentTacticalClassifyPDDLGenerator::generateProblemFile(const std::str
 		}
 	}
 	
-	std::ofstream myfile;
-	myfile.open(file_name.c_str());
-	myfile << "(define (problem squirrel)" << std::endl;
-	myfile << "(:domain classify_objects)" << std::endl;
-	myfile << "(:objects" << std::endl;
+	PDDLWriter myfile(file_name);
+	myfile.begin("define (problem squirrel)");
+	myfile.line("(:domain classify_objects)");
+	myfile.begin(":objects");
 	
-	myfile << "\tl0 - LEVEL" << std::endl;
-	myfile << "\tl1 - LEVEL" << std::endl;
-	myfile << "\tl2 - LEVEL" << std::endl;
-	myfile << ")" << std::endl;
+	myfile.line("l0 - LEVEL");
+	myfile.line("l1 - LEVEL");
+	myfile.line("l2 - LEVEL");
+	myfile.end();
 	myfile << std::endl;
 	
-	myfile << "(:init" << std::endl;
-	myfile << "\t(resolve-axioms)" << std::endl;
-	myfile << "\t(lev l0)" << std::endl;
-	myfile << "\t(next l0 l1)" << std::endl;
-	myfile << "\t(next l1 l2)" << std::endl;
+	myfile.begin(":init");
+	myfile.line("(resolve-axioms)");
+	myfile.line("(lev l0)");
+	myfile.line("(next l0 l1)");
+	myfile.line("(next l1 l2)");
 	
-	myfile << "\t(current_kb " << current_knowledge_base.name_ << ")" << std::endl;
+	myfile.indent() << "(current_kb " << current_knowledge_base.name_ << ")" << std::endl;
 	
 	for (std::vector<const State*>::const_iterator ci = current_knowledge_base.states_.begin(); ci != current_knowledge_base.states_.end(); ++ci)
 	{
 		const State* state = *ci;
-		myfile << "\t(part-of " << state->state_name_ << " " << current_knowledge_base.name_ << ")" << std::endl;
-		myfile << "\t(m " << state->state_name_ << ")" << std::endl;
-		myfile << "\t(robot_at robot " << robot_location.name_ << " " << state->state_name_ << ")" << std::endl;
+		myfile.indent() << "(part-of " << state->state_name_ << " " << current_knowledge_base.name_ << ")" << std::endl;
+		myfile.indent() << "(m " << state->state_name_ << ")" << std::endl;
+		myfile.indent() << "(robot_at robot " << robot_location.name_ << " " << state->state_name_ << ")" << std::endl;
 		//myfile << "\t(gripper_empty robot " << " " << state->state_name_ << ")" << std::endl;
 		
 		// All the objects are clear inially.
@@ -59,7 +61,7 @@ void ContingentTacticalClassifyPDDLGenerator::generateProblemFile(const std::str
 		{
 			const Object* object = *ci;
 			//myfile << "\t(cleared " << object->name_ << " " << state->state_name_ << ")" << std::endl;
-			myfile << "\t(object_at " << object->name_ << " " << object->location_->name_ << " " << state->state_name_ << ")" << std::endl;
+			myfile.indent() << "(object_at " << object->name_ << " " << object->location_->name_ << " " << state->state_name_ << ")" << std::endl;
 			/*
 			for (std::vector<const Location*>::const_iterator ci = object->observable_locations_.begin(); ci != object->observable_locations_.end() - 1; ++ci)
 			{
@@ -77,7 +79,7 @@ void ContingentTacticalClassifyPDDLGenerator::generateProblemFile(const std::str
 		{
 			const Location* location2 = *ci;
 			if (location == location2) continue;
-			myfile << "\t(connected " << location->name_ << " " << location2->name_ << ")" << std::endl;
+			myfile.indent() << "(connected " << location->name_ << " " << location2->name_ << ")" << std::endl;
 		}
 		/*
 		if (location->is_clear_)
@@ -94,7 +96,7 @@ void ContingentTacticalClassifyPDDLGenerator::generateProblemFile(const std::str
 		for (std::vector<const State*>::const_iterator ci = knowledge_base->states_.begin(); ci != knowledge_base->states_.end(); ++ci)
 		{
 			const State* state = *ci;
-			myfile << "\t(part-of " << state->state_name_ << " " << knowledge_base->name_ << ")" << std::endl;
+			myfile.indent() << "(part-of " << state->state_name_ << " " << knowledge_base->name_ << ")" << std::endl;
 			
 			for (std::map<const Object*, const Location*>::const_iterator ci = state->classifiable_from_.begin(); ci != state->classifiable_from_.end(); ++ci)
 			{
@@ -103,33 +105,34 @@ void ContingentTacticalClassifyPDDLGenerator::generateProblemFile(const std::str
 				
 				if ("nowhere" == location->name_)
 				{
-					myfile << "\t(classifiable_from nowhere nowhere " << object->name_ << " " << state->state_name_ << ")" << std::endl;
+					myfile.indent() << "(classifiable_from nowhere nowhere " << object->name_ << " " << state->state_name_ << ")" << std::endl;
 				}
 				else
 				{
-					myfile << "\t(classifiable_from " << location->name_ << " " << object->location_->name_ << " " << object->name_ << " " << state->state_name_ << ")" << std::endl;
+					myfile.indent() << "(classifiable_from " << location->name_ << " " << object->location_->name_ << " " << object->name_ << " " << state->state_name_ << ")" << std::endl;
 				}
 			}
 		}
 		
 		for (std::vector<const KnowledgeBase*>::const_iterator ci = knowledge_base->children_.begin(); ci != knowledge_base->children_.end(); ++ci)
 		{
-			myfile << "\t(parent " << knowledge_base->name_ << " " << (*ci)->name_ << ")" << std::endl;
+			myfile.indent() << "(parent " << knowledge_base->name_ << " " << (*ci)->name_ << ")" << std::endl;
 		}
 	}
-	myfile << ")" << std::endl;
-	myfile << "(:goal (and" << std::endl;
+	myfile.end();
+	myfile.begin(":goal");
+	myfile.begin("and");
 	for (std::vector<Object*>::const_iterator ci = objects.begin(); ci != objects.end(); ++ci)
 	{
 		const Object* object = *ci;
 		for (std::vector<const State*>::const_iterator ci = current_knowledge_base.states_.begin(); ci != current_knowledge_base.states_.end(); ++ci)
 		{
-			myfile << "\t(classified " << object->name_ << " " << (*ci)->state_name_ << ")" << std::endl;
+			myfile.indent() << "(classified " << object->name_ << " " << (*ci)->state_name_ << ")" << std::endl;
 		}
 	}
-	myfile << ")" << std::endl;
-	myfile << ")" << std::endl;
-	myfile << ")" << std::endl;
+	myfile.end();
+	myfile.end();
+	myfile.end();
 	myfile.close();
 }
 
@@ -146,8 +149,7 @@ void ContingentTacticalClassifyPDDLGenerator::generateDomainFile(const std::stri
 		}
 	}
 	
-	std::ofstream myfile;
-	myfile.open (file_name.c_str());
+	PDDLWriter myfile(file_name);
 	myfile << "(define (domain classify_objects)" << std::endl;
 	myfile << "(:requirements :typing :conditional-effects :negative-preconditions :disjunctive-preconditions)" << std::endl;
 	myfile << std::endl;
@@ -946,25 +948,44 @@ void ContingentTacticalClassifyPDDLGenerator::generateDomainFile(const std::stri
 
 void ContingentTacticalClassifyPDDLGenerator::createPDDL(const std::string& path, const std::string& domain_file, const std::string& problem_file, const std::string& robot_location_predicate, const std::vector<std::string>& location_predicates, const std::string& object_predicate, const std::string& object_location_predicate)
 {
+	// Both files only depend on the inputs below, if none of them changed the files are reused before the graph is built.
+	std::string domain_path(path + domain_file);
+	std::string problem_path(path + problem_file);
+	PDDLCache::Fingerprint fingerprint;
+	fingerprint.add("ContingentTacticalClassifyPDDLGenerator").add(robot_location_predicate).add(location_predicates).add(object_predicate).add(object_location_predicate);
+	bool domain_restored = PDDLCache::restore(domain_path, fingerprint);
+	bool problem_restored = PDDLCache::restore(problem_path, fingerprint);
+	if (domain_restored && problem_restored)
+	{
+		ROS_INFO("KCL: (ContingentTacticalClassifyPDDLGenerator) Reuse domain... %s and problem... %s", domain_path.c_str(), problem_path.c_str());
+		return;
+	}
+	
+	// All nodes of the graph are released when this function returns.
+	NodePool<Location> location_pool;
+	NodePool<Object> object_pool;
+	NodePool<State> state_pool;
+	NodePool<KnowledgeBase> knowledge_base_pool;
+	
 	// Now generate the waypoints / boxes / toys / etc.
 	std::vector<Location*> locations;
 	std::vector<Object*> objects;
 	
 	// Initialise the robot's location.
-	Location* robot_location = new Location(robot_location_predicate, false);
+	Location* robot_location = location_pool.create(robot_location_predicate, false);
 	locations.push_back(robot_location);
 	
 	// Initialise the object's location.
-	Location* location = new Location(object_location_predicate, false);
+	Location* location = location_pool.create(object_location_predicate, false);
 	locations.push_back(location);
-	Object* object = new Object(object_predicate, *location);
+	Object* object = object_pool.create(object_predicate, *location);
 	objects.push_back(object);
 	
 	// Add the observation waypoints from where we want to classify the object.
 	for (std::vector<std::string>::const_iterator ci = location_predicates.begin(); ci != location_predicates.end(); ++ci)
 	{
 		const std::string& location_predicate = *ci;
-		Location* location = new Location(location_predicate, true);
+		Location* location = location_pool.create(location_predicate, true);
 		locations.push_back(location);
 		object->observable_locations_.push_back(location);
 	}
@@ -1002,7 +1023,7 @@ void ContingentTacticalClassifyPDDLGenerator::createPDDL(const std::string& path
 		ss.str(std::string());
 		ss << "kb_" << object->name_;
 		
-		KnowledgeBase* kb_location = new KnowledgeBase(ss.str());
+		KnowledgeBase* kb_location = knowledge_base_pool.create(ss.str());
 		basis_kb.addChild(*kb_location);
 		knowledge_bases.push_back(kb_location);
 		
@@ -1015,7 +1036,7 @@ void ContingentTacticalClassifyPDDLGenerator::createPDDL(const std::string& path
 			ss.str(std::string());
 			ss << "kb_" << object->name_;
 			
-			KnowledgeBase* kb_location = new KnowledgeBase(ss.str());
+			KnowledgeBase* kb_location = knowledge_base_pool.create(ss.str());
 			basis_kb.addChild(*kb_location);
 			knowledge_bases.push_back(kb_location);
 			
@@ -1030,21 +1051,25 @@ void ContingentTacticalClassifyPDDLGenerator::createPDDL(const std::string& path
 			
 				ss.str(std::string());
 				ss << "s" << state_id;
-				State* state_pickupable = new State(ss.str(), classifiable_from);
+				State* state_pickupable = state_pool.create(ss.str(), classifiable_from);
 				kb_location->addState(*state_pickupable);
 				++state_id;
 			}
 		}
 	}
 	
-	ss.str(std::string());
-	ss << path << domain_file;
-	ROS_INFO("KCL: (ContingentTacticalClassifyPDDLGenerator) Generate domain... %s", ss.str().c_str());
-	generateDomainFile(ss.str(), basis_kb, knowledge_bases, *robot_location, locations, objects);
-	ss.str(std::string());
-	ss << path  << problem_file;
-	ROS_INFO("KCL: (ContingentTacticalClassifyPDDLGenerator) Generate problem... %s", ss.str().c_str());
-	generateProblemFile(ss.str(), basis_kb, knowledge_bases, *robot_location,locations, objects);
+	if (!domain_restored)
+	{
+		ROS_INFO("KCL: (ContingentTacticalClassifyPDDLGenerator) Generate domain... %s", domain_path.c_str());
+		generateDomainFile(domain_path, basis_kb, knowledge_bases, *robot_location, locations, objects);
+		PDDLCache::store(domain_path, fingerprint);
+	}
+	if (!problem_restored)
+	{
+		ROS_INFO("KCL: (ContingentTacticalClassifyPDDLGenerator) Generate problem... %s", problem_path.c_str());
+		generateProblemFile(problem_path, basis_kb, knowledge_bases, *robot_location, locations, objects);
+		PDDLCache::store(problem_path, fingerprint);
+	}
 }
 
 };
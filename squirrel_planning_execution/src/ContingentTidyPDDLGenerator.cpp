@@ -10,6 +10,9 @@
 #include <ros/ros.h>
 
 #include "squirrel_planning_execution/ContingentTidyPDDLGenerator.h"
+#include "squirrel_planning_execution/PDDLWriter.h"
+#include "squirrel_planning_execution/PDDLCache.h"
+#include "squirrel_planning_execution/NodePool.h"
 
 namespace KCL_rosplan {
 
@@ -26,40 +29,39 @@ void ContingentTidyPDDLGenerator::generateProblemFile(const std::string& file_na
 		}
 	}
 	
-	std::ofstream myfile;
-	myfile.open(file_name.c_str());
-	myfile << "(define (problem Keys-0)" << std::endl;
-	myfile << "(:domain find_key)" << std::endl;
-	myfile << "(:objects" << std::endl;
+	PDDLWriter myfile(file_name);
+	myfile.begin("define (problem Keys-0)");
+	myfile.line("(:domain find_key)");
+	myfile.begin(":objects");
 	
-	myfile << "\tl0 - LEVEL" << std::endl;
-	myfile << "\tl1 - LEVEL" << std::endl;
-	myfile << ")" << std::endl;
+	myfile.line("l0 - LEVEL");
+	myfile.line("l1 - LEVEL");
+	myfile.end();
 	myfile << std::endl;
 	
-	myfile << "(:init" << std::endl;
-	myfile << "\t(resolve-axioms)" << std::endl;
-	myfile << "\t(lev l0)" << std::endl;
+	myfile.begin(":init");
+	myfile.line("(resolve-axioms)");
+	myfile.line("(lev l0)");
 	
-	myfile << "\t(next l0 l1)" << std::endl;
+	myfile.line("(next l0 l1)");
 	
-	myfile << "\t(current_kb " << current_knowledge_base.name_ << ")" << std::endl;
+	myfile.indent() << "(current_kb " << current_knowledge_base.name_ << ")" << std::endl;
 	
 	// Location of the robot.
 	for (std::vector<const State*>::const_iterator ci = current_knowledge_base.states_.begin(); ci != current_knowledge_base.states_.end(); ++ci)
 	{
 		const State* state = *ci;
-		myfile << "\t(part-of " << state->state_name_ << " " << current_knowledge_base.name_ << ")" << std::endl;
-		myfile << "\t(m " << state->state_name_ << ")" << std::endl;
-		myfile << "\t(robot_at robot " << robot_location.name_ << " " << state->state_name_ << ")" << std::endl;
-		myfile << "\t(gripper_empty robot " << " " << state->state_name_ << ")" << std::endl;
+		myfile.indent() << "(part-of " << state->state_name_ << " " << current_knowledge_base.name_ << ")" << std::endl;
+		myfile.indent() << "(m " << state->state_name_ << ")" << std::endl;
+		myfile.indent() << "(robot_at robot " << robot_location.name_ << " " << state->state_name_ << ")" << std::endl;
+		myfile.indent() << "(gripper_empty robot " << " " << state->state_name_ << ")" << std::endl;
 		
 		// All the objects are clear inially.
 		for (std::vector<const Object*>::const_iterator ci = objects.begin(); ci != objects.end(); ++ci)
 		{
 			const Object* object = *ci;
 			//myfile << "\t(clear " << object->name_ << " " << state->state_name_ << ")" << std::endl;
-			myfile << "\t(object_at " << object->name_ << " " << object->location_->name_ << " " << state->state_name_ << ")" << std::endl;
+			myfile.indent() << "(object_at " << object->name_ << " " << object->location_->name_ << " " << state->state_name_ << ")" << std::endl;
 		}
 		
 		for (std::vector<const Location*>::const_iterator ci = locations.begin(); ci != locations.end(); ++ci)
@@ -89,7 +91,7 @@ void ContingentTidyPDDLGenerator::generateProblemFile(const std::string& file_na
 			
 			if (!is_blocked)
 			{
-				myfile << "\t(is_not_occupied " << location->name_ << " " << state->state_name_ << ")" << std::endl;
+				myfile.indent() << "(is_not_occupied " << location->name_ << " " << state->state_name_ << ")" << std::endl;
 			}
 		}
 	}
@@ -98,7 +100,7 @@ void ContingentTidyPDDLGenerator::generateProblemFile(const std::string& file_na
 	for (std::vector<const Box*>::const_iterator ci = boxes.begin(); ci != boxes.end(); ++ci)
 	{
 		const Box* box = *ci;
-		myfile << "\t(box_at " << box->name_ << " " << box->location_->name_ << ")" << std::endl;
+		myfile.indent() << "(box_at " << box->name_ << " " << box->location_->name_ << ")" << std::endl;
 		for (std::vector<const Type*>::const_iterator ci = box->types_that_fit_.begin(); ci != box->types_that_fit_.end(); ++ci)
 		{
 			const Type* type = *ci;
@@ -109,7 +111,7 @@ void ContingentTidyPDDLGenerator::generateProblemFile(const std::string& file_na
 				for (std::vector<const State*>::const_iterator ci = knowledge_base->states_.begin(); ci != knowledge_base->states_.end(); ++ci)
 				{
 					const State* state = *ci;
-					myfile << "\t(can_fit_inside " << type->name_ << " " << box->name_ << " " << state->state_name_ << ")" << std::endl;
+					myfile.indent() << "(can_fit_inside " << type->name_ << " " << box->name_ << " " << state->state_name_ << ")" << std::endl;
 				}
 			}
 		}
@@ -140,7 +142,7 @@ void ContingentTidyPDDLGenerator::generateProblemFile(const std::string& file_na
 		for (std::vector<const State*>::const_iterator ci = knowledge_base->states_.begin(); ci != knowledge_base->states_.end(); ++ci)
 		{
 			const State* state = *ci;
-			myfile << "\t(part-of " << state->state_name_ << " " << knowledge_base->name_ << ")" << std::endl;
+			myfile.indent() << "(part-of " << state->state_name_ << " " << knowledge_base->name_ << ")" << std::endl;
 			
 			/*
 			for (std::map<const Object*, const Object*>::const_iterator ci = state->stackable_mapping_.begin(); ci != state->stackable_mapping_.end(); ++ci)
@@ -150,42 +152,43 @@ void ContingentTidyPDDLGenerator::generateProblemFile(const std::string& file_na
 			*/
 			for (std::map<const Object*, const Type*>::const_iterator ci = state->type_mapping_.begin(); ci != state->type_mapping_.end(); ++ci)
 			{
-				myfile << "\t(is_of_type " << (*ci).first->name_ << " " << (*ci).second->name_ << " " << state->state_name_ << ")" << std::endl;
+				myfile.indent() << "(is_of_type " << (*ci).first->name_ << " " << (*ci).second->name_ << " " << state->state_name_ << ")" << std::endl;
 			}
 			
 			for (std::vector<const Type*>::const_iterator ci = state->pushable_objects_.begin(); ci != state->pushable_objects_.end(); ++ci)
 			{
-				myfile << "\t(can_push robot " << (*ci)->name_ << " " << state->state_name_ << ")" << std::endl;
+				myfile.indent() << "(can_push robot " << (*ci)->name_ << " " << state->state_name_ << ")" << std::endl;
 			}
 			
 			for (std::vector<const Type*>::const_iterator ci = state->pickupable_objects_.begin(); ci != state->pickupable_objects_.end(); ++ci)
 			{
-				myfile << "\t(can_pickup robot " << (*ci)->name_ << " " << state->state_name_ << ")" << std::endl;
+				myfile.indent() << "(can_pickup robot " << (*ci)->name_ << " " << state->state_name_ << ")" << std::endl;
 			}
 		}
 		
 		for (std::vector<const KnowledgeBase*>::const_iterator ci = knowledge_base->children_.begin(); ci != knowledge_base->children_.end(); ++ci)
 		{
-			myfile << "\t(parent " << knowledge_base->name_ << " " << (*ci)->name_ << ")" << std::endl;
+			myfile.indent() << "(parent " << knowledge_base->name_ << " " << (*ci)->name_ << ")" << std::endl;
 		}
 	}
-	myfile << ")" << std::endl;
-	myfile << "(:goal (and" << std::endl;
+	myfile.end();
+	myfile.begin(":goal");
+	myfile.begin("and");
 	for (std::vector<const Object*>::const_iterator ci = objects.begin(); ci != objects.end(); ++ci)
 	{
 		const Object* object = *ci;
 		for (std::vector<const State*>::const_iterator ci = current_knowledge_base.states_.begin(); ci != current_knowledge_base.states_.end(); ++ci)
 		{
-			myfile << "\t(tidy " << object->name_ << " " << (*ci)->state_name_ << ")" << std::endl;
+			myfile.indent() << "(tidy " << object->name_ << " " << (*ci)->state_name_ << ")" << std::endl;
 		}
 	}
-	myfile << ")" << std::endl;
-	myfile << ")" << std::endl;
-	myfile << ")" << std::endl;
+	myfile.end();
+	myfile.end();
+	myfile.end();
 	myfile.close();
 }
 
-void ContingentTidyPDDLGenerator::generateDomainFile(const std::string& file_name, const KnowledgeBase& current_knowledge_base, const std::vector<const KnowledgeBase*>& knowledge_bases, const Location& robot_location, const std::vector<const Location*>& locations, const std::vector<const Object*>& objects, const std::vector<const Box*>& boxes, const std::vector<const Type*>& types)
+void ContingentTidyPDDLGenerator::generateDomainFile(const std::string& file_name, const KnowledgeBase& current_knowledge_base, const std::vector<const KnowledgeBase*>& knowledge_bases, const Location& robot_location, const std::vector<const Location*>& locations, const std::vector<const Object*>& objects, const std::vector<const Box*>& boxes, const std::vector<const Type*>& types, BeliefEncoding belief_encoding)
 {
 	std::vector<const State*> states;
 	for (std::vector<const KnowledgeBase*>::const_iterator ci = knowledge_bases.begin(); ci != knowledge_bases.end(); ++ci)
@@ -198,10 +201,32 @@ void ContingentTidyPDDLGenerator::generateDomainFile(const std::string& file_nam
 		}
 	}
 	
-	std::ofstream myfile;
-	myfile.open (file_name.c_str());
+	// The facts that are moved between knowledge bases by assume_knowledge and shed_knowledge.
+	std::vector<StateFact> shed_facts;
+	shed_facts.push_back(StateFact("gripper_empty", "?v - robot"));
+	shed_facts.push_back(StateFact("holding", "?v - robot ?o - object"));
+	shed_facts.push_back(StateFact("tidy", "?o - object"));
+	shed_facts.push_back(StateFact("inside", "?o - object ?b - box"));
+	shed_facts.push_back(StateFact("robot_at", "?v - robot ?wp - waypoint"));
+	shed_facts.push_back(StateFact("is_not_occupied", "?wp - waypoint"));
+	shed_facts.push_back(StateFact("object_at", "?o - object ?wp - waypoint"));
+	
+	std::vector<StateFact> assume_facts(shed_facts);
+	assume_facts.push_back(StateFact("can_pickup", "?v - robot ?t - type"));
+	assume_facts.push_back(StateFact("can_push", "?v - robot ?t - type"));
+	assume_facts.push_back(StateFact("can_fit_inside", "?t - type ?b - box"));
+	assume_facts.push_back(StateFact("tidy_location", "?t - type ?wp - waypoint"));
+	
+	PDDLWriter myfile(file_name);
 	myfile << "(define (domain find_key)" << std::endl;
-	myfile << "(:requirements :typing :conditional-effects :negative-preconditions :disjunctive-preconditions)" << std::endl;
+	if (belief_encoding == LIFTED_BELIEF_ENCODING)
+	{
+		myfile << "(:requirements :typing :conditional-effects :negative-preconditions :disjunctive-preconditions :quantified-preconditions)" << std::endl;
+	}
+	else
+	{
+		myfile << "(:requirements :typing :conditional-effects :negative-preconditions :disjunctive-preconditions)" << std::endl;
+	}
 	myfile << std::endl;
 	myfile << "(:types" << std::endl;
 	myfile << "\twaypoint robot object box type" << std::endl;
@@ -1087,207 +1112,214 @@ void ContingentTidyPDDLGenerator::generateDomainFile(const std::string& file_nam
 	myfile << "\t\t(resolve-axioms)" << std::endl;
 	myfile << std::endl;
 	
-	myfile << "\t\t;; Now we need to delete all knowledge from the old_kb and insert it to" << std::endl;
-	myfile << "\t\t;; the new_kb level." << std::endl;
-
-	myfile << "\t\t;; For every state ?s, ?s2" << std::endl;
-	for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
+	if (belief_encoding == LIFTED_BELIEF_ENCODING)
 	{
-		const State* state = *ci;
-		
-		// Get rid of all states that are not part of this knowledge base.
-		myfile << "\t\t(when (and (m " << state->state_name_ << ") (not (part-of " << state->state_name_ << " ?new_kb)))" << std::endl;
-		myfile << "\t\t\t(not (m " << state->state_name_ << "))" << std::endl;
-		myfile << "\t\t)" << std::endl;
-		
-		// Enable the states that are encapsulated in this knowledge base.
-		myfile << "\t\t(when (part-of " << state->state_name_ << " ?new_kb)" << std::endl;
-		myfile << "\t\t\t(and (m " << state->state_name_ << "))" << std::endl;
-		myfile << "\t\t)" << std::endl;
-		
-		// Copy all knowledge that is part of ?old_kb to all the new states.
+		writeLiftedAssumeKnowledgeEffects(myfile, assume_facts);
+	}
+	else
+	{
+		myfile << "\t\t;; Now we need to delete all knowledge from the old_kb and insert it to" << std::endl;
+		myfile << "\t\t;; the new_kb level." << std::endl;
+
+		myfile << "\t\t;; For every state ?s, ?s2" << std::endl;
 		for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
 		{
-			const State* state2 = *ci;
-			
-			myfile << "\t\t(when (and (part-of " << state->state_name_ << " ?old_kb) (gripper_empty robot " << state->state_name_ << ") (part-of " << state2->state_name_ << " ?new_kb))" << std::endl;
-			myfile << "\t\t\t(and " << std::endl;
-			myfile << "\t\t\t\t(not (Rgripper_empty robot " << state->state_name_ << "))" << std::endl;
-			myfile << "\t\t\t\t(not (gripper_empty robot " << state->state_name_ << "))" << std::endl;
-			myfile << "\t\t\t\t(Rgripper_empty robot " << state2->state_name_ << ")" << std::endl;
-			myfile << "\t\t\t\t(gripper_empty robot " << state2->state_name_ << ")" << std::endl;
-			myfile << "\t\t\t)" << std::endl;
+			const State* state = *ci;
+		
+			// Get rid of all states that are not part of this knowledge base.
+			myfile << "\t\t(when (and (m " << state->state_name_ << ") (not (part-of " << state->state_name_ << " ?new_kb)))" << std::endl;
+			myfile << "\t\t\t(not (m " << state->state_name_ << "))" << std::endl;
 			myfile << "\t\t)" << std::endl;
-			
-			for (std::vector<const Object*>::const_iterator ci = objects.begin(); ci != objects.end(); ++ci)
+		
+			// Enable the states that are encapsulated in this knowledge base.
+			myfile << "\t\t(when (part-of " << state->state_name_ << " ?new_kb)" << std::endl;
+			myfile << "\t\t\t(and (m " << state->state_name_ << "))" << std::endl;
+			myfile << "\t\t)" << std::endl;
+		
+			// Copy all knowledge that is part of ?old_kb to all the new states.
+			for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
 			{
-				const Object* object = *ci;
-				myfile << "\t\t(when (and (part-of " << state->state_name_ << " ?old_kb) (holding robot " << object->name_ << " " << state->state_name_ << ") (part-of " << state2->state_name_ << " ?new_kb))" << std::endl;
-				myfile << "\t\t\t(and " << std::endl;
-				myfile << "\t\t\t\t(not (Rholding robot " << object->name_ << " " << state->state_name_ << "))" << std::endl;
-				myfile << "\t\t\t\t(not (holding robot " << object->name_ << " " << state->state_name_ << "))" << std::endl;
-				myfile << "\t\t\t\t(Rholding robot " << object->name_ << " " << state2->state_name_ << ")" << std::endl;
-				myfile << "\t\t\t\t(holding robot " << object->name_ << " " << state2->state_name_ << ")" << std::endl;
-				myfile << "\t\t\t)" << std::endl;
-				myfile << "\t\t)" << std::endl;
-				/*
-				myfile << "\t\t(when (and (part-of " << state->state_name_ << " ?old_kb) (clear " << object->name_ << " " << state->state_name_ << ") (part-of " << state2->state_name_ << " ?new_kb))" << std::endl;
-				myfile << "\t\t\t(and " << std::endl;
-				myfile << "\t\t\t\t(not (Rclear " << object->name_ << " " << state->state_name_ << "))" << std::endl;
-				myfile << "\t\t\t\t(not (clear " << object->name_ << " " << state->state_name_ << "))" << std::endl;
-				myfile << "\t\t\t\t(Rclear " << object->name_ << " " << state2->state_name_ << ")" << std::endl;
-				myfile << "\t\t\t\t(clear " << object->name_ << " " << state2->state_name_ << ")" << std::endl;
-				myfile << "\t\t\t)" << std::endl;
-				myfile << "\t\t)" << std::endl;
-				*/
-				myfile << "\t\t(when (and (part-of " << state->state_name_ << " ?old_kb) (tidy " << object->name_ << " " << state->state_name_ << ") (part-of " << state2->state_name_ << " ?new_kb))" << std::endl;
+				const State* state2 = *ci;
+			
+				myfile << "\t\t(when (and (part-of " << state->state_name_ << " ?old_kb) (gripper_empty robot " << state->state_name_ << ") (part-of " << state2->state_name_ << " ?new_kb))" << std::endl;
 				myfile << "\t\t\t(and " << std::endl;
-				myfile << "\t\t\t\t(not (Rtidy " << object->name_ << " " << state->state_name_ << "))" << std::endl;
-				myfile << "\t\t\t\t(not (tidy " << object->name_ << " " << state->state_name_ << "))" << std::endl;
-				myfile << "\t\t\t\t(Rtidy " << object->name_ << " " << state2->state_name_ << ")" << std::endl;
-				myfile << "\t\t\t\t(tidy " << object->name_ << " " << state2->state_name_ << ")" << std::endl;
+				myfile << "\t\t\t\t(not (Rgripper_empty robot " << state->state_name_ << "))" << std::endl;
+				myfile << "\t\t\t\t(not (gripper_empty robot " << state->state_name_ << "))" << std::endl;
+				myfile << "\t\t\t\t(Rgripper_empty robot " << state2->state_name_ << ")" << std::endl;
+				myfile << "\t\t\t\t(gripper_empty robot " << state2->state_name_ << ")" << std::endl;
 				myfile << "\t\t\t)" << std::endl;
 				myfile << "\t\t)" << std::endl;
-				/*
+			
 				for (std::vector<const Object*>::const_iterator ci = objects.begin(); ci != objects.end(); ++ci)
 				{
-					const Object* other_object = *ci;
-					myfile << "\t\t(when (and (part-of " << state->state_name_ << " ?old_kb) (on " << object->name_ << " " << other_object->name_ << " " << state->state_name_ << ") (part-of " << state2->state_name_ << " ?new_kb))" << std::endl;
+					const Object* object = *ci;
+					myfile << "\t\t(when (and (part-of " << state->state_name_ << " ?old_kb) (holding robot " << object->name_ << " " << state->state_name_ << ") (part-of " << state2->state_name_ << " ?new_kb))" << std::endl;
 					myfile << "\t\t\t(and " << std::endl;
-					myfile << "\t\t\t\t(not (Ron " << object->name_ << " " << other_object->name_ << " " << state->state_name_ << "))" << std::endl;
-					myfile << "\t\t\t\t(not (on " << object->name_ << " " << other_object->name_ << " " << state->state_name_ << "))" << std::endl;
-					myfile << "\t\t\t\t(Ron " << object->name_ << " " << other_object->name_ << " " << state2->state_name_ << ")" << std::endl;
-					myfile << "\t\t\t\t(on " << object->name_ << " " << other_object->name_ << " " << state2->state_name_ << ")" << std::endl;
+					myfile << "\t\t\t\t(not (Rholding robot " << object->name_ << " " << state->state_name_ << "))" << std::endl;
+					myfile << "\t\t\t\t(not (holding robot " << object->name_ << " " << state->state_name_ << "))" << std::endl;
+					myfile << "\t\t\t\t(Rholding robot " << object->name_ << " " << state2->state_name_ << ")" << std::endl;
+					myfile << "\t\t\t\t(holding robot " << object->name_ << " " << state2->state_name_ << ")" << std::endl;
 					myfile << "\t\t\t)" << std::endl;
 					myfile << "\t\t)" << std::endl;
-					
-					myfile << "\t\t(when (and (part-of " << state->state_name_ << " ?old_kb) (can_stack_on " << object->name_ << " " << other_object->name_ << " " << state->state_name_ << ") (part-of " << state2->state_name_ << " ?new_kb))" << std::endl;
+					/*
+					myfile << "\t\t(when (and (part-of " << state->state_name_ << " ?old_kb) (clear " << object->name_ << " " << state->state_name_ << ") (part-of " << state2->state_name_ << " ?new_kb))" << std::endl;
 					myfile << "\t\t\t(and " << std::endl;
-					myfile << "\t\t\t\t(not (Rcan_stack_on " << object->name_ << " " << other_object->name_ << " " << state->state_name_ << "))" << std::endl;
-					myfile << "\t\t\t\t(not (can_stack_on " << object->name_ << " " << other_object->name_ << " " << state->state_name_ << "))" << std::endl;
-					myfile << "\t\t\t\t(Rcan_stack_on " << object->name_ << " " << other_object->name_ << " " << state2->state_name_ << ")" << std::endl;
-					myfile << "\t\t\t\t(can_stack_on " << object->name_ << " " << other_object->name_ << " " << state2->state_name_ << ")" << std::endl;
+					myfile << "\t\t\t\t(not (Rclear " << object->name_ << " " << state->state_name_ << "))" << std::endl;
+					myfile << "\t\t\t\t(not (clear " << object->name_ << " " << state->state_name_ << "))" << std::endl;
+					myfile << "\t\t\t\t(Rclear " << object->name_ << " " << state2->state_name_ << ")" << std::endl;
+					myfile << "\t\t\t\t(clear " << object->name_ << " " << state2->state_name_ << ")" << std::endl;
 					myfile << "\t\t\t)" << std::endl;
 					myfile << "\t\t)" << std::endl;
-				}
-				*/
-				for (std::vector<const Box*>::const_iterator ci = boxes.begin(); ci != boxes.end(); ++ci)
-				{
-					const Box* box = *ci;
-					myfile << "\t\t(when (and (part-of " << state->state_name_ << " ?old_kb) (inside " << object->name_ << " " << box->name_ << " " << state->state_name_ << ") (part-of " << state2->state_name_ << " ?new_kb))" << std::endl;
+					*/
+					myfile << "\t\t(when (and (part-of " << state->state_name_ << " ?old_kb) (tidy " << object->name_ << " " << state->state_name_ << ") (part-of " << state2->state_name_ << " ?new_kb))" << std::endl;
 					myfile << "\t\t\t(and " << std::endl;
-					myfile << "\t\t\t\t(not (Rinside " << object->name_ << " " << box->name_ << " " << state->state_name_ << "))" << std::endl;
-					myfile << "\t\t\t\t(not (inside " << object->name_ << " " << box->name_ << " " << state->state_name_ << "))" << std::endl;
-					myfile << "\t\t\t\t(Rinside " << object->name_ << " " << box->name_ << " " << state2->state_name_ << ")" << std::endl;
-					myfile << "\t\t\t\t(inside " << object->name_ << " " << box->name_ << " " << state2->state_name_ << ")" << std::endl;
+					myfile << "\t\t\t\t(not (Rtidy " << object->name_ << " " << state->state_name_ << "))" << std::endl;
+					myfile << "\t\t\t\t(not (tidy " << object->name_ << " " << state->state_name_ << "))" << std::endl;
+					myfile << "\t\t\t\t(Rtidy " << object->name_ << " " << state2->state_name_ << ")" << std::endl;
+					myfile << "\t\t\t\t(tidy " << object->name_ << " " << state2->state_name_ << ")" << std::endl;
 					myfile << "\t\t\t)" << std::endl;
 					myfile << "\t\t)" << std::endl;
+					/*
+					for (std::vector<const Object*>::const_iterator ci = objects.begin(); ci != objects.end(); ++ci)
+					{
+						const Object* other_object = *ci;
+						myfile << "\t\t(when (and (part-of " << state->state_name_ << " ?old_kb) (on " << object->name_ << " " << other_object->name_ << " " << state->state_name_ << ") (part-of " << state2->state_name_ << " ?new_kb))" << std::endl;
+						myfile << "\t\t\t(and " << std::endl;
+						myfile << "\t\t\t\t(not (Ron " << object->name_ << " " << other_object->name_ << " " << state->state_name_ << "))" << std::endl;
+						myfile << "\t\t\t\t(not (on " << object->name_ << " " << other_object->name_ << " " << state->state_name_ << "))" << std::endl;
+						myfile << "\t\t\t\t(Ron " << object->name_ << " " << other_object->name_ << " " << state2->state_name_ << ")" << std::endl;
+						myfile << "\t\t\t\t(on " << object->name_ << " " << other_object->name_ << " " << state2->state_name_ << ")" << std::endl;
+						myfile << "\t\t\t)" << std::endl;
+						myfile << "\t\t)" << std::endl;
+					
+						myfile << "\t\t(when (and (part-of " << state->state_name_ << " ?old_kb) (can_stack_on " << object->name_ << " " << other_object->name_ << " " << state->state_name_ << ") (part-of " << state2->state_name_ << " ?new_kb))" << std::endl;
+						myfile << "\t\t\t(and " << std::endl;
+						myfile << "\t\t\t\t(not (Rcan_stack_on " << object->name_ << " " << other_object->name_ << " " << state->state_name_ << "))" << std::endl;
+						myfile << "\t\t\t\t(not (can_stack_on " << object->name_ << " " << other_object->name_ << " " << state->state_name_ << "))" << std::endl;
+						myfile << "\t\t\t\t(Rcan_stack_on " << object->name_ << " " << other_object->name_ << " " << state2->state_name_ << ")" << std::endl;
+						myfile << "\t\t\t\t(can_stack_on " << object->name_ << " " << other_object->name_ << " " << state2->state_name_ << ")" << std::endl;
+						myfile << "\t\t\t)" << std::endl;
+						myfile << "\t\t)" << std::endl;
+					}
+					*/
+					for (std::vector<const Box*>::const_iterator ci = boxes.begin(); ci != boxes.end(); ++ci)
+					{
+						const Box* box = *ci;
+						myfile << "\t\t(when (and (part-of " << state->state_name_ << " ?old_kb) (inside " << object->name_ << " " << box->name_ << " " << state->state_name_ << ") (part-of " << state2->state_name_ << " ?new_kb))" << std::endl;
+						myfile << "\t\t\t(and " << std::endl;
+						myfile << "\t\t\t\t(not (Rinside " << object->name_ << " " << box->name_ << " " << state->state_name_ << "))" << std::endl;
+						myfile << "\t\t\t\t(not (inside " << object->name_ << " " << box->name_ << " " << state->state_name_ << "))" << std::endl;
+						myfile << "\t\t\t\t(Rinside " << object->name_ << " " << box->name_ << " " << state2->state_name_ << ")" << std::endl;
+						myfile << "\t\t\t\t(inside " << object->name_ << " " << box->name_ << " " << state2->state_name_ << ")" << std::endl;
+						myfile << "\t\t\t)" << std::endl;
+						myfile << "\t\t)" << std::endl;
+					}
 				}
-			}
 			
-			for (std::vector<const Location*>::const_iterator ci = locations.begin(); ci != locations.end(); ++ci)
-			{
-				const Location* location = *ci;
-				
-				myfile << "\t\t(when (and (part-of " << state->state_name_ << " ?old_kb) (robot_at robot " << location->name_ << " " << state->state_name_ << ") (part-of " << state2->state_name_ << " ?new_kb))" << std::endl;
-				myfile << "\t\t\t(and " << std::endl;
-				myfile << "\t\t\t\t(not (Rrobot_at robot " << location->name_ << " " << state->state_name_ << "))" << std::endl;
-				myfile << "\t\t\t\t(not (robot_at robot " << location->name_ << " " << state->state_name_ << "))" << std::endl;
-				myfile << "\t\t\t\t(Rrobot_at robot " << location->name_ << " " << state2->state_name_ << ")" << std::endl;
-				myfile << "\t\t\t\t(robot_at robot " << location->name_ << " " << state2->state_name_ << ")" << std::endl;
-				myfile << "\t\t\t)" << std::endl;
-				myfile << "\t\t)" << std::endl;
-				
-				myfile << "\t\t(when (and (part-of " << state->state_name_ << " ?old_kb) (is_not_occupied " << location->name_ << " " << state->state_name_ << ") (part-of " << state2->state_name_ << " ?new_kb))" << std::endl;
-				myfile << "\t\t\t(and " << std::endl;
-				myfile << "\t\t\t\t(not (Ris_not_occupied " << location->name_ << " " << state->state_name_ << "))" << std::endl;
-				myfile << "\t\t\t\t(not (is_not_occupied " << location->name_ << " " << state->state_name_ << "))" << std::endl;
-				myfile << "\t\t\t\t(Ris_not_occupied " << location->name_ << " " << state2->state_name_ << ")" << std::endl;
-				myfile << "\t\t\t\t(is_not_occupied " << location->name_ << " " << state2->state_name_ << ")" << std::endl;
-				myfile << "\t\t\t)" << std::endl;
-				myfile << "\t\t)" << std::endl;
+				for (std::vector<const Location*>::const_iterator ci = locations.begin(); ci != locations.end(); ++ci)
+				{
+					const Location* location = *ci;
 				
+					myfile << "\t\t(when (and (part-of " << state->state_name_ << " ?old_kb) (robot_at robot " << location->name_ << " " << state->state_name_ << ") (part-of " << state2->state_name_ << " ?new_kb))" << std::endl;
+					myfile << "\t\t\t(and " << std::endl;
+					myfile << "\t\t\t\t(not (Rrobot_at robot " << location->name_ << " " << state->state_name_ << "))" << std::endl;
+					myfile << "\t\t\t\t(not (robot_at robot " << location->name_ << " " << state->state_name_ << "))" << std::endl;
+					myfile << "\t\t\t\t(Rrobot_at robot " << location->name_ << " " << state2->state_name_ << ")" << std::endl;
+					myfile << "\t\t\t\t(robot_at robot " << location->name_ << " " << state2->state_name_ << ")" << std::endl;
+					myfile << "\t\t\t)" << std::endl;
+					myfile << "\t\t)" << std::endl;
 				
-				/*
-				myfile << "\t\t(when (and (part-of " << state->state_name_ << " ?old_kb) (box_at robot " << location->name_ << " " << state->state_name_ << ") (part-of " << state2->state_name_ << " ?new_kb))" << std::endl;
-				myfile << "\t\t\t(and " << std::endl;
-				myfile << "\t\t\t\t(not (Rbox_at robot " << location->name_ << " " << state->state_name_ << "))" << std::endl;
-				myfile << "\t\t\t\t(not (box_at robot " << location->name_ << " " << state->state_name_ << "))" << std::endl;
-				myfile << "\t\t\t\t(Rbox_at robot " << location->name_ << " " << state2->state_name_ << ")" << std::endl;
-				myfile << "\t\t\t\t(box_at robot " << location->name_ << " " << state2->state_name_ << ")" << std::endl;
-				myfile << "\t\t\t)" << std::endl;
-				myfile << "\t\t)" << std::endl;
-				*/
-				for (std::vector<const Object*>::const_iterator ci = objects.begin(); ci != objects.end(); ++ci)
-				{
-					const Object* object = *ci;
-					myfile << "\t\t(when (and (part-of " << state->state_name_ << " ?old_kb) (object_at " << object->name_ << " " << location->name_ << " " << state->state_name_ << ") (part-of " << state2->state_name_ << " ?new_kb))" << std::endl;
+					myfile << "\t\t(when (and (part-of " << state->state_name_ << " ?old_kb) (is_not_occupied " << location->name_ << " " << state->state_name_ << ") (part-of " << state2->state_name_ << " ?new_kb))" << std::endl;
 					myfile << "\t\t\t(and " << std::endl;
-					myfile << "\t\t\t\t(not (Robject_at " << object->name_ << " " << location->name_ << " " << state->state_name_ << "))" << std::endl;
-					myfile << "\t\t\t\t(not (object_at " << object->name_ << " " << location->name_ << " " << state->state_name_ << "))" << std::endl;
-					myfile << "\t\t\t\t(Robject_at " << object->name_ << " " << location->name_ << " " << state2->state_name_ << ")" << std::endl;
-					myfile << "\t\t\t\t(object_at " << object->name_ << " " << location->name_ << " " << state2->state_name_ << ")" << std::endl;
+					myfile << "\t\t\t\t(not (Ris_not_occupied " << location->name_ << " " << state->state_name_ << "))" << std::endl;
+					myfile << "\t\t\t\t(not (is_not_occupied " << location->name_ << " " << state->state_name_ << "))" << std::endl;
+					myfile << "\t\t\t\t(Ris_not_occupied " << location->name_ << " " << state2->state_name_ << ")" << std::endl;
+					myfile << "\t\t\t\t(is_not_occupied " << location->name_ << " " << state2->state_name_ << ")" << std::endl;
 					myfile << "\t\t\t)" << std::endl;
 					myfile << "\t\t)" << std::endl;
+				
+				
 					/*
-					myfile << "\t\t(when (and (part-of " << state->state_name_ << " ?old_kb) (push_location " << object->name_ << " " << location->name_ << " " << state->state_name_ << ") (part-of " << state2->state_name_ << " ?new_kb))" << std::endl;
+					myfile << "\t\t(when (and (part-of " << state->state_name_ << " ?old_kb) (box_at robot " << location->name_ << " " << state->state_name_ << ") (part-of " << state2->state_name_ << " ?new_kb))" << std::endl;
 					myfile << "\t\t\t(and " << std::endl;
-					myfile << "\t\t\t\t(not (Rpush_location " << object->name_ << " " << location->name_ << " " << state->state_name_ << "))" << std::endl;
-					myfile << "\t\t\t\t(not (push_location " << object->name_ << " " << location->name_ << " " << state->state_name_ << "))" << std::endl;
-					myfile << "\t\t\t\t(Rpush_location " << object->name_ << " " << location->name_ << " " << state2->state_name_ << ")" << std::endl;
-					myfile << "\t\t\t\t(push_location " << object->name_ << " " << location->name_ << " " << state2->state_name_ << ")" << std::endl;
+					myfile << "\t\t\t\t(not (Rbox_at robot " << location->name_ << " " << state->state_name_ << "))" << std::endl;
+					myfile << "\t\t\t\t(not (box_at robot " << location->name_ << " " << state->state_name_ << "))" << std::endl;
+					myfile << "\t\t\t\t(Rbox_at robot " << location->name_ << " " << state2->state_name_ << ")" << std::endl;
+					myfile << "\t\t\t\t(box_at robot " << location->name_ << " " << state2->state_name_ << ")" << std::endl;
 					myfile << "\t\t\t)" << std::endl;
 					myfile << "\t\t)" << std::endl;
 					*/
+					for (std::vector<const Object*>::const_iterator ci = objects.begin(); ci != objects.end(); ++ci)
+					{
+						const Object* object = *ci;
+						myfile << "\t\t(when (and (part-of " << state->state_name_ << " ?old_kb) (object_at " << object->name_ << " " << location->name_ << " " << state->state_name_ << ") (part-of " << state2->state_name_ << " ?new_kb))" << std::endl;
+						myfile << "\t\t\t(and " << std::endl;
+						myfile << "\t\t\t\t(not (Robject_at " << object->name_ << " " << location->name_ << " " << state->state_name_ << "))" << std::endl;
+						myfile << "\t\t\t\t(not (object_at " << object->name_ << " " << location->name_ << " " << state->state_name_ << "))" << std::endl;
+						myfile << "\t\t\t\t(Robject_at " << object->name_ << " " << location->name_ << " " << state2->state_name_ << ")" << std::endl;
+						myfile << "\t\t\t\t(object_at " << object->name_ << " " << location->name_ << " " << state2->state_name_ << ")" << std::endl;
+						myfile << "\t\t\t)" << std::endl;
+						myfile << "\t\t)" << std::endl;
+						/*
+						myfile << "\t\t(when (and (part-of " << state->state_name_ << " ?old_kb) (push_location " << object->name_ << " " << location->name_ << " " << state->state_name_ << ") (part-of " << state2->state_name_ << " ?new_kb))" << std::endl;
+						myfile << "\t\t\t(and " << std::endl;
+						myfile << "\t\t\t\t(not (Rpush_location " << object->name_ << " " << location->name_ << " " << state->state_name_ << "))" << std::endl;
+						myfile << "\t\t\t\t(not (push_location " << object->name_ << " " << location->name_ << " " << state->state_name_ << "))" << std::endl;
+						myfile << "\t\t\t\t(Rpush_location " << object->name_ << " " << location->name_ << " " << state2->state_name_ << ")" << std::endl;
+						myfile << "\t\t\t\t(push_location " << object->name_ << " " << location->name_ << " " << state2->state_name_ << ")" << std::endl;
+						myfile << "\t\t\t)" << std::endl;
+						myfile << "\t\t)" << std::endl;
+						*/
+					}
 				}
-			}
 			
-			for (std::vector<const Type*>::const_iterator ci = types.begin(); ci != types.end(); ++ci)
-			{
-				const Type* type = *ci;
-				myfile << "\t\t(when (and (part-of " << state->state_name_ << " ?old_kb) (can_pickup robot " << type->name_ << " " << state->state_name_ << ") (part-of " << state2->state_name_ << " ?new_kb))" << std::endl;
-				myfile << "\t\t\t(and " << std::endl;
-				myfile << "\t\t\t\t(not (Rcan_pickup robot " << type->name_ << " " << state->state_name_ << "))" << std::endl;
-				myfile << "\t\t\t\t(not (can_pickup robot " << type->name_ << " " << state->state_name_ << "))" << std::endl;
-				myfile << "\t\t\t\t(Rcan_pickup robot " << type->name_ << " " << state2->state_name_ << ")" << std::endl;
-				myfile << "\t\t\t\t(can_pickup robot " << type->name_ << " " << state2->state_name_ << ")" << std::endl;
-				myfile << "\t\t\t)" << std::endl;
-				myfile << "\t\t)" << std::endl;
-				
-				myfile << "\t\t(when (and (part-of " << state->state_name_ << " ?old_kb) (can_push robot " << type->name_ << " " << state->state_name_ << ") (part-of " << state2->state_name_ << " ?new_kb))" << std::endl;
-				myfile << "\t\t\t(and " << std::endl;
-				myfile << "\t\t\t\t(not (Rcan_push robot " << type->name_ << " " << state->state_name_ << "))" << std::endl;
-				myfile << "\t\t\t\t(not (can_push robot " << type->name_ << " " << state->state_name_ << "))" << std::endl;
-				myfile << "\t\t\t\t(Rcan_push robot " << type->name_ << " " << state2->state_name_ << ")" << std::endl;
-				myfile << "\t\t\t\t(can_push robot " << type->name_ << " " << state2->state_name_ << ")" << std::endl;
-				myfile << "\t\t\t)" << std::endl;
-				myfile << "\t\t)" << std::endl;
-				
-				for (std::vector<const Box*>::const_iterator ci = boxes.begin(); ci != boxes.end(); ++ci)
+				for (std::vector<const Type*>::const_iterator ci = types.begin(); ci != types.end(); ++ci)
 				{
-					const Box* box = *ci;
-					
-					myfile << "\t\t(when (and (part-of " << state->state_name_ << " ?old_kb) (can_fit_inside " << type->name_ << " " << box->name_ << " " << state->state_name_ << ") (part-of " << state2->state_name_ << " ?new_kb))" << std::endl;
+					const Type* type = *ci;
+					myfile << "\t\t(when (and (part-of " << state->state_name_ << " ?old_kb) (can_pickup robot " << type->name_ << " " << state->state_name_ << ") (part-of " << state2->state_name_ << " ?new_kb))" << std::endl;
 					myfile << "\t\t\t(and " << std::endl;
-					myfile << "\t\t\t\t(not (Rcan_fit_inside " << type->name_ << " " << box->name_ << " " << state->state_name_ << "))" << std::endl;
-					myfile << "\t\t\t\t(not (can_fit_inside " << type->name_ << " " << box->name_ << " " << state->state_name_ << "))" << std::endl;
-					myfile << "\t\t\t\t(Rcan_fit_inside " << type->name_ << " " << box->name_ << " " << state2->state_name_ << ")" << std::endl;
-					myfile << "\t\t\t\t(can_fit_inside " << type->name_ << " " << box->name_ << " " << state2->state_name_ << ")" << std::endl;
+					myfile << "\t\t\t\t(not (Rcan_pickup robot " << type->name_ << " " << state->state_name_ << "))" << std::endl;
+					myfile << "\t\t\t\t(not (can_pickup robot " << type->name_ << " " << state->state_name_ << "))" << std::endl;
+					myfile << "\t\t\t\t(Rcan_pickup robot " << type->name_ << " " << state2->state_name_ << ")" << std::endl;
+					myfile << "\t\t\t\t(can_pickup robot " << type->name_ << " " << state2->state_name_ << ")" << std::endl;
 					myfile << "\t\t\t)" << std::endl;
 					myfile << "\t\t)" << std::endl;
-				}
 				
-				for (std::vector<const Location*>::const_iterator ci = locations.begin(); ci != locations.end(); ++ci)
-				{
-					const Location* location = *ci;
-					myfile << "\t\t(when (and (part-of " << state->state_name_ << " ?old_kb) (tidy_location " << type->name_ << " " << location->name_ << " " << state->state_name_ << ") (part-of " << state2->state_name_ << " ?new_kb))" << std::endl;
+					myfile << "\t\t(when (and (part-of " << state->state_name_ << " ?old_kb) (can_push robot " << type->name_ << " " << state->state_name_ << ") (part-of " << state2->state_name_ << " ?new_kb))" << std::endl;
 					myfile << "\t\t\t(and " << std::endl;
-					myfile << "\t\t\t\t(not (Rtidy_location " << type->name_ << " " << location->name_ << " " << state->state_name_ << "))" << std::endl;
-					myfile << "\t\t\t\t(not (tidy_location " << type->name_ << " " << location->name_ << " " << state->state_name_ << "))" << std::endl;
-					myfile << "\t\t\t\t(Rtidy_location " << type->name_ << " " << location->name_ << " " << state2->state_name_ << ")" << std::endl;
-					myfile << "\t\t\t\t(tidy_location " << type->name_ << " " << location->name_ << " " << state2->state_name_ << ")" << std::endl;
+					myfile << "\t\t\t\t(not (Rcan_push robot " << type->name_ << " " << state->state_name_ << "))" << std::endl;
+					myfile << "\t\t\t\t(not (can_push robot " << type->name_ << " " << state->state_name_ << "))" << std::endl;
+					myfile << "\t\t\t\t(Rcan_push robot " << type->name_ << " " << state2->state_name_ << ")" << std::endl;
+					myfile << "\t\t\t\t(can_push robot " << type->name_ << " " << state2->state_name_ << ")" << std::endl;
 					myfile << "\t\t\t)" << std::endl;
 					myfile << "\t\t)" << std::endl;
+				
+					for (std::vector<const Box*>::const_iterator ci = boxes.begin(); ci != boxes.end(); ++ci)
+					{
+						const Box* box = *ci;
+					
+						myfile << "\t\t(when (and (part-of " << state->state_name_ << " ?old_kb) (can_fit_inside " << type->name_ << " " << box->name_ << " " << state->state_name_ << ") (part-of " << state2->state_name_ << " ?new_kb))" << std::endl;
+						myfile << "\t\t\t(and " << std::endl;
+						myfile << "\t\t\t\t(not (Rcan_fit_inside " << type->name_ << " " << box->name_ << " " << state->state_name_ << "))" << std::endl;
+						myfile << "\t\t\t\t(not (can_fit_inside " << type->name_ << " " << box->name_ << " " << state->state_name_ << "))" << std::endl;
+						myfile << "\t\t\t\t(Rcan_fit_inside " << type->name_ << " " << box->name_ << " " << state2->state_name_ << ")" << std::endl;
+						myfile << "\t\t\t\t(can_fit_inside " << type->name_ << " " << box->name_ << " " << state2->state_name_ << ")" << std::endl;
+						myfile << "\t\t\t)" << std::endl;
+						myfile << "\t\t)" << std::endl;
+					}
+				
+					for (std::vector<const Location*>::const_iterator ci = locations.begin(); ci != locations.end(); ++ci)
+					{
+						const Location* location = *ci;
+						myfile << "\t\t(when (and (part-of " << state->state_name_ << " ?old_kb) (tidy_location " << type->name_ << " " << location->name_ << " " << state->state_name_ << ") (part-of " << state2->state_name_ << " ?new_kb))" << std::endl;
+						myfile << "\t\t\t(and " << std::endl;
+						myfile << "\t\t\t\t(not (Rtidy_location " << type->name_ << " " << location->name_ << " " << state->state_name_ << "))" << std::endl;
+						myfile << "\t\t\t\t(not (tidy_location " << type->name_ << " " << location->name_ << " " << state->state_name_ << "))" << std::endl;
+						myfile << "\t\t\t\t(Rtidy_location " << type->name_ << " " << location->name_ << " " << state2->state_name_ << ")" << std::endl;
+						myfile << "\t\t\t\t(tidy_location " << type->name_ << " " << location->name_ << " " << state2->state_name_ << ")" << std::endl;
+						myfile << "\t\t\t)" << std::endl;
+						myfile << "\t\t)" << std::endl;
+					}
 				}
 			}
 		}
@@ -1303,74 +1335,45 @@ void ContingentTidyPDDLGenerator::generateDomainFile(const std::string& file_nam
 	myfile << "\t\t(current_kb ?old_kb)" << std::endl;
 	myfile << "\t\t(parent ?new_kb ?old_kb)" << std::endl;
 	
-	// We can only move back up the knowledge base if there are not states that belong to this knowledge base.
-	for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
+	if (belief_encoding == LIFTED_BELIEF_ENCODING)
 	{
-		myfile << "\t\t(or " << std::endl;
-		myfile << "\t\t\t(not (part-of " << (*ci)->state_name_ << " ?old_kb))" << std::endl;
-		myfile << "\t\t\t(not (exists (?l - level ) (stack " << (*ci)->state_name_ << " ?l)))" << std::endl;
-		myfile << "\t\t)" << std::endl;
+		writeLiftedShedKnowledgePreconditions(myfile);
 	}
-	
-	// Make sure the robot is in the same location.
-	myfile << "\t\t(or" << std::endl;
-	for (std::vector<const Location*>::const_iterator ci = locations.begin(); ci != locations.end(); ++ci)
+	else
 	{
-		const Location* location = *ci;
-		myfile << "\t\t\t(and" << std::endl;
+		// We can only move back up the knowledge base if there are not states that belong to this knowledge base.
 		for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
 		{
-			const State* state = *ci;
-			// Make sure the state of the toilets are the same.
-			myfile << "\t\t\t\t(or " << std::endl;
-			myfile << "\t\t\t\t\t(not (part-of " << (*ci)->state_name_ << " ?old_kb))" << std::endl;
-			myfile << "\t\t\t\t\t(robot_at robot " << location->name_ << " " << state->state_name_ << ")" << std::endl;
-			myfile << "\t\t\t\t)" << std::endl;
+			myfile << "\t\t(or " << std::endl;
+			myfile << "\t\t\t(not (part-of " << (*ci)->state_name_ << " ?old_kb))" << std::endl;
+			myfile << "\t\t\t(not (exists (?l - level ) (stack " << (*ci)->state_name_ << " ?l)))" << std::endl;
+			myfile << "\t\t)" << std::endl;
 		}
-		myfile << "\t\t\t)" << std::endl;
-	}
-	myfile << "\t\t)" << std::endl;
-	/*
-	// Make sure there is no discrepancy in which locations are accessible and which are not.
-	for (std::vector<const Location*>::const_iterator ci = locations.begin(); ci != locations.end(); ++ci)
-	{
-		const Location* location = *ci;
+	
+		// Make sure the robot is in the same location.
 		myfile << "\t\t(or" << std::endl;
-		myfile << "\t\t\t(and" << std::endl;
-		for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
-		{
-			const State* state = *ci;
-			// Make sure the state of the toilets are the same.
-			myfile << "\t\t\t\t(or " << std::endl;
-			myfile << "\t\t\t\t\t(not (part-of " << (*ci)->state_name_ << " ?old_kb))" << std::endl;
-			myfile << "\t\t\t\t\t(is_not_occupied " << location->name_ << " " << state->state_name_ << ")" << std::endl;
-			myfile << "\t\t\t\t)" << std::endl;
-		}
-		myfile << "\t\t\t)" << std::endl;
-		
-		myfile << "\t\t\t(and" << std::endl;
-		for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
+		for (std::vector<const Location*>::const_iterator ci = locations.begin(); ci != locations.end(); ++ci)
 		{
-			const State* state = *ci;
-			// Make sure the state of the toilets are the same.
-			myfile << "\t\t\t\t(or " << std::endl;
-			myfile << "\t\t\t\t\t(not (part-of " << (*ci)->state_name_ << " ?old_kb))" << std::endl;
-			myfile << "\t\t\t\t\t(not (is_not_occupied " << location->name_ << " " << state->state_name_ << "))" << std::endl;
-			myfile << "\t\t\t\t)" << std::endl;
+			const Location* location = *ci;
+			myfile << "\t\t\t(and" << std::endl;
+			for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
+			{
+				const State* state = *ci;
+				// Make sure the state of the toilets are the same.
+				myfile << "\t\t\t\t(or " << std::endl;
+				myfile << "\t\t\t\t\t(not (part-of " << (*ci)->state_name_ << " ?old_kb))" << std::endl;
+				myfile << "\t\t\t\t\t(robot_at robot " << location->name_ << " " << state->state_name_ << ")" << std::endl;
+				myfile << "\t\t\t\t)" << std::endl;
+			}
+			myfile << "\t\t\t)" << std::endl;
 		}
-		myfile << "\t\t\t)" << std::endl;
 		myfile << "\t\t)" << std::endl;
-	}
-	*/
-	/*
-	// Make sure the location of the objects is identical.
-	for (std::vector<const Object*>::const_iterator ci = objects.begin(); ci != objects.end(); ++ci)
-	{
-		const Object* object = *ci;
-		myfile << "\t\t(or" << std::endl;
+		/*
+		// Make sure there is no discrepancy in which locations are accessible and which are not.
 		for (std::vector<const Location*>::const_iterator ci = locations.begin(); ci != locations.end(); ++ci)
 		{
 			const Location* location = *ci;
+			myfile << "\t\t(or" << std::endl;
 			myfile << "\t\t\t(and" << std::endl;
 			for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
 			{
@@ -1378,38 +1381,74 @@ void ContingentTidyPDDLGenerator::generateDomainFile(const std::string& file_nam
 				// Make sure the state of the toilets are the same.
 				myfile << "\t\t\t\t(or " << std::endl;
 				myfile << "\t\t\t\t\t(not (part-of " << (*ci)->state_name_ << " ?old_kb))" << std::endl;
-				myfile << "\t\t\t\t\t(object_at " << object->name_ << " " <<  location->name_ << " " << state->state_name_ << ")" << std::endl;
+				myfile << "\t\t\t\t\t(is_not_occupied " << location->name_ << " " << state->state_name_ << ")" << std::endl;
 				myfile << "\t\t\t\t)" << std::endl;
 			}
 			myfile << "\t\t\t)" << std::endl;
-		}
 		
-		myfile << "\t\t\t(and" << std::endl;
-		for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
-		{
-			const State* state = *ci;
-			// Make sure the state of the toilets are the same.
-			myfile << "\t\t\t\t(or " << std::endl;
-			myfile << "\t\t\t\t\t(not (part-of " << (*ci)->state_name_ << " ?old_kb))" << std::endl;
-			myfile << "\t\t\t\t\t(holding robot " << object->name_ << " " << state->state_name_ << ")" << std::endl;
-			myfile << "\t\t\t\t)" << std::endl;
+			myfile << "\t\t\t(and" << std::endl;
+			for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
+			{
+				const State* state = *ci;
+				// Make sure the state of the toilets are the same.
+				myfile << "\t\t\t\t(or " << std::endl;
+				myfile << "\t\t\t\t\t(not (part-of " << (*ci)->state_name_ << " ?old_kb))" << std::endl;
+				myfile << "\t\t\t\t\t(not (is_not_occupied " << location->name_ << " " << state->state_name_ << "))" << std::endl;
+				myfile << "\t\t\t\t)" << std::endl;
+			}
+			myfile << "\t\t\t)" << std::endl;
+			myfile << "\t\t)" << std::endl;
 		}
-		myfile << "\t\t\t)" << std::endl;
-		
-		myfile << "\t\t\t(and" << std::endl;
-		for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
+		*/
+		/*
+		// Make sure the location of the objects is identical.
+		for (std::vector<const Object*>::const_iterator ci = objects.begin(); ci != objects.end(); ++ci)
 		{
-			const State* state = *ci;
-			// Make sure the state of the toilets are the same.
-			myfile << "\t\t\t\t(or " << std::endl;
-			myfile << "\t\t\t\t\t(not (part-of " << (*ci)->state_name_ << " ?old_kb))" << std::endl;
-			myfile << "\t\t\t\t\t(tidy " << object->name_ << " " << state->state_name_ << ")" << std::endl;
-			myfile << "\t\t\t\t)" << std::endl;
-		}
-		myfile << "\t\t\t)" << std::endl;
+			const Object* object = *ci;
+			myfile << "\t\t(or" << std::endl;
+			for (std::vector<const Location*>::const_iterator ci = locations.begin(); ci != locations.end(); ++ci)
+			{
+				const Location* location = *ci;
+				myfile << "\t\t\t(and" << std::endl;
+				for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
+				{
+					const State* state = *ci;
+					// Make sure the state of the toilets are the same.
+					myfile << "\t\t\t\t(or " << std::endl;
+					myfile << "\t\t\t\t\t(not (part-of " << (*ci)->state_name_ << " ?old_kb))" << std::endl;
+					myfile << "\t\t\t\t\t(object_at " << object->name_ << " " <<  location->name_ << " " << state->state_name_ << ")" << std::endl;
+					myfile << "\t\t\t\t)" << std::endl;
+				}
+				myfile << "\t\t\t)" << std::endl;
+			}
 		
-		myfile << "\t\t)" << std::endl;
-	}*/
+			myfile << "\t\t\t(and" << std::endl;
+			for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
+			{
+				const State* state = *ci;
+				// Make sure the state of the toilets are the same.
+				myfile << "\t\t\t\t(or " << std::endl;
+				myfile << "\t\t\t\t\t(not (part-of " << (*ci)->state_name_ << " ?old_kb))" << std::endl;
+				myfile << "\t\t\t\t\t(holding robot " << object->name_ << " " << state->state_name_ << ")" << std::endl;
+				myfile << "\t\t\t\t)" << std::endl;
+			}
+			myfile << "\t\t\t)" << std::endl;
+		
+			myfile << "\t\t\t(and" << std::endl;
+			for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
+			{
+				const State* state = *ci;
+				// Make sure the state of the toilets are the same.
+				myfile << "\t\t\t\t(or " << std::endl;
+				myfile << "\t\t\t\t\t(not (part-of " << (*ci)->state_name_ << " ?old_kb))" << std::endl;
+				myfile << "\t\t\t\t\t(tidy " << object->name_ << " " << state->state_name_ << ")" << std::endl;
+				myfile << "\t\t\t\t)" << std::endl;
+			}
+			myfile << "\t\t\t)" << std::endl;
+		
+			myfile << "\t\t)" << std::endl;
+		}*/
+	}
 	
 	myfile << "\t)" << std::endl;
 	myfile << "\t:effect (and" << std::endl;
@@ -1418,125 +1457,42 @@ void ContingentTidyPDDLGenerator::generateDomainFile(const std::string& file_nam
 	myfile << "\t\t(resolve-axioms)" << std::endl;
 	myfile << std::endl;
 	
-	myfile << "\t\t;; Now we need to push all knowledge that is true for all states part of " << std::endl;
-	myfile << "\t\t;; kb_old up to kb_new." << std::endl;
-	for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
+	if (belief_encoding == LIFTED_BELIEF_ENCODING)
 	{
-		const State* state = *ci;
-		
-		// Make the states that were held in suspection active again.
-		myfile << "\t\t(when (part-of " << state->state_name_ << " ?new_kb)" << std::endl;
-		myfile << "\t\t\t(and (m " << state->state_name_ << "))" << std::endl;
-		myfile << "\t\t)" << std::endl;
-		
-		// And those that were active, inactive.
-		myfile << "\t\t(when (not (part-of " << state->state_name_ << " ?new_kb))" << std::endl;
-		myfile << "\t\t\t(and (not (m " << state->state_name_ << ")))" << std::endl;
-		myfile << "\t\t)" << std::endl;
+		writeLiftedShedKnowledgeEffects(myfile, shed_facts);
 	}
-	
-	for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
+	else
 	{
-		const State* state = *ci;
-		myfile << "\t\t(when (and " << std::endl;
-		myfile << "\t\t\t\t;; For every state ?s, ?s2" << std::endl;
-	
+		myfile << "\t\t;; Now we need to push all knowledge that is true for all states part of " << std::endl;
+		myfile << "\t\t;; kb_old up to kb_new." << std::endl;
 		for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
 		{
-			const State* state2 = *ci;
-			myfile << "\t\t\t\t\t(or " << std::endl;
-			myfile << "\t\t\t\t\t\t(not (part-of " << state2->state_name_ << " ?old_kb))" << std::endl;
-			myfile << "\t\t\t\t\t\t(gripper_empty robot " << state2->state_name_ << ")" << std::endl;
-			myfile << "\t\t\t\t\t)" << std::endl;
-		}
-		myfile << "\t\t\t\t\t(part-of " << state->state_name_ << " ?new_kb)" << std::endl;
-		myfile << "\t\t\t)" << std::endl;
-
-		myfile << "\t\t\t;; Conditional effects" << std::endl;
-		myfile << "\t\t\t(and " << std::endl;
-		for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
-		{
-			const State* state2 = *ci;
-			myfile << "\t\t\t\t(not (gripper_empty robot " << state2->state_name_ << "))" << std::endl;
-		}
-		myfile << "\t\t\t\t(gripper_empty robot " << state->state_name_ << ")" << std::endl;
-		myfile << "\t\t\t)" << std::endl;
-		myfile << "\t\t)" << std::endl;
-	}
-	
-	for (std::vector<const Object*>::const_iterator ci = objects.begin(); ci != objects.end(); ++ci)
-	{
-		const Object* object = *ci;
-		for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
-		{
-			// Deal with the location of the robot.
 			const State* state = *ci;
-			myfile << "\t\t(when (and " << std::endl;
-			myfile << "\t\t\t\t;; For every state ?s, ?s2" << std::endl;
 		
-			// Holding.
-			for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
-			{
-				const State* state2 = *ci;
-				myfile << "\t\t\t\t\t(or " << std::endl;
-				myfile << "\t\t\t\t\t\t(not (part-of " << state2->state_name_ << " ?old_kb))" << std::endl;
-				myfile << "\t\t\t\t\t\t(holding robot " << object->name_ << " " << state2->state_name_ << ")" << std::endl;
-				myfile << "\t\t\t\t\t)" << std::endl;
-				
-			}
-			myfile << "\t\t\t\t\t(part-of " << state->state_name_ << " ?new_kb)" << std::endl;
-			myfile << "\t\t\t)" << std::endl;
-
-			myfile << "\t\t\t;; Conditional effects" << std::endl;
-			myfile << "\t\t\t(and " << std::endl;
-			for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
-			{
-				const State* state2 = *ci;
-				myfile << "\t\t\t\t(not (holding robot " << object->name_ << " " << state2->state_name_ << "))" << std::endl;
-			}
-			myfile << "\t\t\t\t(holding robot " << object->name_ << " " << state->state_name_ << ")" << std::endl;
-			myfile << "\t\t\t)" << std::endl;
+			// Make the states that were held in suspection active again.
+			myfile << "\t\t(when (part-of " << state->state_name_ << " ?new_kb)" << std::endl;
+			myfile << "\t\t\t(and (m " << state->state_name_ << "))" << std::endl;
 			myfile << "\t\t)" << std::endl;
-			
-			// Tidy.
-			myfile << "\t\t(when (and " << std::endl;
-			myfile << "\t\t\t\t;; For every state ?s, ?s2" << std::endl;
 		
-			for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
-			{
-				const State* state2 = *ci;
-				myfile << "\t\t\t\t\t(or " << std::endl;
-				myfile << "\t\t\t\t\t\t(not (part-of " << state2->state_name_ << " ?old_kb))" << std::endl;
-				myfile << "\t\t\t\t\t\t(tidy " << object->name_ << " " << state2->state_name_ << ")" << std::endl;
-				myfile << "\t\t\t\t\t)" << std::endl;
-				
-			}
-			myfile << "\t\t\t\t\t(part-of " << state->state_name_ << " ?new_kb)" << std::endl;
-			myfile << "\t\t\t)" << std::endl;
-
-			myfile << "\t\t\t;; Conditional effects" << std::endl;
-			myfile << "\t\t\t(and " << std::endl;
-			for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
-			{
-				const State* state2 = *ci;
-				myfile << "\t\t\t\t(not (tidy " << object->name_ << " " << state2->state_name_ << "))" << std::endl;
-			}
-			myfile << "\t\t\t\t(tidy " << object->name_ << " " << state->state_name_ << ")" << std::endl;
-			myfile << "\t\t\t)" << std::endl;
+			// And those that were active, inactive.
+			myfile << "\t\t(when (not (part-of " << state->state_name_ << " ?new_kb))" << std::endl;
+			myfile << "\t\t\t(and (not (m " << state->state_name_ << ")))" << std::endl;
 			myfile << "\t\t)" << std::endl;
-			/*
-			// Clear.
+		}
+	
+		for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
+		{
+			const State* state = *ci;
 			myfile << "\t\t(when (and " << std::endl;
 			myfile << "\t\t\t\t;; For every state ?s, ?s2" << std::endl;
-		
+	
 			for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
 			{
 				const State* state2 = *ci;
 				myfile << "\t\t\t\t\t(or " << std::endl;
 				myfile << "\t\t\t\t\t\t(not (part-of " << state2->state_name_ << " ?old_kb))" << std::endl;
-				myfile << "\t\t\t\t\t\t(clear " << object->name_ << " " << state2->state_name_ << ")" << std::endl;
+				myfile << "\t\t\t\t\t\t(gripper_empty robot " << state2->state_name_ << ")" << std::endl;
 				myfile << "\t\t\t\t\t)" << std::endl;
-				
 			}
 			myfile << "\t\t\t\t\t(part-of " << state->state_name_ << " ?new_kb)" << std::endl;
 			myfile << "\t\t\t)" << std::endl;
@@ -1546,34 +1502,86 @@ void ContingentTidyPDDLGenerator::generateDomainFile(const std::string& file_nam
 			for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
 			{
 				const State* state2 = *ci;
-				myfile << "\t\t\t\t(not (clear " << object->name_ << " " << state2->state_name_ << "))" << std::endl;
+				myfile << "\t\t\t\t(not (gripper_empty robot " << state2->state_name_ << "))" << std::endl;
 			}
-			myfile << "\t\t\t\t(clear " << object->name_ << " " << state->state_name_ << ")" << std::endl;
+			myfile << "\t\t\t\t(gripper_empty robot " << state->state_name_ << ")" << std::endl;
 			myfile << "\t\t\t)" << std::endl;
 			myfile << "\t\t)" << std::endl;
-			*/
 		}
-		
-		// Objects in boxes.
-		for (std::vector<const Box*>::const_iterator ci = boxes.begin(); ci != boxes.end(); ++ci)
+	
+		for (std::vector<const Object*>::const_iterator ci = objects.begin(); ci != objects.end(); ++ci)
 		{
-			const Box* box = *ci;
+			const Object* object = *ci;
 			for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
 			{
 				// Deal with the location of the robot.
 				const State* state = *ci;
 				myfile << "\t\t(when (and " << std::endl;
 				myfile << "\t\t\t\t;; For every state ?s, ?s2" << std::endl;
-			
+		
 				// Holding.
 				for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
 				{
 					const State* state2 = *ci;
 					myfile << "\t\t\t\t\t(or " << std::endl;
 					myfile << "\t\t\t\t\t\t(not (part-of " << state2->state_name_ << " ?old_kb))" << std::endl;
-					myfile << "\t\t\t\t\t\t(inside " << object->name_ << " " << box->name_ << " " << state2->state_name_ << ")" << std::endl;
+					myfile << "\t\t\t\t\t\t(holding robot " << object->name_ << " " << state2->state_name_ << ")" << std::endl;
 					myfile << "\t\t\t\t\t)" << std::endl;
-					
+				
+				}
+				myfile << "\t\t\t\t\t(part-of " << state->state_name_ << " ?new_kb)" << std::endl;
+				myfile << "\t\t\t)" << std::endl;
+
+				myfile << "\t\t\t;; Conditional effects" << std::endl;
+				myfile << "\t\t\t(and " << std::endl;
+				for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
+				{
+					const State* state2 = *ci;
+					myfile << "\t\t\t\t(not (holding robot " << object->name_ << " " << state2->state_name_ << "))" << std::endl;
+				}
+				myfile << "\t\t\t\t(holding robot " << object->name_ << " " << state->state_name_ << ")" << std::endl;
+				myfile << "\t\t\t)" << std::endl;
+				myfile << "\t\t)" << std::endl;
+			
+				// Tidy.
+				myfile << "\t\t(when (and " << std::endl;
+				myfile << "\t\t\t\t;; For every state ?s, ?s2" << std::endl;
+		
+				for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
+				{
+					const State* state2 = *ci;
+					myfile << "\t\t\t\t\t(or " << std::endl;
+					myfile << "\t\t\t\t\t\t(not (part-of " << state2->state_name_ << " ?old_kb))" << std::endl;
+					myfile << "\t\t\t\t\t\t(tidy " << object->name_ << " " << state2->state_name_ << ")" << std::endl;
+					myfile << "\t\t\t\t\t)" << std::endl;
+				
+				}
+				myfile << "\t\t\t\t\t(part-of " << state->state_name_ << " ?new_kb)" << std::endl;
+				myfile << "\t\t\t)" << std::endl;
+
+				myfile << "\t\t\t;; Conditional effects" << std::endl;
+				myfile << "\t\t\t(and " << std::endl;
+				for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
+				{
+					const State* state2 = *ci;
+					myfile << "\t\t\t\t(not (tidy " << object->name_ << " " << state2->state_name_ << "))" << std::endl;
+				}
+				myfile << "\t\t\t\t(tidy " << object->name_ << " " << state->state_name_ << ")" << std::endl;
+				myfile << "\t\t\t)" << std::endl;
+				myfile << "\t\t)" << std::endl;
+				/*
+				// Clear.
+				myfile << "\t\t(when (and " << std::endl;
+				myfile << "\t\t\t\t;; For every state ?s, ?s2" << std::endl;
+		
+				for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
+				{
+					const State* state2 = *ci;
+					myfile << "\t\t\t\t\t(or " << std::endl;
+					myfile << "\t\t\t\t\t\t(not (part-of " << state2->state_name_ << " ?old_kb))" << std::endl;
+					myfile << "\t\t\t\t\t\t(clear " << object->name_ << " " << state2->state_name_ << ")" << std::endl;
+					myfile << "\t\t\t\t\t)" << std::endl;
+				
 				}
 				myfile << "\t\t\t\t\t(part-of " << state->state_name_ << " ?new_kb)" << std::endl;
 				myfile << "\t\t\t)" << std::endl;
@@ -1583,98 +1591,100 @@ void ContingentTidyPDDLGenerator::generateDomainFile(const std::string& file_nam
 				for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
 				{
 					const State* state2 = *ci;
-					myfile << "\t\t\t\t(not (inside " << object->name_ << " " << box->name_ << " " << state2->state_name_ << "))" << std::endl;
+					myfile << "\t\t\t\t(not (clear " << object->name_ << " " << state2->state_name_ << "))" << std::endl;
 				}
-				myfile << "\t\t\t\t(inside " << object->name_ << " " << box->name_ << " " << state->state_name_ << ")" << std::endl;
+				myfile << "\t\t\t\t(clear " << object->name_ << " " << state->state_name_ << ")" << std::endl;
 				myfile << "\t\t\t)" << std::endl;
 				myfile << "\t\t)" << std::endl;
+				*/
 			}
-		}
-	}
-	
-	// Location of the agent.
-	for (std::vector<const Location*>::const_iterator ci = locations.begin(); ci != locations.end(); ++ci)
-	{
-		const Location* location = *ci;
-		for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
-		{
-			// Deal with the location of the robot.
-			const State* state = *ci;
-			myfile << "\t\t(when (and " << std::endl;
-			myfile << "\t\t\t\t;; For every state ?s, ?s2" << std::endl;
 		
-			for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
+			// Objects in boxes.
+			for (std::vector<const Box*>::const_iterator ci = boxes.begin(); ci != boxes.end(); ++ci)
 			{
-				const State* state2 = *ci;
-				myfile << "\t\t\t\t(and " << std::endl;
-				myfile << "\t\t\t\t\t(or " << std::endl;
-				myfile << "\t\t\t\t\t\t(not (part-of " << state2->state_name_ << " ?old_kb))" << std::endl;
-				myfile << "\t\t\t\t\t\t(robot_at robot " << location->name_ << " " << state2->state_name_ << ")" << std::endl;
-				myfile << "\t\t\t\t\t)" << std::endl;
-				myfile << "\t\t\t\t)" << std::endl;
-			}
-			myfile << "\t\t\t\t\t(part-of " << state->state_name_ << " ?new_kb)" << std::endl;
-			myfile << "\t\t\t)" << std::endl;
-
-			myfile << "\t\t\t;; Conditional effects" << std::endl;
-			myfile << "\t\t\t(and " << std::endl;
+				const Box* box = *ci;
+				for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
+				{
+					// Deal with the location of the robot.
+					const State* state = *ci;
+					myfile << "\t\t(when (and " << std::endl;
+					myfile << "\t\t\t\t;; For every state ?s, ?s2" << std::endl;
 			
-			for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
-			{
-				const State* state2 = *ci;
-				myfile << "\t\t\t\t(not (robot_at robot " << location->name_ << " " << state2->state_name_ << "))" << std::endl;
+					// Holding.
+					for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
+					{
+						const State* state2 = *ci;
+						myfile << "\t\t\t\t\t(or " << std::endl;
+						myfile << "\t\t\t\t\t\t(not (part-of " << state2->state_name_ << " ?old_kb))" << std::endl;
+						myfile << "\t\t\t\t\t\t(inside " << object->name_ << " " << box->name_ << " " << state2->state_name_ << ")" << std::endl;
+						myfile << "\t\t\t\t\t)" << std::endl;
+					
+					}
+					myfile << "\t\t\t\t\t(part-of " << state->state_name_ << " ?new_kb)" << std::endl;
+					myfile << "\t\t\t)" << std::endl;
+
+					myfile << "\t\t\t;; Conditional effects" << std::endl;
+					myfile << "\t\t\t(and " << std::endl;
+					for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
+					{
+						const State* state2 = *ci;
+						myfile << "\t\t\t\t(not (inside " << object->name_ << " " << box->name_ << " " << state2->state_name_ << "))" << std::endl;
+					}
+					myfile << "\t\t\t\t(inside " << object->name_ << " " << box->name_ << " " << state->state_name_ << ")" << std::endl;
+					myfile << "\t\t\t)" << std::endl;
+					myfile << "\t\t)" << std::endl;
+				}
 			}
-			myfile << "\t\t\t\t(robot_at robot " << location->name_ << " " << state->state_name_ << ")" << std::endl;
-			
-			myfile << "\t\t\t)" << std::endl;
-			myfile << "\t\t)" << std::endl;
-			
-			// Deal with whether a location is occupied or not.
-			myfile << "\t\t(when (and " << std::endl;
-			myfile << "\t\t\t\t;; For every state ?s, ?s2" << std::endl;
-		
+		}
+	
+		// Location of the agent.
+		for (std::vector<const Location*>::const_iterator ci = locations.begin(); ci != locations.end(); ++ci)
+		{
+			const Location* location = *ci;
 			for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
 			{
-				const State* state2 = *ci;
-				myfile << "\t\t\t\t(and " << std::endl;
-				myfile << "\t\t\t\t\t(or " << std::endl;
-				myfile << "\t\t\t\t\t\t(not (part-of " << state2->state_name_ << " ?old_kb))" << std::endl;
-				myfile << "\t\t\t\t\t\t(is_not_occupied " << location->name_ << " " << state2->state_name_ << ")" << std::endl;
-				myfile << "\t\t\t\t\t)" << std::endl;
-				myfile << "\t\t\t\t)" << std::endl;
-			}
-			myfile << "\t\t\t\t\t(part-of " << state->state_name_ << " ?new_kb)" << std::endl;
-			myfile << "\t\t\t)" << std::endl;
+				// Deal with the location of the robot.
+				const State* state = *ci;
+				myfile << "\t\t(when (and " << std::endl;
+				myfile << "\t\t\t\t;; For every state ?s, ?s2" << std::endl;
+		
+				for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
+				{
+					const State* state2 = *ci;
+					myfile << "\t\t\t\t(and " << std::endl;
+					myfile << "\t\t\t\t\t(or " << std::endl;
+					myfile << "\t\t\t\t\t\t(not (part-of " << state2->state_name_ << " ?old_kb))" << std::endl;
+					myfile << "\t\t\t\t\t\t(robot_at robot " << location->name_ << " " << state2->state_name_ << ")" << std::endl;
+					myfile << "\t\t\t\t\t)" << std::endl;
+					myfile << "\t\t\t\t)" << std::endl;
+				}
+				myfile << "\t\t\t\t\t(part-of " << state->state_name_ << " ?new_kb)" << std::endl;
+				myfile << "\t\t\t)" << std::endl;
 
-			myfile << "\t\t\t;; Conditional effects" << std::endl;
-			myfile << "\t\t\t(and " << std::endl;
+				myfile << "\t\t\t;; Conditional effects" << std::endl;
+				myfile << "\t\t\t(and " << std::endl;
 			
-			for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
-			{
-				const State* state2 = *ci;
-				myfile << "\t\t\t\t(not (is_not_occupied " << location->name_ << " " << state2->state_name_ << "))" << std::endl;
-			}
-			myfile << "\t\t\t\t(is_not_occupied " << location->name_ << " " << state->state_name_ << ")" << std::endl;
+				for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
+				{
+					const State* state2 = *ci;
+					myfile << "\t\t\t\t(not (robot_at robot " << location->name_ << " " << state2->state_name_ << "))" << std::endl;
+				}
+				myfile << "\t\t\t\t(robot_at robot " << location->name_ << " " << state->state_name_ << ")" << std::endl;
 			
-			myfile << "\t\t\t)" << std::endl;
-			myfile << "\t\t)" << std::endl;
+				myfile << "\t\t\t)" << std::endl;
+				myfile << "\t\t)" << std::endl;
 			
-			// The locations of the objects.
-			for (std::vector<const Object*>::const_iterator ci = objects.begin(); ci != objects.end(); ++ci)
-			{
-				const Object* object = *ci;
-				
-				// Deal with the location of the robot.
+				// Deal with whether a location is occupied or not.
 				myfile << "\t\t(when (and " << std::endl;
 				myfile << "\t\t\t\t;; For every state ?s, ?s2" << std::endl;
-			
+		
 				for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
 				{
 					const State* state2 = *ci;
 					myfile << "\t\t\t\t(and " << std::endl;
 					myfile << "\t\t\t\t\t(or " << std::endl;
 					myfile << "\t\t\t\t\t\t(not (part-of " << state2->state_name_ << " ?old_kb))" << std::endl;
-					myfile << "\t\t\t\t\t\t(object_at " << object->name_ << " " << location->name_ << " " << state2->state_name_ << ")" << std::endl;
+					myfile << "\t\t\t\t\t\t(is_not_occupied " << location->name_ << " " << state2->state_name_ << ")" << std::endl;
 					myfile << "\t\t\t\t\t)" << std::endl;
 					myfile << "\t\t\t\t)" << std::endl;
 				}
@@ -1683,16 +1693,52 @@ void ContingentTidyPDDLGenerator::generateDomainFile(const std::string& file_nam
 
 				myfile << "\t\t\t;; Conditional effects" << std::endl;
 				myfile << "\t\t\t(and " << std::endl;
-				
+			
 				for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
 				{
 					const State* state2 = *ci;
-					myfile << "\t\t\t\t(not (object_at " << object->name_ << " " << location->name_ << " " << state2->state_name_ << "))" << std::endl;
+					myfile << "\t\t\t\t(not (is_not_occupied " << location->name_ << " " << state2->state_name_ << "))" << std::endl;
 				}
-				myfile << "\t\t\t\t(object_at " << object->name_ << " " << location->name_ << " " << state->state_name_ << ")" << std::endl;
-				
+				myfile << "\t\t\t\t(is_not_occupied " << location->name_ << " " << state->state_name_ << ")" << std::endl;
+			
 				myfile << "\t\t\t)" << std::endl;
 				myfile << "\t\t)" << std::endl;
+			
+				// The locations of the objects.
+				for (std::vector<const Object*>::const_iterator ci = objects.begin(); ci != objects.end(); ++ci)
+				{
+					const Object* object = *ci;
+				
+					// Deal with the location of the robot.
+					myfile << "\t\t(when (and " << std::endl;
+					myfile << "\t\t\t\t;; For every state ?s, ?s2" << std::endl;
+			
+					for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
+					{
+						const State* state2 = *ci;
+						myfile << "\t\t\t\t(and " << std::endl;
+						myfile << "\t\t\t\t\t(or " << std::endl;
+						myfile << "\t\t\t\t\t\t(not (part-of " << state2->state_name_ << " ?old_kb))" << std::endl;
+						myfile << "\t\t\t\t\t\t(object_at " << object->name_ << " " << location->name_ << " " << state2->state_name_ << ")" << std::endl;
+						myfile << "\t\t\t\t\t)" << std::endl;
+						myfile << "\t\t\t\t)" << std::endl;
+					}
+					myfile << "\t\t\t\t\t(part-of " << state->state_name_ << " ?new_kb)" << std::endl;
+					myfile << "\t\t\t)" << std::endl;
+
+					myfile << "\t\t\t;; Conditional effects" << std::endl;
+					myfile << "\t\t\t(and " << std::endl;
+				
+					for (std::vector<const State*>::const_iterator ci = states.begin(); ci != states.end(); ++ci)
+					{
+						const State* state2 = *ci;
+						myfile << "\t\t\t\t(not (object_at " << object->name_ << " " << location->name_ << " " << state2->state_name_ << "))" << std::endl;
+					}
+					myfile << "\t\t\t\t(object_at " << object->name_ << " " << location->name_ << " " << state->state_name_ << ")" << std::endl;
+				
+					myfile << "\t\t\t)" << std::endl;
+					myfile << "\t\t)" << std::endl;
+				}
 			}
 		}
 	}
@@ -1703,8 +1749,29 @@ void ContingentTidyPDDLGenerator::generateDomainFile(const std::string& file_nam
 	myfile.close();
 }
 
-void ContingentTidyPDDLGenerator::createPDDL(const std::string& path, const std::string& domain_file, const std::string& problem_file, const std::string& robot_location_predicate, const std::map<std::string, std::string>& object_to_location_mapping, std::map<std::string, std::vector<std::string> >& near_waypoint_mappings, const std::map<std::string, std::string>& object_to_type_mapping, const std::map<std::string, std::string>& box_to_location_mapping, const std::map<std::string, std::string>& box_to_type_mapping)
+void ContingentTidyPDDLGenerator::createPDDL(const std::string& path, const std::string& domain_file, const std::string& problem_file, const std::string& robot_location_predicate, const std::map<std::string, std::string>& object_to_location_mapping, std::map<std::string, std::vector<std::string> >& near_waypoint_mappings, const std::map<std::string, std::string>& object_to_type_mapping, const std::map<std::string, std::string>& box_to_location_mapping, const std::map<std::string, std::string>& box_to_type_mapping, BeliefEncoding belief_encoding)
 {
+	// Both files only depend on the inputs below, if none of them changed the files are reused before the graph is built.
+	std::string domain_path(path + domain_file);
+	std::string problem_path(path + problem_file);
+	PDDLCache::Fingerprint fingerprint;
+	fingerprint.add("ContingentTidyPDDLGenerator").add(robot_location_predicate).add(object_to_location_mapping).add(near_waypoint_mappings).add(object_to_type_mapping).add(box_to_location_mapping).add(box_to_type_mapping).add((unsigned int)belief_encoding);
+	bool domain_restored = PDDLCache::restore(domain_path, fingerprint);
+	bool problem_restored = PDDLCache::restore(problem_path, fingerprint);
+	if (domain_restored && problem_restored)
+	{
+		ROS_INFO("KCL: (ContingentTidyPDDLGenerator) Reuse domain... %s and problem... %s", domain_path.c_str(), problem_path.c_str());
+		return;
+	}
+	
+	// All nodes of the graph are released when this function returns.
+	NodePool<Location> location_pool;
+	NodePool<Object> object_pool;
+	NodePool<Box> box_pool;
+	NodePool<Type> type_pool;
+	NodePool<State> state_pool;
+	NodePool<KnowledgeBase> knowledge_base_pool;
+	
 	// Now generate the waypoints / boxes / toys / etc.
 	std::vector<const Location*> locations;
 	std::vector<const Box*> boxes;
@@ -1716,8 +1783,8 @@ void ContingentTidyPDDLGenerator::createPDDL(const std::string& path, const std:
 		const std::string& object_predicate = (*ci).first;
 		const std::string& location_predicate = (*ci).second;
 		
-		Location* location = new Location(location_predicate, false);
-		Object* object = new Object(object_predicate, *location);
+		Location* location = location_pool.create(location_predicate, false);
+		Object* object = object_pool.create(object_predicate, *location);
 		locations.push_back(location);
 		objects.push_back(object);
 		
@@ -1728,7 +1795,7 @@ void ContingentTidyPDDLGenerator::createPDDL(const std::string& path, const std:
 			for (std::vector<std::string>::const_iterator ci = near_locations.begin(); ci != near_locations.end(); ++ci)
 			{
 				const std::string& near_location_name = *ci;
-				Location* near_location = new Location(near_location_name, false);
+				Location* near_location = location_pool.create(near_location_name, false);
 				locations.push_back(near_location);
 				location->near_locations_.push_back(near_location);
 			}
@@ -1752,7 +1819,7 @@ void ContingentTidyPDDLGenerator::createPDDL(const std::string& path, const std:
 		}
 		
 		if (box_type == NULL) {
-			box_type = new Type(box_type_predicate);
+			box_type = type_pool.create(box_type_predicate);
 			types.push_back(box_type);
 		}
 		std::vector<const Type*> box_types;
@@ -1760,15 +1827,15 @@ void ContingentTidyPDDLGenerator::createPDDL(const std::string& path, const std:
 		
 		std::vector<const Object*> empty_object_list;
 		
-		Location* box_location = new Location(location_predicate, true);
-		Box* box = new Box(box_predicate, *box_location, box_types, empty_object_list);
+		Location* box_location = location_pool.create(location_predicate, true);
+		Box* box = box_pool.create(box_predicate, *box_location, box_types, empty_object_list);
 		
 		locations.push_back(box_location);
 		boxes.push_back(box);
 	}
 	
 	// Initialise the robot's location.
-	Location* robot_location = new Location(robot_location_predicate, false);
+	Location* robot_location = location_pool.create(robot_location_predicate, false);
 	locations.push_back(robot_location);
 
 	//std::cout << "(ContingentTidyPDDLGenerator) Creating all possible states..." << std::endl;
@@ -1795,7 +1862,7 @@ void ContingentTidyPDDLGenerator::createPDDL(const std::string& path, const std:
 		ss.str(std::string());
 		ss << "kb_" << object->name_;
 		
-		KnowledgeBase* kb_location = new KnowledgeBase(ss.str());
+		KnowledgeBase* kb_location = knowledge_base_pool.create(ss.str());
 		basis_kb.addChild(*kb_location);
 		knowledge_bases.push_back(kb_location);
 		
@@ -1816,7 +1883,7 @@ void ContingentTidyPDDLGenerator::createPDDL(const std::string& path, const std:
 				ss.str(std::string());
 				ss << "s" << state_id << "_pick";
 				pickupable_types.push_back(type);
-				State* state_pickupable = new State(ss.str()/*, object_location_mapping*/, stackable_mapping, type_mapping, pushable_types, pickupable_types);
+				State* state_pickupable = state_pool.create(ss.str()/*, object_location_mapping*/, stackable_mapping, type_mapping, pushable_types, pickupable_types);
 				kb_location->addState(*state_pickupable);
 				pickupable_types.clear();
 				/*
@@ -1835,14 +1902,18 @@ void ContingentTidyPDDLGenerator::createPDDL(const std::string& path, const std:
 	
 	
 	
-	ss.str(std::string());
-	ss << path << domain_file;
-	ROS_INFO("KCL: (ContingentTidyPDDLGenerator) Generate domain... %s", ss.str().c_str());
-	generateDomainFile(ss.str(), basis_kb, knowledge_bases, *robot_location, locations, objects, boxes, types);
-	ss.str(std::string());
-	ss << path  << problem_file;
-	ROS_INFO("KCL: (ContingentTidyPDDLGenerator) Generate problem... %s", ss.str().c_str());
-	generateProblemFile(ss.str(), basis_kb, knowledge_bases, *robot_location, locations, objects, boxes, types);
+	if (!domain_restored)
+	{
+		ROS_INFO("KCL: (ContingentTidyPDDLGenerator) Generate domain... %s", domain_path.c_str());
+		generateDomainFile(domain_path, basis_kb, knowledge_bases, *robot_location, locations, objects, boxes, types, belief_encoding);
+		PDDLCache::store(domain_path, fingerprint);
+	}
+	if (!problem_restored)
+	{
+		ROS_INFO("KCL: (ContingentTidyPDDLGenerator) Generate problem... %s", problem_path.c_str());
+		generateProblemFile(problem_path, basis_kb, knowledge_bases, *robot_location, locations, objects, boxes, types);
+		PDDLCache::store(problem_path, fingerprint);
+	}
 }
 
 };
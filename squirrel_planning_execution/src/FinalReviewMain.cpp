@@ -29,6 +29,7 @@
 
 #include <squirrel_planning_execution/KnowledgeBase.h>
 #include <squirrel_planning_execution/ConfigReader.h>
+#include <squirrel_planning_execution/WaypointIndex.h>
 
 #include "pddl_actions/ExamineAreaPDDLAction.h"
 #include "pddl_actions/ExploreAreaPDDLAction.h"
@@ -38,6 +39,7 @@
 #include "pddl_actions/ClearObjectPDDLAction.h"
 #include "pddl_actions/ShedKnowledgePDDLAction.h"
 #include "pddl_actions/FinaliseClassificationPDDLAction.h"
+#include "pddl_actions/PlannerInstance.h"
 
 // Note: Part of code in https://github.com/Morloth1274/squirrel_planning/blob/edith-exploration-2017/squirrel_planning_execution/src/FinalReview.cpp
 bool setupLumps(KCL_rosplan::KnowledgeBase& kb, mongodb_store::MessageStoreProxy& message_store)
@@ -286,19 +288,28 @@ int main(int argc, char **argv) {
 	// Setup the knowledge base.
 	mongodb_store::MessageStoreProxy message_store(nh);
 	KCL_rosplan::KnowledgeBase knowledge_base(nh, message_store);
+	KCL_rosplan::WaypointIndex waypoint_index(message_store);
 	
+	bool cache_knowledge = false;
+	nh.getParam("/squirrel_planning_execution/cache_knowledge", cache_knowledge);
+	if (cache_knowledge)
+	{
+		double cache_max_age = 0;
+		nh.getParam("/squirrel_planning_execution/cache_max_age", cache_max_age);
+		knowledge_base.enableCache(cache_max_age);
+	}
 	
 	// Initialise the context for this planning task.
 	std::string config_file;
 	nh.getParam("/scenario_setup_file", config_file);
 	
 	KCL_rosplan::ConfigReader reader(nh, message_store);
-	reader.readConfigurationFile(config_file);
+	if (!reader.readConfigurationFile(config_file)) exit(-1);
 	
 	// Create all PDDL actions that we might need during execution.
 	KCL_rosplan::ExamineAreaPDDLAction examine_area_action(nh, knowledge_base);
 	KCL_rosplan::ExploreAreaPDDLAction explore_area_action(nh, knowledge_base);
-	KCL_rosplan::TidyAreaPDDLAction tidy_area_action(nh, knowledge_base);
+	KCL_rosplan::TidyAreaPDDLAction tidy_area_action(nh, knowledge_base, waypoint_index);
 	KCL_rosplan::FinaliseClassificationPDDLAction finalise_classification_action(nh);
 	KCL_rosplan::ObserveClassifiableOnAttemptPDDLAction observe_classifiable_on_attempt_action(nh);
 	KCL_rosplan::ClearObjectPDDLAction clear_object_action(nh);
@@ -307,12 +318,28 @@ int main(int argc, char **argv) {
 	
 	initialiseKnowledgeBase(knowledge_base);
 	
+	// Start the planners for the recursive actions while we set up the first goals, tidy_area and 
+	// explore_area let ROSPlan generate their problem, examine_area and observe_classifiable_on_attempt do not.
+	int max_planner_instances = 8;
+	nh.getParam("/squirrel_planning_execution/max_planner_instances", max_planner_instances);
+	KCL_rosplan::PlannerInstance::setMaxInstances(max_planner_instances);
+	
+	double planner_start_timeout = 30.0;
+	nh.getParam("/squirrel_planning_execution/planner_start_timeout", planner_start_timeout);
+	KCL_rosplan::PlannerInstance::setStartTimeout(ros::Duration(planner_start_timeout));
+	
+	int warm_planner_instances = 1;
+	nh.getParam("/squirrel_planning_execution/warm_planner_instances", warm_planner_instances);
+	KCL_rosplan::PlannerInstance::warmUp(nh, "ff", true, warm_planner_instances);
+	KCL_rosplan::PlannerInstance::warmUp(nh, "ff", false, warm_planner_instances);
+	
 	// Keep running forever.
-	while (true)
+	while (ros::ok())
 	{
 		setupGoals(knowledge_base, message_store);
 		startPlanning(nh);
 	}
 	
+	KCL_rosplan::PlannerInstance::shutdown();
 	return 0;
 }
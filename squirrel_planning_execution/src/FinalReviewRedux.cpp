@@ -500,7 +500,7 @@ int main(int argc, char **argv) {
 	nh.getParam("/scenario_setup_file", config_file);
 	
 	KCL_rosplan::ConfigReader reader(nh, message_store);
-	reader.readConfigurationFile(config_file);
+	if (!reader.readConfigurationFile(config_file)) exit(-1);
 	
 	// Create all PDDL actions that we might need during execution.
 //	KCL_rosplan::ExploreAreaPDDLAction explore_area_action(nh, knowledge_base);
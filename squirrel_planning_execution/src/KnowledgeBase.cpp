@@ -4,6 +4,10 @@
 #include <sstream>
 #include <iostream>
 #include <vector>
+#include <algorithm>
+
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
 
 #include <diagnostic_msgs/KeyValue.h>
 
@@ -17,16 +21,152 @@
 namespace KCL_rosplan
 {
 KnowledgeBase::KnowledgeBase(ros::NodeHandle& nh, mongodb_store::MessageStoreProxy& message_store)
-	: nh_(&nh), message_store_(&message_store)
+	: nh_(&nh), message_store_(&message_store), max_concurrent_queries_(8), cache_enabled_(false), cache_generation_(0)
 {
 	update_knowledge_client_ = nh.serviceClient<rosplan_knowledge_msgs::KnowledgeUpdateService>("/kcl_rosplan/update_knowledge_base");
 	query_knowledge_client_ = nh.serviceClient<rosplan_knowledge_msgs::KnowledgeQueryService>("/kcl_rosplan/query_knowledge_base");
 	
 	get_domain_predicates_client_ = nh.serviceClient<rosplan_knowledge_msgs::GetDomainAttributeService>("/kcl_rosplan/get_domain_predicates");
+	get_domain_functions_client_ = nh.serviceClient<rosplan_knowledge_msgs::GetDomainAttributeService>("/kcl_rosplan/get_domain_functions");
 	get_domain_types_client_ = nh.serviceClient<rosplan_knowledge_msgs::GetDomainTypeService>("/kcl_rosplan/get_domain_types");
 	get_instance_client_ = nh.serviceClient<rosplan_knowledge_msgs::GetInstanceService>("/kcl_rosplan/get_current_instances");
 	get_attribute_client_ = nh.serviceClient<rosplan_knowledge_msgs::GetAttributeService>("/kcl_rosplan/get_current_knowledge");
 	get_current_goals_client_ = nh.serviceClient<rosplan_knowledge_msgs::GetAttributeService>("/kcl_rosplan/get_current_goals");
+	
+	knowledge_changed_pub_ = nh.advertise<rosplan_knowledge_msgs::KnowledgeItem>("/kcl_rosplan/knowledge_base_changed", 1000);
+}
+
+void KnowledgeBase::enableCache(double max_age)
+{
+	boost::mutex::scoped_lock lock(cache_mutex_);
+	if (!cache_enabled_)
+	{
+		knowledge_changed_sub_ = nh_->subscribe("/kcl_rosplan/knowledge_base_changed", 1000, &KCL_rosplan::KnowledgeBase::knowledgeChangedCallback, this);
+	}
+	cache_enabled_ = true;
+	cache_max_age_ = ros::Duration(max_age);
+	ROS_INFO("KCL: (KnowledgeBase) Caching enabled (max age %f seconds).", max_age);
+}
+
+void KnowledgeBase::disableCache()
+{
+	boost::mutex::scoped_lock lock(cache_mutex_);
+	knowledge_changed_sub_.shutdown();
+	cache_enabled_ = false;
+	cached_predicates_.clear();
+	cached_types_.clear();
+	++cache_generation_;
+}
+
+void KnowledgeBase::invalidateCache()
+{
+	boost::mutex::scoped_lock lock(cache_mutex_);
+	cached_predicates_.clear();
+	cached_types_.clear();
+	++cache_generation_;
+}
+
+bool KnowledgeBase::isFresh(const ros::Time& fetched) const
+{
+	return cache_max_age_.toSec() <= 0 || ros::Time::now() - fetched < cache_max_age_;
+}
+
+const KnowledgeBase::CachedPredicate* KnowledgeBase::fetchPredicate(const std::string& predicate, boost::mutex::scoped_lock& lock, CachedPredicate& uncached)
+{
+	std::map<std::string, CachedPredicate>::const_iterator ci = cached_predicates_.find(predicate);
+	if (ci != cached_predicates_.end() && isFresh(ci->second.fetched_))
+	{
+		return &ci->second;
+	}
+	
+	// Do not block other queries while waiting for ROSPlan.
+	unsigned int generation = cache_generation_;
+	lock.unlock();
+	
+	rosplan_knowledge_msgs::GetAttributeService get_attribute;
+	get_attribute.request.predicate_name = predicate;
+	bool success = get_attribute_client_.call(get_attribute);
+	lock.lock();
+	
+	if (!success) {
+		ROS_ERROR("KCL: (KnowledgeBase) Failed to recieve the attributes of the predicate '%s'", predicate.c_str());
+		return NULL;
+	}
+	
+	// Only keep the result if nothing was invalidated while it was being fetched.
+	CachedPredicate& cached_predicate = cache_enabled_ && generation == cache_generation_ ? cached_predicates_[predicate] : uncached;
+	cached_predicate.fetched_ = ros::Time::now();
+	cached_predicate.facts_.clear();
+	for (std::vector<rosplan_knowledge_msgs::KnowledgeItem>::const_iterator ci = get_attribute.response.attributes.begin();
+			ci != get_attribute.response.attributes.end(); ++ci)
+	{
+		cached_predicate.facts_[std::make_pair((bool)ci->is_negative, getParameters(*ci))] = *ci;
+	}
+	return &cached_predicate;
+}
+
+void KnowledgeBase::updateSucceeded(unsigned char update_type, const rosplan_knowledge_msgs::KnowledgeItem& knowledge_item)
+{
+	// Goals are never mirrored.
+	if (update_type == rosplan_knowledge_msgs::KnowledgeUpdateService::Request::ADD_GOAL ||
+	    update_type == rosplan_knowledge_msgs::KnowledgeUpdateService::Request::REMOVE_GOAL)
+	{
+		return;
+	}
+	
+	// The mirror is not written through: the announcement below invalidates the same entries in this object
+	// as well, so a written value would not survive it anyway.
+	{
+		boost::mutex::scoped_lock lock(cache_mutex_);
+		if (cache_enabled_)
+		{
+			++cache_generation_;
+			if (knowledge_item.knowledge_type == rosplan_knowledge_msgs::KnowledgeItem::INSTANCE)
+			{
+				cached_types_.clear();
+				
+				// Removing an instance also removes all facts it is part of.
+				if (update_type == rosplan_knowledge_msgs::KnowledgeUpdateService::Request::REMOVE_KNOWLEDGE)
+				{
+					cached_predicates_.clear();
+				}
+			}
+			else
+			{
+				cached_predicates_.erase(knowledge_item.attribute_name);
+			}
+		}
+	}
+	
+	knowledge_changed_pub_.publish(knowledge_item);
+}
+
+void KnowledgeBase::knowledgeChangedCallback(const rosplan_knowledge_msgs::KnowledgeItem::ConstPtr& msg)
+{
+	boost::mutex::scoped_lock lock(cache_mutex_);
+	
+	// Announcements carry no sender, so our own updates are invalidated as well. That costs one extra
+	// fetch, but an announcement that is lost or made by someone else can never leave a stale entry.
+	++cache_generation_;
+	if (msg->knowledge_type == rosplan_knowledge_msgs::KnowledgeItem::INSTANCE)
+	{
+		cached_types_.clear();
+		cached_predicates_.clear();
+	}
+	else
+	{
+		cached_predicates_.erase(msg->attribute_name);
+	}
+}
+
+std::map<std::string, std::string> KnowledgeBase::getParameters(const rosplan_knowledge_msgs::KnowledgeItem& knowledge_item)
+{
+	std::map<std::string, std::string> parameters;
+	for (std::vector<diagnostic_msgs::KeyValue>::const_iterator ci = knowledge_item.values.begin(); ci != knowledge_item.values.end(); ++ci)
+	{
+		parameters[ci->key] = ci->value;
+	}
+	return parameters;
 }
 
 bool KnowledgeBase::addInstance(const std::string& type, const std::string& name)
@@ -45,6 +185,7 @@ bool KnowledgeBase::addInstance(const std::string& type, const std::string& name
 		return false;
 	}
 	ROS_INFO("KCL: (KnowledgeBase) Added the instance %s of type %s to the knowledge base.", name.c_str(), type.c_str());
+	updateSucceeded(knowledge_update_service.request.update_type, knowledge_item);
 	return true;
 }
 
@@ -64,12 +205,14 @@ bool KnowledgeBase::removeInstance(const std::string& type, const std::string& n
 		return false;
 	}
 	ROS_INFO("KCL: (KnowledgeBase) Removed the instance %s of type %s from the knowledge base.", name.c_str(), type.c_str());
+	updateSucceeded(knowledge_update_service.request.update_type, knowledge_item);
 	return true;
 }
 
-bool KnowledgeBase::getAllInstances(std::vector<std::string>& store)
+bool KnowledgeBase::getAllInstances(std::vector<std::string>& store, SnapshotTiming* timing)
 {
 	ROS_INFO("KCL: (KnowledgeBase) Get all instances.");
+	ros::WallTime start_time = ros::WallTime::now();
 	
 	rosplan_knowledge_msgs::GetDomainTypeService get_domain_type_service;
 	if (!get_domain_types_client_.call(get_domain_type_service))
@@ -77,20 +220,119 @@ bool KnowledgeBase::getAllInstances(std::vector<std::string>& store)
 		ROS_ERROR("KCL: (KnowledgeBase) error getting all types.");
 		return false;
 	}
+	ros::WallTime domain_time = ros::WallTime::now();
+	
+	std::vector<SnapshotQuery> queries(get_domain_type_service.response.types.size());
+	for (unsigned int i = 0; i < queries.size(); ++i)
+	{
+		queries[i].name_ = get_domain_type_service.response.types[i];
+		queries[i].is_type_ = true;
+	}
+	runSnapshotQueries(queries);
 	
-	for (std::vector<std::string>::const_iterator ci = get_domain_type_service.response.types.begin();
-		  ci != get_domain_type_service.response.types.end(); ++ci)
+	// Merge the results in the order the types are declared in the domain.
+	bool success = true;
+	for (std::vector<SnapshotQuery>::const_iterator ci = queries.begin(); ci != queries.end(); ++ci)
 	{
-		if (!getInstances(store, *ci))
+		if (!ci->success_)
 		{
-			return false;
+			success = false;
+			continue;
 		}
+		store.insert(store.end(), ci->instances_.begin(), ci->instances_.end());
 	}
-	return true;
+	
+	reportSnapshotTiming(queries, start_time, domain_time, timing);
+	return success;
+}
+
+bool KnowledgeBase::getAllInstances(std::vector<rosplan_knowledge_msgs::KnowledgeItem>& store, SnapshotTiming* timing)
+{
+	ROS_INFO("KCL: (KnowledgeBase) Get all instances and their types.");
+	ros::WallTime start_time = ros::WallTime::now();
+	
+	rosplan_knowledge_msgs::GetDomainTypeService get_domain_type_service;
+	if (!get_domain_types_client_.call(get_domain_type_service))
+	{
+		ROS_ERROR("KCL: (KnowledgeBase) error getting all types.");
+		return false;
+	}
+	ros::WallTime domain_time = ros::WallTime::now();
+	
+	const std::vector<std::string>& types = get_domain_type_service.response.types;
+	const std::vector<std::string>& super_types = get_domain_type_service.response.super_types;
+	std::map<std::string, std::string> super_type_of;
+	for (unsigned int i = 0; i < types.size() && i < super_types.size(); ++i)
+	{
+		super_type_of[types[i]] = super_types[i];
+	}
+	
+	std::vector<SnapshotQuery> queries(types.size());
+	for (unsigned int i = 0; i < queries.size(); ++i)
+	{
+		queries[i].name_ = types[i];
+		queries[i].is_type_ = true;
+	}
+	runSnapshotQueries(queries);
+	
+	// Instances of subtypes are returned for their super types too, keep the deepest type of every instance.
+	bool success = true;
+	std::vector<std::string> names;
+	std::map<std::string, std::pair<std::string, unsigned int> > type_of;
+	for (std::vector<SnapshotQuery>::const_iterator ci = queries.begin(); ci != queries.end(); ++ci)
+	{
+		if (!ci->success_)
+		{
+			success = false;
+			continue;
+		}
+		
+		unsigned int depth = 0;
+		for (std::map<std::string, std::string>::const_iterator type = super_type_of.find(ci->name_);
+		     type != super_type_of.end() && depth < types.size(); type = super_type_of.find(type->second))
+		{
+			++depth;
+		}
+		
+		for (std::vector<std::string>::const_iterator name = ci->instances_.begin(); name != ci->instances_.end(); ++name)
+		{
+			std::map<std::string, std::pair<std::string, unsigned int> >::iterator i = type_of.find(*name);
+			if (i == type_of.end())
+			{
+				names.push_back(*name);
+				type_of[*name] = std::make_pair(ci->name_, depth);
+			}
+			else if (depth > i->second.second)
+			{
+				i->second = std::make_pair(ci->name_, depth);
+			}
+		}
+	}
+	
+	for (std::vector<std::string>::const_iterator ci = names.begin(); ci != names.end(); ++ci)
+	{
+		store.push_back(createInstance(type_of[*ci].first, *ci));
+	}
+	
+	reportSnapshotTiming(queries, start_time, domain_time, timing);
+	return success;
 }
 
 bool KnowledgeBase::getInstances(std::vector< std::string >& store, const std::string& type)
 {
+	boost::mutex::scoped_lock lock(cache_mutex_);
+	if (cache_enabled_)
+	{
+		std::map<std::string, CachedType>::const_iterator ci = cached_types_.find(type);
+		if (ci != cached_types_.end() && isFresh(ci->second.fetched_))
+		{
+			store.insert(store.end(), ci->second.instances_.begin(), ci->second.instances_.end());
+			return true;
+		}
+	}
+	unsigned int generation = cache_generation_;
+	lock.unlock();
+	
 	rosplan_knowledge_msgs::GetInstanceService getInstances;
 	getInstances.request.type_name = type;
 	if (!get_instance_client_.call(getInstances))
@@ -100,6 +342,15 @@ bool KnowledgeBase::getInstances(std::vector< std::string >& store, const std::s
 	}
 	ROS_INFO("KCL: (KnowledgeBase) Received all the instances of type %s.", type.c_str());
 	store.insert(store.end(), getInstances.response.instances.begin(), getInstances.response.instances.end());
+	
+	lock.lock();
+	if (cache_enabled_ && generation == cache_generation_)
+	{
+		CachedType& cached_type = cached_types_[type];
+		cached_type.fetched_ = ros::Time::now();
+		cached_type.instances_ = getInstances.response.instances;
+	}
+	return true;
 }
 
 bool KnowledgeBase::addFact(const std::string& predicate, const std::map<std::string, std::string>& parameters, bool is_true, AddUpdateTarget target)
@@ -123,6 +374,7 @@ bool KnowledgeBase::addFact(const rosplan_knowledge_msgs::KnowledgeItem& fact, A
 		return false;
 	}
 	ROS_INFO("KCL: (KnowledgeBase) Added %s to the knowledge base.", s.c_str());
+	updateSucceeded(knowledge_update_service.request.update_type, fact);
 	return true;
 }
 
@@ -147,6 +399,7 @@ bool KnowledgeBase::removeFact(const rosplan_knowledge_msgs::KnowledgeItem& fact
 		return false;
 	}
 	ROS_INFO("KCL: (KnowledgeBase) Removed %s from the knowledge base.", s.c_str());
+	updateSucceeded(knowledge_update_service.request.update_type, fact);
 	return true;
 }
 
@@ -167,6 +420,7 @@ bool KnowledgeBase::addFunction(const std::string& predicate, const std::map<std
 		return false;
 	}
 	ROS_DEBUG("KCL: (KnowledgeBase) Added %s to the knowledge base.", s.c_str());
+	updateSucceeded(knowledge_update_service.request.update_type, knowledge_item);
 	return true;
 }
 
@@ -187,6 +441,7 @@ bool KnowledgeBase::removeFunction(const std::string& predicate, const std::map<
 		return false;
 	}
 	ROS_INFO("KCL: (KnowledgeBase) Removed %s from the knowledge base.", s.c_str());
+	updateSucceeded(knowledge_update_service.request.update_type, knowledge_item);
 	return true;
 }
 
@@ -220,31 +475,157 @@ bool KnowledgeBase::removeAllGoals()
 	return true;
 }
 
-bool KnowledgeBase::getAllFacts(std::vector<rosplan_knowledge_msgs::KnowledgeItem>& store)
+bool KnowledgeBase::getAllFacts(std::vector<rosplan_knowledge_msgs::KnowledgeItem>& store, SnapshotTiming* timing)
 {
 	ROS_INFO("KCL: (KnowledgeBase) Get all facts.");
+	return getAllAttributes(get_domain_predicates_client_, store, timing);
+}
+
+bool KnowledgeBase::getAllFunctions(std::vector<rosplan_knowledge_msgs::KnowledgeItem>& store, SnapshotTiming* timing)
+{
+	ROS_INFO("KCL: (KnowledgeBase) Get all functions.");
+	return getAllAttributes(get_domain_functions_client_, store, timing);
+}
+
+bool KnowledgeBase::getAllGoals(std::vector<rosplan_knowledge_msgs::KnowledgeItem>& store)
+{
+	rosplan_knowledge_msgs::GetAttributeService gat;
+	if (!get_current_goals_client_.call(gat))
+	{
+		ROS_ERROR("KCL: (KnowledgeBase) Failed to get all current goals.");
+		return false;
+	}
+	store.insert(store.end(), gat.response.attributes.begin(), gat.response.attributes.end());
+	return true;
+}
+
+bool KnowledgeBase::getAllAttributes(ros::ServiceClient& domain_client, std::vector<rosplan_knowledge_msgs::KnowledgeItem>& store, SnapshotTiming* timing)
+{
+	ros::WallTime start_time = ros::WallTime::now();
 	
 	rosplan_knowledge_msgs::GetDomainAttributeService get_domain_predicates_service;
-	if (!get_domain_predicates_client_.call(get_domain_predicates_service))
+	if (!domain_client.call(get_domain_predicates_service))
 	{
-		ROS_ERROR("KCL: (KnowledgeBase) error getting all facts.");
+		ROS_ERROR("KCL: (KnowledgeBase) error calling %s.", domain_client.getService().c_str());
 		return false;
 	}
+	ros::WallTime domain_time = ros::WallTime::now();
+	
+	std::vector<SnapshotQuery> queries(get_domain_predicates_service.response.items.size());
+	for (unsigned int i = 0; i < queries.size(); ++i)
+	{
+		queries[i].name_ = get_domain_predicates_service.response.items[i].name;
+		queries[i].is_type_ = false;
+	}
+	runSnapshotQueries(queries);
 	
-	for (std::vector<rosplan_knowledge_msgs::DomainFormula>::const_iterator ci = get_domain_predicates_service.response.items.begin();
-		  ci != get_domain_predicates_service.response.items.end(); ++ci)
+	// Merge the results in the order the predicates are declared in the domain.
+	bool success = true;
+	for (std::vector<SnapshotQuery>::const_iterator ci = queries.begin(); ci != queries.end(); ++ci)
 	{
-		ROS_INFO("KCL: (KnowledgeBase) Getting all facts with the predicate %s.", ci->name.c_str());
-		if (!getFacts(store, ci->name))
+		if (!ci->success_)
 		{
-			return false;
+			success = false;
+			continue;
 		}
+		store.insert(store.end(), ci->facts_.begin(), ci->facts_.end());
+	}
+	
+	reportSnapshotTiming(queries, start_time, domain_time, timing);
+	return success;
+}
+
+void KnowledgeBase::setMaxConcurrentQueries(unsigned int max_concurrent_queries)
+{
+	max_concurrent_queries_ = max_concurrent_queries < 1 ? 1 : max_concurrent_queries;
+}
+
+void KnowledgeBase::runSnapshotQueries(std::vector<SnapshotQuery>& queries)
+{
+	unsigned int next_query = 0;
+	boost::mutex next_query_mutex;
+	
+	unsigned int nr_threads = std::min<unsigned int>(max_concurrent_queries_, queries.size());
+	if (nr_threads <= 1)
+	{
+		snapshotWorker(queries, next_query, next_query_mutex);
+		return;
+	}
+	
+	boost::thread_group workers;
+	for (unsigned int i = 0; i < nr_threads; ++i)
+	{
+		workers.create_thread(boost::bind(&KnowledgeBase::snapshotWorker, this, boost::ref(queries), boost::ref(next_query), boost::ref(next_query_mutex)));
+	}
+	workers.join_all();
+}
+
+void KnowledgeBase::snapshotWorker(std::vector<SnapshotQuery>& queries, unsigned int& next_query, boost::mutex& next_query_mutex)
+{
+	while (true)
+	{
+		unsigned int i;
+		{
+			boost::mutex::scoped_lock lock(next_query_mutex);
+			if (next_query >= queries.size()) return;
+			i = next_query++;
+		}
+		
+		SnapshotQuery& query = queries[i];
+		ros::WallTime start_time = ros::WallTime::now();
+		if (query.is_type_)
+		{
+			query.success_ = getInstances(query.instances_, query.name_);
+		}
+		else
+		{
+			ROS_INFO("KCL: (KnowledgeBase) Getting all facts with the predicate %s.", query.name_.c_str());
+			query.success_ = getFacts(query.facts_, query.name_);
+		}
+		query.duration_ = (ros::WallTime::now() - start_time).toSec();
+	}
+}
+
+void KnowledgeBase::reportSnapshotTiming(const std::vector<SnapshotQuery>& queries, const ros::WallTime& start_time, const ros::WallTime& domain_time, SnapshotTiming* timing) const
+{
+	ros::WallTime end_time = ros::WallTime::now();
+	double sum = 0;
+	for (std::vector<SnapshotQuery>::const_iterator ci = queries.begin(); ci != queries.end(); ++ci)
+	{
+		sum += ci->duration_;
+		ROS_DEBUG("KCL: (KnowledgeBase) Query %s took %f seconds.", ci->name_.c_str(), ci->duration_);
+	}
+	ROS_INFO("KCL: (KnowledgeBase) Snapshot of %lu queries took %f seconds (%f seconds sequentially).", queries.size(), (end_time - start_time).toSec(), (domain_time - start_time).toSec() + sum);
+	
+	if (timing == NULL) return;
+	timing->domain_query_time_ = (domain_time - start_time).toSec();
+	timing->total_time_ = (end_time - start_time).toSec();
+	timing->query_times_.clear();
+	for (std::vector<SnapshotQuery>::const_iterator ci = queries.begin(); ci != queries.end(); ++ci)
+	{
+		timing->query_times_.push_back(std::make_pair(ci->name_, ci->duration_));
 	}
-	return true;
 }
 
 bool KnowledgeBase::getFacts(std::vector<rosplan_knowledge_msgs::KnowledgeItem>& store, const std::string& predicate)
 {
+	boost::mutex::scoped_lock lock(cache_mutex_);
+	if (cache_enabled_)
+	{
+		CachedPredicate uncached;
+		const CachedPredicate* cached_predicate = fetchPredicate(predicate, lock, uncached);
+		if (cached_predicate == NULL)
+		{
+			return false;
+		}
+		for (std::map<CachedPredicate::Key, rosplan_knowledge_msgs::KnowledgeItem>::const_iterator ci = cached_predicate->facts_.begin(); ci != cached_predicate->facts_.end(); ++ci)
+		{
+			store.push_back(ci->second);
+		}
+		return true;
+	}
+	lock.unlock();
+	
 	rosplan_knowledge_msgs::GetAttributeService get_attribute;
 	get_attribute.request.predicate_name = predicate;
 	if (!get_attribute_client_.call(get_attribute)) {
@@ -265,6 +646,33 @@ bool KnowledgeBase::getFacts(std::vector<rosplan_knowledge_msgs::KnowledgeItem>&
 
 bool KnowledgeBase::isFactTrue(const std::string& predicate, const std::map<std::string, std::string>& parameters, bool is_true)
 {
+	{
+		boost::mutex::scoped_lock lock(cache_mutex_);
+		CachedPredicate uncached;
+		const CachedPredicate* cached_predicate = cache_enabled_ ? fetchPredicate(predicate, lock, uncached) : NULL;
+		if (cached_predicate != NULL)
+		{
+			// Like ROSPlan, a fact is false unless it is present as a positive fact.
+			const std::map<CachedPredicate::Key, rosplan_knowledge_msgs::KnowledgeItem>& facts = cached_predicate->facts_;
+			bool is_present = facts.find(std::make_pair(false, parameters)) != facts.end();
+			
+			// The parameters might only be a subset of the parameters of the predicate.
+			for (std::map<CachedPredicate::Key, rosplan_knowledge_msgs::KnowledgeItem>::const_iterator fi = facts.begin(); !is_present && fi != facts.end(); ++fi)
+			{
+				if (fi->first.first || fi->first.second.size() == parameters.size()) continue;
+				
+				bool matches = true;
+				for (std::map<std::string, std::string>::const_iterator ci = parameters.begin(); matches && ci != parameters.end(); ++ci)
+				{
+					std::map<std::string, std::string>::const_iterator value = fi->first.second.find(ci->first);
+					matches = value != fi->first.second.end() && value->second == ci->second;
+				}
+				is_present = matches;
+			}
+			return is_present == is_true;
+		}
+	}
+	
 	// Check if this object has been examined.
 	rosplan_knowledge_msgs::KnowledgeItem knowledge_item = createFact(predicate, parameters, is_true);
 	
@@ -283,6 +691,15 @@ bool KnowledgeBase::isFactTrue(const std::string& predicate, const std::map<std:
 	return knowledge_query.response.all_true;
 }
 
+rosplan_knowledge_msgs::KnowledgeItem KnowledgeBase::createInstance(const std::string& type, const std::string& name)
+{
+	rosplan_knowledge_msgs::KnowledgeItem knowledge_item;
+	knowledge_item.knowledge_type = rosplan_knowledge_msgs::KnowledgeItem::INSTANCE;
+	knowledge_item.instance_type = type;
+	knowledge_item.instance_name = name;
+	return knowledge_item;
+}
+
 rosplan_knowledge_msgs::KnowledgeItem KnowledgeBase::createFact(const std::string& predicate, const std::map<std::string, std::string>& parameters, bool is_true)
 {
 	rosplan_knowledge_msgs::KnowledgeItem knowledge_item;
@@ -319,6 +736,143 @@ rosplan_knowledge_msgs::KnowledgeItem KnowledgeBase::createFunction(const std::s
 	return knowledge_item;
 }
 
+/*-------------*/
+/* Transaction */
+/*-------------*/
+
+KnowledgeBase::Transaction::Transaction(KnowledgeBase& knowledge_base)
+	: knowledge_base_(&knowledge_base)
+{
+	
+}
+
+void KnowledgeBase::Transaction::addInstance(const std::string& type, const std::string& name)
+{
+	record(rosplan_knowledge_msgs::KnowledgeUpdateService::Request::ADD_KNOWLEDGE, createInstance(type, name));
+}
+
+void KnowledgeBase::Transaction::removeInstance(const std::string& type, const std::string& name)
+{
+	rosplan_knowledge_msgs::KnowledgeItem knowledge_item;
+	knowledge_item.knowledge_type = rosplan_knowledge_msgs::KnowledgeItem::INSTANCE;
+	knowledge_item.instance_type = type;
+	knowledge_item.instance_name = name;
+	record(rosplan_knowledge_msgs::KnowledgeUpdateService::Request::REMOVE_KNOWLEDGE, knowledge_item);
+}
+
+void KnowledgeBase::Transaction::addFact(const std::string& predicate, const std::map<std::string, std::string>& parameters, bool is_true, AddUpdateTarget target)
+{
+	addFact(createFact(predicate, parameters, is_true), target);
+}
+
+void KnowledgeBase::Transaction::addFact(const rosplan_knowledge_msgs::KnowledgeItem& fact, AddUpdateTarget target)
+{
+	record(target, fact);
+}
+
+void KnowledgeBase::Transaction::addKnowledgeItem(const rosplan_knowledge_msgs::KnowledgeItem& knowledge_item, AddUpdateTarget target)
+{
+	record(target, knowledge_item);
+}
+
+void KnowledgeBase::Transaction::removeKnowledgeItem(const rosplan_knowledge_msgs::KnowledgeItem& knowledge_item, RemoveUpdateTarget target)
+{
+	record(target, knowledge_item);
+}
+
+void KnowledgeBase::Transaction::removeFact(const std::string& predicate, const std::map<std::string, std::string>& parameters, bool is_true, RemoveUpdateTarget target)
+{
+	removeFact(createFact(predicate, parameters, is_true), target);
+}
+
+void KnowledgeBase::Transaction::removeFact(const rosplan_knowledge_msgs::KnowledgeItem& fact, RemoveUpdateTarget target)
+{
+	record(target, fact);
+}
+
+void KnowledgeBase::Transaction::addFunction(const std::string& predicate, const std::map<std::string, std::string>& parameters, float value, AddUpdateTarget target)
+{
+	record(target, createFunction(predicate, parameters, value));
+}
+
+void KnowledgeBase::Transaction::removeFunction(const std::string& predicate, const std::map<std::string, std::string>& parameters, RemoveUpdateTarget target)
+{
+	record(target, createFunction(predicate, parameters, 0.0f));
+}
+
+void KnowledgeBase::Transaction::record(unsigned char update_type, const rosplan_knowledge_msgs::KnowledgeItem& knowledge_item)
+{
+	rosplan_knowledge_msgs::KnowledgeUpdateService knowledge_update_service;
+	knowledge_update_service.request.update_type = update_type;
+	knowledge_update_service.request.knowledge = knowledge_item;
+	updates_.push_back(knowledge_update_service);
+}
+
+bool KnowledgeBase::Transaction::commit()
+{
+	errors_.clear();
+	if (updates_.empty())
+	{
+		return true;
+	}
+	
+	ROS_INFO("KCL: (KnowledgeBase) Commit %lu updates to the knowledge base.", updates_.size());
+	
+	// A persistent connection is negotiated once and reused for every update in this batch.
+	ros::ServiceClient update_client = knowledge_base_->nh_->serviceClient<rosplan_knowledge_msgs::KnowledgeUpdateService>("/kcl_rosplan/update_knowledge_base", true);
+	
+	for (std::vector<rosplan_knowledge_msgs::KnowledgeUpdateService>::iterator i = updates_.begin(); i != updates_.end(); ++i)
+	{
+		// Reconnect if the knowledge base dropped the connection halfway through.
+		if (!update_client.isValid())
+		{
+			update_client = knowledge_base_->nh_->serviceClient<rosplan_knowledge_msgs::KnowledgeUpdateService>("/kcl_rosplan/update_knowledge_base", true);
+		}
+		
+		if (update_client.call(*i) && i->response.success)
+		{
+			knowledge_base_->updateSucceeded(i->request.update_type, i->request.knowledge);
+		}
+		else
+		{
+			std::stringstream ss;
+			switch (i->request.update_type)
+			{
+			case rosplan_knowledge_msgs::KnowledgeUpdateService::Request::ADD_KNOWLEDGE: ss << "add "; break;
+			case rosplan_knowledge_msgs::KnowledgeUpdateService::Request::ADD_GOAL: ss << "add goal "; break;
+			case rosplan_knowledge_msgs::KnowledgeUpdateService::Request::REMOVE_KNOWLEDGE: ss << "remove "; break;
+			case rosplan_knowledge_msgs::KnowledgeUpdateService::Request::REMOVE_GOAL: ss << "remove goal "; break;
+			}
+			ss << knowledge_base_->toString(i->request.knowledge);
+			errors_.push_back(ss.str());
+		}
+	}
+	update_client.shutdown();
+	
+	if (!errors_.empty())
+	{
+		std::stringstream ss;
+		for (std::vector<std::string>::const_iterator ci = errors_.begin(); ci != errors_.end(); ++ci)
+		{
+			ss << std::endl << "  " << *ci;
+		}
+		ROS_ERROR("KCL: (KnowledgeBase) %lu out of %lu updates failed:%s", errors_.size(), updates_.size(), ss.str().c_str());
+	}
+	else
+	{
+		ROS_INFO("KCL: (KnowledgeBase) Committed %lu updates to the knowledge base.", updates_.size());
+	}
+	
+	updates_.clear();
+	return errors_.empty();
+}
+
+void KnowledgeBase::Transaction::clear()
+{
+	updates_.clear();
+	errors_.clear();
+}
+
 std::string KnowledgeBase::toString(const rosplan_knowledge_msgs::KnowledgeItem& knowledge_item) const
 {
 	std::stringstream ss;
@@ -0,0 +1,61 @@
+#include <algorithm>
+
+#include <squirrel_planning_execution/KnowledgeScorer.h>
+
+namespace KCL_rosplan {
+
+// The number of partial sums, a float sum only vectorises if it is split into independent lanes.
+static const unsigned int g_lanes = 8;
+
+KnowledgeScorer::KnowledgeScorer()
+{
+
+}
+
+void KnowledgeScorer::addFact(unsigned int fact_id)
+{
+	if (fact_id >= weights_.size())
+	{
+		weights_.resize(fact_id + 1, 0.0f);
+	}
+	weights_[fact_id] += 1.0f;
+}
+
+void KnowledgeScorer::clear()
+{
+	weights_.clear();
+}
+
+float KnowledgeScorer::score(const std::vector<float>& probabilities) const
+{
+	unsigned int size = std::min(weights_.size(), probabilities.size());
+	if (size == 0)
+	{
+		return 0.0f;
+	}
+	const float* weights = &weights_[0];
+	const float* values = &probabilities[0];
+
+	float partial_sums[g_lanes] = { 0 };
+	unsigned int i = 0;
+	for (; i + g_lanes <= size; i += g_lanes)
+	{
+		for (unsigned int lane = 0; lane < g_lanes; ++lane)
+		{
+			partial_sums[lane] += weights[i + lane] * values[i + lane];
+		}
+	}
+
+	float sum = 0.0f;
+	for (; i < size; ++i)
+	{
+		sum += weights[i] * values[i];
+	}
+	for (unsigned int lane = 0; lane < g_lanes; ++lane)
+	{
+		sum += partial_sums[lane];
+	}
+	return sum;
+}
+
+};
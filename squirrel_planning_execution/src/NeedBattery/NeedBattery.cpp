@@ -36,7 +36,7 @@ NeedBattery::NeedBattery(ros::NodeHandle& nh)
 	nh.getParam("/scenario_setup_file", config_file);
 	
 	ConfigReader reader(nh, message_store_);
-	reader.readConfigurationFile(config_file);
+	if (!reader.readConfigurationFile(config_file)) exit(-1);
 	
 	// Initialise the knowledge base and MongoDB for this problem.
 	initialiseKnowledgeBase();
@@ -101,7 +101,14 @@ void PersuadeChild::dispatchCallback(const rosplan_dispatch_msgs::ActionDispatch
 	ROS_INFO("KCL: (PersuadeChild) Process the action: %s, %s gives %s to %s at %s", normalised_action_name.c_str(), child.c_str(), object.c_str(), robot.c_str(), child_waypoint.c_str());
 	bool actionAchieved = false;
 	
-	PlannerInstance& planner_instance = PlannerInstance::createInstance(*node_handle_, "ff", true);
+	PlannerInstance* planner_instance = PlannerInstance::createInstance(*node_handle_, "ff", true);
+	if (planner_instance == NULL)
+	{
+		ROS_ERROR("KCL: (PersuadeChild) no planner instance is available for action name %s.", normalised_action_name.c_str());
+		fb.status = "action failed";
+		action_feedback_pub_.publish(fb);
+		return;
+	}
 	
 	// Lets start the planning process.
 	std::string data_path;
@@ -132,7 +139,7 @@ void PersuadeChild::dispatchCallback(const rosplan_dispatch_msgs::ActionDispatch
 		return;
 	}
 	*/
-	planner_instance.startPlanner(domain_name, problem_name, data_path, planner_command);
+	planner_instance->startPlanner(domain_name, problem_name, data_path, planner_command);
 	
 	// publish feedback (enabled)
 	fb.action_id = msg->action_id;
@@ -141,12 +148,13 @@ void PersuadeChild::dispatchCallback(const rosplan_dispatch_msgs::ActionDispatch
 
 	// wait for action to finish
 	ros::Rate loop_rate(1);
-	while (ros::ok() && (planner_instance.getState() == actionlib::SimpleClientGoalState::ACTIVE || planner_instance.getState() == actionlib::SimpleClientGoalState::PENDING)) {
+	while (ros::ok() && (planner_instance->getState() == actionlib::SimpleClientGoalState::ACTIVE || planner_instance->getState() == actionlib::SimpleClientGoalState::PENDING)) {
 		ros::spinOnce();
 		loop_rate.sleep();
 	}
 
-	actionlib::SimpleClientGoalState state = planner_instance.getState();
+	actionlib::SimpleClientGoalState state = planner_instance->getState();
+	planner_instance->release();
 	ROS_INFO("KCL: (ExamineAreaPDDLAction) action finished: %s, %s", "persuade-child-give-battery", state.toString().c_str());
 
 	if(state == actionlib::SimpleClientGoalState::SUCCEEDED)
@@ -0,0 +1,133 @@
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <sys/stat.h>
+
+#include <ros/ros.h>
+
+#include "squirrel_planning_execution/PDDLCache.h"
+#include "squirrel_planning_execution/PDDLWriter.h"
+
+namespace KCL_rosplan {
+
+// The FNV-1a offset basis and prime for 64 bit hashes.
+static const boost::uint64_t g_fnv_offset_basis = 14695981039346656037ULL;
+static const boost::uint64_t g_fnv_prime = 1099511628211ULL;
+
+std::map<std::string, PDDLCache::Entry> PDDLCache::entries_;
+boost::mutex PDDLCache::entries_mutex_;
+
+PDDLCache::Fingerprint::Fingerprint()
+	: value_(g_fnv_offset_basis)
+{
+
+}
+
+void PDDLCache::Fingerprint::addBytes(const char* data, size_t size)
+{
+	for (size_t i = 0; i < size; ++i)
+	{
+		value_ ^= (unsigned char)data[i];
+		value_ *= g_fnv_prime;
+	}
+}
+
+PDDLCache::Fingerprint& PDDLCache::Fingerprint::add(const std::string& value)
+{
+	// Include the length, so ("ab", "c") and ("a", "bc") do not collide.
+	add((unsigned int)value.size());
+	addBytes(value.data(), value.size());
+	return *this;
+}
+
+PDDLCache::Fingerprint& PDDLCache::Fingerprint::add(unsigned int value)
+{
+	addBytes(reinterpret_cast<const char*>(&value), sizeof(value));
+	return *this;
+}
+
+PDDLCache::Fingerprint& PDDLCache::Fingerprint::add(const std::vector<std::string>& values)
+{
+	add((unsigned int)values.size());
+	for (std::vector<std::string>::const_iterator ci = values.begin(); ci != values.end(); ++ci)
+	{
+		add(*ci);
+	}
+	return *this;
+}
+
+PDDLCache::Fingerprint& PDDLCache::Fingerprint::add(const std::map<std::string, std::string>& values)
+{
+	add((unsigned int)values.size());
+	for (std::map<std::string, std::string>::const_iterator ci = values.begin(); ci != values.end(); ++ci)
+	{
+		add(ci->first);
+		add(ci->second);
+	}
+	return *this;
+}
+
+PDDLCache::Fingerprint& PDDLCache::Fingerprint::add(const std::map<std::string, std::vector<std::string> >& values)
+{
+	add((unsigned int)values.size());
+	for (std::map<std::string, std::vector<std::string> >::const_iterator ci = values.begin(); ci != values.end(); ++ci)
+	{
+		add(ci->first);
+		add(ci->second);
+	}
+	return *this;
+}
+
+bool PDDLCache::restore(const std::string& file_name, const Fingerprint& fingerprint)
+{
+	boost::mutex::scoped_lock lock(entries_mutex_);
+	std::map<std::string, Entry>::const_iterator ci = entries_.find(file_name);
+	if (ci == entries_.end() || ci->second.fingerprint_ != fingerprint.getValue())
+	{
+		return false;
+	}
+
+	// Someone else removed or changed the file, write it again from memory.
+	const Entry& entry = ci->second;
+	if (!hasContent(file_name, entry.text_))
+	{
+		ROS_INFO("KCL: (PDDLCache) Restore %s from memory.", file_name.c_str());
+		PDDLWriter writer(file_name);
+		writer << entry.text_;
+		return writer.close();
+	}
+	return true;
+}
+
+void PDDLCache::store(const std::string& file_name, const Fingerprint& fingerprint)
+{
+	std::ifstream file(file_name.c_str(), std::ios::in | std::ios::binary);
+	if (!file.is_open())
+	{
+		ROS_ERROR("KCL: (PDDLCache) Could not read %s.", file_name.c_str());
+		return;
+	}
+	std::stringstream text;
+	text << file.rdbuf();
+
+	boost::mutex::scoped_lock lock(entries_mutex_);
+	Entry& entry = entries_[file_name];
+	entry.fingerprint_ = fingerprint.getValue();
+	entry.text_ = text.str();
+}
+
+bool PDDLCache::hasContent(const std::string& file_name, const std::string& text)
+{
+	// Compare the size first, so most changes are found without reading the file.
+	struct stat file_status;
+	if (stat(file_name.c_str(), &file_status) != 0 || file_status.st_size != (off_t)text.size())
+	{
+		return false;
+	}
+
+	std::ifstream file(file_name.c_str(), std::ios::in | std::ios::binary);
+	std::vector<char> content(text.size());
+	return file.read(content.empty() ? NULL : &content[0], content.size()) && std::equal(content.begin(), content.end(), text.begin());
+}
+
+};
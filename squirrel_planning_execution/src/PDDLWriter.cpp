@@ -0,0 +1,119 @@
+#include <cstdio>
+
+#include <ros/ros.h>
+
+#include "squirrel_planning_execution/PDDLWriter.h"
+
+namespace KCL_rosplan {
+
+// Most generated domains fit in this without growing the buffer.
+static const size_t g_initial_buffer_size = 1024 * 1024;
+
+PDDLWriter::Buffer::Buffer()
+{
+	data_.reserve(g_initial_buffer_size);
+}
+
+PDDLWriter::Buffer::int_type PDDLWriter::Buffer::overflow(int_type c)
+{
+	if (!traits_type::eq_int_type(c, traits_type::eof()))
+	{
+		data_.push_back(traits_type::to_char_type(c));
+	}
+	return traits_type::not_eof(c);
+}
+
+std::streamsize PDDLWriter::Buffer::xsputn(const char* s, std::streamsize n)
+{
+	data_.append(s, n);
+	return n;
+}
+
+PDDLWriter::PDDLWriter()
+	: std::ostream(NULL), depth_(0)
+{
+	rdbuf(&buffer_);
+}
+
+PDDLWriter::PDDLWriter(const std::string& file_name)
+	: std::ostream(NULL), depth_(0)
+{
+	rdbuf(&buffer_);
+	open(file_name);
+}
+
+PDDLWriter::~PDDLWriter()
+{
+	if (is_open())
+	{
+		close();
+	}
+}
+
+void PDDLWriter::open(const std::string& file_name)
+{
+	file_name_ = file_name;
+	buffer_.data_.clear();
+	depth_ = 0;
+	clear();
+}
+
+bool PDDLWriter::close()
+{
+	if (!is_open())
+	{
+		return false;
+	}
+	
+	FILE* file = fopen(file_name_.c_str(), "wb");
+	bool success = file != NULL;
+	if (success)
+	{
+		size_t written = fwrite(buffer_.data_.data(), 1, buffer_.data_.size(), file);
+		success = fclose(file) == 0 && written == buffer_.data_.size();
+	}
+	if (!success)
+	{
+		ROS_ERROR("KCL: (PDDLWriter) Could not write %lu bytes to %s.", buffer_.data_.size(), file_name_.c_str());
+		setstate(std::ios_base::badbit);
+	}
+	file_name_.clear();
+	return success;
+}
+
+PDDLWriter& PDDLWriter::begin(const std::string& head)
+{
+	indent();
+	buffer_.data_ += '(';
+	buffer_.data_ += head;
+	buffer_.data_ += '\n';
+	++depth_;
+	return *this;
+}
+
+PDDLWriter& PDDLWriter::end()
+{
+	if (depth_ > 0)
+	{
+		--depth_;
+	}
+	indent();
+	buffer_.data_ += ")\n";
+	return *this;
+}
+
+PDDLWriter& PDDLWriter::line(const std::string& text)
+{
+	indent();
+	buffer_.data_ += text;
+	buffer_.data_ += '\n';
+	return *this;
+}
+
+PDDLWriter& PDDLWriter::indent()
+{
+	buffer_.data_.append(depth_, '\t');
+	return *this;
+}
+
+};
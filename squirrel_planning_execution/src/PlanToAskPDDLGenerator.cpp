@@ -10,6 +10,7 @@
 #include <ros/ros.h>
 
 #include "squirrel_planning_execution/PlanToAskPDDLGenerator.h"
+#include "squirrel_planning_execution/PDDLWriter.h"
 
 namespace KCL_rosplan {
 
@@ -26,47 +27,46 @@ void PlanToAskPDDLGenerator::generateProblemFile(const std::string& file_name, c
 		}
 	}
 	
-	std::ofstream myfile;
-	myfile.open(file_name.c_str());
-	myfile << "(define (problem squirrel)" << std::endl;
-	myfile << "(:domain classify_objects)" << std::endl;
-	myfile << "(:objects" << std::endl;
+	PDDLWriter myfile(file_name);
+	myfile.begin("define (problem squirrel)");
+	myfile.line("(:domain classify_objects)");
+	myfile.begin(":objects");
 	
-	myfile << "\tl0 - LEVEL" << std::endl;
-	myfile << "\tl1 - LEVEL" << std::endl;
-	myfile << "\tl2 - LEVEL" << std::endl;
-	myfile << ")" << std::endl;
+	myfile.line("l0 - LEVEL");
+	myfile.line("l1 - LEVEL");
+	myfile.line("l2 - LEVEL");
+	myfile.end();
 	myfile << std::endl;
 	
-	myfile << "(:init" << std::endl;
-	myfile << "\t(resolve-axioms)" << std::endl;
-	myfile << "\t(lev l0)" << std::endl;
-	myfile << "\t(next l0 l1)" << std::endl;
-	myfile << "\t(next l1 l2)" << std::endl;
+	myfile.begin(":init");
+	myfile.line("(resolve-axioms)");
+	myfile.line("(lev l0)");
+	myfile.line("(next l0 l1)");
+	myfile.line("(next l1 l2)");
 	
 	for (std::vector<const Box*>::const_iterator ci = boxes.begin(); ci != boxes.end(); ++ci)
 	{
 		const Box* box = *ci;
-		myfile << "\t(box_at " << box->name_ << " " << box->location_->name_ << ")" << std::endl;
+		myfile.indent() << "(box_at " << box->name_ << " " << box->location_->name_ << ")" << std::endl;
 	}
 	
-	myfile << "\t(current_kb " << current_knowledge_base.name_ << ")" << std::endl;
+	myfile.indent() << "(current_kb " << current_knowledge_base.name_ << ")" << std::endl;
 	
 	for (std::vector<const State*>::const_iterator ci = current_knowledge_base.states_.begin(); ci != current_knowledge_base.states_.end(); ++ci)
 	{
 		const State* state = *ci;
-		myfile << "\t(part-of " << state->state_name_ << " " << current_knowledge_base.name_ << ")" << std::endl;
-		myfile << "\t(m " << state->state_name_ << ")" << std::endl;
-		myfile << "\t(robot_at robot " << robot_location.name_ << " " << state->state_name_ << ")" << std::endl;
+		myfile.indent() << "(part-of " << state->state_name_ << " " << current_knowledge_base.name_ << ")" << std::endl;
+		myfile.indent() << "(m " << state->state_name_ << ")" << std::endl;
+		myfile.indent() << "(robot_at robot " << robot_location.name_ << " " << state->state_name_ << ")" << std::endl;
 		//myfile << "\t(child_at child child_wp " << state->state_name_ << ")" << std::endl;
-		myfile << "\t(gripper_empty robot " << " " << state->state_name_ << ")" << std::endl;
+		myfile.indent() << "(gripper_empty robot " << " " << state->state_name_ << ")" << std::endl;
 		
 		// All the objects are clear inially.
 		for (std::vector<Toy*>::const_iterator ci = objects.begin(); ci != objects.end(); ++ci)
 		{
 			const Toy* object = *ci;
 			//myfile << "\t(cleared " << object->name_ << " " << state->state_name_ << ")" << std::endl;
-			myfile << "\t(object_at " << object->name_ << " " << object->location_->name_ << " " << state->state_name_ << ")" << std::endl;
+			myfile.indent() << "(object_at " << object->name_ << " " << object->location_->name_ << " " << state->state_name_ << ")" << std::endl;
 			/*
 			for (std::vector<const Location*>::const_iterator ci = object->observable_locations_.begin(); ci != object->observable_locations_.end() - 1; ++ci)
 			{
@@ -77,7 +77,7 @@ void PlanToAskPDDLGenerator::generateProblemFile(const std::string& file_name, c
 		}
 		
 		// Set the top of the tree as 'active'.
-		myfile << "\t(to_observe " << root.object_->name_ << " " << root.box_->name_ << " " << state->state_name_ << ")" << std::endl;
+		myfile.indent() << "(to_observe " << root.object_->name_ << " " << root.box_->name_ << " " << state->state_name_ << ")" << std::endl;
 	}
 	
 	for (std::vector<Location*>::const_iterator ci = locations.begin(); ci != locations.end(); ++ci)
@@ -87,7 +87,7 @@ void PlanToAskPDDLGenerator::generateProblemFile(const std::string& file_name, c
 		{
 			const Location* location2 = *ci;
 			if (location == location2) continue;
-			myfile << "\t(near " << location->name_ << " " << location2->name_ << ")" << std::endl;
+			myfile.indent() << "(near " << location->name_ << " " << location2->name_ << ")" << std::endl;
 		}
 		/*
 		if (location->is_clear_)
@@ -104,38 +104,39 @@ void PlanToAskPDDLGenerator::generateProblemFile(const std::string& file_name, c
 		for (std::vector<const State*>::const_iterator ci = knowledge_base->states_.begin(); ci != knowledge_base->states_.end(); ++ci)
 		{
 			const State* state = *ci;
-			myfile << "\t(part-of " << state->state_name_ << " " << knowledge_base->name_ << ")" << std::endl;
+			myfile.indent() << "(part-of " << state->state_name_ << " " << knowledge_base->name_ << ")" << std::endl;
 			
 			for (unsigned int i = 0; i < state->sense_sequence_.size() - 1; ++i)
 			{
 				const TreeNode* node = state->sense_sequence_[i];
 				const TreeNode* next_node = state->sense_sequence_[i + 1];
-				myfile << "\t(order " << node->object_->name_ << " " << node->box_->name_ << " " << next_node->object_->name_ << " " << next_node->box_->name_ << " " << state->state_name_ << ")" << std::endl;
+				myfile.indent() << "(order " << node->object_->name_ << " " << node->box_->name_ << " " << next_node->object_->name_ << " " << next_node->box_->name_ << " " << state->state_name_ << ")" << std::endl;
 			}
 			
 			for (std::map<const Toy*, const Box*>::const_iterator ci = state->believe_state_.begin(); ci != state->believe_state_.end(); ++ci)
 			{
-				myfile << "\t(belongs_in " << ci->first->name_ << " " << ci->second->name_ << " " << state->state_name_ << ")" << std::endl;
+				myfile.indent() << "(belongs_in " << ci->first->name_ << " " << ci->second->name_ << " " << state->state_name_ << ")" << std::endl;
 			}
 			
 			const TreeNode* last_node = state->sense_sequence_[state->sense_sequence_.size() - 1];
-			myfile << "\t(last_observation " << last_node->object_->name_ << " " << last_node->box_->name_ << " " << state->state_name_ << ")" << std::endl;
+			myfile.indent() << "(last_observation " << last_node->object_->name_ << " " << last_node->box_->name_ << " " << state->state_name_ << ")" << std::endl;
 		}
 		
 		for (std::vector<const KnowledgeBase*>::const_iterator ci = knowledge_base->children_.begin(); ci != knowledge_base->children_.end(); ++ci)
 		{
-			myfile << "\t(parent " << knowledge_base->name_ << " " << (*ci)->name_ << ")" << std::endl;
+			myfile.indent() << "(parent " << knowledge_base->name_ << " " << (*ci)->name_ << ")" << std::endl;
 		}
 	}
-	myfile << ")" << std::endl;
-	myfile << "(:goal (and" << std::endl;
+	myfile.end();
+	myfile.begin(":goal");
+	myfile.begin("and");
 	for (std::vector<const State*>::const_iterator ci = current_knowledge_base.states_.begin(); ci != current_knowledge_base.states_.end(); ++ci)
 	{
-		myfile << "\t(finished " << " " << (*ci)->state_name_ << ")" << std::endl;
+		myfile.indent() << "(finished " << " " << (*ci)->state_name_ << ")" << std::endl;
 	}
-	myfile << ")" << std::endl;
-	myfile << ")" << std::endl;
-	myfile << ")" << std::endl;
+	myfile.end();
+	myfile.end();
+	myfile.end();
 	myfile.close();
 }
 
@@ -152,8 +153,7 @@ void PlanToAskPDDLGenerator::generateDomainFile(const std::string& file_name, co
 		}
 	}
 	
-	std::ofstream myfile;
-	myfile.open (file_name.c_str());
+	PDDLWriter myfile(file_name);
 	myfile << "(define (domain classify_objects)" << std::endl;
 	myfile << "(:requirements :typing :conditional-effects :negative-preconditions :disjunctive-preconditions)" << std::endl;
 	myfile << std::endl;
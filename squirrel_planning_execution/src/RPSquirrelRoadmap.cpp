@@ -1,11 +1,13 @@
 #include "squirrel_planning_execution/RPSquirrelRoadmap.h"
+#include <algorithm>
+#include <boost/bind.hpp>
 
 /* implementation of squirrel_planning_execution::RPSquirrelRoadmap.h */
 namespace KCL_rosplan {
 
 	/* constructor */
 	RPSquirrelRoadmap::RPSquirrelRoadmap(ros::NodeHandle &nh, std::string frame)
-	 : message_store(nh), fixed_frame(frame) {
+	 : message_store(nh), knowledge_base(nh, message_store), fixed_frame(frame), node_handle(nh) {
 
 		// config
 		std::string dataPath("common/");
@@ -17,15 +19,14 @@ namespace KCL_rosplan {
 
 		// knowledge interface
 		get_instance_client = nh.serviceClient<rosplan_knowledge_msgs::GetInstanceService>("/kcl_rosplan/get_instances");
-		update_knowledge_client = nh.serviceClient<rosplan_knowledge_msgs::KnowledgeUpdateService>("/kcl_rosplan/update_knowledge_base");
 
 		// visualisation
 		waypoints_pub = nh.advertise<visualization_msgs::MarkerArray>("/kcl_rosplan/viz/waypoints", 10, true);
 
 		// request topics
 		std::string manipulationTopic("/squirrel_manipulation/waypoint_service");
-		nh.param("manipulation_service_topic", manipulationTopic, manipulationTopic);
-		manipulation_client = nh.serviceClient<squirrel_planning_knowledge_msgs::TaskPoseService>(manipulationTopic);
+		nh.param("manipulation_service_topic", manipulation_service_topic, manipulationTopic);
+		nh.param("max_concurrent_requests", max_concurrent_requests, 4);
 
 		// map interface
 		map_client = nh.serviceClient<nav_msgs::GetMap>(static_map_service);
@@ -46,33 +47,12 @@ namespace KCL_rosplan {
 	/*-----------*/
 
 	/**
-	 * Generates waypoints and stores them in the knowledge base and scene database
+	 * Generates waypoints and stores them in the knowledge base and scene database. The waypoints are computed 
+	 * first, the old roadmap is only replaced once all of them are known.
 	 */
 	bool RPSquirrelRoadmap::generateRoadmap(rosplan_knowledge_msgs::CreatePRM::Request &req, rosplan_knowledge_msgs::CreatePRM::Response &res) {
 
-		ros::NodeHandle nh("~");
-
-		// clear previous roadmap from knowledge base
-		ROS_INFO("KCL: (RPSquirrelRoadmap) Cleaning old roadmap");
-		rosplan_knowledge_msgs::KnowledgeUpdateService updateSrv;
-		updateSrv.request.update_type = rosplan_knowledge_msgs::KnowledgeUpdateService::Request::REMOVE_KNOWLEDGE;
-		updateSrv.request.knowledge.knowledge_type = rosplan_knowledge_msgs::KnowledgeItem::INSTANCE;
-		updateSrv.request.knowledge.instance_type = "waypoint";
-		update_knowledge_client.call(updateSrv);
-
-		// clear previous roadmap from scene database
-		for (std::map<std::string,Waypoint*>::iterator wit=waypoints.begin(); wit!=waypoints.end(); ++wit) {
-			message_store.deleteID(db_name_map[wit->first]);
-		}
-		db_name_map.clear();
-
-		// clear from visualization
-		clearMarkerArrays(nh);
-
-		// clear internal map
-		for (std::map<std::string, Waypoint*>::const_iterator ci = waypoints.begin(); ci != waypoints.end(); ++ci)
-			delete (*ci).second;
-		waypoints.clear();
+		ros::Time start_time = ros::Time::now();
 
 		// read map
 		nav_msgs::OccupancyGrid map;
@@ -85,16 +65,35 @@ namespace KCL_rosplan {
 			map = cost_map;
 		}
 
-		// map info
-		int width = map.info.width;
-		int height = map.info.height;
-		double resolution = map.info.resolution; // m per cell
-
-		if(width==0 || height==0) {
+		if(map.info.width==0 || map.info.height==0) {
 			ROS_INFO("KCL: (RPSquirrelRoadmap) Empty map");
 			return false;
 		}
 
+		// compute the new roadmap
+		std::map<std::string, Waypoint*> new_waypoints;
+		if (!computeRoadmap(map, new_waypoints)) {
+			for (std::map<std::string, Waypoint*>::const_iterator ci = new_waypoints.begin(); ci != new_waypoints.end(); ++ci)
+				delete (*ci).second;
+			return false;
+		}
+
+		// replace the old roadmap
+		if (!commitRoadmap(new_waypoints, res.waypoints)) {
+			for (std::map<std::string, Waypoint*>::const_iterator ci = new_waypoints.begin(); ci != new_waypoints.end(); ++ci)
+				delete (*ci).second;
+			return false;
+		}
+
+		ROS_INFO("KCL: (RPSquirrelRoadmap) Done, %lu waypoints in %f seconds", waypoints.size(), (ros::Time::now() - start_time).toSec());
+		return true;
+	}
+
+	/**
+	 * Requests the manipulation waypoints of every object and keeps those that are not in collision.
+	 */
+	bool RPSquirrelRoadmap::computeRoadmap(const nav_msgs::OccupancyGrid &map, std::map<std::string, Waypoint*> &new_waypoints) {
+
 		// generate waypoints
 		ROS_INFO("KCL: (RPSquirrelRoadmap) Requesting waypoints");
 
@@ -108,88 +107,188 @@ namespace KCL_rosplan {
 			return false;
 		}
 		ROS_INFO("KCL: (RPSquirrelRoadmap) Received all the object instances.");
-		for (std::vector<std::string>::const_iterator ci = getInstances.response.instances.begin(); ci != getInstances.response.instances.end(); ++ci) {
-
-			// fetch position of object from message store
-			std::vector< boost::shared_ptr<geometry_msgs::PoseStamped> > results;
-			if(message_store.queryNamed<geometry_msgs::PoseStamped>(*ci, results)) {
-				if(results.size()<1) {
-					ROS_ERROR("KCL: (RPSquirrelRoadmap) aborting waypoint request; no matching obID %s", (*ci).c_str());
-					return false;
-				}
-			} else {
-				ROS_ERROR("KCL: (RPSquirrelRoadmap) could not query message store to fetch object pose");
-				return false;
+
+		// request the waypoints of all objects concurrently, sorted by id so the results are merged in a fixed order
+		std::vector<std::string> objects(getInstances.response.instances);
+		std::sort(objects.begin(), objects.end());
+		std::vector<ObjectTaskPoses> requests;
+		for (std::vector<std::string>::const_iterator ci = objects.begin(); ci != objects.end(); ++ci)
+			requests.push_back(ObjectTaskPoses(*ci));
+
+		size_t next_request = 0;
+		boost::mutex next_request_mutex;
+		size_t nr_workers = std::min(requests.size(), (size_t)std::max(max_concurrent_requests, 1));
+		boost::thread_group workers;
+		for (size_t i = 0; i < nr_workers; ++i)
+			workers.create_thread(boost::bind(&RPSquirrelRoadmap::requestTaskPosesWorker, this, boost::ref(requests), boost::ref(next_request), boost::ref(next_request_mutex)));
+		workers.join_all();
+
+		// the same transform is used for every collision check
+		tf::Transform world_to_map;
+		tf::poseMsgToTF(map.info.origin, world_to_map);
+
+		unsigned int failed_objects = 0;
+		for (std::vector<ObjectTaskPoses>::const_iterator ci = requests.begin(); ci != requests.end(); ++ci) {
+
+			// objects without waypoints are reported, the roadmap is built from the others
+			if (!ci->success) {
+				ROS_ERROR("KCL: (RPSquirrelRoadmap) No manipulation waypoints for %s: %s", ci->obID.c_str(), ci->error.c_str());
+				++failed_objects;
+				continue;
 			}
 
-			// request manipulation waypoints for object
-			geometry_msgs::PoseStamped &objPose = *results[0];
-
-			squirrel_planning_knowledge_msgs::TaskPoseService getTaskPose;
-			getTaskPose.request.target.header = objPose.header;
-			getTaskPose.request.target.point = objPose.pose.position;
-
-			if (!manipulation_client.call(getTaskPose)) {
-				ROS_ERROR("KCL: (RPSquirrelRoadmap) Failed to recieve manipulation waypoints for %s.", (*ci).c_str());
-			} else {
-
-				for(int i=0;i<getTaskPose.response.poses.size(); i++) {
-
-					geometry_msgs::Point p = getTaskPose.response.poses[i].pose.position;
-				
-					// check collision
-					tf::Point p1;
-					tf::pointMsgToTF(p, p1);
-					tf::Transform world_to_map;
-					tf::poseMsgToTF (map.info.origin, world_to_map);
-					tf::Point p2 = world_to_map.inverse()*p1;
-					int index = floor(p2.x()/map.info.resolution) + floor(p2.y()/map.info.resolution)*map.info.width;
-					if (map.data[index] > occupancy_threshold) {
-						std::cout << "DEBUG: collision detected, ignoring waypoint" << std::endl;
-					} else {
-
-						// save here for viz
-						std::stringstream ss;
-						ss << "wp_" << (*ci) << "_" << i;
-						Waypoint* wp = new Waypoint(ss.str(), p.x, p.y);
-						waypoints[wp->wpID] = wp;
-
-						// publish visualization
-						publishWaypointMarkerArray(nh);
-
-						// add roadmap to knowledge base and scene database
-						ROS_INFO("KCL: (RPSquirrelRoadmap) Adding knowledge");
-						for (std::map<std::string,Waypoint*>::iterator wit=waypoints.begin(); wit!=waypoints.end(); ++wit) {
-
-							// instance
-							rosplan_knowledge_msgs::KnowledgeUpdateService updateSrv;
-							updateSrv.request.update_type = rosplan_knowledge_msgs::KnowledgeUpdateService::Request::ADD_KNOWLEDGE;
-							updateSrv.request.knowledge.knowledge_type = rosplan_knowledge_msgs::KnowledgeItem::INSTANCE;
-							updateSrv.request.knowledge.instance_type = "waypoint";
-							updateSrv.request.knowledge.instance_name = wit->first;
-							update_knowledge_client.call(updateSrv);
-
-							res.waypoints.push_back(wit->first);
-
-							//data
-							geometry_msgs::PoseStamped pose;
-							pose.header.frame_id = fixed_frame;
-							pose.pose.position.x = wit->second->real_x;
-							pose.pose.position.y = wit->second->real_y;
-							pose.pose.position.z = 0.0;
-							pose.pose.orientation.x = 0.0;;
-							pose.pose.orientation.y = 0.0;;
-							pose.pose.orientation.z = 1.0;
-							pose.pose.orientation.w = 1.0;
-							std::string id(message_store.insertNamed(wit->first, pose));
-							db_name_map[wit->first] = id;
-						}
-					}
+			for(size_t i=0;i<ci->poses.size(); i++) {
+
+				const geometry_msgs::Point &p = ci->poses[i];
+				if (isInCollision(map, world_to_map, p)) {
+					ROS_DEBUG("KCL: (RPSquirrelRoadmap) Collision detected, ignoring waypoint");
+					continue;
 				}
+
+				std::stringstream ss;
+				ss << "wp_" << ci->obID << "_" << i;
+				std::map<std::string, Waypoint*>::iterator wit = new_waypoints.find(ss.str());
+				if (wit != new_waypoints.end())
+					delete wit->second;
+				new_waypoints[ss.str()] = new Waypoint(ss.str(), p.x, p.y);
+			}
+		}
+
+		if (failed_objects > 0)
+			ROS_WARN("KCL: (RPSquirrelRoadmap) %u out of %lu objects have no manipulation waypoints", failed_objects, requests.size());
+		return true;
+	}
+
+	/**
+	 * Takes the next object that has no waypoints yet until all objects are done. Every worker has its own
+	 * service client, such that the requests are in flight at the same time.
+	 */
+	void RPSquirrelRoadmap::requestTaskPosesWorker(std::vector<ObjectTaskPoses> &requests, size_t &next_request, boost::mutex &next_request_mutex) {
+
+		ros::ServiceClient manipulation_client = node_handle.serviceClient<squirrel_planning_knowledge_msgs::TaskPoseService>(manipulation_service_topic);
+		while (true) {
+			ObjectTaskPoses* request = NULL;
+			{
+				boost::mutex::scoped_lock lock(next_request_mutex);
+				if (next_request >= requests.size())
+					break;
+				request = &requests[next_request];
+				++next_request;
 			}
+			requestTaskPoses(manipulation_client, *request);
+		}
+		manipulation_client.shutdown();
+	}
+
+	/**
+	 * Fetches the pose of a single object from the message store and requests its manipulation waypoints.
+	 */
+	void RPSquirrelRoadmap::requestTaskPoses(ros::ServiceClient &manipulation_client, ObjectTaskPoses &request) {
+
+		// fetch position of object from message store, the proxy is shared by all workers
+		std::vector< boost::shared_ptr<geometry_msgs::PoseStamped> > results;
+		bool queried;
+		{
+			boost::mutex::scoped_lock lock(message_store_mutex);
+			queried = message_store.queryNamed<geometry_msgs::PoseStamped>(request.obID, results);
+		}
+		if (!queried) {
+			request.error = "could not query message store to fetch object pose";
+			return;
+		}
+		if (results.size()<1) {
+			request.error = "no matching obID in the message store";
+			return;
+		}
+
+		// request manipulation waypoints for object
+		geometry_msgs::PoseStamped &objPose = *results[0];
+
+		squirrel_planning_knowledge_msgs::TaskPoseService getTaskPose;
+		getTaskPose.request.target.header = objPose.header;
+		getTaskPose.request.target.point = objPose.pose.position;
+
+		if (!manipulation_client.call(getTaskPose)) {
+			request.error = "the manipulation service failed";
+			return;
+		}
+
+		for(size_t i=0;i<getTaskPose.response.poses.size(); i++)
+			request.poses.push_back(getTaskPose.response.poses[i].pose.position);
+		request.success = true;
+	}
+
+	/**
+	 * A point is in collision if its cell is occupied, points outside the map are treated as occupied.
+	 */
+	bool RPSquirrelRoadmap::isInCollision(const nav_msgs::OccupancyGrid &map, const tf::Transform &world_to_map, const geometry_msgs::Point &p) const {
+
+		tf::Point p1;
+		tf::pointMsgToTF(p, p1);
+		tf::Point p2 = world_to_map.inverse()*p1;
+		int x = floor(p2.x()/map.info.resolution);
+		int y = floor(p2.y()/map.info.resolution);
+		if (x < 0 || y < 0 || x >= (int)map.info.width || y >= (int)map.info.height)
+			return true;
+		return map.data[x + y*map.info.width] > occupancy_threshold;
+	}
+
+	/**
+	 * Removes the old roadmap and stores the new one: all knowledge base updates are sent as one transaction,
+	 * every waypoint is inserted into the scene database once, and the markers are published once. The scene
+	 * database and the markers are left alone if the knowledge base rejects the new roadmap.
+	 */
+	bool RPSquirrelRoadmap::commitRoadmap(std::map<std::string, Waypoint*> &new_waypoints, std::vector<std::string> &committed_waypoints) {
+
+		ros::NodeHandle nh("~");
+
+		// replace the roadmap in the knowledge base, an instance without a name removes all waypoints
+		ROS_INFO("KCL: (RPSquirrelRoadmap) Adding knowledge");
+		KnowledgeBase::Transaction transaction(knowledge_base);
+		transaction.removeInstance("waypoint", "");
+		for (std::map<std::string, Waypoint*>::const_iterator wit = new_waypoints.begin(); wit != new_waypoints.end(); ++wit) {
+			transaction.addInstance("waypoint", wit->first);
+		}
+		if (!transaction.commit()) {
+			ROS_ERROR("KCL: (RPSquirrelRoadmap) The knowledge base did not accept the new roadmap");
+			return false;
+		}
+
+		// clear previous roadmap from scene database
+		ROS_INFO("KCL: (RPSquirrelRoadmap) Cleaning old roadmap");
+		for (std::map<std::string, std::string>::const_iterator ci = db_name_map.begin(); ci != db_name_map.end(); ++ci) {
+			message_store.deleteID(ci->second);
+		}
+		db_name_map.clear();
+
+		// clear from visualization
+		clearMarkerArrays(nh);
+
+		// clear internal map
+		for (std::map<std::string, Waypoint*>::const_iterator ci = waypoints.begin(); ci != waypoints.end(); ++ci)
+			delete (*ci).second;
+		waypoints.clear();
+		waypoints.swap(new_waypoints);
+
+		// add roadmap to scene database
+		for (std::map<std::string, Waypoint*>::const_iterator wit = waypoints.begin(); wit != waypoints.end(); ++wit) {
+
+			committed_waypoints.push_back(wit->first);
+
+			geometry_msgs::PoseStamped pose;
+			pose.header.frame_id = fixed_frame;
+			pose.pose.position.x = wit->second->real_x;
+			pose.pose.position.y = wit->second->real_y;
+			pose.pose.position.z = 0.0;
+			pose.pose.orientation.x = 0.0;
+			pose.pose.orientation.y = 0.0;
+			pose.pose.orientation.z = 1.0;
+			pose.pose.orientation.w = 1.0;
+			db_name_map[wit->first] = message_store.insertNamed(wit->first, pose);
 		}
 
-		ROS_INFO("KCL: (RPSquirrelRoadmap) Done");
+		// publish visualization
+		publishWaypointMarkerArray(nh);
 		return true;
 	}
 
@@ -5,6 +5,9 @@
 #include <vector>
 #include <sstream>
 #include <time.h>
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include <boost/random/random_number_generator.hpp>
 #include <tf/tf.h>
 
 #include <geometry_msgs/Pose.h>
@@ -33,6 +36,8 @@
 #include "squirrel_planning_execution/PlanToAskPDDLGenerator.h"
 
 #include "squirrel_planning_execution/RecommenderSystem.h"
+#include "squirrel_planning_execution/ScenarioLoader.h"
+#include "squirrel_planning_execution/KnowledgeBase.h"
 
 //#define RECOMMENDER_SYSTEM_DEBUG
 namespace KCL_rosplan {
@@ -48,7 +53,7 @@ namespace KCL_rosplan {
 		std::map<std::string, const Type*>::const_iterator mi = generated_types_.find(name);
 		if (mi == generated_types_.end())
 		{
-			t = new Type(name, parent);
+			t = new Type(name, parent, generated_types_.size());
 			generated_types_[name] = t;
 		}
 		else
@@ -98,15 +103,28 @@ namespace KCL_rosplan {
 	 * Objects.
 	 */
 	std::map<std::string, const Object*> Object::generated_objects_;
+	std::map<const Type*, std::vector<const Object*> > Object::objects_by_type_;
+	boost::mutex Object::objects_by_type_mutex_;
+	unsigned int Object::nr_grounding_iterators_ = 0;
 	
 	const Object& Object::createObject(const std::string& name, const Type& type)
 	{
+		boost::mutex::scoped_lock lock(objects_by_type_mutex_);
+		
+		// A grounding iterator refers to the lists in objects_by_type_, which are invalidated below.
+		if (nr_grounding_iterators_ != 0)
+		{
+			ROS_ERROR("KCL: (RecommenderSystem) Requested the object %s while a predicate is being grounded. Stopping!", name.c_str());
+			exit(-1);
+		}
+		
 		const Object* o = getObject(name);
 		if (o == NULL)
 		{
-			o = new Object(name, type);
+			o = new Object(name, type, generated_objects_.size());
 			generated_objects_[name] = o;
 		}
+		objects_by_type_.clear();
 		
 		// Check if we need to update the type of object.
 		if (type.isChildOf(o->getType()))
@@ -138,22 +156,52 @@ namespace KCL_rosplan {
 	
 	void Object::getObjects(const Type& type, std::vector<const Object*>& objects)
 	{
+		const std::vector<const Object*>& objects_of_type = getObjects(type);
+		objects.insert(objects.end(), objects_of_type.begin(), objects_of_type.end());
+	}
+	
+	const std::vector<const Object*>& Object::getObjects(const Type& type)
+	{
+		boost::mutex::scoped_lock lock(objects_by_type_mutex_);
+		
+		// Types that are created after the index was built are added here, inserting into the map does not 
+		// invalidate the lists of other types.
+		std::map<const Type*, std::vector<const Object*> >::iterator mi = objects_by_type_.find(&type);
+		if (mi != objects_by_type_.end())
+		{
+			return mi->second;
+		}
+		
+		std::vector<const Object*>& objects = objects_by_type_[&type];
 		for (std::map<std::string, const Object*>::const_iterator ci = generated_objects_.begin(); ci != generated_objects_.end(); ++ci)
 		{
 			const Object* o = (*ci).second;
-			if (type.isChildOf(*o->type_))
+			if (o->type_->isChildOf(type))
 			{
 				objects.push_back(o);
 			}
 		}
+		return objects;
+	}
+	
+	void Object::buildTypeIndex()
+	{
+		std::vector<const Type*> all_types;
+		Type::getAllTypes(all_types);
+		for (std::vector<const Type*>::const_iterator ci = all_types.begin(); ci != all_types.end(); ++ci)
+		{
+			getObjects(**ci);
+		}
 	}
 	
 	void Object::cleanup()
 	{
+		boost::mutex::scoped_lock lock(objects_by_type_mutex_);
 		for (std::map<std::string, const Object*>::iterator i = generated_objects_.begin(); i != generated_objects_.end(); ++i)
 		{
 			delete (*i).second;
 		}
+		objects_by_type_.clear();
 	}
 	
 	/**
@@ -169,7 +217,7 @@ namespace KCL_rosplan {
 		const Predicate* p = getPredicate(name);
 		if (p == NULL)
 		{
-			p = new Predicate(name, types);
+			p = new Predicate(name, types, generated_predicates_.size());
 			generated_predicates_[name] = p;
 		}
 		
@@ -208,42 +256,103 @@ namespace KCL_rosplan {
 	
 	void Predicate::ground(std::vector<const Fact*>& facts) const
 	{
-		unsigned int counter[getArity()];
-		std::vector<std::vector<const Object*> > objects;
-		for (unsigned int i = 0; i < getArity(); ++i)
+		GroundingIterator grounding(*this);
+		while (grounding.next())
 		{
-			counter[i] = 0;
-			
-			std::vector<const Object*> objects_of_type;
-			Object::getObjects(*types_[i], objects_of_type);
-			objects.push_back(objects_of_type);
+			facts.push_back(&grounding.getFact());
 		}
+	}
+	
+	/**
+	 * Grounding iterator.
+	 */
+	GroundingIterator::GroundingIterator(const Predicate& predicate, const Filter& filter)
+		: predicate_(&predicate), filter_(filter), counters_(predicate.getArity(), 0), started_(false), done_(false)
+	{
+		for (std::vector<const Type*>::const_iterator ci = predicate.getTypes().begin(); ci != predicate.getTypes().end(); ++ci)
+		{
+			domains_.push_back(&Object::getObjects(**ci));
+		}
+		objects_.reserve(predicate.getArity());
 		
-		bool done = false;
-		while (!done)
+		boost::mutex::scoped_lock lock(Object::objects_by_type_mutex_);
+		++Object::nr_grounding_iterators_;
+	}
+	
+	GroundingIterator::GroundingIterator(const GroundingIterator& other)
+		: predicate_(other.predicate_), filter_(other.filter_), domains_(other.domains_), counters_(other.counters_), objects_(other.objects_), started_(other.started_), done_(other.done_)
+	{
+		boost::mutex::scoped_lock lock(Object::objects_by_type_mutex_);
+		++Object::nr_grounding_iterators_;
+	}
+	
+	GroundingIterator::~GroundingIterator()
+	{
+		boost::mutex::scoped_lock lock(Object::objects_by_type_mutex_);
+		--Object::nr_grounding_iterators_;
+	}
+	
+	bool GroundingIterator::next()
+	{
+		if (done_)
+		{
+			return false;
+		}
+		
+		int arity = domains_.size();
+		int argument;
+		if (!started_)
 		{
-			done = true;
-			std::vector<const Object*> fact_objects;
-			for (unsigned int i = 0; i < getArity(); ++i)
+			started_ = true;
+			if (arity == 0)
 			{
-				fact_objects.push_back(objects[i][counter[i]]);
+				return true;
 			}
-			facts.push_back(&Fact::getFact(*this, fact_objects));
-			
-			for (unsigned int i = 0; i < getArity(); ++i)
+			argument = 0;
+			counters_[0] = 0;
+		}
+		else
+		{
+			if (arity == 0)
 			{
-				if (counter[i] + 1 == objects[i].size())
-				{
-					counter[i] = 0;
-				}
-				else 
+				done_ = true;
+				return false;
+			}
+			argument = arity - 1;
+			++counters_[argument];
+		}
+		
+		// Depth first search over the arguments, the last argument changes fastest.
+		while (argument >= 0)
+		{
+			if (counters_[argument] >= domains_[argument]->size())
+			{
+				--argument;
+				if (argument >= 0)
 				{
-					counter[i] = counter[i] + 1;
-					done = false;
-					break;
+					++counters_[argument];
 				}
+				continue;
 			}
+			
+			objects_.resize(argument + 1);
+			objects_[argument] = (*domains_[argument])[counters_[argument]];
+			if (filter_ && !filter_(objects_))
+			{
+				++counters_[argument];
+				continue;
+			}
+			
+			if (argument + 1 == arity)
+			{
+				return true;
+			}
+			++argument;
+			counters_[argument] = 0;
 		}
+		objects_.clear();
+		done_ = true;
+		return false;
 	}
 	
 	void Predicate::cleanup()
@@ -257,8 +366,29 @@ namespace KCL_rosplan {
 	/**
 	 * Facts.
 	 */
-	std::map<FactProto, const Fact*, FactProto> Fact::generated_facts_;
+	boost::unordered_map<uint64_t, const Fact*> Fact::generated_facts_;
+	std::map<std::vector<unsigned int>, const Fact*> Fact::generated_wide_facts_;
+	std::vector<const Fact*> Fact::all_facts_;
+	boost::mutex Fact::generated_facts_mutex_;
 	
+	bool Fact::getKey(const Predicate& predicate, const std::vector<const Object*>& objects, bool is_negative, uint64_t& key)
+	{
+		if (objects.size() > 3 || predicate.getId() >= (1 << 15))
+		{
+			return false;
+		}
+		
+		key = (predicate.getId() << 1) | (is_negative ? 1 : 0);
+		for (unsigned int i = 0; i < objects.size(); ++i)
+		{
+			if (objects[i]->getId() >= (1 << 16))
+			{
+				return false;
+			}
+			key |= (uint64_t)(objects[i]->getId()) << (16 * (i + 1));
+		}
+		return true;
+	}
 	
 	const Fact& Fact::getFact(const Predicate& predicate, const std::vector<const Object*>& objects, bool is_negative)
 	{
@@ -269,25 +399,47 @@ namespace KCL_rosplan {
 			exit(-1);
 		}
 		
-		const Fact* f = NULL;
-		FactProto proto(predicate, objects, is_negative);
-		std::map<FactProto, const Fact*>::const_iterator mi = generated_facts_.find(proto);
-		if (mi == generated_facts_.end())
+		boost::mutex::scoped_lock lock(generated_facts_mutex_);
+		uint64_t key;
+		if (getKey(predicate, objects, is_negative, key))
 		{
-			f = new Fact(predicate, objects, is_negative);
-			generated_facts_[proto] = f;
+			boost::unordered_map<uint64_t, const Fact*>::const_iterator mi = generated_facts_.find(key);
+			if (mi != generated_facts_.end())
+			{
+				return *(*mi).second;
+			}
+			
+			const Fact* f = new Fact(predicate, objects, is_negative, all_facts_.size());
+			generated_facts_[key] = f;
+			all_facts_.push_back(f);
 			return *f;
 		}
-		f = (*mi).second;
+		
+		// Facts that do not fit in a packed key are stored by the list of their ids.
+		std::vector<unsigned int> wide_key;
+		wide_key.push_back(predicate.getId());
+		wide_key.push_back(is_negative ? 1 : 0);
+		for (std::vector<const Object*>::const_iterator ci = objects.begin(); ci != objects.end(); ++ci)
+		{
+			wide_key.push_back((*ci)->getId());
+		}
+		
+		std::map<std::vector<unsigned int>, const Fact*>::const_iterator mi = generated_wide_facts_.find(wide_key);
+		if (mi != generated_wide_facts_.end())
+		{
+			return *(*mi).second;
+		}
+		
+		const Fact* f = new Fact(predicate, objects, is_negative, all_facts_.size());
+		generated_wide_facts_[wide_key] = f;
+		all_facts_.push_back(f);
 		return *f;
 	}
 	
 	void Fact::getAllFacts(std::vector<const Fact*>& all_facts)
 	{
-		for (std::map<FactProto, const Fact*>::iterator i = generated_facts_.begin(); i != generated_facts_.end(); ++i)
-		{
-			all_facts.push_back(i->second);
-		}
+		boost::mutex::scoped_lock lock(generated_facts_mutex_);
+		all_facts.insert(all_facts.end(), all_facts_.begin(), all_facts_.end());
 	}
 	
 	std::string Fact::getFullForm() const
@@ -309,10 +461,13 @@ namespace KCL_rosplan {
 	 */
 	void Fact::cleanup()
 	{
-		for (std::map<FactProto, const Fact*>::iterator i = generated_facts_.begin(); i != generated_facts_.end(); ++i)
+		for (std::vector<const Fact*>::iterator i = all_facts_.begin(); i != all_facts_.end(); ++i)
 		{
-			delete (*i).second;
+			delete *i;
 		}
+		all_facts_.clear();
+		generated_facts_.clear();
+		generated_wide_facts_.clear();
 	}
 	
 	std::ostream& operator<<(std::ostream& os, const Fact& fact)
@@ -336,6 +491,53 @@ namespace KCL_rosplan {
 		return os;
 	}
 	
+	/**
+	 * Evidence.
+	 */
+	bool Evidence::find(const Fact& fact, float& value) const
+	{
+		for (const Evidence* evidence = this; evidence != NULL; evidence = evidence->parent_)
+		{
+			std::map<const Fact*, float>::const_iterator mi = evidence->changes_.find(&fact);
+			if (mi != evidence->changes_.end())
+			{
+				value = mi->second;
+				return true;
+			}
+			
+			if (evidence->weighted_facts_ != NULL)
+			{
+				mi = evidence->weighted_facts_->find(&fact);
+				if (mi != evidence->weighted_facts_->end())
+				{
+					value = mi->second;
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+	
+	void Evidence::flatten(std::map<const Fact*, float>& weighted_facts) const
+	{
+		// Apply the changes from the root down, so the values of the children win.
+		if (parent_ != NULL)
+		{
+			parent_->flatten(weighted_facts);
+		}
+		if (weighted_facts_ != NULL)
+		{
+			for (std::map<const Fact*, float>::const_iterator ci = weighted_facts_->begin(); ci != weighted_facts_->end(); ++ci)
+			{
+				weighted_facts[ci->first] = ci->second;
+			}
+		}
+		for (std::map<const Fact*, float>::const_iterator ci = changes_.begin(); ci != changes_.end(); ++ci)
+		{
+			weighted_facts[ci->first] = ci->second;
+		}
+	}
+	
 	/*-------------*/
 	/* constructor */
 	/*-------------*/
@@ -363,6 +565,28 @@ namespace KCL_rosplan {
 		nh.getParam("/squirrel_planning_execution/recommender/data_path", data_path);
 		nh.getParam("/squirrel_planning_execution/recommender/input_file", input_file);
 		nh.getParam("/squirrel_planning_execution/recommender/output_file", output_file);
+		nh.param<std::string>("/squirrel_planning_execution/recommender/backend", backend, "service");
+		if (backend != "service" && backend != "local")
+		{
+			ROS_WARN("KCL: (RecommenderSystem) Unknown recommender backend %s, using the service instead.", backend.c_str());
+			backend = "service";
+		}
+		
+		int sample_size = 3;
+		nh.param("/squirrel_planning_execution/recommender/sample_size", sample_size, sample_size);
+		sample_size_ = std::max(0, sample_size);
+		int nr_threads = boost::thread::hardware_concurrency();
+		nh.param("/squirrel_planning_execution/recommender/threads", nr_threads, nr_threads);
+		nr_threads_ = std::max(1, nr_threads);
+		int cache_size = 1024;
+		nh.param("/squirrel_planning_execution/recommender/cache_size", cache_size, cache_size);
+		cache_size_ = std::max(0, cache_size);
+		
+		// Without a seed every run samples differently, the seed that is used is logged so a run can be repeated.
+		int seed = time(NULL);
+		nh.param("/squirrel_planning_execution/recommender/seed", seed, seed);
+		ROS_INFO("KCL: (RecommenderSystem) Sample facts with seed %d.", seed);
+		setSeed(seed);
 		
 		std::stringstream ss;
 		ss << data_path << "/" << input_file;
@@ -382,6 +606,11 @@ namespace KCL_rosplan {
 		Object::cleanup();
 	}
 	
+	void RecommenderSystem::setSeed(unsigned int seed)
+	{
+		random_generator_.seed(seed);
+	}
+	
 	void RecommenderSystem::initialise()
 	{
 		ROS_INFO("KCL: (RecommenderSystem) Initialise.\n");
@@ -431,6 +660,7 @@ namespace KCL_rosplan {
 				Object::createObject(*iit, *type);
 			}
 		}
+		Object::buildTypeIndex();
 		
 		// Get all the predicates.
 		rosplan_knowledge_msgs::GetDomainAttributeService predSrv;
@@ -451,24 +681,166 @@ namespace KCL_rosplan {
 				types.push_back(&Type::getType(p_ci->value));
 			}
 			
-			// Create the predicate and ground it to get all the facts.
-			const Predicate& predicate = Predicate::getPredicate(name, types);
-			std::vector<const Fact*> grounded_facts;
-			predicate.ground(grounded_facts);
+			// Create the predicate, its facts are created when they are needed.
+			Predicate::getPredicate(name, types);
 		}
 	}
 	
-	void RecommenderSystem::writeCSV(const std::vector<const Object*>& objects, const std::vector<const Predicate*>& predicates, const std::map<const Fact*, float>& weighted_facts)
+	void RecommendationMatrix::resize(const std::vector<const Object*>& objects, const std::vector<const Predicate*>& predicates)
+	{
+		objects_ = objects;
+		predicates_ = predicates;
+		unsigned int size = getNumberOfRows() * getNumberOfColumns();
+		values_.resize(size);
+		predictions_.resize(size);
+		confidences_.resize(size);
+	}
+	
+	void RecommenderSystem::writeMatrix(const std::vector<const Object*>& objects, const std::vector<const Predicate*>& predicates, const Evidence& weighted_facts, RecommendationMatrix& matrix) const
+	{
+		matrix.resize(objects, predicates);
+		
+		std::vector<const Object*> fact_objects;
+		for (unsigned int row = 0; row < matrix.getNumberOfRows(); ++row)
+		{
+			const Object& o1 = matrix.getFirstObject(row);
+			const Object& o2 = matrix.getSecondObject(row);
+			for (unsigned int column = 0; column < matrix.getNumberOfColumns(); ++column)
+			{
+				const Predicate* predicate = predicates[column];
+				float& value = matrix.values_[matrix.getIndex(row, column)];
+				
+				// Try to create a fact with this predicate and the given objects. If this is impossible, mark it as
+				// not applicable and move on.
+				fact_objects.clear();
+				if (predicate->getArity() > 0)
+				{
+					if (!o1.getType().isChildOf(*predicate->getTypes()[0]))
+					{
+						value = RecommendationMatrix::NOT_APPLICABLE;
+						continue;
+					}
+					fact_objects.push_back(&o1);
+				}
+				if (predicate->getArity() > 1)
+				{
+					if (!o2.getType().isChildOf(*predicate->getTypes()[1]))
+					{
+						value = RecommendationMatrix::NOT_APPLICABLE;
+						continue;
+					}
+					fact_objects.push_back(&o2);
+				}
+				
+				// A fact can be created given these objects. Facts we know nothing about are treated as false, 
+				// facts with a weight of 0 have to be predicted.
+				const Fact& fact = Fact::getFact(*predicate, fact_objects);
+				if (!weighted_facts.find(fact, value))
+				{
+					value = RecommendationMatrix::KNOWN_FALSE;
+				}
+			}
+		}
+	}
+	
+	void RecommenderSystem::readMatrix(const RecommendationMatrix& matrix, std::map<const Fact*, float>& results) const
+	{
+		std::vector<const Object*> objects;
+		std::vector<const Object*> o;
+		for (unsigned int row = 0; row < matrix.getNumberOfRows(); ++row)
+		{
+			objects.clear();
+			objects.push_back(&matrix.getFirstObject(row));
+			objects.push_back(&matrix.getSecondObject(row));
+			for (unsigned int column = 0; column < matrix.getNumberOfColumns(); ++column)
+			{
+				const Predicate* p = matrix.predicates_[column];
+				unsigned int index = matrix.getIndex(row, column);
+				
+				o.clear();
+				for (unsigned int j = 0; j < p->getArity(); ++j)
+				{
+					o.push_back(objects[j]);
+				}
+				
+				const Fact& fact = Fact::getFact(*p, o, matrix.predictions_[index] == 0);
+				results[&fact] = matrix.confidences_[index];
+			}
+		}
+	}
+	
+	void RecommenderSystem::runLocalRecommender(RecommendationMatrix& matrix) const
+	{
+		unsigned int nr_objects = matrix.objects_.size();
+		std::vector<unsigned int> known(nr_objects);
+		std::vector<unsigned int> known_true(nr_objects);
+		for (unsigned int column = 0; column < matrix.getNumberOfColumns(); ++column)
+		{
+			// Count the known facts of this predicate, per second object and in total.
+			std::fill(known.begin(), known.end(), 0);
+			std::fill(known_true.begin(), known_true.end(), 0);
+			unsigned int total_known = 0;
+			unsigned int total_known_true = 0;
+			for (unsigned int row = 0; row < matrix.getNumberOfRows(); ++row)
+			{
+				float value = matrix.values_[matrix.getIndex(row, column)];
+				if (value == RecommendationMatrix::NOT_APPLICABLE || value == RecommendationMatrix::UNKNOWN)
+				{
+					continue;
+				}
+				bool is_true = value == RecommendationMatrix::KNOWN_TRUE;
+				++known[row % nr_objects];
+				++total_known;
+				if (is_true)
+				{
+					++known_true[row % nr_objects];
+					++total_known_true;
+				}
+			}
+			
+			// Only facts with two or more arguments depend on the second object.
+			bool use_second_object = matrix.predicates_[column]->getArity() > 1;
+			float prior = (total_known_true + 1.0f) / (total_known + 2.0f);
+			for (unsigned int row = 0; row < matrix.getNumberOfRows(); ++row)
+			{
+				unsigned int index = matrix.getIndex(row, column);
+				float value = matrix.values_[index];
+				float p;
+				if (value == RecommendationMatrix::NOT_APPLICABLE)
+				{
+					p = 0.0f;
+				}
+				else if (value == RecommendationMatrix::UNKNOWN)
+				{
+					p = prior;
+					if (use_second_object)
+					{
+						unsigned int second_object = row % nr_objects;
+						p = (known_true[second_object] + prior) / (known[second_object] + 1.0f);
+					}
+				}
+				else
+				{
+					p = value == RecommendationMatrix::KNOWN_TRUE ? 1.0f : 0.0f;
+				}
+				
+				matrix.predictions_[index] = p >= 0.5f;
+				matrix.confidences_[index] = p >= 0.5f ? p : 1.0f - p;
+			}
+		}
+	}
+	
+	void RecommenderSystem::writeCSV(const RecommendationMatrix& matrix, const std::string& file_name)
 	{
 #ifdef RECOMMENDER_SYSTEM_DEBUG
 		ROS_INFO("KCL: (RecommenderSystem) Write CSV.\n");
 #endif
 		std::ofstream ofs;
-		ofs.open(absolute_input_file.c_str());
+		ofs.open(file_name.c_str());
 		
 		// Write header.
 		ofs << "'object1','object2'";
-		for (std::vector<const Predicate*>::const_iterator ci = predicates.begin(); ci != predicates.end(); ++ci)
+		for (std::vector<const Predicate*>::const_iterator ci = matrix.predicates_.begin(); ci != matrix.predicates_.end(); ++ci)
 		{
 			ofs << ",'" << (*ci)->getName() << "'";
 		}
@@ -478,73 +850,32 @@ namespace KCL_rosplan {
 		
 		ofs << "," << std::endl;
 		
-		for (std::vector<const Object*>::const_iterator ci = objects.begin(); ci != objects.end(); ++ci)
+		for (unsigned int row = 0; row < matrix.getNumberOfRows(); ++row)
 		{
-			const Object* o1 = *ci;
-			for (std::vector<const Object*>::const_iterator ci = objects.begin(); ci != objects.end(); ++ci)
+			const Object& o1 = matrix.getFirstObject(row);
+			const Object& o2 = matrix.getSecondObject(row);
+			ofs << "'" << o1.getName() << "'" << ",'" << o2.getName() << "'";
+			
+			// Facts that are not applicable are marked as false, unknown facts are left empty.
+			for (unsigned int column = 0; column < matrix.getNumberOfColumns(); ++column)
 			{
-				const Object* o2 = *ci;
-				ofs << "'" << o1->getName() << "'" << ",'" << o2->getName() << "'";
-				
-				for (std::vector<const Predicate*>::const_iterator ci = predicates.begin(); ci != predicates.end(); ++ci)
-				{
-					const Predicate* predicate = *ci;
-					
-					// Try to create a fact with this predicate and the given objects. If this is impossible, mark it as
-					// a '0' and move on.
-					std::vector<const Object*> objects;
-					if (predicate->getArity() > 0)
-					{
-						if (o1->getType().isChildOf(*predicate->getTypes()[0]))
-						{
-							objects.push_back(o1);
-						}
-						else
-						{
-							ofs <<",1";
-							continue;
-						}
-					}
-					if (predicate->getArity() > 1)
-					{
-						if (o2->getType().isChildOf(*predicate->getTypes()[1]))
-						{
-							objects.push_back(o2);
-						}
-						else
-						{
-							ofs <<",1";
-							continue;
-						}
-					}
-					
-					// A fact can be created given these objects.
-					const Fact& fact = Fact::getFact(*predicate, objects);
-					std::map<const Fact*, float>::const_iterator mi = weighted_facts.find(&fact);
-					
-					// Check if we know the probability of this fact being true, otherwise leave it empty.
-					if (mi == weighted_facts.end())
-					{
-						ofs << ",1";
-					}
-					else
-					{
-						if (mi->second == 0)
-							ofs << ",";
-						else
-							ofs << "," << mi->second;
-					}
-				}
-				if (o2->getType().getName() == "box")
-				{
-					ofs << ",2";
-				}
-				else
-				{
+				float value = matrix.values_[matrix.getIndex(row, column)];
+				if (value == RecommendationMatrix::NOT_APPLICABLE)
 					ofs << ",1";
-				}
-				ofs << "," << std::endl;
+				else if (value == RecommendationMatrix::UNKNOWN)
+					ofs << ",";
+				else
+					ofs << "," << value;
+			}
+			if (o2.getType().getName() == "box")
+			{
+				ofs << ",2";
+			}
+			else
+			{
+				ofs << ",1";
 			}
+			ofs << "," << std::endl;
 		}
 		ofs.close();
 #ifdef RECOMMENDER_SYSTEM_DEBUG
@@ -552,13 +883,13 @@ namespace KCL_rosplan {
 #endif
 	}
 		
-	void RecommenderSystem::readCSV(std::map<const Fact*, float>& results, const std::vector<const Predicate*>& predicates)
+	void RecommenderSystem::readCSV(const std::string& file_name, std::map<const Fact*, float>& results, const std::vector<const Predicate*>& predicates)
 	{
 #ifdef RECOMMENDER_SYSTEM_DEBUG
 		ROS_INFO("KCL: (RecommenderSystem) Read CSV.\n");
 #endif
 		// Read the header.
-		std::ifstream file(absolute_output_file.c_str());
+		std::ifstream file(file_name.c_str());
 		std::string line;
 		unsigned int line_nr = 0;
 		unsigned int max_arity = 0;
@@ -657,6 +988,7 @@ namespace KCL_rosplan {
 			// Create the facts and read the values.
 //			for (unsigned int i = max_arity + predicates.size() + 2; i < predicates.size() + predicates.size() + max_arity; ++i)
 			unsigned int fact_nr = 0;
+			std::vector<const Object*> o;
 			for (unsigned int i = max_arity + predicates.size() + 2; i < predicates.size() + predicates.size() + max_arity + 2; ++i)
 			{
 				float confidence = ::atof(tokens[i].c_str());
@@ -664,7 +996,7 @@ namespace KCL_rosplan {
 #ifdef RECOMMENDER_SYSTEM_DEBUG
 				std::cout << "Fact values: Process value: " << tokens[i] << " - Predicate: " << p->getName() << std::endl;
 #endif
-				std::vector<const Object*> o;
+				o.clear();
 				for (unsigned int j = 0; j < p->getArity(); ++j)
 				{
 					o.push_back(objects[j]);
@@ -681,79 +1013,160 @@ namespace KCL_rosplan {
 		}
 	}
 	
-	float RecommenderSystem::calculateKnowledge(const std::map<const Fact*, float>& results, const std::vector<const Fact*>& interesting_facts) const
+	void RecommenderSystem::getKnowledgeScorer(const std::vector<const Fact*>& interesting_facts, KnowledgeScorer& scorer) const
+	{
+		// Only the facts that tell us in which box an object belongs count towards our knowledge.
+		scorer.clear();
+		for (std::vector<const Fact*>::const_iterator ci = interesting_facts.begin(); ci != interesting_facts.end(); ++ci)
+		{
+			const Fact* fact = *ci;
+			if (fact->getPredicate().getName() != "belongs_in") continue;
+			if (fact->getObjects()[0]->getType().getName() != "object") continue;
+			if (fact->getObjects()[1]->getType().getName() != "box") continue;
+			scorer.addFact(fact->getId());
+		}
+	}
+	
+	float RecommenderSystem::calculateKnowledge(const RecommenderResults& results, const KnowledgeScorer& scorer) const
 	{
 #ifdef RECOMMENDER_SYSTEM_DEBUG
 		ROS_INFO("KCL: (RecommenderSystem) RecommenderSystem::calculateKnowledge");
 #endif
 		// Check the current values of the interesting facts. This forms the baseline for determining which observation
 		// actions are best to improve these.
+		return scorer.score(results.probabilities_);
+	}
+	
+	float RecommenderSystem::calculateKnowledge(const Evidence& weighted_facts, const std::vector<const Fact*>& interesting_facts) const
+	{
+		// The same facts as those marked by getKnowledgeScorer, but looked up in the evidence.
 		float value = 0;
-		
-		std::vector<const Fact*> facts_to_sense;
-		for (std::map<const Fact*, float>::const_iterator ci = results.begin(); ci != results.end(); ++ci)
+		for (std::vector<const Fact*>::const_iterator ci = interesting_facts.begin(); ci != interesting_facts.end(); ++ci)
 		{
-			const Fact* fact = (*ci).first;
+			const Fact* fact = *ci;
 			if (fact->getPredicate().getName() != "belongs_in") continue;
 			if (fact->getObjects()[0]->getType().getName() != "object") continue;
 			if (fact->getObjects()[1]->getType().getName() != "box") continue;
-			float p = (*ci).second;
 			
-			for (unsigned int i = 0; i < interesting_facts.size(); ++i)
+			float p;
+			if (weighted_facts.find(*fact, p))
 			{
-				if (interesting_facts[i] == fact)
-				{
-					value += p;
-#ifdef RECOMMENDER_SYSTEM_DEBUG
-					std::cout << "\t" << *fact << " -- Increase knowledge gain by " << p << " total value: " << value << std::endl;
-#endif
-				}
+				value += p;
 			}
 		}
 		return value;
 	}
 	
-	std::map<const Fact*, float> RecommenderSystem::runRecommender(const std::vector<const Object*>& objects, const std::vector<const Predicate*>& predicates, const std::map<const Fact*, float>& weighted_facts)
+	boost::shared_ptr<const RecommenderResults> RecommenderSystem::runRecommender(const std::vector<const Object*>& objects, const std::vector<const Predicate*>& predicates, const Evidence& weighted_facts, unsigned int slot)
 	{
 #ifdef RECOMMENDER_SYSTEM_DEBUG
 		ROS_INFO("KCL: (RecommenderSystem) Run recommender.");
 #endif
-		writeCSV(objects, predicates, weighted_facts);
+		RecommendationMatrix matrix;
+		writeMatrix(objects, predicates, weighted_facts, matrix);
 		
-		squirrel_prediction_msgs::RecommendRelations rr;
-		rr.request.data_path = data_path;
-		rr.request.input_file = input_file;
-		rr.request.output_file = output_file;
-		rr.request.number_of_columns = predicates.size() + 2;
-		
-		
-		if (!recommender_client.call(rr))
+		// The output of the recommender only depends on its input, so the same evidence never has to be sent twice.
+		RecommenderCacheKey key;
+		for (std::vector<const Object*>::const_iterator ci = objects.begin(); ci != objects.end(); ++ci)
 		{
-			ROS_ERROR("Could not call the recommender system. Stopping!\n");
-			exit(-1);
+			key.first.push_back((*ci)->getId());
 		}
-		
-		if (!rr.response.finished)
+		for (std::vector<const Predicate*>::const_iterator ci = predicates.begin(); ci != predicates.end(); ++ci)
 		{
-			ROS_ERROR("The recommender system did not reported it finished, something went wrong? Stopping!\n");
-			exit(-1);
+			key.first.push_back((*ci)->getId());
+		}
+		key.second.swap(matrix.values_);
+		{
+			boost::mutex::scoped_lock lock(recommender_cache_mutex_);
+			RecommenderCache::const_iterator mi = recommender_cache_.find(key);
+			if (mi != recommender_cache_.end())
+			{
+				return mi->second;
+			}
 		}
+		key.second.swap(matrix.values_);
 		
-		std::map<const Fact*, float> results;
-		readCSV(results, predicates);
+		boost::shared_ptr<RecommenderResults> recommender_results(new RecommenderResults());
+		std::map<const Fact*, float>& results = recommender_results->facts_;
+		if (backend == "local")
+		{
+			runLocalRecommender(matrix);
+			readMatrix(matrix, results);
+		}
+		else
+		{
+			std::string slot_input_file = getSlotFileName(input_file, slot);
+			std::string slot_output_file = getSlotFileName(output_file, slot);
+			writeCSV(matrix, data_path + "/" + slot_input_file);
+			
+			squirrel_prediction_msgs::RecommendRelations rr;
+			rr.request.data_path = data_path;
+			rr.request.input_file = slot_input_file;
+			rr.request.output_file = slot_output_file;
+			rr.request.number_of_columns = predicates.size() + 2;
+			
+			if (!recommender_client.call(rr))
+			{
+				ROS_ERROR("Could not call the recommender system. Stopping!\n");
+				exit(-1);
+			}
+			
+			if (!rr.response.finished)
+			{
+				ROS_ERROR("The recommender system did not reported it finished, something went wrong? Stopping!\n");
+				exit(-1);
+			}
+			
+			readCSV(data_path + "/" + slot_output_file, results, predicates);
+		}
 		
-#ifdef RECOMMENDER_SYSTEM_DEBUG
+		// Store the confidences by fact id as well, so they can be scored without any lookups.
+		std::vector<float>& probabilities = recommender_results->probabilities_;
 		for (std::map<const Fact*, float>::const_iterator ci = results.begin(); ci != results.end(); ++ci)
 		{
 			const Fact* fact = ci->first;
-			float p = ci->second;
-			std::cout << "KCL: (RecommenderSystem) " << *fact << " = " << p << std::endl;
-		}
+			if (fact->getId() >= probabilities.size())
+			{
+				probabilities.resize(fact->getId() + 1, 0.0f);
+			}
+			probabilities[fact->getId()] = ci->second;
+#ifdef RECOMMENDER_SYSTEM_DEBUG
+			std::cout << "KCL: (RecommenderSystem) " << *fact << " = " << ci->second << std::endl;
 #endif
-		return results;
+		}
+		
+		if (cache_size_ > 0)
+		{
+			key.second.swap(matrix.values_);
+			boost::mutex::scoped_lock lock(recommender_cache_mutex_);
+			std::pair<RecommenderCache::iterator, bool> inserted = recommender_cache_.insert(std::make_pair(key, recommender_results));
+			
+			// Another worker may have added the same input in the mean time.
+			if (inserted.second)
+			{
+				recommender_cache_order_.push_back(inserted.first);
+				if (recommender_cache_.size() > cache_size_)
+				{
+					recommender_cache_.erase(recommender_cache_order_.front());
+					recommender_cache_order_.pop_front();
+				}
+			}
+		}
+		return recommender_results;
 	}
 	
-	std::pair<float, float> RecommenderSystem::calculateKnowledgeIncrease(const std::vector<const Object*>& objects, const std::vector<const Predicate*>& predicates, std::map<const Fact*, float> weighted_facts, const std::vector<const Fact*>& interesting_facts, const Fact& sensing_action)
+	std::string RecommenderSystem::getSlotFileName(const std::string& file_name, unsigned int slot) const
+	{
+		if (slot == 0)
+		{
+			return file_name;
+		}
+		std::stringstream ss;
+		ss << "slot" << slot << "_" << file_name;
+		return ss.str();
+	}
+	
+	std::pair<float, float> RecommenderSystem::calculateKnowledgeIncrease(const std::vector<const Object*>& objects, const std::vector<const Predicate*>& predicates, const Evidence& weighted_facts, const std::vector<const Fact*>& interesting_facts, const KnowledgeScorer& scorer, const Fact& sensing_action, unsigned int slot)
 	{
 		// 0 = unknown
 		// 1 = false
@@ -761,89 +1174,136 @@ namespace KCL_rosplan {
 		
 		float knowledge_value_baseline = calculateKnowledge(weighted_facts, interesting_facts);
 		
-//#ifdef RECOMMENDER_SYSTEM_DEBUG
+#ifdef RECOMMENDER_SYSTEM_DEBUG
 		ROS_INFO("KCL: (RecommenderSystem) Simulate fact to be true.");
-//#endif
-		std::map<const Fact*, float> weighted_facts_copy = weighted_facts;
-		weighted_facts_copy[&sensing_action] = 2;
+#endif
+		Evidence weighted_facts_copy(&weighted_facts);
+		weighted_facts_copy.set(sensing_action, 2);
 		processMutualExclusive(weighted_facts_copy, interesting_facts);
+#ifdef RECOMMENDER_SYSTEM_DEBUG
 		std::cout << "Pre recog..." << std::endl;
-		for (std::map<const Fact*, float>::const_iterator ci = weighted_facts_copy.begin(); ci != weighted_facts_copy.end(); ++ci)
+		for (std::vector<const Fact*>::const_iterator ci = interesting_facts.begin(); ci != interesting_facts.end(); ++ci)
 		{
-			if (ci->first->getPredicate().getName() == "belongs_in" && ci->first->getObjects()[0]->getType().getName() == "object" && ci->first->getObjects()[1]->getType().getName() == "box")
-				std::cout << *ci->first << " = " << ci->second << std::endl;
+			std::cout << **ci << " = " << weighted_facts_copy.get(**ci) << std::endl;
 		}
-		std::map<const Fact*, float> results = runRecommender(objects, predicates, weighted_facts_copy);
+#endif
+		boost::shared_ptr<const RecommenderResults> results = runRecommender(objects, predicates, weighted_facts_copy, slot);
+#ifdef RECOMMENDER_SYSTEM_DEBUG
 		std::cout << "Post recog..." << std::endl;
-		for (std::map<const Fact*, float>::const_iterator ci = results.begin(); ci != results.end(); ++ci)
+		for (std::map<const Fact*, float>::const_iterator ci = results->facts_.begin(); ci != results->facts_.end(); ++ci)
 		{
 			if (ci->first->getPredicate().getName() == "belongs_in" && ci->first->getObjects()[0]->getType().getName() == "object" && ci->first->getObjects()[1]->getType().getName() == "box")
 				std::cout << *ci->first << " = " << ci->second << std::endl;
 		}
+#endif
 		
-		float knowledge_value_if_true = calculateKnowledge(results, interesting_facts) - knowledge_value_baseline;
-//#ifdef RECOMMENDER_SYSTEM_DEBUG
+		float knowledge_value_if_true = calculateKnowledge(*results, scorer) - knowledge_value_baseline;
+#ifdef RECOMMENDER_SYSTEM_DEBUG
 		ROS_INFO("KCL: (RecommenderSystem) Simulate fact to be false.");
-//#endif
-		weighted_facts_copy = weighted_facts;
-		weighted_facts_copy[&sensing_action] = 1;
+#endif
+		weighted_facts_copy.clear();
+		weighted_facts_copy.set(sensing_action, 1);
 		processMutualExclusive(weighted_facts_copy, interesting_facts);
+#ifdef RECOMMENDER_SYSTEM_DEBUG
 		std::cout << "Pre recog..." << std::endl;
-		for (std::map<const Fact*, float>::const_iterator ci = weighted_facts_copy.begin(); ci != weighted_facts_copy.end(); ++ci)
+		for (std::vector<const Fact*>::const_iterator ci = interesting_facts.begin(); ci != interesting_facts.end(); ++ci)
 		{
-			if (ci->first->getPredicate().getName() == "belongs_in" && ci->first->getObjects()[0]->getType().getName() == "object" && ci->first->getObjects()[1]->getType().getName() == "box")
-				std::cout << *ci->first << " = " << ci->second << std::endl;
+			std::cout << **ci << " = " << weighted_facts_copy.get(**ci) << std::endl;
 		}
-		results = runRecommender(objects, predicates, weighted_facts_copy);
+#endif
+		results = runRecommender(objects, predicates, weighted_facts_copy, slot);
+#ifdef RECOMMENDER_SYSTEM_DEBUG
 		std::cout << "Post recog..." << std::endl;
-		for (std::map<const Fact*, float>::const_iterator ci = results.begin(); ci != results.end(); ++ci)
+		for (std::map<const Fact*, float>::const_iterator ci = results->facts_.begin(); ci != results->facts_.end(); ++ci)
 		{
 			if (ci->first->getPredicate().getName() == "belongs_in" && ci->first->getObjects()[0]->getType().getName() == "object" && ci->first->getObjects()[1]->getType().getName() == "box")
 				std::cout << *ci->first << " = " << ci->second << std::endl;
 		}
+#endif
 		
-		float knowledge_value_if_false = calculateKnowledge(results, interesting_facts) - knowledge_value_baseline;
+		float knowledge_value_if_false = calculateKnowledge(*results, scorer) - knowledge_value_baseline;
 		
 		return std::make_pair(knowledge_value_if_true, knowledge_value_if_false);
 	}
 	
-	std::vector<const Fact*> RecommenderSystem::getBestSensingActions(const std::vector<const Object*>& objects, const std::vector<const Predicate*>& predicates, const std::map<const Fact*, float>& weighted_facts, const std::vector<const Fact*>& interesting_facts, unsigned int max_depth)
+	void RecommenderSystem::calculateKnowledgeIncreaseWorker(const std::vector<const Object*>& objects, const std::vector<const Predicate*>& predicates, const Evidence& weighted_facts, const std::vector<const Fact*>& interesting_facts, const KnowledgeScorer& scorer, std::vector<SensingCandidate>& candidates, unsigned int& next_candidate, unsigned int slot)
+	{
+		while (true)
+		{
+			unsigned int candidate;
+			{
+				boost::mutex::scoped_lock lock(next_candidate_mutex_);
+				if (next_candidate >= candidates.size())
+				{
+					return;
+				}
+				candidate = next_candidate++;
+			}
+			candidates[candidate].knowledge_gain_ = calculateKnowledgeIncrease(objects, predicates, weighted_facts, interesting_facts, scorer, *candidates[candidate].fact_, slot);
+		}
+	}
+	
+	std::vector<const Fact*> RecommenderSystem::getBestSensingActions(const std::vector<const Object*>& objects, const std::vector<const Predicate*>& predicates, const Evidence& weighted_facts, const std::vector<const Fact*>& interesting_facts, unsigned int max_depth)
 	{
 		ROS_INFO("KCL: (RecommenderSystem) Get best sensing actions %zd.", interesting_facts.size());
 		std::vector<const Fact*> best_facts_to_sense;
 		
-		std::map<const Fact*, float> results = runRecommender(objects, predicates, weighted_facts);
+		KnowledgeScorer scorer;
+		getKnowledgeScorer(interesting_facts, scorer);
 		
-		float knowledge_value = calculateKnowledge(results, interesting_facts);
+		boost::shared_ptr<const RecommenderResults> results = runRecommender(objects, predicates, weighted_facts);
+		
+		float knowledge_value = calculateKnowledge(*results, scorer);
 		
 		std::cout << "[RecommenderSystem::getBestSensingActions] Baseline: " << knowledge_value << std::endl;
 		
-		// Given the baseline, we now check all facts we can observe and pick the one that increases it the most.
-		float max_gain = 0;
-		std::priority_queue<const UtilityFact*> queue;
+		// Sample the facts we do not know whether they are true or false, in a random order.
+		std::vector<const Fact*> shuffled_facts(interesting_facts);
+		boost::random_number_generator<boost::mt19937> random_number_generator(random_generator_);
+		std::random_shuffle(shuffled_facts.begin(), shuffled_facts.end(), random_number_generator);
 		
+		std::vector<SensingCandidate> candidates;
 		std::set<const Fact*> processed_facts;
-		int sample_size = 3;
-		for (unsigned int i = 0; i < sample_size; ++i)
+		for (std::vector<const Fact*>::const_iterator ci = shuffled_facts.begin(); ci != shuffled_facts.end(); ++ci)
 		{
-			int index;
-			do
-			{
-				index = rand() % interesting_facts.size();
-			} while (processed_facts.find(interesting_facts[index]) != processed_facts.end());
-			processed_facts.insert(interesting_facts[index]);
-			
-			const Fact* fact_to_sense = interesting_facts[index];
+			const Fact* fact_to_sense = *ci;
+			if (sample_size_ > 0 && candidates.size() >= sample_size_) break;
+			if (!processed_facts.insert(fact_to_sense).second) continue;
 			
 			// Ignore this fact if we know whether it is true or false.
-			std::map<const Fact*, float>::const_iterator map_ci = weighted_facts.find(fact_to_sense);
-			if (map_ci == weighted_facts.end() || map_ci->second != 0)
+			float value;
+			if (!weighted_facts.find(*fact_to_sense, value) || value != 0)
 			{
 				continue;
 			}
-			std::cout << "[RecommenderSystem::getBestSensingActions] (" << i << "/" << sample_size << ") Check: " << *fact_to_sense << std::endl;
-			
-			std::pair<float, float> knowledge_gain = calculateKnowledgeIncrease(objects, predicates, weighted_facts, interesting_facts, *fact_to_sense);
+			candidates.push_back(SensingCandidate(*fact_to_sense));
+		}
+		
+		// Given the baseline, we now check all facts we can observe and pick the one that increases it the most.
+		unsigned int next_candidate = 0;
+		unsigned int nr_threads = std::min<unsigned int>(nr_threads_, candidates.size());
+		if (nr_threads <= 1)
+		{
+			calculateKnowledgeIncreaseWorker(objects, predicates, weighted_facts, interesting_facts, scorer, candidates, next_candidate, 0);
+		}
+		else
+		{
+			boost::thread_group workers;
+			for (unsigned int t = 0; t < nr_threads; ++t)
+			{
+				workers.create_thread(boost::bind(&RecommenderSystem::calculateKnowledgeIncreaseWorker, this, boost::cref(objects), boost::cref(predicates), boost::cref(weighted_facts), boost::cref(interesting_facts), boost::cref(scorer), boost::ref(candidates), boost::ref(next_candidate), t));
+			}
+			workers.join_all();
+		}
+		
+		// Pick the best candidate in sample order, so ties are broken the same way however the work was divided.
+		float max_gain = 0;
+		std::priority_queue<const UtilityFact*> queue;
+		for (unsigned int i = 0; i < candidates.size(); ++i)
+		{
+			const Fact* fact_to_sense = candidates[i].fact_;
+			const std::pair<float, float>& knowledge_gain = candidates[i].knowledge_gain_;
+			std::cout << "[RecommenderSystem::getBestSensingActions] (" << i << "/" << candidates.size() << ") Check: " << *fact_to_sense << std::endl;
 			
 			float d = (knowledge_gain.first + knowledge_gain.second) / 2.0f;
 			if (d > max_gain)
@@ -866,83 +1326,87 @@ namespace KCL_rosplan {
 			const UtilityFact* uf = queue.top();
 			queue.pop();
 			std::cout <<  *uf << std::endl;
+			delete uf;
 		}
 		
 		return best_facts_to_sense;
 	}
 	
-	void RecommenderSystem::processMutualExclusive(std::map<const Fact*, float>& weighted_facts_copy, const std::vector<const Fact*>& interesting_facts)
+	/**
+	 * Order the entries of the variable domains by the object they belong to.
+	 */
+	static bool compareVariableDomainEntries(const std::pair<const Object*, const Fact*>& lhs, const std::pair<const Object*, const Fact*>& rhs)
+	{
+		return lhs.first->getId() < rhs.first->getId();
+	}
+	
+	void RecommenderSystem::processMutualExclusive(Evidence& weighted_facts_copy, const std::vector<const Fact*>& interesting_facts) const
 	{
 #ifdef RECOMMENDER_SYSTEM_DEBUG
 		std::cout << "callRecogniser:" << std::endl;
 		for (std::vector<const Fact*>::const_iterator ci = interesting_facts.begin(); ci != interesting_facts.end(); ++ci)
 		{
-			std::cout << "\t-" << **ci << " -> " << weighted_facts_copy[*ci] << std::endl;
+			std::cout << "\t-" << **ci << " -> " << weighted_facts_copy.get(**ci) << std::endl;
 		}
 #endif
 		
-		std::map<const Object*, std::vector<const Fact*>* > variable_domains;
+		// The variable domains are stored in a single array, sorted by the object they belong to, so each domain
+		// is a contiguous range and all of them are released at once when this search step returns.
+		std::vector<std::pair<const Object*, const Fact*> > variable_domains;
+		variable_domains.reserve(interesting_facts.size());
 		
 #ifdef RECOMMENDER_SYSTEM_DEBUG
-		std::cout << "Build variable domains. Fact: " << last_sensed_fact << std::endl;
+		std::cout << "Build variable domains." << std::endl;
 #endif
 		for (std::vector<const Fact*>::const_iterator ci = interesting_facts.begin(); ci != interesting_facts.end(); ++ci)
 		{
+			// Facts without a value are unknown, record them as such so the recommender predicts them.
+			float value;
+			if (!weighted_facts_copy.find(**ci, value))
+			{
+				value = 0.0f;
+				weighted_facts_copy.set(**ci, value);
+			}
 #ifdef RECOMMENDER_SYSTEM_DEBUG
-			std::cout << "Interesting fact: " << **ci << " = " << weighted_facts_copy[*ci] << std::endl;
+			std::cout << "Interesting fact: " << **ci << " = " << value << std::endl;
 #endif
 			
-			if (weighted_facts_copy[*ci] != 1)
+			if (value != 1)
 			{
-				std::vector<const Fact*>* domain = NULL;
-				
-				if (variable_domains.find((*ci)->getObjects()[0]) == variable_domains.end())
-				{
-					domain = new std::vector<const Fact*>();
-					variable_domains[(*ci)->getObjects()[0]] = domain;
-				}
-				else
-				{
-					domain = variable_domains[(*ci)->getObjects()[0]];
-				}
-				domain->push_back(*ci);
+				variable_domains.push_back(std::make_pair((*ci)->getObjects()[0], *ci));
 			}
 		}
+		std::stable_sort(variable_domains.begin(), variable_domains.end(), compareVariableDomainEntries);
 		
-		// Check if the domain of a variable has only a single entry. If so make that fact true.
-#ifdef RECOMMENDER_SYSTEM_DEBUG
-		std::cout << "Variable domains: " << std::endl;
-#endif
-		for (std::map<const Object*, std::vector<const Fact*>* >::const_iterator ci = variable_domains.begin(); ci != variable_domains.end(); ++ci)
+		std::vector<std::pair<const Object*, const Fact*> >::const_iterator domain_begin = variable_domains.begin();
+		while (domain_begin != variable_domains.end())
 		{
-			const Object* object = ci->first;
-			std::vector<const Fact*>* facts = ci->second;
+			std::vector<std::pair<const Object*, const Fact*> >::const_iterator domain_end = domain_begin;
+			while (domain_end != variable_domains.end() && domain_end->first == domain_begin->first)
+			{
+				++domain_end;
+			}
 			
 #ifdef RECOMMENDER_SYSTEM_DEBUG
-			std::cout << "- " << object->getName() << " = {";
-			for (std::vector<const Fact*>::const_iterator ci = facts->begin(); ci != facts->end(); ++ci)
+			std::cout << "- " << domain_begin->first->getName() << " = {";
+			for (std::vector<std::pair<const Object*, const Fact*> >::const_iterator ci = domain_begin; ci != domain_end; ++ci)
 			{
-				std::cout << **ci << ", ";
+				std::cout << *ci->second << ", ";
 			}
 			std::cout << "}" << std::endl;
 #endif
 			
-			if (facts->size() == 1)
+			// Check if the domain of a variable has only a single entry. If so make that fact true.
+			if (domain_end - domain_begin == 1)
 			{
-				weighted_facts_copy[(*facts)[0]] = 2.0f;
+				weighted_facts_copy.set(*domain_begin->second, 2.0f);
 			}
-		}
-		
-		// If a single entry is already true, make the rest false.
-		for (std::map<const Object*, std::vector<const Fact*>* >::const_iterator ci = variable_domains.begin(); ci != variable_domains.end(); ++ci)
-		{
-			const Object* object = ci->first;
-			std::vector<const Fact*>* facts = ci->second;
-			bool value_found = false;
 			
-			for (std::vector<const Fact*>::const_iterator ci = facts->begin(); ci != facts->end(); ++ci)
+			// If a single entry is already true, make the rest false.
+			bool value_found = false;
+			for (std::vector<std::pair<const Object*, const Fact*> >::const_iterator ci = domain_begin; ci != domain_end; ++ci)
 			{
-				if (weighted_facts_copy[*ci] == 2.0f)
+				if (weighted_facts_copy.get(*ci->second) == 2.0f)
 				{
 					value_found = true;
 					break;
@@ -951,41 +1415,43 @@ namespace KCL_rosplan {
 			
 			if (value_found)
 			{
-				for (std::vector<const Fact*>::const_iterator ci = facts->begin(); ci != facts->end(); ++ci)
+				for (std::vector<std::pair<const Object*, const Fact*> >::const_iterator ci = domain_begin; ci != domain_end; ++ci)
 				{
-					if (weighted_facts_copy[*ci] != 2.0f)
+					if (weighted_facts_copy.get(*ci->second) != 2.0f)
 					{
-						weighted_facts_copy[*ci] = 1.0f;
+						weighted_facts_copy.set(*ci->second, 1.0f);
 					}
 				}
 			}
+			domain_begin = domain_end;
 		}
 		
 #ifdef RECOMMENDER_SYSTEM_DEBUG
 		std::cout << "Final facts: " << std::endl;
 		for (std::vector<const Fact*>::const_iterator ci = interesting_facts.begin(); ci != interesting_facts.end(); ++ci)
 		{
-			std::cout << "\t-" << **ci << " -> " << weighted_facts_copy[*ci] << std::endl;
+			std::cout << "\t-" << **ci << " -> " << weighted_facts_copy.get(**ci) << std::endl;
 		}
 #endif
 	}
 
 	
-	void RecommenderSystem::callRecogniser(FactObserveTree& node, const Fact& last_sensed_fact, unsigned int current_depth, unsigned int max_depth, const std::vector<const Object*>& objects, const std::vector<const Predicate*>& predicates, const std::map<const Fact*, float>& weighted_facts, const std::vector<const Fact*>& interesting_facts)
+	void RecommenderSystem::callRecogniser(FactObserveTree& node, const Fact& last_sensed_fact, unsigned int current_depth, unsigned int max_depth, const std::vector<const Object*>& objects, const std::vector<const Predicate*>& predicates, const Evidence& weighted_facts, const std::vector<const Fact*>& interesting_facts)
 	{
 		if (current_depth == max_depth) return;
 		
-		std::map<const Fact*, float> weighted_facts_copy(weighted_facts);
+		// Each branch only stores the facts it changes on top of the evidence of its parent.
+		Evidence weighted_facts_copy(&weighted_facts);
 		
 		// Make the best sensing action true and run the system again.
-		weighted_facts_copy[&last_sensed_fact] = 2.0;
+		weighted_facts_copy.set(last_sensed_fact, 2.0);
 		processMutualExclusive(weighted_facts_copy, interesting_facts);
 		
 #ifdef RECOMMENDER_SYSTEM_DEBUG
 		std::cout << "Get sensing actions for TRUE branch: " << std::endl;
 		for (std::vector<const Fact*>::const_iterator ci = interesting_facts.begin(); ci != interesting_facts.end(); ++ci)
 		{
-			std::cout << "\t-" << **ci << " -> " << weighted_facts_copy[*ci] << std::endl;
+			std::cout << "\t-" << **ci << " -> " << weighted_facts_copy.get(**ci) << std::endl;
 		}
 #endif
 		
@@ -1006,15 +1472,15 @@ namespace KCL_rosplan {
 		}
 		
 		// Make the best sensing action false and run the system again.
-		weighted_facts_copy = weighted_facts;
-		weighted_facts_copy[&last_sensed_fact] = 1.0;
+		weighted_facts_copy.clear();
+		weighted_facts_copy.set(last_sensed_fact, 1.0);
 		processMutualExclusive(weighted_facts_copy, interesting_facts);
 		
 #ifdef RECOMMENDER_SYSTEM_DEBUG
 		std::cout << "Get sensing actions for FALSE branch: " << std::endl;
 		for (std::vector<const Fact*>::const_iterator ci = interesting_facts.begin(); ci != interesting_facts.end(); ++ci)
 		{
-			std::cout << "\t-" << **ci << " -> " << weighted_facts_copy[*ci] << std::endl;
+			std::cout << "\t-" << **ci << " -> " << weighted_facts_copy.get(**ci) << std::endl;
 		}
 #endif
 		
@@ -1118,9 +1584,10 @@ namespace KCL_rosplan {
 				
 			}
 		}
-		processMutualExclusive(weighted_facts, interesting_facts);
+		Evidence evidence(weighted_facts);
+		processMutualExclusive(evidence, interesting_facts);
 		
-		std::map<const Fact*, float> results = runRecommender(objects, predicates, weighted_facts);
+		std::map<const Fact*, float> results = runRecommender(objects, predicates, evidence)->facts_;
 		
 		// Visualise the mapping.
 		// output file
@@ -1220,178 +1687,261 @@ namespace KCL_rosplan {
 	
 }; // close namespace
 
-void tokenise(const std::string& s, std::vector<std::string>& tokens)
-{
-	size_t current;
-	size_t next = -1;
-
-	do
-	{
-		current = next + 1;
-		next = s.find_first_of(" ", current);
-		tokens.push_back(s.substr(current, next - current));
-	} 
-	while (next != std::string::npos);
-}
-
-geometry_msgs::Pose transformToPose(const std::string& s)
+/**
+ * Record a line of the db file that cannot be read.
+ */
+static void addDBError(std::vector<std::string>& errors, unsigned int line_nr, const std::string& message)
 {
-#ifdef RECOMMENDER_SYSTEM_DEBUG
-	std::cout << "Tranform to pose: " << s << std::endl;
-#endif
-	geometry_msgs::Pose p;
-	int first_break = s.find(',');
-	int second_break = s.find(',', first_break + 1);
-
-	p.position.x = ::atof(s.substr(1, first_break - 1).c_str());
-	p.position.y = ::atof(s.substr(first_break + 1, second_break - (first_break + 1)).c_str());
-	p.position.z = ::atof(s.substr(second_break + 1, s.size() - (second_break + 2)).c_str());
-
-	return p;
+	std::stringstream ss;
+	ss << "line " << line_nr << ": " << message;
+	errors.push_back(ss.str());
 }
 
-/** 
- * Read in db file
+/**
+ * Check every line of a db file before anything is created or stored. Types, objects and predicates have to be
+ * declared before they are used.
+ * @param lines All lines of the db file.
+ * @param errors A description of every line that cannot be read, including its line number.
+ * @return True if all lines can be read, false otherwise.
  */
-void readDBFile(mongodb_store::MessageStoreProxy& message_store, ros::ServiceClient& update_knowledge_client, const std::string& file_name, std::vector<const KCL_rosplan::Type*>& types, std::vector<const KCL_rosplan::Object*>& objects, std::vector<const KCL_rosplan::Predicate*>& predicates, std::set<const KCL_rosplan::Fact*>& facts)
+static bool validateDBFile(const std::vector<std::string>& lines, std::vector<std::string>& errors)
 {
-	ROS_INFO("KCL: (RecommenderSystem) Load scenarion from file: %s.\n", file_name.c_str());
-	std::ifstream f(file_name.c_str());
-	std::string line;
-
-	rosplan_knowledge_msgs::KnowledgeUpdateService knowledge_update_service;
-
-	if (f.is_open())
+	std::set<std::string> type_names;
+	std::set<std::string> object_names;
+	std::map<std::string, unsigned int> predicate_arities;
+	for (unsigned int i = 0; i < lines.size(); ++i)
 	{
-		while (getline(f, line))
-		{
-
-			if (line.size() == 0 || line[0] == '#') continue;
+		const std::string& line = lines[i];
+		unsigned int line_nr = i + 1;
+		if (line.size() == 0 || line[0] == '#') continue;
 
-			std::vector<std::string> tokens;
-			tokenise(line, tokens);
+		std::vector<KCL_rosplan::ScenarioLoader::Slice> tokens;
+		KCL_rosplan::ScenarioLoader::tokenise(line, tokens);
 
-			// Types.
-			if (line[0] == 't')
+		// Types.
+		if (line[0] == 't')
+		{
+			if (tokens.size() != 2)
 			{
-				if (tokens.size() != 2)
-				{
-					ROS_ERROR("KCL (RecommenderSystem) Malformed line, expected t type. Read %s\n", line.c_str());
-					exit(0);
-				}
-				const std::string& type_name = tokens[1];
-				
-				const KCL_rosplan::Type& type = KCL_rosplan::Type::createType(type_name, NULL);
-				types.push_back(&type);
+				addDBError(errors, line_nr, "malformed line, expected t type. Read " + line);
+				continue;
 			}
-			else if (line[0] == 'o')
+			type_names.insert(tokens[1].str());
+		}
+		else if (line[0] == 'o')
+		{
+			if (tokens.size() != 3)
 			{
-				if (tokens.size() != 3)
-				{
-					ROS_ERROR("KCL (RecommenderSystem) Malformed line, expected o object type. Read %s\n", line.c_str());
-					exit(0);
-				}
-				const std::string& object_name = tokens[1];
-				const std::string& type_name = tokens[2];
-				objects.push_back(&KCL_rosplan::Object::createObject(object_name, KCL_rosplan::Type::getType(type_name)));
-
-				// Add to the knowledge base.
-				rosplan_knowledge_msgs::KnowledgeItem knowledge_item;
-				
-				knowledge_item.instance_type = type_name;
-				knowledge_item.instance_name = object_name;
-				
-				knowledge_update_service.request.knowledge = knowledge_item;knowledge_item.knowledge_type = rosplan_knowledge_msgs::KnowledgeItem::INSTANCE;
-				if (!update_knowledge_client.call(knowledge_update_service)) {
-					ROS_ERROR("KCL: (RobotKnowsGame) Could not add the %s %s to the knowledge base.", type_name.c_str(), object_name.c_str());
-					exit(-1);
-				}
+				addDBError(errors, line_nr, "malformed line, expected o object type. Read " + line);
+				continue;
 			}
-			else if (line[0] == 'p')
+			if (type_names.count(tokens[2].str()) == 0)
 			{
-				if (tokens.size() < 2)
-				{
-					ROS_ERROR("KCL (RecommenderSystem) Malformed line, expected p predicate [type]. Read %s\n", line.c_str());
-					exit(0);
-				}
-				
-				const std::string& predicate_name = tokens[1];
-				
-				std::vector<const KCL_rosplan::Type*> predicate_types;
-				for (unsigned int i = 2; i < tokens.size(); ++i)
-				{
-					predicate_types.push_back(&KCL_rosplan::Type::getType(tokens[i]));
-				}
-				predicates.push_back(&KCL_rosplan::Predicate::getPredicate(predicate_name, predicate_types));
+				addDBError(errors, line_nr, "the type " + tokens[2].str() + " is not declared.");
 			}
-			else if (line[0] == 'f')
+			object_names.insert(tokens[1].str());
+		}
+		else if (line[0] == 'p')
+		{
+			if (tokens.size() < 2)
 			{
-				if (tokens.size() < 2)
-				{
-					ROS_ERROR("KCL (RecommenderSystem) Malformed line, expected f fact [object]. Read %s\n", line.c_str());
-					exit(0);
-				}
-				
-				const std::string& predicate_name = tokens[1];
-				
-				std::vector<const KCL_rosplan::Object*> fact_objects;
-				for (unsigned int i = 2; i < tokens.size(); ++i)
+				addDBError(errors, line_nr, "malformed line, expected p predicate [type]. Read " + line);
+				continue;
+			}
+			for (unsigned int i = 2; i < tokens.size(); ++i)
+			{
+				if (type_names.count(tokens[i].str()) == 0)
 				{
-					fact_objects.push_back(KCL_rosplan::Object::getObject(tokens[i]));
+					addDBError(errors, line_nr, "the type " + tokens[i].str() + " is not declared.");
 				}
-				
-				facts.insert(&KCL_rosplan::Fact::getFact(*KCL_rosplan::Predicate::getPredicate(predicate_name), fact_objects));
 			}
-			else if (line[0] == 'r')
+			
+			std::string predicate_name = tokens[1].str();
+			std::map<std::string, unsigned int>::const_iterator mi = predicate_arities.find(predicate_name);
+			if (mi != predicate_arities.end() && mi->second != tokens.size() - 2)
+			{
+				addDBError(errors, line_nr, "the predicate " + predicate_name + " is declared with a different arity.");
+				continue;
+			}
+			predicate_arities[predicate_name] = tokens.size() - 2;
+		}
+		else if (line[0] == 'f')
+		{
+			if (tokens.size() < 2)
+			{
+				addDBError(errors, line_nr, "malformed line, expected f fact [object]. Read " + line);
+				continue;
+			}
+			
+			std::string predicate_name = tokens[1].str();
+			std::map<std::string, unsigned int>::const_iterator mi = predicate_arities.find(predicate_name);
+			if (mi == predicate_arities.end())
+			{
+				addDBError(errors, line_nr, "the predicate " + predicate_name + " is not declared.");
+			}
+			else if (mi->second != tokens.size() - 2)
+			{
+				addDBError(errors, line_nr, "the number of objects does not match the arity of " + predicate_name + ".");
+			}
+			for (unsigned int i = 2; i < tokens.size(); ++i)
 			{
-				if (tokens.size() < 3)
+				if (object_names.count(tokens[i].str()) == 0)
 				{
-					ROS_ERROR("KCL (RecommenderSystem) Malformed line, expected r waypoint (f,f,f). Read %s\n", line.c_str());
-					exit(0);
+					addDBError(errors, line_nr, "the object " + tokens[i].str() + " is not declared.");
 				}
-				std::string waypoint_predicate = tokens[1];
-				geometry_msgs::Pose waypoint_location = transformToPose(tokens[2]);
-				
-				geometry_msgs::PoseStamped pose;
-				pose.header.seq = 0;
-				pose.header.stamp = ros::Time::now();
-				pose.header.frame_id = "/map";
-				pose.pose = waypoint_location;
-				pose.pose.orientation.x = 0;
-				pose.pose.orientation.y = 0;
-				pose.pose.orientation.z = 0;
-				pose.pose.orientation.w = 1;
-				std::string id (message_store.insertNamed(waypoint_predicate, pose));
-
-				// Calculate it's near component.
-				float centre_x = 0.372;
-				float centre_y = -0.342;
-				float distance = 0.8f;
-
-				float direction_x = centre_x - pose.pose.position.x;
-				float direction_y = centre_y - pose.pose.position.y;
-				float length = sqrt((direction_x * direction_x) + (direction_y * direction_y));
-				direction_x = direction_x / length;
-				direction_y = direction_y / length;
-				std::stringstream ss;
-				ss << "near_" << waypoint_predicate;
-
-				float near_x = pose.pose.position.x + direction_x * distance;
-				float near_y = pose.pose.position.y + direction_y * distance;
+			}
+		}
+		else if (line[0] == 'r')
+		{
+			geometry_msgs::Pose waypoint_location;
+			if (tokens.size() < 3 || !KCL_rosplan::ScenarioLoader::parsePose(tokens[2], waypoint_location))
+			{
+				addDBError(errors, line_nr, "malformed line, expected r waypoint (f,f,f). Read " + line);
+			}
+		}
+	}
+	return errors.empty();
+}
 
-				float angle = atan2(pose.pose.position.y - near_y, pose.pose.position.x - near_x);
-				if(isnan(angle)) angle = 0;
+/** 
+ * Read in db file. The whole file is checked before anything is created, all objects are added to the knowledge
+ * base in a single transaction and the waypoints are only stored once that transaction has been committed.
+ * @return True if the file was read and stored, false otherwise.
+ */
+bool readDBFile(mongodb_store::MessageStoreProxy& message_store, KCL_rosplan::KnowledgeBase& knowledge_base, const std::string& file_name, std::vector<const KCL_rosplan::Type*>& types, std::vector<const KCL_rosplan::Object*>& objects, std::vector<const KCL_rosplan::Predicate*>& predicates, std::set<const KCL_rosplan::Fact*>& facts)
+{
+	ROS_INFO("KCL: (RecommenderSystem) Load scenarion from file: %s.\n", file_name.c_str());
+	std::ifstream f(file_name.c_str());
+	if (!f.is_open())
+	{
+		ROS_ERROR("KCL: (RecommenderSystem) Could not open %s.", file_name.c_str());
+		return false;
+	}
+	
+	std::vector<std::string> lines;
+	std::string line;
+	while (getline(f, line))
+	{
+		lines.push_back(line);
+	}
+	
+	std::vector<std::string> errors;
+	if (!validateDBFile(lines, errors))
+	{
+		for (std::vector<std::string>::const_iterator ci = errors.begin(); ci != errors.end(); ++ci)
+		{
+			ROS_ERROR("KCL (RecommenderSystem) %s\n", ci->c_str());
+		}
+		return false;
+	}
+	
+	KCL_rosplan::KnowledgeBase::Transaction transaction(knowledge_base);
+	std::vector<std::pair<std::string, geometry_msgs::PoseStamped> > waypoints;
+	for (std::vector<std::string>::const_iterator ci = lines.begin(); ci != lines.end(); ++ci)
+	{
+		const std::string& line = *ci;
+		if (line.size() == 0 || line[0] == '#') continue;
 
-				pose.pose.position.x = near_x;
-				pose.pose.position.y = near_y;
-				pose.pose.position.z = 0;
-				pose.pose.orientation = tf::createQuaternionMsgFromYaw(angle);
+		std::vector<KCL_rosplan::ScenarioLoader::Slice> tokens;
+		KCL_rosplan::ScenarioLoader::tokenise(line, tokens);
 
+		// Types.
+		if (line[0] == 't')
+		{
+			std::string type_name = tokens[1].str();
+			
+			const KCL_rosplan::Type& type = KCL_rosplan::Type::createType(type_name, NULL);
+			types.push_back(&type);
+		}
+		else if (line[0] == 'o')
+		{
+			std::string object_name = tokens[1].str();
+			std::string type_name = tokens[2].str();
+			objects.push_back(&KCL_rosplan::Object::createObject(object_name, KCL_rosplan::Type::getType(type_name)));
 
-				std::string near_id(message_store.insertNamed(ss.str(), pose));
+			// Add to the knowledge base.
+			transaction.addInstance(type_name, object_name);
+		}
+		else if (line[0] == 'p')
+		{
+			std::string predicate_name = tokens[1].str();
+			
+			std::vector<const KCL_rosplan::Type*> predicate_types;
+			for (unsigned int i = 2; i < tokens.size(); ++i)
+			{
+				predicate_types.push_back(&KCL_rosplan::Type::getType(tokens[i].str()));
+			}
+			predicates.push_back(&KCL_rosplan::Predicate::getPredicate(predicate_name, predicate_types));
+		}
+		else if (line[0] == 'f')
+		{
+			std::string predicate_name = tokens[1].str();
+			
+			std::vector<const KCL_rosplan::Object*> fact_objects;
+			for (unsigned int i = 2; i < tokens.size(); ++i)
+			{
+				fact_objects.push_back(KCL_rosplan::Object::getObject(tokens[i].str()));
 			}
+			
+			facts.insert(&KCL_rosplan::Fact::getFact(*KCL_rosplan::Predicate::getPredicate(predicate_name), fact_objects));
+		}
+		else if (line[0] == 'r')
+		{
+			geometry_msgs::Pose waypoint_location;
+			KCL_rosplan::ScenarioLoader::parsePose(tokens[2], waypoint_location);
+			std::string waypoint_predicate = tokens[1].str();
+			
+			geometry_msgs::PoseStamped pose;
+			pose.header.seq = 0;
+			pose.header.stamp = ros::Time::now();
+			pose.header.frame_id = "/map";
+			pose.pose = waypoint_location;
+			pose.pose.orientation.x = 0;
+			pose.pose.orientation.y = 0;
+			pose.pose.orientation.z = 0;
+			pose.pose.orientation.w = 1;
+			waypoints.push_back(std::make_pair(waypoint_predicate, pose));
+
+			// Calculate it's near component.
+			float centre_x = 0.372;
+			float centre_y = -0.342;
+			float distance = 0.8f;
+
+			float direction_x = centre_x - pose.pose.position.x;
+			float direction_y = centre_y - pose.pose.position.y;
+			float length = sqrt((direction_x * direction_x) + (direction_y * direction_y));
+			direction_x = direction_x / length;
+			direction_y = direction_y / length;
+			std::stringstream ss;
+			ss << "near_" << waypoint_predicate;
+
+			float near_x = pose.pose.position.x + direction_x * distance;
+			float near_y = pose.pose.position.y + direction_y * distance;
+
+			float angle = atan2(pose.pose.position.y - near_y, pose.pose.position.x - near_x);
+			if(isnan(angle)) angle = 0;
+
+			pose.pose.position.x = near_x;
+			pose.pose.position.y = near_y;
+			pose.pose.position.z = 0;
+			pose.pose.orientation = tf::createQuaternionMsgFromYaw(angle);
+
+			waypoints.push_back(std::make_pair(ss.str(), pose));
 		}
 	}
+	KCL_rosplan::Object::buildTypeIndex();
+	
+	if (!transaction.commit())
+	{
+		ROS_ERROR("KCL: (RecommenderSystem) Could not add the objects of %s to the knowledge base.", file_name.c_str());
+		return false;
+	}
+	
+	for (std::vector<std::pair<std::string, geometry_msgs::PoseStamped> >::const_iterator ci = waypoints.begin(); ci != waypoints.end(); ++ci)
+	{
+		message_store.insertNamed(ci->first, ci->second);
+	}
+	return true;
 }
 
 /**
@@ -1401,16 +1951,18 @@ bool generatePDDLProblemFile(rosplan_knowledge_msgs::GenerateProblemService::Req
 	return true;
 }
 
+// Tools that only need the types, objects and facts of the recommender (e.g. the generator benchmark) are built
+// with RECOMMENDER_SYSTEM_NO_MAIN.
+#ifndef RECOMMENDER_SYSTEM_NO_MAIN
 int main(int argc, char** argv)
 {
-        srand(time(NULL));
         ROS_INFO("KCL: (RecommenderSystem) Started!\n");
 
         ros::init(argc, argv, "rosplan_RecommanderSystem");
         ros::NodeHandle nh;
 
         mongodb_store::MessageStoreProxy ms(nh);
-        ros::ServiceClient update_knowledge_client = nh.serviceClient<rosplan_knowledge_msgs::KnowledgeUpdateService>("/kcl_rosplan/update_knowledge_base");
+        KCL_rosplan::KnowledgeBase knowledge_base(nh, ms);
 
         std::string domain_path;
         nh.getParam("/rosplan/domain", domain_path);
@@ -1425,7 +1977,10 @@ int main(int argc, char** argv)
 	std::vector<const KCL_rosplan::Object*> objects;
 	std::vector<const KCL_rosplan::Predicate*> predicates;
 	std::set<const KCL_rosplan::Fact*> true_facts;
-	readDBFile(ms, update_knowledge_client, config_file, types, objects, predicates, true_facts);
+	if (!readDBFile(ms, knowledge_base, config_file, types, objects, predicates, true_facts))
+	{
+		return -1;
+	}
 
         std::vector<const KCL_rosplan::Object*> relevant_objects;
         for (std::vector<const KCL_rosplan::Object*>::const_iterator ci = objects.begin(); ci != objects.end(); ++ci)
@@ -1435,39 +1990,33 @@ int main(int argc, char** argv)
                 relevant_objects.push_back(*ci);
         }
         
-        // Ground all Facts .
-        std::vector<const KCL_rosplan::Fact*> all_facts;
-        for (std::vector<const KCL_rosplan::Predicate*>::const_iterator ci = predicates.begin(); ci != predicates.end(); ++ci)
-        {
-                const KCL_rosplan::Predicate* predicate = *ci;
-                predicate->ground(all_facts);
-        }
-
-
-	/* Mark all facts that are valid with 0 (uncertain). */
+	/* Mark all facts that are known to be true with 2, facts without a weight are false. */
 	std::map<const KCL_rosplan::Fact*, float> weighted_facts;
+	std::vector<const KCL_rosplan::Fact*> all_facts;
+	for (std::set<const KCL_rosplan::Fact*>::const_iterator ci = true_facts.begin(); ci != true_facts.end(); ++ci)
+	{
+		weighted_facts[*ci] = 2.0;
+		if ((*ci)->getPredicate().getName() != "belongs_in")
+		{
+			all_facts.push_back(*ci);
+		}
+	}
+	
+	/* Mark all facts that are valid with 0 (uncertain). Only these facts are grounded, so the facts of the other 
+	 * predicates are never created. */
 	std::vector<const KCL_rosplan::Fact*> interesting_facts;
-	for (std::vector<const KCL_rosplan::Fact*>::const_iterator ci = all_facts.begin(); ci != all_facts.end(); ++ci)
-	{
-	       const KCL_rosplan::Fact* fact = *ci;
-	       
-	       // Check if this fact is known to be true.
-	       if (true_facts.find(fact) != true_facts.end())
-	       {
-		       weighted_facts[*ci] = 2.0;
-	       }
-	       // Otherwise we set it to false.
-	       else
-	       {
-		       weighted_facts[*ci] = 1.0;
-	       }
-	       
-	       // All facts that are certain are set true.
-	       if ((*ci)->getPredicate().getName() == "belongs_in")
-	       {
-		       interesting_facts.push_back(*ci);
-		       weighted_facts[*ci] = 0.0;
-	       }
+	for (std::vector<const KCL_rosplan::Predicate*>::const_iterator ci = predicates.begin(); ci != predicates.end(); ++ci)
+	{
+		if ((*ci)->getName() != "belongs_in") continue;
+		
+		KCL_rosplan::GroundingIterator grounding(**ci);
+		while (grounding.next())
+		{
+			const KCL_rosplan::Fact& fact = grounding.getFact();
+			all_facts.push_back(&fact);
+			interesting_facts.push_back(&fact);
+			weighted_facts[&fact] = 0.0;
+		}
 	}
 	ROS_INFO("KCL: (RecommenderSystem) Weighted facts created.\n");
 
@@ -1625,4 +2174,4 @@ int main(int argc, char** argv)
 	}
 	return 0;
 }
-
+#endif
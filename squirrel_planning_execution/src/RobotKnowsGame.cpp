@@ -2,6 +2,7 @@
 #include <iostream>
 #include <fstream>
 #include <tf/tf.h>
+#include <boost/bind.hpp>
 
 #include <actionlib/client/simple_action_client.h>
 
@@ -23,40 +24,13 @@
 #include "pddl_actions/TidyAreaPDDLAction.h"
 #include "pddl_actions/PlannerInstance.h"
 #include "pddl_actions/GotoViewWaypointPDDLAction.h"
+#include "squirrel_planning_execution/KnowledgeBase.h"
+#include "squirrel_planning_execution/ScenarioLoader.h"
 
 ros::NodeHandle* nh;
 ros::Publisher action_feedback_pub;
 
 
-void tokenise(const std::string& s, std::vector<std::string>& tokens)
-{
-	size_t current;
-	size_t next = -1;
-
-	do
-	{
-		current = next + 1;
-		next = s.find_first_of(" ", current);
-		tokens.push_back(s.substr(current, next - current));
-	} 
-	while (next != std::string::npos);
-}
-
-// Expect s to be "(f,f,f)"
-geometry_msgs::Pose transformToPose(const std::string& s)
-{
-	std::cout << "Tranform to pose: " << s << std::endl;
-	geometry_msgs::Pose p;
-	int first_break = s.find(',');
-	int second_break = s.find(',', first_break + 1);
-
-	p.position.x = ::atof(s.substr(1, first_break - 1).c_str());
-	p.position.y = ::atof(s.substr(first_break + 1, second_break - (first_break + 1)).c_str());
-	p.position.z = ::atof(s.substr(second_break + 1, s.size() - (second_break + 2)).c_str());
-
-	return p;
-}
-
 void sendMarker(const geometry_msgs::Pose& pose, const std::string& name, ros::Publisher& vis_pub, float size)
 {
 	static int id = 0;
@@ -80,272 +54,55 @@ void sendMarker(const geometry_msgs::Pose& pose, const std::string& name, ros::P
 }
 
 
-void setupSimulation(const std::string& config_file, ros::ServiceClient& update_knowledge_client, mongodb_store::MessageStoreProxy& message_store, ros::Publisher& vis_pub)
+void setupSimulation(const std::string& config_file, mongodb_store::MessageStoreProxy& message_store, ros::Publisher& vis_pub)
 {
 	ROS_INFO("KCL: (RobotKnowsGame) Load scenarion from file: %s.\n", config_file.c_str());
-	std::ifstream f(config_file.c_str());
-	std::string line;
-
-	rosplan_knowledge_msgs::KnowledgeUpdateService knowledge_update_service;
-
-	if (f.is_open())
+	
+	// The whole file is validated before anything is stored.
+	KCL_rosplan::Scenario scenario;
+	std::vector<std::string> errors;
+	if (!KCL_rosplan::ScenarioLoader::load(config_file, scenario, errors))
 	{
-		while (getline(f, line))
+		for (std::vector<std::string>::const_iterator ci = errors.begin(); ci != errors.end(); ++ci)
 		{
-
-			std::cout << line << std::endl;
-			if (line.size() == 0) continue;
-
-			std::vector<std::string> tokens;
-			tokenise(line, tokens);
-
-			// Boxes.
-			if (line[0] == 'b')
-			{
-				if (tokens.size() != 4)
-				{
-					ROS_ERROR("KCL (RobotKnowsGame) Malformed line, expected b BOX_NAME (f,f,f) (f,f,f). Read %s\n", line.c_str());
-					exit(0);
-				}
-				std::string box_predicate = tokens[1];
-				geometry_msgs::Pose box_location = transformToPose(tokens[2]);
-				geometry_msgs::Pose near_box = transformToPose(tokens[3]);
-				sendMarker(box_location, box_predicate, vis_pub, 0.25f);
-				{
-					std::stringstream ss;
-					ss << "near_" << box_predicate;
-					sendMarker(near_box, ss.str(), vis_pub, 0.1f);
-				}
-				
-
-				// Add the box predicate to the knowledge base.
-				rosplan_knowledge_msgs::KnowledgeItem knowledge_item;
-				
-				knowledge_item.instance_type = "box";
-				knowledge_item.instance_name = box_predicate;
-				
-				knowledge_update_service.request.knowledge = knowledge_item;knowledge_item.knowledge_type = rosplan_knowledge_msgs::KnowledgeItem::INSTANCE;
-				if (!update_knowledge_client.call(knowledge_update_service)) {
-					ROS_ERROR("KCL: (RobotKnowsGame) Could not add the box %s to the knowledge base.", box_predicate.c_str());
-					exit(-1);
-				}
-				ROS_INFO("KCL: (RobotKnowsGame) Added %s to the knowledge base.", box_predicate.c_str());
-
-				// Add waypoints for these boxes.
-				knowledge_item.instance_type = "waypoint";
-				std::stringstream ss;
-				ss << box_predicate << "_location";
-				knowledge_item.instance_name = ss.str();
-				
-				knowledge_update_service.request.knowledge = knowledge_item;
-				if (!update_knowledge_client.call(knowledge_update_service)) {
-					ROS_ERROR("KCL: (RobotKnowsGame) Could not add the waypoint %s to the knowledge base.", ss.str().c_str());
-					exit(-1);
-				}
-				ROS_INFO("KCL: (RobotKnowsGame) Added %s to the knowledge base.", ss.str().c_str());
-
-				// Set the actual location of the box waypoints in message store.
-				{
-				geometry_msgs::PoseStamped pose;
-				pose.header.seq = 0;
-				pose.header.stamp = ros::Time::now();
-				pose.header.frame_id = "/map";
-				pose.pose = box_location;
-				
-				pose.pose.orientation.x = 0.0f;
-				pose.pose.orientation.y = 0.0f;
-				pose.pose.orientation.z = 0.0f;
-				pose.pose.orientation.w = 1.0f;
-				std::string near_waypoint_mongodb_id3(message_store.insertNamed(ss.str(), pose));
-				ROS_INFO("KCL: (RobotKnowsGame) Added %s to the knowledge base.", ss.str().c_str());
-				}
-				
-				// Link the boxes to these waypoints.
-				knowledge_item.knowledge_type = rosplan_knowledge_msgs::KnowledgeItem::FACT;
-				knowledge_item.attribute_name = "box_at";
-				knowledge_item.is_negative = false;
-				
-				diagnostic_msgs::KeyValue kv;
-				kv.key = "b";
-				kv.value = box_predicate;
-				knowledge_item.values.push_back(kv);
-				
-				kv.key = "wp";
-				kv.value = ss.str();
-				knowledge_item.values.push_back(kv);
-				
-				knowledge_update_service.request.knowledge = knowledge_item;
-				if (!update_knowledge_client.call(knowledge_update_service)) {
-					ROS_ERROR("KCL: (RobotKnowsGame) Could not add the fact (box_at %s %s) to the knowledge base.", box_predicate.c_str(), ss.str().c_str());
-					exit(-1);
-				}
-				ROS_INFO("KCL: (RobotKnowsGame) Added the fact (box_at %s %s) to the knowledge base.", box_predicate.c_str(), ss.str().c_str());
-				knowledge_item.values.clear();
-				
-				knowledge_item.knowledge_type = rosplan_knowledge_msgs::KnowledgeItem::INSTANCE;
-				knowledge_item.instance_type = "waypoint";
-				ss.str(std::string());
-				ss << "near_" << box_predicate;
-				knowledge_item.instance_name = ss.str();
-				
-				knowledge_update_service.request.knowledge = knowledge_item;
-				if (!update_knowledge_client.call(knowledge_update_service)) {
-					ROS_ERROR("KCL: (RobotKnowsGame) Could not add the waypoint %s to the knowledge base.", ss.str().c_str());
-					exit(-1);
-				}
-				{
-				geometry_msgs::PoseStamped pose;
-				pose.header.seq = 0;
-				pose.header.stamp = ros::Time::now();
-				pose.header.frame_id = "/map";
-				pose.pose = near_box;
-				
-				float angle = atan2(box_location.position.y - near_box.position.y, box_location.position.x - near_box.position.x);
-				pose.pose.orientation = tf::createQuaternionMsgFromYaw(angle);
-//				pose.pose.orientation.x = 0.0f;
-//				pose.pose.orientation.y = 0.0f;
-//				pose.pose.orientation.z = 1.0f;
-//				pose.pose.orientation.w = angle;
-				std::string near_waypoint_mongodb_id3(message_store.insertNamed(ss.str(), pose));
-				ROS_INFO("KCL: (RobotKnowsGame) Added %s to the knowledge base.", ss.str().c_str());
-				}
-			}
-			else if (line[0] == 'w')
-			{
-
-				if (tokens.size() != 3)
-				{
-					ROS_ERROR("KCL (RobotKnowsGame) Malformed line, expected w WAYPOINT_NAME (f,f,f). Read %s\n", line.c_str());
-					exit(0);
-				}
-				std::string waypoint_predicate = tokens[1];
-				geometry_msgs::Pose waypoint_pose = transformToPose(tokens[2]);
-
-				geometry_msgs::PoseStamped pose;
-				pose.header.seq = 0;
-				pose.header.stamp = ros::Time::now();
-				pose.header.frame_id = "/map";
-				pose.pose = waypoint_pose;
-				
-				pose.pose.orientation.x = 0.0f;
-				pose.pose.orientation.y = 0.0f;
-				pose.pose.orientation.z = 0.0f;
-				pose.pose.orientation.w = 1.0f;
-				std::string near_waypoint_mongodb_id3(message_store.insertNamed(waypoint_predicate, pose));
-
-				rosplan_knowledge_msgs::KnowledgeItem knowledge_item;
-				knowledge_item.knowledge_type = rosplan_knowledge_msgs::KnowledgeItem::INSTANCE;
-				knowledge_item.instance_type = "waypoint";
-				knowledge_item.instance_name = waypoint_predicate;
-				
-				knowledge_update_service.request.knowledge = knowledge_item;
-				if (!update_knowledge_client.call(knowledge_update_service)) {
-					ROS_ERROR("KCL: (RobotKnowsGame) Could not add the waypoint %s to the knowledge base.", waypoint_predicate.c_str());
-					exit(-1);
-				}
-				ROS_INFO("KCL: (RobotKnowsGame) Added %s to the knowledge base.", waypoint_predicate.c_str());
-			}
-			else if (line[0] == 't')
-			{
-				if (tokens.size() != 3)
-				{
-					ROS_ERROR("KCL (RobotKnowsGame) Malformed line, expected t TOY_NAME (f,f,f). Read %s\n", line.c_str());
-					exit(0);
-				}
-				std::string toy_predicate = tokens[1];
-				geometry_msgs::Pose toy_pose = transformToPose(tokens[2]);
-
-				// Create a Scene Object for the toy.
-				squirrel_object_perception_msgs::SceneObject scene_object;
-				scene_object.id = toy_predicate;
-				scene_object.category = "unknown";
-				
-				geometry_msgs::PoseStamped object_pose;
-				object_pose.header.seq = 0;
-				object_pose.header.stamp = ros::Time::now();
-				object_pose.header.frame_id = "/map";
-				object_pose.pose = toy_pose;
-				
-				object_pose.pose.orientation.x = 0.0f;
-				object_pose.pose.orientation.y = 0.0f;
-				object_pose.pose.orientation.z = 0.0f;
-				object_pose.pose.orientation.w = 1.0f;
-				scene_object.pose = object_pose.pose;
-				
-				std::string near_waypoint_mongodb_id(message_store.insertNamed(toy_predicate, scene_object));
-				ROS_INFO("KCL: (RobotKnowsGame) Added %s to the knowledge base.", toy_predicate.c_str());
-			}
-			else if (line[0] == 'm')
-			{
-				if (tokens.size() != 3)
-				{
-					ROS_ERROR("KCL (RobotKnowsGame) Malformed line, expected m OBJECT_ID BOX_NAME. Read %s\n", line.c_str());
-					exit(0);
-				}
-				std::string object_id = tokens[1];
-				std::string box_name = tokens[2];
-
-				rosplan_knowledge_msgs::KnowledgeItem knowledge_item;
-				knowledge_item.knowledge_type = rosplan_knowledge_msgs::KnowledgeItem::FACT;
-				knowledge_item.attribute_name = "belongs_in";
-				knowledge_item.is_negative = false;
-				
-				diagnostic_msgs::KeyValue kv;
-				kv.key = "o";
-				kv.value = object_id;
-				knowledge_item.values.push_back(kv);
-				
-				kv.key = "b";
-				kv.value = box_name;
-				knowledge_item.values.push_back(kv);
-				
-				knowledge_update_service.request.knowledge = knowledge_item;
-				if (!update_knowledge_client.call(knowledge_update_service)) {
-					ROS_ERROR("KCL: (RobotKnowsGame) Could not add the fact (belongs_in %s %s) to the knowledge base.", object_id.c_str(), box_name.c_str());
-					exit(-1);
-				}
-				ROS_INFO("KCL: (RobotKnowsGame) Added the fact (belongs_in %s %s) to the knowledge base.", object_id.c_str(), box_name.c_str());
-			}
+			ROS_ERROR("KCL (RobotKnowsGame) %s\n", ci->c_str());
 		}
+		exit(0);
 	}
-
-	// Set kenny at it's starting waypoint.
+	
+	for (std::vector<KCL_rosplan::ScenarioBox>::const_iterator ci = scenario.boxes_.begin(); ci != scenario.boxes_.end(); ++ci)
 	{
-		rosplan_knowledge_msgs::KnowledgeItem knowledge_item;
-		knowledge_item.knowledge_type = rosplan_knowledge_msgs::KnowledgeItem::INSTANCE;
-		knowledge_item.instance_type = "robot";
-		knowledge_item.instance_name = "robot";
-		
-		knowledge_update_service.request.knowledge = knowledge_item;
-		if (!update_knowledge_client.call(knowledge_update_service)) {
-			ROS_ERROR("KCL: (RobotKnowsGame) Could not add the robot robot to the knowledge base.");
-			exit(-1);
-		}
-		ROS_INFO("KCL: (RobotKnowsGame) Added robot to the knowledge base.");
+		sendMarker(ci->location_, ci->name_, vis_pub, 0.25f);
+		sendMarker(ci->near_, "near_" + ci->name_, vis_pub, 0.1f);
 	}
-
-	rosplan_knowledge_msgs::KnowledgeItem knowledge_item;
-	knowledge_item.knowledge_type = rosplan_knowledge_msgs::KnowledgeItem::FACT;
-	knowledge_item.attribute_name = "robot_at";
-	knowledge_item.is_negative = false;
 	
-	diagnostic_msgs::KeyValue kv;
-	kv.key = "v";
-	kv.value = "robot";
-	knowledge_item.values.push_back(kv);
+	// The toys are only known to the recogniser, they are added to the knowledge base once they are observed.
+	KCL_rosplan::ScenarioLoader::StoreOptions options;
+	options.add_near_facts_ = false;
+	options.toys_as_scene_objects_ = true;
 	
-	kv.key = "wp";
-	kv.value = "kenny_waypoint";
-	knowledge_item.values.push_back(kv);
+	KCL_rosplan::KnowledgeBase knowledge_base(*nh, message_store);
+	KCL_rosplan::KnowledgeBase::Transaction transaction(knowledge_base);
+	KCL_rosplan::ScenarioSnapshot snapshot;
+	KCL_rosplan::ScenarioLoader::store(scenario, transaction, snapshot, options);
 	
-	knowledge_update_service.request.knowledge = knowledge_item;
-	if (!update_knowledge_client.call(knowledge_update_service)) {
-		ROS_ERROR("KCL: (RobotKnowsGame) Could not add the fact (robot_at robot kenny_waypoint) to the knowledge base.");
+	// Set kenny at it's starting waypoint.
+	transaction.addInstance("robot", "robot");
+	
+	std::map<std::string, std::string> parameters;
+	parameters["v"] = "robot";
+	parameters["wp"] = "kenny_waypoint";
+	transaction.addFact("robot_at", parameters, true, KCL_rosplan::KnowledgeBase::KB_ADD_KNOWLEDGE);
+	
+	if (!transaction.commit())
+	{
+		ROS_ERROR("KCL: (RobotKnowsGame) Could not add the scenario to the knowledge base.");
 		exit(-1);
 	}
-	ROS_INFO("KCL: (RobotKnowsGame) Added the fact (robot_at robot kenny_waypoint) to the knowledge base.");
-
-	f.close();
+	ROS_INFO("KCL: (RobotKnowsGame) Added the scenario to the knowledge base.");
+	
+	// Only now that the knowledge is in, the poses it refers to are written.
+	snapshot.storePoses(message_store);
 }
 
 void setupSimulation(ros::ServiceClient& update_knowledge_client)
@@ -695,6 +452,14 @@ bool generatePDDLProblemFile(rosplan_knowledge_msgs::GenerateProblemService::Req
 	return true;
 }
 
+/**
+ * Called when the sub-plan of a phase is done.
+ * @param state The final state of the sub-plan.
+ * @param msg The action that started the sub-plan.
+ * @param planner_instance The planner instance that executed the sub-plan.
+ */
+void planFinished(const actionlib::SimpleClientGoalState& state, const rosplan_dispatch_msgs::ActionDispatch::ConstPtr& msg, KCL_rosplan::PlannerInstance* planner_instance);
+
 void dispatchCallback(const rosplan_dispatch_msgs::ActionDispatch::ConstPtr& msg)
 {
 	rosplan_dispatch_msgs::ActionDispatch normalised_action_dispatch = *msg;
@@ -709,8 +474,6 @@ void dispatchCallback(const rosplan_dispatch_msgs::ActionDispatch::ConstPtr& msg
 		return;
 	}
 
-	bool actionAchieved = false;
-	
 	ROS_INFO("KCL: (ExamineAreaPDDLAction) action recieved %s", action_name.c_str());
 	
 	// publish feedback (enabled)
@@ -719,7 +482,14 @@ void dispatchCallback(const rosplan_dispatch_msgs::ActionDispatch::ConstPtr& msg
 	fb.status = "action enabled";
 	action_feedback_pub.publish(fb);
 	
-	KCL_rosplan::PlannerInstance& planner_instance = KCL_rosplan::PlannerInstance::createInstance(*nh, "ff");
+	KCL_rosplan::PlannerInstance* planner_instance = KCL_rosplan::PlannerInstance::createInstance(*nh, "ff");
+	if (planner_instance == NULL)
+	{
+		ROS_ERROR("KCL: (ExamineAreaPDDLAction) no planner instance is available for action name %s.", action_name.c_str());
+		fb.status = "action failed";
+		action_feedback_pub.publish(fb);
+		return;
+	}
 	
 	// Lets start the planning process.
 	std::string data_path;
@@ -747,17 +517,15 @@ void dispatchCallback(const rosplan_dispatch_msgs::ActionDispatch::ConstPtr& msg
 		nh->getParam("/squirrel_planning_execution/planner_command_phase2", planner_command);
 	}
 	
-	planner_instance.startPlanner(domain_path, problem_path, data_path, planner_command);
+	planner_instance->startPlanner(domain_path, problem_path, data_path, planner_command, boost::bind(&planFinished, _1, msg, planner_instance));
 	
-	// wait for action to finish
-	ros::Rate loop_rate(1);
-	while (ros::ok() && (planner_instance.getState() == actionlib::SimpleClientGoalState::ACTIVE || planner_instance.getState() == actionlib::SimpleClientGoalState::PENDING)) {
-		ros::spinOnce();
-		loop_rate.sleep();
-	}
+	// The sub-plan runs in the background, planFinished is called once it is done.
+}
 
-	actionlib::SimpleClientGoalState state = planner_instance.getState();
-	ROS_INFO("KCL: (ExamineAreaPDDLAction) action finished: %s, %s", action_name.c_str(), state.toString().c_str());
+void planFinished(const actionlib::SimpleClientGoalState& state, const rosplan_dispatch_msgs::ActionDispatch::ConstPtr& msg, KCL_rosplan::PlannerInstance* planner_instance)
+{
+	planner_instance->release();
+	ROS_INFO("KCL: (ExamineAreaPDDLAction) action finished: %s, %s", msg->name.c_str(), state.toString().c_str());
 
 	if(state == actionlib::SimpleClientGoalState::SUCCEEDED)
 	{
@@ -794,7 +562,7 @@ int main(int argc, char **argv) {
 	mongodb_store::MessageStoreProxy message_store(*nh);
 	std::string config_file;
 	nh->getParam("/scenario_setup_file", config_file);
-	setupSimulation(config_file, update_knowledge_client, message_store, vis_pub);
+	setupSimulation(config_file, message_store, vis_pub);
 	
 	//setupSimulation(update_knowledge_client);
 	//initMongoDBData(message_store);
@@ -0,0 +1,449 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <set>
+#include <map>
+
+#include <geometry_msgs/PoseStamped.h>
+#include <squirrel_object_perception_msgs/SceneObject.h>
+#include <tf/tf.h>
+
+#include "squirrel_planning_execution/ScenarioLoader.h"
+
+namespace KCL_rosplan
+{
+
+void Scenario::clear()
+{
+	boxes_.clear();
+	toys_.clear();
+	waypoints_.clear();
+	children_.clear();
+	mappings_.clear();
+	functions_.clear();
+}
+
+ScenarioLoader::StoreOptions::StoreOptions()
+	: add_near_facts_(true), toys_as_scene_objects_(false), mapping_predicate_("belongs_in"), mapping_target_(KnowledgeBase::KB_ADD_KNOWLEDGE)
+{
+
+}
+
+/**
+ * Record a malformed line.
+ */
+static void addError(std::vector<std::string>& errors, unsigned int line_nr, const char* expected, const char* begin, const char* end)
+{
+	std::stringstream ss;
+	ss << "line " << line_nr << ": malformed line, expected " << expected << ". Read " << std::string(begin, end);
+	errors.push_back(ss.str());
+}
+
+/**
+ * Make sure every box, toy, waypoint and child is only declared once.
+ */
+static bool isNewName(std::set<std::string>& names, const std::string& name, std::vector<std::string>& errors, unsigned int line_nr)
+{
+	if (names.insert(name).second)
+	{
+		return true;
+	}
+	std::stringstream ss;
+	ss << "line " << line_nr << ": " << name << " is declared more than once.";
+	errors.push_back(ss.str());
+	return false;
+}
+
+bool ScenarioLoader::load(const std::string& file_name, Scenario& scenario, std::vector<std::string>& errors)
+{
+	std::ifstream f(file_name.c_str(), std::ios::in | std::ios::binary);
+	if (!f.is_open())
+	{
+		errors.push_back("could not open " + file_name + ".");
+		return false;
+	}
+
+	std::stringstream text;
+	text << f.rdbuf();
+	return parse(text.str(), scenario, errors);
+}
+
+bool ScenarioLoader::parse(const std::string& text, Scenario& scenario, std::vector<std::string>& errors)
+{
+	size_t nr_errors = errors.size();
+	std::set<std::string> names;
+	std::vector<Slice> tokens;
+
+	const char* line_begin = text.data();
+	const char* text_end = text.data() + text.size();
+	for (unsigned int line_nr = 1; line_begin < text_end; ++line_nr)
+	{
+		const char* line_end = static_cast<const char*>(memchr(line_begin, '\n', text_end - line_begin));
+		if (line_end == NULL) line_end = text_end;
+		const char* next_line = line_end == text_end ? text_end : line_end + 1;
+
+		// Files written on Windows end their lines with \r\n.
+		if (line_end > line_begin && *(line_end - 1) == '\r') --line_end;
+
+		tokens.clear();
+		tokenise(line_begin, line_end, tokens);
+		if (tokens.empty() || *tokens[0].begin_ == '#')
+		{
+			line_begin = next_line;
+			continue;
+		}
+
+		const Slice& kind = tokens[0];
+		if (kind.size() != 1)
+		{
+			addError(errors, line_nr, "one of b, t, w, c, m or f as first token", line_begin, line_end);
+		}
+		else if (*kind.begin_ == 'b')
+		{
+			ScenarioBox box;
+			if (tokens.size() != 4 || !parsePose(tokens[2], box.location_) || !parsePose(tokens[3], box.near_))
+			{
+				addError(errors, line_nr, "b BOX_NAME (f,f,f) (f,f,f)", line_begin, line_end);
+			}
+			else
+			{
+				box.name_ = tokens[1].str();
+				if (isNewName(names, box.name_, errors, line_nr)) scenario.boxes_.push_back(box);
+			}
+		}
+		else if (*kind.begin_ == 't')
+		{
+			// The type is optional, so is the location; the near location is only given after a location.
+			ScenarioToy toy;
+			toy.has_location_ = false;
+			toy.has_near_ = false;
+			bool valid = tokens.size() >= 2 && tokens.size() <= 5;
+			size_t next = 2;
+			if (valid && next < tokens.size() && *tokens[next].begin_ != '(')
+			{
+				toy.type_ = tokens[next].str();
+				++next;
+			}
+			if (valid && next < tokens.size())
+			{
+				toy.has_location_ = parsePose(tokens[next], toy.location_);
+				valid = toy.has_location_;
+				++next;
+			}
+			if (valid && next < tokens.size())
+			{
+				toy.has_near_ = parsePose(tokens[next], toy.near_);
+				valid = toy.has_near_;
+				++next;
+			}
+			if (!valid || next != tokens.size())
+			{
+				addError(errors, line_nr, "t TOY_NAME [TYPE] [(f,f,f) [(f,f,f)]]", line_begin, line_end);
+			}
+			else
+			{
+				toy.name_ = tokens[1].str();
+				if (isNewName(names, toy.name_, errors, line_nr)) scenario.toys_.push_back(toy);
+			}
+		}
+		else if (*kind.begin_ == 'w')
+		{
+			ScenarioWaypoint waypoint;
+			if (tokens.size() != 3 || !parsePose(tokens[2], waypoint.location_))
+			{
+				addError(errors, line_nr, "w WAYPOINT_NAME (f,f,f)", line_begin, line_end);
+			}
+			else
+			{
+				waypoint.name_ = tokens[1].str();
+				if (isNewName(names, waypoint.name_, errors, line_nr)) scenario.waypoints_.push_back(waypoint);
+			}
+		}
+		else if (*kind.begin_ == 'c')
+		{
+			ScenarioChild child;
+			if (tokens.size() != 6 ||
+			    !parseFloat(tokens[2], child.pleasure_) || !parseFloat(tokens[3], child.arousal_) ||
+			    !parseFloat(tokens[4], child.dominance_) || !parseFloat(tokens[5], child.reciprocity_))
+			{
+				addError(errors, line_nr, "c CHILD_NAME P A D R", line_begin, line_end);
+			}
+			else
+			{
+				child.name_ = tokens[1].str();
+				if (isNewName(names, child.name_, errors, line_nr)) scenario.children_.push_back(child);
+			}
+		}
+		else if (*kind.begin_ == 'm')
+		{
+			// The toy ids are given by the recogniser, so they are not declared in this file.
+			if (tokens.size() != 3)
+			{
+				addError(errors, line_nr, "m OBJECT_ID BOX_NAME", line_begin, line_end);
+			}
+			else
+			{
+				ScenarioMapping mapping;
+				mapping.object_ = tokens[1].str();
+				mapping.box_ = tokens[2].str();
+				scenario.mappings_.push_back(mapping);
+			}
+		}
+		else if (*kind.begin_ == 'f')
+		{
+			ScenarioFunction function;
+			if (tokens.size() != 3 || !parseFloat(tokens[2], function.value_))
+			{
+				addError(errors, line_nr, "f FUNCTION VALUE", line_begin, line_end);
+			}
+			else
+			{
+				function.name_ = tokens[1].str();
+				scenario.functions_.push_back(function);
+			}
+		}
+		else
+		{
+			addError(errors, line_nr, "one of b, t, w, c, m or f as first token", line_begin, line_end);
+		}
+		line_begin = next_line;
+	}
+	return errors.size() == nr_errors;
+}
+
+/**
+ * @return A pose in the map frame at @ref{pose}, facing @ref{target}.
+ */
+static geometry_msgs::PoseStamped createPose(const geometry_msgs::Pose& pose, const geometry_msgs::Pose* target)
+{
+	geometry_msgs::PoseStamped pose_stamped;
+	pose_stamped.header.seq = 0;
+	pose_stamped.header.stamp = ros::Time::now();
+	pose_stamped.header.frame_id = "/map";
+	pose_stamped.pose = pose;
+	if (target != NULL)
+	{
+		float angle = atan2(target->position.y - pose.position.y, target->position.x - pose.position.x);
+		pose_stamped.pose.orientation = tf::createQuaternionMsgFromYaw(angle);
+	}
+	return pose_stamped;
+}
+
+void ScenarioLoader::compile(const Scenario& scenario, ScenarioSnapshot& snapshot, const StoreOptions& options)
+{
+	snapshot.clear();
+	std::map<std::string, std::string> parameters;
+
+	for (std::vector<ScenarioBox>::const_iterator ci = scenario.boxes_.begin(); ci != scenario.boxes_.end(); ++ci)
+	{
+		const ScenarioBox& box = *ci;
+		std::string location = box.name_ + "_location";
+		std::string near = "near_" + box.name_;
+
+		snapshot.knowledge_.push_back(KnowledgeBase::createInstance("box", box.name_));
+		snapshot.knowledge_.push_back(KnowledgeBase::createInstance("waypoint", location));
+		snapshot.knowledge_.push_back(KnowledgeBase::createInstance("waypoint", near));
+
+		parameters.clear();
+		parameters["b"] = box.name_;
+		parameters["wp"] = location;
+		snapshot.knowledge_.push_back(KnowledgeBase::createFact("box_at", parameters, true));
+
+		if (options.add_near_facts_)
+		{
+			parameters.clear();
+			parameters["wp1"] = near;
+			parameters["wp2"] = location;
+			snapshot.knowledge_.push_back(KnowledgeBase::createFact("near", parameters, true));
+		}
+
+		snapshot.poses_.push_back(ScenarioSnapshot::NamedPose(location, createPose(box.location_, NULL)));
+		snapshot.poses_.push_back(ScenarioSnapshot::NamedPose(near, createPose(box.near_, &box.location_)));
+	}
+
+	for (std::vector<ScenarioToy>::const_iterator ci = scenario.toys_.begin(); ci != scenario.toys_.end(); ++ci)
+	{
+		const ScenarioToy& toy = *ci;
+		if (options.toys_as_scene_objects_)
+		{
+			if (!toy.has_location_) continue;
+
+			squirrel_object_perception_msgs::SceneObject scene_object;
+			scene_object.id = toy.name_;
+			scene_object.category = toy.type_.empty() ? "unknown" : toy.type_;
+			scene_object.pose = createPose(toy.location_, NULL).pose;
+			snapshot.scene_objects_.push_back(scene_object);
+			continue;
+		}
+
+		snapshot.knowledge_.push_back(KnowledgeBase::createInstance("object", toy.name_));
+		if (!toy.type_.empty())
+		{
+			snapshot.knowledge_.push_back(KnowledgeBase::createInstance("type", toy.type_));
+
+			parameters.clear();
+			parameters["o"] = toy.name_;
+			parameters["t"] = toy.type_;
+			snapshot.knowledge_.push_back(KnowledgeBase::createFact("is_of_type", parameters, true));
+		}
+
+		if (toy.has_location_)
+		{
+			std::string location = toy.name_ + "_location";
+			snapshot.knowledge_.push_back(KnowledgeBase::createInstance("waypoint", location));
+
+			parameters.clear();
+			parameters["o"] = toy.name_;
+			parameters["wp"] = location;
+			snapshot.knowledge_.push_back(KnowledgeBase::createFact("object_at", parameters, true));
+
+			snapshot.poses_.push_back(ScenarioSnapshot::NamedPose(location, createPose(toy.location_, NULL)));
+		}
+
+		if (toy.has_near_)
+		{
+			std::string near = "near_" + toy.name_;
+			snapshot.knowledge_.push_back(KnowledgeBase::createInstance("waypoint", near));
+			snapshot.poses_.push_back(ScenarioSnapshot::NamedPose(near, createPose(toy.near_, &toy.location_)));
+		}
+	}
+
+	for (std::vector<ScenarioWaypoint>::const_iterator ci = scenario.waypoints_.begin(); ci != scenario.waypoints_.end(); ++ci)
+	{
+		snapshot.knowledge_.push_back(KnowledgeBase::createInstance("waypoint", ci->name_));
+		snapshot.poses_.push_back(ScenarioSnapshot::NamedPose(ci->name_, createPose(ci->location_, NULL)));
+	}
+
+	for (std::vector<ScenarioChild>::const_iterator ci = scenario.children_.begin(); ci != scenario.children_.end(); ++ci)
+	{
+		snapshot.knowledge_.push_back(KnowledgeBase::createInstance("child", ci->name_));
+
+		parameters.clear();
+		parameters["c"] = ci->name_;
+		snapshot.knowledge_.push_back(KnowledgeBase::createFunction("pleasure", parameters, ci->pleasure_));
+		snapshot.knowledge_.push_back(KnowledgeBase::createFunction("arousal", parameters, ci->arousal_));
+		snapshot.knowledge_.push_back(KnowledgeBase::createFunction("dominance", parameters, ci->dominance_));
+		snapshot.knowledge_.push_back(KnowledgeBase::createFunction("reciprocal", parameters, ci->reciprocity_));
+	}
+
+	for (std::vector<ScenarioMapping>::const_iterator ci = scenario.mappings_.begin(); ci != scenario.mappings_.end(); ++ci)
+	{
+		parameters.clear();
+		parameters["o"] = ci->object_;
+		parameters["b"] = ci->box_;
+		rosplan_knowledge_msgs::KnowledgeItem mapping = KnowledgeBase::createFact(options.mapping_predicate_, parameters, true);
+		if (options.mapping_target_ == KnowledgeBase::KB_ADD_GOAL) snapshot.goals_.push_back(mapping);
+		else snapshot.knowledge_.push_back(mapping);
+	}
+
+	for (std::vector<ScenarioFunction>::const_iterator ci = scenario.functions_.begin(); ci != scenario.functions_.end(); ++ci)
+	{
+		parameters.clear();
+		parameters["r"] = "robot";
+		snapshot.knowledge_.push_back(KnowledgeBase::createFunction(ci->name_, parameters, ci->value_));
+	}
+
+	ROS_INFO("KCL: (ScenarioLoader) Compiled %zd boxes, %zd toys, %zd waypoints, %zd children, %zd mappings and %zd functions.",
+	         scenario.boxes_.size(), scenario.toys_.size(), scenario.waypoints_.size(),
+	         scenario.children_.size(), scenario.mappings_.size(), scenario.functions_.size());
+}
+
+void ScenarioLoader::store(const Scenario& scenario, KnowledgeBase::Transaction& transaction, ScenarioSnapshot& snapshot, const StoreOptions& options)
+{
+	compile(scenario, snapshot, options);
+	snapshot.record(transaction);
+}
+
+void ScenarioLoader::tokenise(const char* begin, const char* end, std::vector<Slice>& tokens)
+{
+	const char* current = begin;
+	while (current != end)
+	{
+		if (*current == ' ' || *current == '\t')
+		{
+			++current;
+			continue;
+		}
+
+		const char* token_begin = current;
+		int depth = 0;
+		for (; current != end; ++current)
+		{
+			if (*current == '(') ++depth;
+			else if (*current == ')' && depth > 0) --depth;
+			else if (depth == 0 && (*current == ' ' || *current == '\t')) break;
+		}
+		tokens.push_back(Slice(token_begin, current));
+	}
+}
+
+void ScenarioLoader::tokenise(const std::string& line, std::vector<Slice>& tokens)
+{
+	tokenise(line.data(), line.data() + line.size(), tokens);
+}
+
+bool ScenarioLoader::parsePose(const Slice& token, geometry_msgs::Pose& pose)
+{
+	if (token.size() < 2 || *token.begin_ != '(' || *(token.end_ - 1) != ')')
+	{
+		return false;
+	}
+
+	float coordinates[3];
+	unsigned int nr_coordinates = 0;
+	const char* field_begin = token.begin_ + 1;
+	const char* coordinates_end = token.end_ - 1;
+	while (field_begin <= coordinates_end)
+	{
+		const char* field_end = std::find(field_begin, coordinates_end, ',');
+		Slice field(field_begin, field_end);
+
+		// Skip white space around the number and empty fields.
+		while (!field.empty() && (*field.begin_ == ' ' || *field.begin_ == '\t')) ++field.begin_;
+		while (!field.empty() && (*(field.end_ - 1) == ' ' || *(field.end_ - 1) == '\t')) --field.end_;
+		if (!field.empty())
+		{
+			if (nr_coordinates == 3 || !parseFloat(field, coordinates[nr_coordinates]))
+			{
+				return false;
+			}
+			++nr_coordinates;
+		}
+		field_begin = field_end + 1;
+	}
+
+	if (nr_coordinates != 3)
+	{
+		return false;
+	}
+
+	pose.position.x = coordinates[0];
+	pose.position.y = coordinates[1];
+	pose.position.z = coordinates[2];
+	pose.orientation.x = 0.0f;
+	pose.orientation.y = 0.0f;
+	pose.orientation.z = 0.0f;
+	pose.orientation.w = 1.0f;
+	return true;
+}
+
+bool ScenarioLoader::parseFloat(const Slice& token, float& value)
+{
+	// strtod needs a terminated string, numbers are short so they are copied to the stack.
+	char buffer[64];
+	if (token.empty() || token.size() >= sizeof(buffer))
+	{
+		return false;
+	}
+	memcpy(buffer, token.begin_, token.size());
+	buffer[token.size()] = '\0';
+
+	char* end;
+	value = strtod(buffer, &end);
+	return end == buffer + token.size();
+}
+
+};
@@ -0,0 +1,256 @@
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+
+#include <ros/serialization.h>
+
+#include "squirrel_planning_execution/ScenarioSnapshot.h"
+
+namespace KCL_rosplan
+{
+
+// Every snapshot starts with this string, followed by the version of the format.
+static const std::string g_snapshot_magic("KCL_SCENARIO_SNAPSHOT");
+static const uint32_t g_snapshot_version = 1;
+
+/**
+ * @return The md5sums of all messages in a snapshot, a snapshot can only be read if these match.
+ */
+static std::vector<std::string> getMessageMd5sums()
+{
+	std::vector<std::string> md5sums;
+	md5sums.push_back(ros::message_traits::md5sum<rosplan_knowledge_msgs::KnowledgeItem>());
+	md5sums.push_back(ros::message_traits::md5sum<geometry_msgs::PoseStamped>());
+	md5sums.push_back(ros::message_traits::md5sum<squirrel_object_perception_msgs::SceneObject>());
+	return md5sums;
+}
+
+void ScenarioSnapshot::clear()
+{
+	knowledge_.clear();
+	goals_.clear();
+	poses_.clear();
+	scene_objects_.clear();
+}
+
+bool ScenarioSnapshot::save(const std::string& file_name) const
+{
+	std::vector<std::string> md5sums = getMessageMd5sums();
+	std::vector<std::string> pose_names;
+	std::vector<geometry_msgs::PoseStamped> poses;
+	for (std::vector<NamedPose>::const_iterator ci = poses_.begin(); ci != poses_.end(); ++ci)
+	{
+		pose_names.push_back(ci->name_);
+		poses.push_back(ci->pose_);
+	}
+
+	uint32_t length = ros::serialization::serializationLength(g_snapshot_magic) +
+	                  ros::serialization::serializationLength(g_snapshot_version) +
+	                  ros::serialization::serializationLength(md5sums) +
+	                  ros::serialization::serializationLength(knowledge_) +
+	                  ros::serialization::serializationLength(goals_) +
+	                  ros::serialization::serializationLength(pose_names) +
+	                  ros::serialization::serializationLength(poses) +
+	                  ros::serialization::serializationLength(scene_objects_);
+
+	std::vector<uint8_t> buffer(length);
+	ros::serialization::OStream stream(&buffer[0], length);
+	ros::serialization::serialize(stream, g_snapshot_magic);
+	ros::serialization::serialize(stream, g_snapshot_version);
+	ros::serialization::serialize(stream, md5sums);
+	ros::serialization::serialize(stream, knowledge_);
+	ros::serialization::serialize(stream, goals_);
+	ros::serialization::serialize(stream, pose_names);
+	ros::serialization::serialize(stream, poses);
+	ros::serialization::serialize(stream, scene_objects_);
+
+	std::ofstream f(file_name.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!f.is_open() || !f.write(reinterpret_cast<const char*>(&buffer[0]), buffer.size()))
+	{
+		ROS_ERROR("KCL: (ScenarioSnapshot) Could not write the snapshot %s.", file_name.c_str());
+		return false;
+	}
+	ROS_INFO("KCL: (ScenarioSnapshot) Saved %zd knowledge items, %zd goals, %zd poses and %zd scene objects to %s (%u bytes).",
+	         knowledge_.size(), goals_.size(), poses_.size(), scene_objects_.size(), file_name.c_str(), length);
+	return true;
+}
+
+bool ScenarioSnapshot::load(const std::string& file_name)
+{
+	clear();
+
+	std::ifstream f(file_name.c_str(), std::ios::in | std::ios::binary);
+	if (!f.is_open())
+	{
+		ROS_ERROR("KCL: (ScenarioSnapshot) Could not open the snapshot %s.", file_name.c_str());
+		return false;
+	}
+	std::vector<uint8_t> buffer((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+
+	std::string magic;
+	uint32_t version = 0;
+	std::vector<std::string> md5sums;
+	std::vector<std::string> pose_names;
+	std::vector<geometry_msgs::PoseStamped> poses;
+	try
+	{
+		ros::serialization::IStream stream(buffer.empty() ? NULL : &buffer[0], buffer.size());
+		ros::serialization::deserialize(stream, magic);
+		if (magic != g_snapshot_magic)
+		{
+			ROS_ERROR("KCL: (ScenarioSnapshot) %s is not a snapshot.", file_name.c_str());
+			return false;
+		}
+
+		ros::serialization::deserialize(stream, version);
+		ros::serialization::deserialize(stream, md5sums);
+		if (version != g_snapshot_version || md5sums != getMessageMd5sums())
+		{
+			ROS_ERROR("KCL: (ScenarioSnapshot) %s was written by a different version, compile it again.", file_name.c_str());
+			return false;
+		}
+
+		ros::serialization::deserialize(stream, knowledge_);
+		ros::serialization::deserialize(stream, goals_);
+		ros::serialization::deserialize(stream, pose_names);
+		ros::serialization::deserialize(stream, poses);
+		ros::serialization::deserialize(stream, scene_objects_);
+	}
+	catch (ros::serialization::StreamOverrunException&)
+	{
+		ROS_ERROR("KCL: (ScenarioSnapshot) The snapshot %s is truncated.", file_name.c_str());
+		clear();
+		return false;
+	}
+
+	if (pose_names.size() != poses.size())
+	{
+		ROS_ERROR("KCL: (ScenarioSnapshot) The snapshot %s is corrupt.", file_name.c_str());
+		clear();
+		return false;
+	}
+	for (unsigned int i = 0; i < poses.size(); ++i)
+	{
+		poses_.push_back(NamedPose(pose_names[i], poses[i]));
+	}
+
+	ROS_INFO("KCL: (ScenarioSnapshot) Loaded %zd knowledge items, %zd goals, %zd poses and %zd scene objects from %s.",
+	         knowledge_.size(), goals_.size(), poses_.size(), scene_objects_.size(), file_name.c_str());
+	return true;
+}
+
+bool ScenarioSnapshot::isSnapshot(const std::string& file_name)
+{
+	// Compare the start of the file with the serialised magic string.
+	uint32_t length = ros::serialization::serializationLength(g_snapshot_magic);
+	std::vector<uint8_t> expected(length);
+	ros::serialization::OStream stream(&expected[0], length);
+	ros::serialization::serialize(stream, g_snapshot_magic);
+
+	std::vector<char> start(length);
+	std::ifstream f(file_name.c_str(), std::ios::in | std::ios::binary);
+	return f.read(&start[0], length) && std::equal(start.begin(), start.end(), expected.begin());
+}
+
+void ScenarioSnapshot::record(KnowledgeBase::Transaction& transaction) const
+{
+	for (std::vector<rosplan_knowledge_msgs::KnowledgeItem>::const_iterator ci = knowledge_.begin(); ci != knowledge_.end(); ++ci)
+	{
+		transaction.addKnowledgeItem(*ci, KnowledgeBase::KB_ADD_KNOWLEDGE);
+	}
+	for (std::vector<rosplan_knowledge_msgs::KnowledgeItem>::const_iterator ci = goals_.begin(); ci != goals_.end(); ++ci)
+	{
+		transaction.addKnowledgeItem(*ci, KnowledgeBase::KB_ADD_GOAL);
+	}
+}
+
+void ScenarioSnapshot::storePoses(mongodb_store::MessageStoreProxy& message_store) const
+{
+	// Upsert, so resetting a scenario does not leave the old poses behind under the same name.
+	ros::Time now = ros::Time::now();
+	for (std::vector<NamedPose>::const_iterator ci = poses_.begin(); ci != poses_.end(); ++ci)
+	{
+		geometry_msgs::PoseStamped pose = ci->pose_;
+		pose.header.stamp = now;
+		message_store.updateNamed(ci->name_, pose, true);
+	}
+	for (std::vector<squirrel_object_perception_msgs::SceneObject>::const_iterator ci = scene_objects_.begin(); ci != scene_objects_.end(); ++ci)
+	{
+		message_store.updateNamed(ci->id, *ci, true);
+	}
+}
+
+bool ScenarioSnapshot::restore(KnowledgeBase& knowledge_base, mongodb_store::MessageStoreProxy& message_store) const
+{
+	ros::WallTime start_time = ros::WallTime::now();
+
+	// Everything of the previous run is removed, otherwise its facts (robot_at, object_at, ...) would
+	// contradict the snapshot.
+	std::vector<rosplan_knowledge_msgs::KnowledgeItem> old_knowledge;
+	std::vector<rosplan_knowledge_msgs::KnowledgeItem> old_goals;
+	if (!knowledge_base.getAllInstances(old_knowledge) || !knowledge_base.getAllFacts(old_knowledge) ||
+	    !knowledge_base.getAllFunctions(old_knowledge) || !knowledge_base.getAllGoals(old_goals))
+	{
+		ROS_ERROR("KCL: (ScenarioSnapshot) Could not read the knowledge base, nothing is restored.");
+		return false;
+	}
+
+	KnowledgeBase::Transaction transaction(knowledge_base);
+	for (std::vector<rosplan_knowledge_msgs::KnowledgeItem>::const_iterator ci = old_goals.begin(); ci != old_goals.end(); ++ci)
+	{
+		transaction.removeKnowledgeItem(*ci, KnowledgeBase::KB_REMOVE_GOAL);
+	}
+	// Facts and functions come after the instances they use, so remove them first.
+	for (std::vector<rosplan_knowledge_msgs::KnowledgeItem>::const_reverse_iterator ci = old_knowledge.rbegin(); ci != old_knowledge.rend(); ++ci)
+	{
+		transaction.removeKnowledgeItem(*ci, KnowledgeBase::KB_REMOVE_KNOWLEDGE);
+	}
+	record(transaction);
+	if (!transaction.commit())
+	{
+		ROS_ERROR("KCL: (ScenarioSnapshot) The knowledge base did not accept the snapshot, the poses are not restored.");
+		return false;
+	}
+	storePoses(message_store);
+
+	ROS_INFO("KCL: (ScenarioSnapshot) Restored %zd knowledge items, %zd goals, %zd poses and %zd scene objects in %f seconds.",
+	         knowledge_.size(), goals_.size(), poses_.size(), scene_objects_.size(), (ros::WallTime::now() - start_time).toSec());
+	return true;
+}
+
+bool ScenarioSnapshot::dump(KnowledgeBase& knowledge_base, mongodb_store::MessageStoreProxy& message_store)
+{
+	clear();
+
+	// Instances first, so the facts and functions can be restored in the same order.
+	bool success = knowledge_base.getAllInstances(knowledge_);
+	size_t nr_instances = knowledge_.size();
+	success = knowledge_base.getAllFacts(knowledge_) && success;
+	success = knowledge_base.getAllFunctions(knowledge_) && success;
+	success = knowledge_base.getAllGoals(goals_) && success;
+
+	for (unsigned int i = 0; i < nr_instances; ++i)
+	{
+		const std::string& name = knowledge_[i].instance_name;
+		std::vector< boost::shared_ptr<geometry_msgs::PoseStamped> > results;
+		if (message_store.queryNamed<geometry_msgs::PoseStamped>(name, results) && !results.empty())
+		{
+			poses_.push_back(NamedPose(name, *results[0]));
+		}
+	}
+
+	std::vector< boost::shared_ptr<squirrel_object_perception_msgs::SceneObject> > scene_objects;
+	if (message_store.query<squirrel_object_perception_msgs::SceneObject>(scene_objects))
+	{
+		for (std::vector< boost::shared_ptr<squirrel_object_perception_msgs::SceneObject> >::const_iterator ci = scene_objects.begin(); ci != scene_objects.end(); ++ci)
+		{
+			scene_objects_.push_back(**ci);
+		}
+	}
+
+	ROS_INFO("KCL: (ScenarioSnapshot) Dumped %zd knowledge items, %zd goals, %zd poses and %zd scene objects.",
+	         knowledge_.size(), goals_.size(), poses_.size(), scene_objects_.size());
+	return success;
+}
+
+};
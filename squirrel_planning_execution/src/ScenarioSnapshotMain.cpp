@@ -0,0 +1,69 @@
+#include <string>
+#include <vector>
+
+#include <ros/ros.h>
+#include <mongodb_store/message_store.h>
+
+#include "squirrel_planning_execution/KnowledgeBase.h"
+#include "squirrel_planning_execution/ScenarioLoader.h"
+#include "squirrel_planning_execution/ScenarioSnapshot.h"
+
+/**
+ * Compile, restore and dump scenario snapshots (see ScenarioSnapshot).
+ *
+ * scenario_snapshot compile SCENARIO_FILE SNAPSHOT_FILE
+ *   Validate a scenario file and save everything it adds to the knowledge base and the message store. This
+ *   does not need a running ROS master. The snapshot can be given as /scenario_setup_file instead of the
+ *   scenario file.
+ *
+ * scenario_snapshot restore SNAPSHOT_FILE
+ *   Replace the content of the knowledge base with a snapshot, e.g. to reset a scenario between runs.
+ *
+ * scenario_snapshot dump SNAPSHOT_FILE
+ *   Save the current content of the knowledge base and the message store.
+ */
+int main(int argc, char **argv) {
+
+	ros::init(argc, argv, "scenario_snapshot", ros::init_options::AnonymousName);
+
+	std::vector<std::string> args;
+	ros::removeROSArgs(argc, argv, args);
+	bool valid = (args.size() == 4 && args[1] == "compile") ||
+	             (args.size() == 3 && (args[1] == "restore" || args[1] == "dump"));
+	if (!valid)
+	{
+		ROS_ERROR("KCL: (ScenarioSnapshot) Usage: scenario_snapshot compile SCENARIO_FILE SNAPSHOT_FILE | restore SNAPSHOT_FILE | dump SNAPSHOT_FILE");
+		return 1;
+	}
+
+	if (args[1] == "compile")
+	{
+		KCL_rosplan::Scenario scenario;
+		std::vector<std::string> errors;
+		if (!KCL_rosplan::ScenarioLoader::load(args[2], scenario, errors))
+		{
+			for (std::vector<std::string>::const_iterator ci = errors.begin(); ci != errors.end(); ++ci)
+			{
+				ROS_ERROR("KCL: (ScenarioSnapshot) %s", ci->c_str());
+			}
+			return 1;
+		}
+
+		KCL_rosplan::ScenarioSnapshot snapshot;
+		KCL_rosplan::ScenarioLoader::compile(scenario, snapshot);
+		return snapshot.save(args[3]) ? 0 : 1;
+	}
+
+	ros::NodeHandle nh;
+	mongodb_store::MessageStoreProxy message_store(nh);
+	KCL_rosplan::KnowledgeBase knowledge_base(nh, message_store);
+	KCL_rosplan::ScenarioSnapshot snapshot;
+
+	if (args[1] == "restore")
+	{
+		return snapshot.load(args[2]) && snapshot.restore(knowledge_base, message_store) ? 0 : 1;
+	}
+
+	bool success = snapshot.dump(knowledge_base, message_store);
+	return snapshot.save(args[2]) && success ? 0 : 1;
+}
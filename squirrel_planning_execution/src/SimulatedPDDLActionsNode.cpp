@@ -1,6 +1,7 @@
 #include <ros/ros.h>
 #include <mongodb_store/message_store.h>
 #include <squirrel_planning_execution/KnowledgeBase.h>
+#include <squirrel_planning_execution/WaypointIndex.h>
 
 #include "pddl_actions/GotoPDDLAction.h"
 #include "pddl_actions/ExploreWaypointPDDLAction.h"
@@ -27,6 +28,8 @@ int main(int argc, char **argv) {
 	ros::NodeHandle nh("~");
 	mongodb_store::MessageStoreProxy message_store(nh);
 	KCL_rosplan::KnowledgeBase knowledge_base(nh, message_store);
+	KCL_rosplan::WaypointIndex waypoint_index(message_store);
+	waypoint_index.watchKnowledgeBase(nh, "object");
 
 	bool goto_waypoint,
 	     explore_waypoint,
@@ -70,7 +73,7 @@ int main(int argc, char **argv) {
 	KCL_rosplan::TakeObjectPDDLAction* take_object_action;
 	KCL_rosplan::ChildrenPDDLAction* children_action;
 	KCL_rosplan::ExamineObjectInHandPDDLAction* examine_object_in_hand_action;
-	KCL_rosplan::SimulatedObservePDDLAction observe_actions(nh);
+	KCL_rosplan::SimulatedObservePDDLAction observe_actions(nh, waypoint_index);
 	KCL_rosplan::FollowChildPDDLAction* follow_child_action;
 	KCL_rosplan::ChildGiveObjectToRobotPDDLAction* child_give_object_to_robot_action;
 	KCL_rosplan::ChildPickupPDDLAction* child_pickup_action;
@@ -83,7 +86,7 @@ int main(int argc, char **argv) {
 
 	if(explore_waypoint) {
 		ROS_INFO("KCL: (SimulatedPDDLActionsNode) Simulating: explore_waypoint");
-		explore_waypoint_action = new KCL_rosplan::ExploreWaypointPDDLAction(nh, message_store, knowledge_base);
+		explore_waypoint_action = new KCL_rosplan::ExploreWaypointPDDLAction(nh, waypoint_index, knowledge_base);
 	}
 	if(clear_object) {
 		ROS_INFO("KCL: (SimulatedPDDLActionsNode) Simulating: clear_object");
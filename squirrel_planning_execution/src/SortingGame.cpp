@@ -6,6 +6,7 @@
 #include <sstream>
 
 #include "squirrel_planning_execution/SortingGame.h"
+#include "squirrel_planning_execution/WaypointIndex.h"
 #include "pddl_actions/ShedKnowledgePDDLAction.h"
 #include "pddl_actions/FinaliseClassificationPDDLAction.h"
 #include "pddl_actions/NextTurnPDDLAction.h"
@@ -460,11 +461,15 @@ namespace KCL_rosplan {
 		// create PDDL action subscriber
 		KCL_rosplan::SortingGame sorting_game(nh);
 		
+		mongodb_store::MessageStoreProxy message_store(nh);
+		KCL_rosplan::WaypointIndex waypoint_index(message_store);
+		waypoint_index.watchKnowledgeBase(nh, "object");
+
 		// Setup all the simulated actions.
 		KCL_rosplan::ShedKnowledgePDDLAction shed_knowledge_action(nh);
 		KCL_rosplan::FinaliseClassificationPDDLAction finalise_classify_action(nh);
 		KCL_rosplan::NextTurnPDDLAction next_turn_action(nh);
-		KCL_rosplan::SimulatedObservePDDLAction simulated_observe_action(nh);
+		KCL_rosplan::SimulatedObservePDDLAction simulated_observe_action(nh, waypoint_index);
 
 		// Lets start the planning process.
 		std::string data_path;
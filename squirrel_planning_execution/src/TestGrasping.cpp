@@ -127,7 +127,7 @@ int main(int argc, char **argv) {
 	nh.getParam("/scenario_setup_file", config_file);
 	
 	KCL_rosplan::ConfigReader reader(nh, message_store);
-	reader.readConfigurationFile(config_file);
+	if (!reader.readConfigurationFile(config_file)) exit(-1);
 
 	initialiseKnowledgeBase(knowledge_base, message_store);
 	startPlanning(nh);
@@ -2,11 +2,15 @@
 #include <occupancy_grid_utils/ray_tracer.h>
 #include <occupancy_grid_utils/coordinate_conversions.h>
 #include <visualization_msgs/MarkerArray.h>
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
 //#include <tf/Quaternion.h>
 //#include <tf/Vector3.h>
 
 #include <stdlib.h>
 #include <time.h> 
+#include <algorithm>
+#include <limits>
 #define VIEWCONE_DEBUG_ENABLED
 
 namespace KCL_rosplan {
@@ -17,12 +21,126 @@ ViewConeGenerator::ViewConeGenerator(ros::NodeHandle& node_handle, const std::st
 	navigation_grid_sub_ = node_handle.subscribe(topic_name, 1, &ViewConeGenerator::storeNavigationGrid, this);
 	rivz_pub_ = node_handle.advertise<visualization_msgs::MarkerArray>("/vis/view_cones", 1000);
 	srand(time(NULL));
+	
+	// A fixed seed makes the generated view cones reproducible.
+	int seed = time(NULL);
+	node_handle.param("/squirrel_planning_execution/view_cone_seed", seed, seed);
+	random_state_ = seed;
+	
+	int nr_threads = boost::thread::hardware_concurrency();
+	node_handle.param("/squirrel_planning_execution/view_cone_threads", nr_threads, nr_threads);
+	nr_threads_ = std::max(1, nr_threads);
 }
 
 void ViewConeGenerator::storeNavigationGrid(const nav_msgs::OccupancyGrid::ConstPtr& msg)
 {
+	const nav_msgs::MapMetaData& old_info = last_received_occupancy_grid_msgs_.info;
+	const nav_msgs::MapMetaData& new_info = msg->info;
+	bool same_layout = has_received_occupancy_grid_ &&
+	                   old_info.width == new_info.width && old_info.height == new_info.height && old_info.resolution == new_info.resolution &&
+	                   old_info.origin.position.x == new_info.origin.position.x && old_info.origin.position.y == new_info.origin.position.y &&
+	                   last_received_occupancy_grid_msgs_.data.size() == msg->data.size();
+	
+	// Only the columns that contain a changed cell have to be processed again.
+	int min_x = 0;
+	int max_x = (int)new_info.width - 1;
+	if (same_layout) {
+		min_x = new_info.width;
+		max_x = -1;
+		for (unsigned int i = 0; i < msg->data.size(); ++i) {
+			if (msg->data[i] != last_received_occupancy_grid_msgs_.data[i]) {
+				int x = i % new_info.width;
+				min_x = std::min(min_x, x);
+				max_x = std::max(max_x, x);
+			}
+		}
+	} else {
+		column_distance_.assign(new_info.width * new_info.height, -1.0f);
+		obstacle_distance_.assign(new_info.width * new_info.height, 0.0f);
+	}
+	
 	last_received_occupancy_grid_msgs_ = *msg;
 	has_received_occupancy_grid_ = true;
+	
+	if (min_x <= max_x) {
+		updateDistanceTransform(min_x, max_x);
+	}
+}
+
+void ViewConeGenerator::updateDistanceTransform(unsigned int min_x, unsigned int max_x)
+{
+	const nav_msgs::OccupancyGrid& grid = last_received_occupancy_grid_msgs_;
+	unsigned int width = grid.info.width;
+	unsigned int height = grid.info.height;
+	unsigned int size = std::max(width, height);
+	
+	std::vector<float> f(size);
+	std::vector<float> d(size);
+	std::vector<int> v(size);
+	std::vector<float> z(size + 1);
+	
+	// First pass: the distance to the nearest obstacle in the same column. A row only has to be processed again
+	// in the second pass if one of its column distances changed.
+	std::vector<bool> changed_rows(height, false);
+	for (unsigned int x = min_x; x <= max_x; ++x) {
+		for (unsigned int y = 0; y < height; ++y) {
+			f[y] = grid.data[x + y * width] != 0 ? 0.0f : 1e20f;
+		}
+		distanceTransform(f, height, d, v, z);
+		for (unsigned int y = 0; y < height; ++y) {
+			if (column_distance_[x + y * width] != d[y]) {
+				column_distance_[x + y * width] = d[y];
+				changed_rows[y] = true;
+			}
+		}
+	}
+	
+	// Second pass: combine the column distances along each row.
+	unsigned int nr_changed_rows = 0;
+	for (unsigned int y = 0; y < height; ++y) {
+		if (!changed_rows[y]) {
+			continue;
+		}
+		++nr_changed_rows;
+		for (unsigned int x = 0; x < width; ++x) {
+			f[x] = column_distance_[x + y * width];
+		}
+		distanceTransform(f, width, d, v, z);
+		for (unsigned int x = 0; x < width; ++x) {
+			obstacle_distance_[x + y * width] = d[x];
+		}
+	}
+	
+	ROS_INFO("(ViewConeGenerator) Updated the obstacle distances of columns [%u, %u] and %u rows.", min_x, max_x, nr_changed_rows);
+}
+
+void ViewConeGenerator::distanceTransform(const std::vector<float>& f, unsigned int n, std::vector<float>& d, std::vector<int>& v, std::vector<float>& z) const
+{
+	// Compute the lower envelope of the parabolas rooted at (q, f(q)), see Felzenszwalb and Huttenlocher,
+	// "Distance Transforms of Sampled Functions".
+	int k = 0;
+	v[0] = 0;
+	z[0] = -std::numeric_limits<float>::max();
+	z[1] = std::numeric_limits<float>::max();
+	for (int q = 1; q < (int)n; ++q) {
+		float s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2 * q - 2 * v[k]);
+		while (s <= z[k]) {
+			--k;
+			s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2 * q - 2 * v[k]);
+		}
+		++k;
+		v[k] = q;
+		z[k] = s;
+		z[k + 1] = std::numeric_limits<float>::max();
+	}
+	
+	k = 0;
+	for (int q = 0; q < (int)n; ++q) {
+		while (z[k + 1] < q) {
+			++k;
+		}
+		d[q] = (q - v[k]) * (q - v[k]) + f[v[k]];
+	}
 }
 
 void ViewConeGenerator::createViewCones(std::vector<geometry_msgs::Pose>& poses, const std::vector<tf::Vector3>& bounding_box, unsigned int max_view_cones, int occupancy_threshold, float fov, float view_distance, unsigned int sample_size, float safe_distance)
@@ -72,212 +190,45 @@ void ViewConeGenerator::createViewCones(std::vector<geometry_msgs::Pose>& poses,
 	
 	for (unsigned int i = 0; i < max_view_cones; ++i) {
 		//ROS_INFO("(ViewConeGenerator) Process view cone: %d.", i);
-		// First we generate a bunch of random view cones and rate them.
-		geometry_msgs::Pose best_pose;
-		std::vector<occupancy_grid_utils::Cell> best_visible_cells;
+		// First we generate a bunch of random view cones and rate them. The candidates are sampled on this
+		// thread, so they only depend on the seed and not on how the scoring is divided over the threads.
+		std::vector<ViewConeCandidate> candidates(sample_size);
 		for (unsigned int j = 0; j < sample_size; ++j) {
-//			int grid_x = ((float)rand() / (float)RAND_MAX) * last_received_occupancy_grid_msgs_.info.width;
-//			int grid_y = ((float)rand() / (float)RAND_MAX) * last_received_occupancy_grid_msgs_.info.height;
-			geometry_msgs::Point p;
-			p.x = ((float)rand() / (float)RAND_MAX) * (max_point.x - min_point.x) + min_point.x;
-			p.y = ((float)rand() / (float)RAND_MAX) * (max_point.y - min_point.y) + min_point.y;
-			p.z = 0;
-			
-			occupancy_grid_utils::Cell c = occupancy_grid_utils::pointCell(last_received_occupancy_grid_msgs_.info, p);
-			int grid_x = c.x;
-			int grid_y = c.y;
-			
-			// Check if this cell point is not too close to any obstacles.
-			if (isBlocked(p, safe_distance)) {
-//				  ROS_INFO("(ViewConeGenerator) Blocked!");
-				continue;
-			}
-			
-			/*
-			// Check if this point falls within the bounding box.
-			{
-				bool falls_within_bounded_box = true;
-				char sign = 0;
-				tf::Vector3 cell_point(p.x, p.y, p.z);
-				for (int i = 0; i < bounding_box.size(); ++i)
-				{
-					const tf::Vector3& v1 = bounding_box[i];
-					const tf::Vector3& v2 = bounding_box[i + 1];
-					
-					tf::Vector3 cross_product = (cell_point - v1).cross(v2 - v1);
-					
-					if (sign == 0)
-					{
-						sign = cross_product.z() > 0 ? 1 : -1;
-					}
-					else
-					{
-						if (sign == -1 && cross_product.z() > 0 ||
-							 sign == 1 && cross_product.z() < 0)
-						{
-							falls_within_bounded_box = false;
-							break;
-						}
-					}
-				}
-				
-				if (!falls_within_bounded_box)
-				{
-					ROS_INFO("(ViewConeGenerator) Not within bounding box!");
-					continue;
-				}
-			}
-			*/
-			float yaw = ((float)rand() / (float)RAND_MAX) * 2 * M_PI;
-			
-			//ROS_INFO("(ViewConeGenerator) Sample cone: (%d, %d) %f.", grid_x, grid_y, yaw);
-			//ROS_INFO("(ViewConeGenerator) Sample cone: (%f, %f) %f.", p.x, p.y, yaw);
-			
-			geometry_msgs::Pose pose;
-			pose.position = p;
-			
-			tf::Quaternion q;
-			q.setEulerZYX(yaw, 0.0f, 0.0f);
-
-			pose.orientation.x = q.getX();
-			pose.orientation.y = q.getY();
-			pose.orientation.z = q.getZ();
-			pose.orientation.w = q.getW();
-			
-			// Calculate the triangle points encompasses the area that is viewed.
-			tf::Vector3 view_point(p.x, p.y, p.z);
-			
-			tf::Vector3 v0(view_distance, 0.0f, 0.0f);
-			v0 = v0.rotate(tf::Vector3(0.0f, 0.0f, 1.0f), yaw);
-			
-			//ROS_INFO("(ViewConeGenerator) Viewing direction: (%f, %f, %f).", v0.x(), v0.y(), v0.z());
-			
-			tf::Vector3 v0_normalised = v0.normalized();
-			
-			//ROS_INFO("(ViewConeGenerator) Viewing direction (normalised): (%f, %f, %f).", v0_normalised.x(), v0_normalised.y(), v0_normalised.z());
-			
-			tf::Vector3 v1 = v0;
-			v1 = v1.rotate(tf::Vector3(0.0f, 0.0f, 1.0f), fov / 2.0f);
-			v1 = v1.normalize();
-			
-			//ROS_INFO("(ViewConeGenerator) V1 (normalised): (%f, %f, %f).", v1.x(), v1.y(), v1.z());
-			
-			float length = v0.length() / v0_normalised.dot(v1);
-			v1 *= length;
-			v1 += view_point;
-			
-			//ROS_INFO("(ViewConeGenerator) V1 (actual): (%f, %f, %f); length = %f.", v1.x(), v1.y(), v1.z(), length);
-			
-			tf::Vector3 v2 = v0;
-			v2 = v2.rotate(tf::Vector3(0.0f, 0.0f, 1.0f), -fov / 2.0f);
-			v2 = v2.normalize();
-			//ROS_INFO("(ViewConeGenerator) V2 (normalised): (%f, %f, %f).", v2.x(), v2.y(), v2.z());
-			
-			length = v0.length() / v0_normalised.dot(v2);
-			v2 *= length;
-			v2 += view_point;
-			//ROS_INFO("(ViewConeGenerator) V2 (actual): (%f, %f, %f); length = %f.", v2.x(), v2.y(), v2.z(), length);
-			
-			//ROS_INFO("(ViewConeGenerator) Triangle: (%f, %f, %f), (%f, %f, %f), (%f, %f, %f).", p.x, p.y, p.z, v1.x(), v1.y(), v1.z(), v2.x(), v2.y(), v2.z());
-			
-			// The triangle now is view_point, v1, v2, we use a flood algorithm to determine which cells
-			// are inside the viewing cone.
-			//occupancy_grid_utils::Cell cell = occupancy_grid_utils::pointCell(last_received_occupancy_grid_msgs_.info, );
-			
-			std::vector<occupancy_grid_utils::Cell> open_list;
-			open_list.push_back(c);
-			
-			std::vector<occupancy_grid_utils::Cell> complete_list;
-			
-			while (open_list.size() > 0) {
-				
-				occupancy_grid_utils::Cell cell = open_list[0];
-				open_list.erase(open_list.begin());
-				
-				// Check if the cell is inside the triangle.
-				geometry_msgs::Point cell_centre_point = occupancy_grid_utils::cellCenter(last_received_occupancy_grid_msgs_.info, cell);
-				tf::Vector3 cell_point(cell_centre_point.x, cell_centre_point.y, cell_centre_point.z);
-				
-				tf::Vector3 cross_v1 = (cell_point - v1).cross(v2 - v1);
-				tf::Vector3 cross_v2 = (cell_point - v2).cross(view_point - v2);
-				tf::Vector3 cross_v3 = (cell_point - view_point).cross(v1 - view_point);
-				
-				// If both cross produces have the same sign we are good.
-				bool is_in_triangle = false;
-				if ((cross_v1.z() > 0 && cross_v2.z() > 0 && cross_v3.z() > 0) ||
-					(cross_v1.z() < 0 && cross_v2.z() < 0 && cross_v3.z() < 0) ||
-					(cell.x == c.x && cell.y == c.y)) {
-					is_in_triangle = true;
-				}
-				
-				if (!is_in_triangle) {
-					continue;
-				}
-				
-				// Make sure this cell was not already added.
-				bool has_been_processed = false;
-				for (std::vector<occupancy_grid_utils::Cell>::const_iterator ci = complete_list.begin(); ci != complete_list.end(); ++ci) {
-					const occupancy_grid_utils::Cell& completed_cell = *ci;
-					if (completed_cell.x == cell.x && completed_cell.y == cell.y) {
-						has_been_processed = true;
-						break;
-					}
-				}
-				
-				if (has_been_processed) {
-					continue;
-				}
-				
-				complete_list.push_back(cell);
-				
-				// Add its children to the list.
-				occupancy_grid_utils::Cell new_cell;
-				for (int x = cell.x - 1; x < cell.x + 2; ++x) {
-					for (int y = cell.y - 1; y < cell.y + 2; ++y) {
-						if (x > -1 && x + 1 < last_received_occupancy_grid_msgs_.info.width &&
-							y > -1 && y + 1 < last_received_occupancy_grid_msgs_.info.height)
-						{
-							new_cell.x = x;
-							new_cell.y = y;
-							open_list.push_back(new_cell);
-						}
-					}
-				}
-			}
-			
-			//ROS_INFO("(ViewConeGenerator) Finished flood algorithm, %d cells in view.", complete_list.size());
-			
-			// Next we determine which of these cell points are visible from 'view_point'.
-			std::vector<occupancy_grid_utils::Cell> visible_cells;
-			for (std::vector<occupancy_grid_utils::Cell>::const_iterator ci = complete_list.begin(); ci != complete_list.end(); ++ci) {
-				
-				const occupancy_grid_utils::Cell& cell = *ci;
-				// Don't count cells that have already been processed.
-				if (processed_cells[cell.x + cell.y * last_received_occupancy_grid_msgs_.info.width]) {
-					continue;
-				}
-				
-				geometry_msgs::Point point = occupancy_grid_utils::cellCenter(last_received_occupancy_grid_msgs_.info, *ci);
-				
-				if (canConnect(point, p, occupancy_threshold)) {
-					visible_cells.push_back(cell);
-				}
+			ViewConeCandidate& candidate = candidates[j];
+			candidate.position.x = ((float)rand_r(&random_state_) / (float)RAND_MAX) * (max_point.x - min_point.x) + min_point.x;
+			candidate.position.y = ((float)rand_r(&random_state_) / (float)RAND_MAX) * (max_point.y - min_point.y) + min_point.y;
+			candidate.position.z = 0;
+			candidate.yaw = ((float)rand_r(&random_state_) / (float)RAND_MAX) * 2 * M_PI;
+		}
+		
+		unsigned int next_candidate = 0;
+		boost::mutex next_candidate_mutex;
+		unsigned int nr_threads = std::min(nr_threads_, sample_size);
+		if (nr_threads <= 1) {
+			scoreViewConesWorker(candidates, next_candidate, next_candidate_mutex, processed_cells, occupancy_threshold, fov, view_distance, safe_distance);
+		} else {
+			boost::thread_group workers;
+			for (unsigned int t = 0; t < nr_threads; ++t) {
+				workers.create_thread(boost::bind(&ViewConeGenerator::scoreViewConesWorker, this, boost::ref(candidates), boost::ref(next_candidate), boost::ref(next_candidate_mutex), boost::cref(processed_cells), occupancy_threshold, fov, view_distance, safe_distance));
 			}
-			
-			//ROS_INFO("(ViewConeGenerator) Finished checking visibility, %d cells actually visible.", visible_cells.size());
-			
-			// Check if this is the best view cone thus far.
-			if (visible_cells.size() > best_visible_cells.size()) {
-				best_pose = pose;
-				best_visible_cells = visible_cells;
-				
-				tf::Quaternion q(best_pose.orientation.x, best_pose.orientation.y, best_pose.orientation.z, best_pose.orientation.w);
-				float best_yaw = tf::getYaw(q);
-				
-				//ROS_INFO("(ViewConeGenerator) Best new pose(%f, %f, %f), yaw=%f (actual=%f) with %d cells.", best_pose.position.x, best_pose.position.y, best_pose.position.z, best_yaw, yaw, visible_cells.size());
+			workers.join_all();
+		}
+		
+		// Pick the best candidate in sample order, so ties are broken the same way however the work was divided.
+		ViewConeCandidate* best_candidate = NULL;
+		for (std::vector<ViewConeCandidate>::iterator ci = candidates.begin(); ci != candidates.end(); ++ci) {
+			if (best_candidate == NULL || (*ci).visible_cells.size() > best_candidate->visible_cells.size()) {
+				best_candidate = &*ci;
 			}
 		}
 		
+		geometry_msgs::Pose best_pose;
+		std::vector<occupancy_grid_utils::Cell> best_visible_cells;
+		if (best_candidate != NULL) {
+			best_pose = best_candidate->pose;
+			best_visible_cells.swap(best_candidate->visible_cells);
+		}
+		
 		if (best_visible_cells.size() < 100) {
 			//ROS_INFO("(ViewConeGenerator) No good poses found!");
 			continue;
@@ -304,6 +255,210 @@ void ViewConeGenerator::createViewCones(std::vector<geometry_msgs::Pose>& poses,
 	visualiseViewCones(poses, view_distance, fov);
 }
 
+void ViewConeGenerator::scoreViewConesWorker(std::vector<ViewConeCandidate>& candidates, unsigned int& next_candidate, boost::mutex& next_candidate_mutex, const std::vector<bool>& processed_cells, int occupancy_threshold, float fov, float view_distance, float safe_distance) const
+{
+	VisibilityField visibility_field;
+	while (true) {
+		unsigned int candidate;
+		{
+			boost::mutex::scoped_lock lock(next_candidate_mutex);
+			if (next_candidate >= candidates.size()) {
+				return;
+			}
+			candidate = next_candidate++;
+		}
+		scoreViewCone(candidates[candidate], visibility_field, processed_cells, occupancy_threshold, fov, view_distance, safe_distance);
+	}
+}
+
+void ViewConeGenerator::scoreViewCone(ViewConeCandidate& candidate, VisibilityField& visibility_field, const std::vector<bool>& processed_cells, int occupancy_threshold, float fov, float view_distance, float safe_distance) const
+{
+	const geometry_msgs::Point& p = candidate.position;
+	float yaw = candidate.yaw;
+	occupancy_grid_utils::Cell c = occupancy_grid_utils::pointCell(last_received_occupancy_grid_msgs_.info, p);
+	int grid_x = c.x;
+	int grid_y = c.y;
+	
+	// Check if this cell point is not too close to any obstacles.
+	if (isBlocked(p, safe_distance)) {
+//				  ROS_INFO("(ViewConeGenerator) Blocked!");
+		return;
+	}
+	
+	/*
+	// Check if this point falls within the bounding box.
+	{
+		bool falls_within_bounded_box = true;
+		char sign = 0;
+		tf::Vector3 cell_point(p.x, p.y, p.z);
+		for (int i = 0; i < bounding_box.size(); ++i)
+		{
+			const tf::Vector3& v1 = bounding_box[i];
+			const tf::Vector3& v2 = bounding_box[i + 1];
+			
+			tf::Vector3 cross_product = (cell_point - v1).cross(v2 - v1);
+			
+			if (sign == 0)
+			{
+				sign = cross_product.z() > 0 ? 1 : -1;
+			}
+			else
+			{
+				if (sign == -1 && cross_product.z() > 0 ||
+					 sign == 1 && cross_product.z() < 0)
+				{
+					falls_within_bounded_box = false;
+					break;
+				}
+			}
+		}
+		
+		if (!falls_within_bounded_box)
+		{
+			ROS_INFO("(ViewConeGenerator) Not within bounding box!");
+			continue;
+		}
+	}
+	*/
+	
+	//ROS_INFO("(ViewConeGenerator) Sample cone: (%d, %d) %f.", grid_x, grid_y, yaw);
+	//ROS_INFO("(ViewConeGenerator) Sample cone: (%f, %f) %f.", p.x, p.y, yaw);
+	
+	geometry_msgs::Pose& pose = candidate.pose;
+	pose.position = p;
+	
+	tf::Quaternion q;
+	q.setEulerZYX(yaw, 0.0f, 0.0f);
+
+	pose.orientation.x = q.getX();
+	pose.orientation.y = q.getY();
+	pose.orientation.z = q.getZ();
+	pose.orientation.w = q.getW();
+	
+	// Calculate the triangle points encompasses the area that is viewed.
+	tf::Vector3 view_point(p.x, p.y, p.z);
+	
+	tf::Vector3 v0(view_distance, 0.0f, 0.0f);
+	v0 = v0.rotate(tf::Vector3(0.0f, 0.0f, 1.0f), yaw);
+	
+	//ROS_INFO("(ViewConeGenerator) Viewing direction: (%f, %f, %f).", v0.x(), v0.y(), v0.z());
+	
+	tf::Vector3 v0_normalised = v0.normalized();
+	
+	//ROS_INFO("(ViewConeGenerator) Viewing direction (normalised): (%f, %f, %f).", v0_normalised.x(), v0_normalised.y(), v0_normalised.z());
+	
+	tf::Vector3 v1 = v0;
+	v1 = v1.rotate(tf::Vector3(0.0f, 0.0f, 1.0f), fov / 2.0f);
+	v1 = v1.normalize();
+	
+	//ROS_INFO("(ViewConeGenerator) V1 (normalised): (%f, %f, %f).", v1.x(), v1.y(), v1.z());
+	
+	float length = v0.length() / v0_normalised.dot(v1);
+	v1 *= length;
+	v1 += view_point;
+	
+	//ROS_INFO("(ViewConeGenerator) V1 (actual): (%f, %f, %f); length = %f.", v1.x(), v1.y(), v1.z(), length);
+	
+	tf::Vector3 v2 = v0;
+	v2 = v2.rotate(tf::Vector3(0.0f, 0.0f, 1.0f), -fov / 2.0f);
+	v2 = v2.normalize();
+	//ROS_INFO("(ViewConeGenerator) V2 (normalised): (%f, %f, %f).", v2.x(), v2.y(), v2.z());
+	
+	length = v0.length() / v0_normalised.dot(v2);
+	v2 *= length;
+	v2 += view_point;
+	//ROS_INFO("(ViewConeGenerator) V2 (actual): (%f, %f, %f); length = %f.", v2.x(), v2.y(), v2.z(), length);
+	
+	//ROS_INFO("(ViewConeGenerator) Triangle: (%f, %f, %f), (%f, %f, %f), (%f, %f, %f).", p.x, p.y, p.z, v1.x(), v1.y(), v1.z(), v2.x(), v2.y(), v2.z());
+	
+	// The triangle now is view_point, v1, v2, rasterise it to determine which cells are inside the viewing cone.
+	std::vector<occupancy_grid_utils::Cell> complete_list;
+	getViewConeCells(view_point, v1, v2, c, complete_list);
+	
+	//ROS_INFO("(ViewConeGenerator) Finished rasterising, %d cells in view.", complete_list.size());
+	
+	// Next we determine which of these cell points are visible from 'view_point'.
+	float radius = std::max((v1 - view_point).length(), (v2 - view_point).length()) / last_received_occupancy_grid_msgs_.info.resolution;
+	visibility_field.compute(last_received_occupancy_grid_msgs_, c, (unsigned int)ceil(radius) + 1, occupancy_threshold, yaw, fov);
+	
+	std::vector<occupancy_grid_utils::Cell>& visible_cells = candidate.visible_cells;
+	for (std::vector<occupancy_grid_utils::Cell>::const_iterator ci = complete_list.begin(); ci != complete_list.end(); ++ci) {
+		
+		const occupancy_grid_utils::Cell& cell = *ci;
+		// Don't count cells that have already been processed.
+		if (processed_cells[cell.x + cell.y * last_received_occupancy_grid_msgs_.info.width]) {
+			continue;
+		}
+		
+		if (visibility_field.isVisible(cell)) {
+			visible_cells.push_back(cell);
+		}
+	}
+	
+	//ROS_INFO("(ViewConeGenerator) Finished checking visibility, %d cells actually visible.", visible_cells.size());
+}
+
+void ViewConeGenerator::getViewConeCells(const tf::Vector3& view_point, const tf::Vector3& v1, const tf::Vector3& v2, const occupancy_grid_utils::Cell& view_cell, std::vector<occupancy_grid_utils::Cell>& cells) const
+{
+	const nav_msgs::MapMetaData& info = last_received_occupancy_grid_msgs_.info;
+	
+	// Work in grid coordinates, where cell (x, y) spans [x, x + 1) x [y, y + 1).
+	tf::Vector3 corners[3];
+	corners[0] = view_point;
+	corners[1] = v1;
+	corners[2] = v2;
+	float min_y = std::numeric_limits<float>::max();
+	float max_y = -std::numeric_limits<float>::max();
+	for (int i = 0; i < 3; ++i) {
+		corners[i].setX((corners[i].x() - info.origin.position.x) / info.resolution);
+		corners[i].setY((corners[i].y() - info.origin.position.y) / info.resolution);
+		min_y = std::min(min_y, (float)corners[i].y());
+		max_y = std::max(max_y, (float)corners[i].y());
+	}
+	
+	// Only cells whose centre lies inside the triangle are part of the view cone, so every row is sampled at the
+	// centre of its cells and the span between the edges it crosses is added.
+	int first_row = std::max(0, (int)ceil(min_y - 0.5f));
+	int last_row = std::min((int)info.height - 1, (int)floor(max_y - 0.5f));
+	bool contains_view_cell = false;
+	occupancy_grid_utils::Cell cell;
+	for (int y = first_row; y <= last_row; ++y) {
+		float row_centre = y + 0.5f;
+		float min_x = std::numeric_limits<float>::max();
+		float max_x = -std::numeric_limits<float>::max();
+		for (int i = 0; i < 3; ++i) {
+			const tf::Vector3& a = corners[i];
+			const tf::Vector3& b = corners[(i + 1) % 3];
+			if ((a.y() <= row_centre && row_centre < b.y()) || (b.y() <= row_centre && row_centre < a.y())) {
+				float x = a.x() + (row_centre - a.y()) * (b.x() - a.x()) / (b.y() - a.y());
+				min_x = std::min(min_x, x);
+				max_x = std::max(max_x, x);
+			}
+		}
+		
+		if (min_x > max_x) {
+			continue;
+		}
+		
+		int first_column = std::max(0, (int)ceil(min_x - 0.5f));
+		int last_column = std::min((int)info.width - 1, (int)floor(max_x - 0.5f));
+		if (y == view_cell.y && first_column <= view_cell.x && view_cell.x <= last_column) {
+			contains_view_cell = true;
+		}
+		
+		cell.y = y;
+		for (int x = first_column; x <= last_column; ++x) {
+			cell.x = x;
+			cells.push_back(cell);
+		}
+	}
+	
+	// The cell the robot stands on is always in view, even when the apex of the triangle misses its centre.
+	if (!contains_view_cell && view_cell.x >= 0 && view_cell.x < (int)info.width && view_cell.y >= 0 && view_cell.y < (int)info.height) {
+		cells.push_back(view_cell);
+	}
+}
+
 void ViewConeGenerator::getNextColour(float& r, float& g, float& b) const
 {
 	static float h_org = 360.0f * ((float)rand() / (float)RAND_MAX);
@@ -502,26 +657,17 @@ void ViewConeGenerator::visualiseViewCones(const std::vector<geometry_msgs::Pose
 	rivz_pub_.publish(marker_array);
 }
 
-bool ViewConeGenerator::canConnect(const geometry_msgs::Point& w1, const geometry_msgs::Point& w2, int occupancy_threshold)
+bool ViewConeGenerator::isBlocked(const geometry_msgs::Point& point, float min_distance) const
 {
-	occupancy_grid_utils::RayTraceIterRange ray_range = occupancy_grid_utils::rayTrace(last_received_occupancy_grid_msgs_.info, w1, w2, true, true);
-	for (occupancy_grid_utils::RayTraceIterator i = ray_range.first; i != ray_range.second; ++i)
-	{
-		const occupancy_grid_utils::Cell& cell = *i;
-
-		// Check if this cell is occupied.
-		if (cell.x + cell.y * last_received_occupancy_grid_msgs_.info.width < last_received_occupancy_grid_msgs_.data.size() && cell.x + cell.y * last_received_occupancy_grid_msgs_.info.width >= 0 && last_received_occupancy_grid_msgs_.data[cell.x + cell.y * last_received_occupancy_grid_msgs_.info.width] > occupancy_threshold)
-		{
-			return false;
-		}
+	const nav_msgs::MapMetaData& info = last_received_occupancy_grid_msgs_.info;
+	occupancy_grid_utils::Cell centre = occupancy_grid_utils::pointCell(info, point);
+	if (centre.x >= 0 && centre.y >= 0 && centre.x < (int)info.width && centre.y < (int)info.height &&
+	    obstacle_distance_.size() == info.width * info.height) {
+		float max_cells = min_distance / info.resolution;
+		return obstacle_distance_[centre.x + centre.y * info.width] <= max_cells * max_cells;
 	}
 	
-	return true;
-}
-
-
-bool ViewConeGenerator::isBlocked(const geometry_msgs::Point& point, float min_distance) const
-{
+	// Points outside the grid are checked by sampling the disc around them.
 	for (float x = -min_distance - last_received_occupancy_grid_msgs_.info.resolution; x < min_distance + last_received_occupancy_grid_msgs_.info.resolution; x += last_received_occupancy_grid_msgs_.info.resolution)
 	{
 		for (float y = -min_distance - last_received_occupancy_grid_msgs_.info.resolution; y < min_distance + last_received_occupancy_grid_msgs_.info.resolution; y += last_received_occupancy_grid_msgs_.info.resolution)
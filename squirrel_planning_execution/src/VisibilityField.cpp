@@ -0,0 +1,149 @@
+#include <squirrel_planning_execution/VisibilityField.h>
+
+namespace KCL_rosplan {
+
+// Maps the (column, row) offsets of the scan onto the grid for each of the eight octants.
+static const int g_octant_multipliers[4][8] = {
+	{ 1,  0,  0, -1, -1,  0,  0,  1 },
+	{ 0,  1, -1,  0,  0, -1,  1,  0 },
+	{ 0,  1,  1,  0,  0, -1, -1,  0 },
+	{ 1,  0,  0,  1, -1,  0,  0, -1 }
+};
+
+VisibilityField::VisibilityField()
+	: grid_(NULL), radius_(0), occupancy_threshold_(0), generation_(0)
+{
+
+}
+
+void VisibilityField::compute(const nav_msgs::OccupancyGrid& grid, const occupancy_grid_utils::Cell& origin, unsigned int radius, int occupancy_threshold, float direction, float fov)
+{
+	grid_ = &grid;
+	origin_ = origin;
+	radius_ = radius;
+	occupancy_threshold_ = occupancy_threshold;
+
+	unsigned int window_size = (2 * radius + 1) * (2 * radius + 1);
+	++generation_;
+	if (visible_.size() != window_size || generation_ == 0) {
+		visible_.assign(window_size, 0);
+		generation_ = 1;
+	}
+
+	if (origin.x < 0 || origin.y < 0 || origin.x >= (int)grid.info.width || origin.y >= (int)grid.info.height) {
+		return;
+	}
+	visible_[getWindowIndex(origin.x, origin.y)] = generation_;
+
+	for (int octant = 0; octant < 8; ++octant) {
+		int xx = g_octant_multipliers[0][octant];
+		int xy = g_octant_multipliers[1][octant];
+		int yx = g_octant_multipliers[2][octant];
+		int yy = g_octant_multipliers[3][octant];
+
+		// Skip the octants that do not overlap with the field of view, each octant spans PI / 4 radians
+		// around the bisector of its two edges.
+		if (fov < 2 * M_PI) {
+			float diagonal = atan2(-yx - yy, -xx - xy);
+			float axis = atan2(-yy, -xy);
+			float bisector = atan2(sin(diagonal) + sin(axis), cos(diagonal) + cos(axis));
+			float difference = fabs(atan2(sin(bisector - direction), cos(bisector - direction)));
+			if (difference > M_PI / 8.0f + fov / 2.0f + 1e-3f) {
+				continue;
+			}
+		}
+
+		castLight(1, 1.0f, 0.0f, xx, xy, yx, yy);
+	}
+}
+
+void VisibilityField::castLight(int row, float start_slope, float end_slope, int xx, int xy, int yx, int yy)
+{
+	if (start_slope < end_slope) {
+		return;
+	}
+
+	int radius_squared = radius_ * radius_;
+	float next_start_slope = start_slope;
+	for (int distance = row; distance <= radius_; ++distance) {
+		bool blocked = false;
+		int dy = -distance;
+		for (int dx = -distance; dx <= 0; ++dx) {
+			float left_slope = (dx - 0.5f) / (dy + 0.5f);
+			float right_slope = (dx + 0.5f) / (dy - 0.5f);
+			if (start_slope < right_slope) {
+				continue;
+			} else if (end_slope > left_slope) {
+				break;
+			}
+
+			// Only cells whose centre is lit are visible, like a ray traced from the centre of the origin.
+			int x = origin_.x + dx * xx + dy * xy;
+			int y = origin_.y + dx * yx + dy * yy;
+			int window_index = getWindowIndex(x, y);
+			float centre_slope = (float)dx / (float)dy;
+			if (centre_slope <= start_slope && centre_slope >= end_slope &&
+			    dx * dx + dy * dy <= radius_squared && window_index != -1 &&
+			    x >= 0 && y >= 0 && x < (int)grid_->info.width && y < (int)grid_->info.height) {
+				visible_[window_index] = generation_;
+			}
+
+			bool opaque = isOpaque(x, y);
+			if (blocked) {
+				if (opaque) {
+					next_start_slope = right_slope;
+					continue;
+				}
+				blocked = false;
+				start_slope = next_start_slope;
+			} else if (opaque && distance < radius_) {
+				// This cell casts a shadow, scan the part of the next row that is still lit before it.
+				blocked = true;
+				castLight(distance + 1, start_slope, left_slope, xx, xy, yx, yy);
+				next_start_slope = right_slope;
+			}
+		}
+
+		if (blocked) {
+			break;
+		}
+	}
+}
+
+bool VisibilityField::isOpaque(int x, int y) const
+{
+	if (x < 0 || y < 0 || x >= (int)grid_->info.width || y >= (int)grid_->info.height) {
+		return true;
+	}
+	return grid_->data[x + y * grid_->info.width] > occupancy_threshold_;
+}
+
+int VisibilityField::getWindowIndex(int x, int y) const
+{
+	int window_x = x - origin_.x + radius_;
+	int window_y = y - origin_.y + radius_;
+	int window_width = 2 * radius_ + 1;
+	if (window_x < 0 || window_y < 0 || window_x >= window_width || window_y >= window_width) {
+		return -1;
+	}
+	return window_x + window_y * window_width;
+}
+
+bool VisibilityField::isVisible(const occupancy_grid_utils::Cell& cell) const
+{
+	if (grid_ == NULL) {
+		return false;
+	}
+	int window_index = getWindowIndex(cell.x, cell.y);
+	return window_index != -1 && visible_[window_index] == generation_;
+}
+
+bool VisibilityField::isVisible(const geometry_msgs::Point& point) const
+{
+	if (grid_ == NULL) {
+		return false;
+	}
+	return isVisible(occupancy_grid_utils::pointCell(grid_->info, point));
+}
+
+};
@@ -0,0 +1,327 @@
+#include <algorithm>
+#include <cmath>
+
+#include "squirrel_planning_execution/WaypointIndex.h"
+
+namespace KCL_rosplan
+{
+
+WaypointIndex::WaypointIndex(mongodb_store::MessageStoreProxy& message_store, float cell_size)
+	: message_store_(&message_store), cell_size_(cell_size > 0 ? cell_size : 1.0f)
+{
+
+}
+
+std::string WaypointIndex::insertNamed(const std::string& name, const geometry_msgs::PoseStamped& pose, const std::string& category)
+{
+	std::string id(message_store_->insertNamed(name, pose));
+	boost::mutex::scoped_lock lock(entries_mutex_);
+	set(name, pose.pose.position, category);
+	return id;
+}
+
+std::string WaypointIndex::insertNamed(const std::string& name, const squirrel_object_perception_msgs::SceneObject& scene_object, const std::string& category)
+{
+	std::string id(message_store_->insertNamed(name, scene_object));
+	boost::mutex::scoped_lock lock(entries_mutex_);
+	set(name, scene_object.pose.position, category);
+	return id;
+}
+
+bool WaypointIndex::updateNamed(const std::string& name, const geometry_msgs::PoseStamped& pose, const std::string& category)
+{
+	bool updated = message_store_->updateNamed(name, pose);
+	boost::mutex::scoped_lock lock(entries_mutex_);
+	if (updated)
+	{
+		set(name, pose.pose.position, category);
+	}
+	else
+	{
+		// We no longer know what the message store holds, fetch it again when it is needed.
+		erase(name);
+	}
+	return updated;
+}
+
+bool WaypointIndex::updateNamed(const std::string& name, const squirrel_object_perception_msgs::SceneObject& scene_object, const std::string& category)
+{
+	bool updated = message_store_->updateNamed(name, scene_object);
+	boost::mutex::scoped_lock lock(entries_mutex_);
+	if (updated)
+	{
+		set(name, scene_object.pose.position, category);
+	}
+	else
+	{
+		erase(name);
+	}
+	return updated;
+}
+
+bool WaypointIndex::loadPose(const std::string& name, const std::string& category)
+{
+	{
+		boost::mutex::scoped_lock lock(entries_mutex_);
+		if (entries_.find(name) != entries_.end())
+		{
+			return true;
+		}
+	}
+
+	std::vector< boost::shared_ptr<geometry_msgs::PoseStamped> > results;
+	if (!message_store_->queryNamed<geometry_msgs::PoseStamped>(name, results) || results.empty())
+	{
+		ROS_ERROR("KCL: (WaypointIndex) Could not fetch the pose of %s from the message store.", name.c_str());
+		return false;
+	}
+
+	boost::mutex::scoped_lock lock(entries_mutex_);
+	set(name, results[0]->pose.position, category);
+	return true;
+}
+
+bool WaypointIndex::loadSceneObject(const std::string& name, const std::string& category)
+{
+	{
+		boost::mutex::scoped_lock lock(entries_mutex_);
+		if (entries_.find(name) != entries_.end())
+		{
+			return true;
+		}
+	}
+
+	std::vector< boost::shared_ptr<squirrel_object_perception_msgs::SceneObject> > results;
+	if (!message_store_->queryNamed<squirrel_object_perception_msgs::SceneObject>(name, results) || results.empty())
+	{
+		ROS_ERROR("KCL: (WaypointIndex) Could not fetch the scene object %s from the message store.", name.c_str());
+		return false;
+	}
+
+	boost::mutex::scoped_lock lock(entries_mutex_);
+	set(name, results[0]->pose.position, category);
+	return true;
+}
+
+void WaypointIndex::watchKnowledgeBase(ros::NodeHandle& node_handle, const std::string& category)
+{
+	{
+		boost::mutex::scoped_lock lock(entries_mutex_);
+		watched_category_ = category;
+	}
+	knowledge_changed_sub_ = node_handle.subscribe("/kcl_rosplan/knowledge_base_changed", 1000, &KCL_rosplan::WaypointIndex::knowledgeChangedCallback, this);
+}
+
+void WaypointIndex::knowledgeChangedCallback(const rosplan_knowledge_msgs::KnowledgeItem::ConstPtr& msg)
+{
+	boost::mutex::scoped_lock lock(entries_mutex_);
+	if (msg->knowledge_type == rosplan_knowledge_msgs::KnowledgeItem::INSTANCE)
+	{
+		eraseWatched(msg->instance_name);
+		return;
+	}
+
+	// A fact like (object_at toy1 wp3) tells us toy1 might have moved.
+	for (std::vector<diagnostic_msgs::KeyValue>::const_iterator ci = msg->values.begin(); ci != msg->values.end(); ++ci)
+	{
+		eraseWatched(ci->value);
+	}
+}
+
+void WaypointIndex::eraseWatched(const std::string& name)
+{
+	std::map<std::string, Entry>::const_iterator ci = entries_.find(name);
+	if (ci != entries_.end() && ci->second.category_ == watched_category_)
+	{
+		erase(name);
+	}
+}
+
+void WaypointIndex::remove(const std::string& name)
+{
+	boost::mutex::scoped_lock lock(entries_mutex_);
+	erase(name);
+}
+
+void WaypointIndex::clear()
+{
+	boost::mutex::scoped_lock lock(entries_mutex_);
+	entries_.clear();
+	cells_.clear();
+}
+
+bool WaypointIndex::getPosition(const std::string& name, geometry_msgs::Point& position) const
+{
+	boost::mutex::scoped_lock lock(entries_mutex_);
+	std::map<std::string, Entry>::const_iterator ci = entries_.find(name);
+	if (ci == entries_.end())
+	{
+		return false;
+	}
+	position = ci->second.position_;
+	return true;
+}
+
+void WaypointIndex::findNearest(const geometry_msgs::Point& position, unsigned int k, const std::string& category, std::vector<std::string>& names) const
+{
+	names.clear();
+	boost::mutex::scoped_lock lock(entries_mutex_);
+	if (k == 0 || cells_.empty())
+	{
+		return;
+	}
+
+	// Visit the cells in rings of growing size around the cell of the position. After ring r has been visited,
+	// every pose we have not seen yet is at least r cells away from the position.
+	Cell center = getCell(position);
+	int first_ring = std::max(std::max(min_cell_.first - center.first, center.first - max_cell_.first),
+	                          std::max(min_cell_.second - center.second, center.second - max_cell_.second));
+	first_ring = std::max(first_ring, 0);
+	int last_ring = std::max(std::max(center.first - min_cell_.first, max_cell_.first - center.first),
+	                         std::max(center.second - min_cell_.second, max_cell_.second - center.second));
+
+	std::vector<std::pair<float, std::string> > candidates;
+	for (int r = first_ring; r <= last_ring; ++r)
+	{
+		int min_x = std::max(center.first - r, min_cell_.first);
+		int max_x = std::min(center.first + r, max_cell_.first);
+		int min_y = std::max(center.second - r + 1, min_cell_.second);
+		int max_y = std::min(center.second + r - 1, max_cell_.second);
+
+		// The top and bottom rows of the ring.
+		for (int x = min_x; x <= max_x; ++x)
+		{
+			addCandidates(Cell(x, center.second - r), position, category, candidates);
+			if (r > 0)
+			{
+				addCandidates(Cell(x, center.second + r), position, category, candidates);
+			}
+		}
+
+		// The left and right columns of the ring, without the corners.
+		for (int y = min_y; y <= max_y; ++y)
+		{
+			addCandidates(Cell(center.first - r, y), position, category, candidates);
+			addCandidates(Cell(center.first + r, y), position, category, candidates);
+		}
+
+		if (candidates.size() >= k)
+		{
+			std::nth_element(candidates.begin(), candidates.begin() + (k - 1), candidates.end());
+			float covered_distance = r * cell_size_;
+			if (candidates[k - 1].first <= covered_distance * covered_distance)
+			{
+				break;
+			}
+		}
+	}
+
+	std::sort(candidates.begin(), candidates.end());
+	for (unsigned int i = 0; i < candidates.size() && i < k; ++i)
+	{
+		names.push_back(candidates[i].second);
+	}
+}
+
+void WaypointIndex::findWithinRadius(const geometry_msgs::Point& position, float radius, const std::string& category, std::vector<std::string>& names) const
+{
+	names.clear();
+	boost::mutex::scoped_lock lock(entries_mutex_);
+	if (radius < 0 || cells_.empty())
+	{
+		return;
+	}
+
+	geometry_msgs::Point corner = position;
+	corner.x -= radius;
+	corner.y -= radius;
+	Cell min_cell = getCell(corner);
+	corner.x += 2 * radius;
+	corner.y += 2 * radius;
+	Cell max_cell = getCell(corner);
+
+	std::vector<std::pair<float, std::string> > candidates;
+	for (int x = std::max(min_cell.first, min_cell_.first); x <= std::min(max_cell.first, max_cell_.first); ++x)
+	{
+		for (int y = std::max(min_cell.second, min_cell_.second); y <= std::min(max_cell.second, max_cell_.second); ++y)
+		{
+			addCandidates(Cell(x, y), position, category, candidates);
+		}
+	}
+
+	std::sort(candidates.begin(), candidates.end());
+	for (std::vector<std::pair<float, std::string> >::const_iterator ci = candidates.begin(); ci != candidates.end() && ci->first <= radius * radius; ++ci)
+	{
+		names.push_back(ci->second);
+	}
+}
+
+void WaypointIndex::set(const std::string& name, const geometry_msgs::Point& position, const std::string& category)
+{
+	erase(name);
+
+	Entry& entry = entries_[name];
+	entry.position_ = position;
+	entry.category_ = category;
+	entry.cell_ = getCell(position);
+
+	if (cells_.empty())
+	{
+		min_cell_ = entry.cell_;
+		max_cell_ = entry.cell_;
+	}
+	else
+	{
+		min_cell_.first = std::min(min_cell_.first, entry.cell_.first);
+		min_cell_.second = std::min(min_cell_.second, entry.cell_.second);
+		max_cell_.first = std::max(max_cell_.first, entry.cell_.first);
+		max_cell_.second = std::max(max_cell_.second, entry.cell_.second);
+	}
+	cells_[entry.cell_].push_back(name);
+}
+
+void WaypointIndex::erase(const std::string& name)
+{
+	std::map<std::string, Entry>::iterator i = entries_.find(name);
+	if (i == entries_.end())
+	{
+		return;
+	}
+
+	// The bounds are not shrunk, they only need to contain all non empty cells.
+	std::map<Cell, std::vector<std::string> >::iterator cell = cells_.find(i->second.cell_);
+	cell->second.erase(std::find(cell->second.begin(), cell->second.end(), name));
+	if (cell->second.empty())
+	{
+		cells_.erase(cell);
+	}
+	entries_.erase(i);
+}
+
+WaypointIndex::Cell WaypointIndex::getCell(const geometry_msgs::Point& position) const
+{
+	return Cell((int)std::floor(position.x / cell_size_), (int)std::floor(position.y / cell_size_));
+}
+
+void WaypointIndex::addCandidates(const Cell& cell, const geometry_msgs::Point& position, const std::string& category, std::vector<std::pair<float, std::string> >& candidates) const
+{
+	std::map<Cell, std::vector<std::string> >::const_iterator ci = cells_.find(cell);
+	if (ci == cells_.end())
+	{
+		return;
+	}
+
+	for (std::vector<std::string>::const_iterator name = ci->second.begin(); name != ci->second.end(); ++name)
+	{
+		const Entry& entry = entries_.find(*name)->second;
+		if (entry.category_ != category)
+		{
+			continue;
+		}
+		float dx = entry.position_.x - position.x;
+		float dy = entry.position_.y - position.y;
+		candidates.push_back(std::make_pair(dx * dx + dy * dy, *name));
+	}
+}
+
+};
@@ -0,0 +1,357 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <cstdio>
+#include <cstdlib>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include <squirrel_planning_execution/ContingentTidyPDDLGenerator.h>
+#include <squirrel_planning_execution/ContingentStrategicClassifyPDDLGenerator.h>
+#include <squirrel_planning_execution/ContingentTacticalClassifyPDDLGenerator.h>
+#include <squirrel_planning_execution/ClassicalTidyPDDLGenerator.h>
+#include <squirrel_planning_execution/PlanToSensePDDLGenerator.h>
+#include <squirrel_planning_execution/PlanToAskPDDLGenerator.h>
+#include <squirrel_planning_execution/RecommenderSystem.h>
+
+/**
+ * Measures how the PDDL generators scale with the size of the problem, without any ROS services. For every size
+ * from 1 to N a scenario is synthesised with that many objects, half as many boxes (at least two) and two waypoints
+ * near every object and box. Every generator is then run on it in a child process, which records:
+ * - the wall time of createPDDL;
+ * - the peak resident set size of the child, which includes the memory it shares with this process;
+ * - the number of bytes of the domain and problem files.
+ * Once a generator times out or fails, it is not run for larger sizes. The results are written to
+ * generator_scaling.csv and generator_scaling.json in the output directory, the PDDL files are kept there as well.
+ *
+ * Usage: generator_scaling_benchmark <output directory> [max size = 10] [timeout in seconds = 60]
+ */
+
+// The mappings the action servers pass to the generators.
+struct Scenario
+{
+	unsigned int nr_objects;
+	unsigned int nr_boxes;
+	std::string robot_location;
+	std::map<std::string, std::string> object_to_location;
+	std::map<std::string, std::string> object_to_type;
+	std::map<std::string, std::string> box_to_location;
+	std::map<std::string, std::string> box_to_type;
+	std::map<std::string, std::vector<std::string> > near_object_locations; // Object location -> waypoints near it.
+	std::map<std::string, std::vector<std::string> > near_box_locations;    // Box location -> waypoints near it.
+	std::vector<std::string> observation_locations;                        // Waypoints to classify the first object from.
+};
+
+typedef void (*GenerateFunction)(const Scenario& scenario, const std::string& path, const std::string& domain_file, const std::string& problem_file);
+
+struct Generator
+{
+	const char* name;
+	GenerateFunction generate;
+};
+
+struct Measurement
+{
+	std::string generator;
+	unsigned int size;
+	unsigned int nr_objects;
+	unsigned int nr_boxes;
+	std::string status;
+	double time_ms;
+	long peak_rss_kb;
+	long domain_bytes;
+	long problem_bytes;
+};
+
+Scenario createScenario(unsigned int size)
+{
+	Scenario scenario;
+	scenario.nr_objects = size;
+	scenario.nr_boxes = size / 2 < 2 ? 2 : size / 2;
+	scenario.robot_location = "kenny_wp";
+
+	for (unsigned int i = 0; i < scenario.nr_boxes; ++i)
+	{
+		std::stringstream box, location, type;
+		box << "box" << i;
+		location << "box" << i << "_wp";
+		type << "type" << i;
+		scenario.box_to_location[box.str()] = location.str();
+		scenario.box_to_type[box.str()] = type.str();
+		for (unsigned int j = 0; j < 2; ++j)
+		{
+			std::stringstream near_location;
+			near_location << location.str() << "_near" << j;
+			scenario.near_box_locations[location.str()].push_back(near_location.str());
+		}
+	}
+
+	for (unsigned int i = 0; i < scenario.nr_objects; ++i)
+	{
+		std::stringstream object, location, type;
+		object << "object" << i;
+		location << "object" << i << "_wp";
+		type << "type" << i % scenario.nr_boxes;
+		scenario.object_to_location[object.str()] = location.str();
+		scenario.object_to_type[object.str()] = type.str();
+		for (unsigned int j = 0; j < 2; ++j)
+		{
+			std::stringstream near_location;
+			near_location << location.str() << "_near" << j;
+			scenario.near_object_locations[location.str()].push_back(near_location.str());
+		}
+
+		std::stringstream observation_location;
+		observation_location << "observation" << i << "_wp";
+		scenario.observation_locations.push_back(observation_location.str());
+	}
+	return scenario;
+}
+
+/**
+ * Create a chain of (belongs_in object box0) facts, one for every object. Only the true branch is followed, such
+ * that the number of belief states grows linearly with the number of objects.
+ */
+KCL_rosplan::FactObserveTree& createFactObserveTree(const Scenario& scenario)
+{
+	const KCL_rosplan::Type& object_type = KCL_rosplan::Type::createType("object", NULL);
+	const KCL_rosplan::Type& box_type = KCL_rosplan::Type::createType("box", NULL);
+	std::vector<const KCL_rosplan::Type*> types;
+	types.push_back(&object_type);
+	types.push_back(&box_type);
+	const KCL_rosplan::Predicate& belongs_in = KCL_rosplan::Predicate::getPredicate("belongs_in", types);
+	const KCL_rosplan::Object& box = KCL_rosplan::Object::createObject(scenario.box_to_location.begin()->first, box_type);
+
+	// The child process exits after generating the files, so the tree is never freed.
+	KCL_rosplan::FactObserveTree* root = NULL;
+	KCL_rosplan::FactObserveTree* last = NULL;
+	for (std::map<std::string, std::string>::const_iterator ci = scenario.object_to_location.begin(); ci != scenario.object_to_location.end(); ++ci)
+	{
+		std::vector<const KCL_rosplan::Object*> objects;
+		objects.push_back(&KCL_rosplan::Object::createObject(ci->first, object_type));
+		objects.push_back(&box);
+
+		KCL_rosplan::FactObserveTree* node = new KCL_rosplan::FactObserveTree(KCL_rosplan::Fact::getFact(belongs_in, objects));
+		if (last == NULL) root = node;
+		else last->true_branch_ = node;
+		last = node;
+	}
+	return *root;
+}
+
+void generateContingentTidy(const Scenario& scenario, const std::string& path, const std::string& domain_file, const std::string& problem_file)
+{
+	std::map<std::string, std::vector<std::string> > near_object_locations = scenario.near_object_locations;
+	KCL_rosplan::ContingentTidyPDDLGenerator::createPDDL(path, domain_file, problem_file, scenario.robot_location, scenario.object_to_location, near_object_locations, scenario.object_to_type, scenario.box_to_location, scenario.box_to_type, KCL_rosplan::EXPANDED_BELIEF_ENCODING);
+}
+
+void generateContingentTidyLifted(const Scenario& scenario, const std::string& path, const std::string& domain_file, const std::string& problem_file)
+{
+	std::map<std::string, std::vector<std::string> > near_object_locations = scenario.near_object_locations;
+	KCL_rosplan::ContingentTidyPDDLGenerator::createPDDL(path, domain_file, problem_file, scenario.robot_location, scenario.object_to_location, near_object_locations, scenario.object_to_type, scenario.box_to_location, scenario.box_to_type, KCL_rosplan::LIFTED_BELIEF_ENCODING);
+}
+
+void generateContingentStrategicClassify(const Scenario& scenario, const std::string& path, const std::string& domain_file, const std::string& problem_file)
+{
+	KCL_rosplan::ContingentStrategicClassifyPDDLGenerator::createPDDL(path, domain_file, problem_file, scenario.robot_location, scenario.object_to_location, scenario.near_object_locations, 1, KCL_rosplan::EXPANDED_BELIEF_ENCODING);
+}
+
+void generateContingentStrategicClassifyLifted(const Scenario& scenario, const std::string& path, const std::string& domain_file, const std::string& problem_file)
+{
+	KCL_rosplan::ContingentStrategicClassifyPDDLGenerator::createPDDL(path, domain_file, problem_file, scenario.robot_location, scenario.object_to_location, scenario.near_object_locations, 1, KCL_rosplan::LIFTED_BELIEF_ENCODING);
+}
+
+void generateContingentTacticalClassify(const Scenario& scenario, const std::string& path, const std::string& domain_file, const std::string& problem_file)
+{
+	const std::string& object = scenario.object_to_location.begin()->first;
+	const std::string& object_location = scenario.object_to_location.begin()->second;
+	KCL_rosplan::ContingentTacticalClassifyPDDLGenerator::createPDDL(path, domain_file, problem_file, scenario.robot_location, scenario.observation_locations, object, object_location);
+}
+
+void generateClassicalTidy(const Scenario& scenario, const std::string& path, const std::string& domain_file, const std::string& problem_file)
+{
+	std::map<std::string, std::vector<std::string> > object_waypoints;
+	for (std::map<std::string, std::string>::const_iterator ci = scenario.object_to_location.begin(); ci != scenario.object_to_location.end(); ++ci)
+	{
+		object_waypoints[ci->first] = scenario.near_object_locations.find(ci->second)->second;
+	}
+	KCL_rosplan::ClassicalTidyPDDLGenerator::createPDDL(path, domain_file, problem_file, scenario.robot_location, scenario.object_to_location, object_waypoints, object_waypoints, scenario.object_to_type, scenario.box_to_location, scenario.box_to_type, scenario.near_box_locations);
+}
+
+void generatePlanToSense(const Scenario& scenario, const std::string& path, const std::string& domain_file, const std::string& problem_file)
+{
+	KCL_rosplan::PlanToSensePDDLGenerator::createPDDL(createFactObserveTree(scenario), path, domain_file, problem_file, scenario.robot_location, scenario.object_to_location, scenario.box_to_location);
+}
+
+void generatePlanToAsk(const Scenario& scenario, const std::string& path, const std::string& domain_file, const std::string& problem_file)
+{
+	KCL_rosplan::PlanToAskPDDLGenerator::createPDDL(createFactObserveTree(scenario), path, domain_file, problem_file, scenario.robot_location, scenario.object_to_location, scenario.box_to_location);
+}
+
+long getFileSize(const std::string& file_name)
+{
+	struct stat file_status;
+	if (stat(file_name.c_str(), &file_status) != 0)
+	{
+		return -1;
+	}
+	return file_status.st_size;
+}
+
+/**
+ * Run a generator in a child process.
+ * @param generator The generator to run.
+ * @param size The size of the scenario.
+ * @param path The directory where the PDDL files are written, ending with a '/'.
+ * @param timeout The number of seconds after which the child is stopped.
+ * @return The measurement, its status is "ok", "timeout" or "failed".
+ */
+Measurement measure(const Generator& generator, unsigned int size, const std::string& path, unsigned int timeout)
+{
+	Scenario scenario = createScenario(size);
+	Measurement measurement;
+	measurement.generator = generator.name;
+	measurement.size = size;
+	measurement.nr_objects = scenario.nr_objects;
+	measurement.nr_boxes = scenario.nr_boxes;
+	measurement.time_ms = -1;
+	measurement.peak_rss_kb = -1;
+	measurement.domain_bytes = -1;
+	measurement.problem_bytes = -1;
+
+	std::stringstream ss;
+	ss << generator.name << "_" << size << "_domain.pddl";
+	std::string domain_file = ss.str();
+	ss.str(std::string());
+	ss << generator.name << "_" << size << "_problem.pddl";
+	std::string problem_file = ss.str();
+
+	// Start without the files of a previous run.
+	std::remove((path + domain_file).c_str());
+	std::remove((path + problem_file).c_str());
+
+	int result_pipe[2];
+	if (pipe(result_pipe) != 0)
+	{
+		measurement.status = "failed";
+		return measurement;
+	}
+
+	pid_t pid = fork();
+	if (pid == 0)
+	{
+		// The generators are chatty, only keep the warnings and errors.
+		close(result_pipe[0]);
+		if (std::freopen("/dev/null", "w", stdout) == NULL) _exit(1);
+		alarm(timeout);
+
+		boost::posix_time::ptime start = boost::posix_time::microsec_clock::local_time();
+		generator.generate(scenario, path, domain_file, problem_file);
+		double time_ms = (boost::posix_time::microsec_clock::local_time() - start).total_microseconds() / 1000.0;
+
+		_exit(write(result_pipe[1], &time_ms, sizeof(time_ms)) == sizeof(time_ms) ? 0 : 1);
+	}
+	close(result_pipe[1]);
+
+	double time_ms = -1;
+	bool has_time = pid > 0 && read(result_pipe[0], &time_ms, sizeof(time_ms)) == sizeof(time_ms);
+	close(result_pipe[0]);
+
+	int status = 0;
+	struct rusage usage;
+	if (pid < 0 || wait4(pid, &status, 0, &usage) != pid)
+	{
+		measurement.status = "failed";
+		return measurement;
+	}
+
+	if (WIFSIGNALED(status) && WTERMSIG(status) == SIGALRM) measurement.status = "timeout";
+	else if (!has_time || !WIFEXITED(status) || WEXITSTATUS(status) != 0) measurement.status = "failed";
+	else measurement.status = "ok";
+
+	measurement.time_ms = time_ms;
+	measurement.peak_rss_kb = usage.ru_maxrss;
+	measurement.domain_bytes = getFileSize(path + domain_file);
+	measurement.problem_bytes = getFileSize(path + problem_file);
+	return measurement;
+}
+
+void writeCSV(const std::string& file_name, const std::vector<Measurement>& measurements)
+{
+	std::ofstream file(file_name.c_str());
+	file << "generator,size,objects,boxes,status,time_ms,peak_rss_kb,domain_bytes,problem_bytes" << std::endl;
+	for (std::vector<Measurement>::const_iterator ci = measurements.begin(); ci != measurements.end(); ++ci)
+	{
+		const Measurement& m = *ci;
+		file << m.generator << "," << m.size << "," << m.nr_objects << "," << m.nr_boxes << "," << m.status << "," << m.time_ms << "," << m.peak_rss_kb << "," << m.domain_bytes << "," << m.problem_bytes << std::endl;
+	}
+}
+
+void writeJSON(const std::string& file_name, const std::vector<Measurement>& measurements)
+{
+	std::ofstream file(file_name.c_str());
+	file << "[" << std::endl;
+	for (std::vector<Measurement>::const_iterator ci = measurements.begin(); ci != measurements.end(); ++ci)
+	{
+		const Measurement& m = *ci;
+		file << "\t{\"generator\": \"" << m.generator << "\", \"size\": " << m.size << ", \"objects\": " << m.nr_objects << ", \"boxes\": " << m.nr_boxes << ", \"status\": \"" << m.status << "\", \"time_ms\": " << m.time_ms << ", \"peak_rss_kb\": " << m.peak_rss_kb << ", \"domain_bytes\": " << m.domain_bytes << ", \"problem_bytes\": " << m.problem_bytes << "}";
+		file << (ci + 1 == measurements.end() ? "" : ",") << std::endl;
+	}
+	file << "]" << std::endl;
+}
+
+int main(int argc, char **argv) {
+
+	if (argc < 2)
+	{
+		std::cerr << "Usage: " << argv[0] << " <output directory> [max size = 10] [timeout in seconds = 60]" << std::endl;
+		return 1;
+	}
+
+	std::string path = argv[1];
+	if (path[path.size() - 1] != '/') path += '/';
+	unsigned int max_size = 10;
+	unsigned int timeout = 60;
+	if (argc > 2) max_size = ::atoi(argv[2]);
+	if (argc > 3) timeout = ::atoi(argv[3]);
+
+	const Generator generators[] = {
+		{ "contingent_tidy", &generateContingentTidy },
+		{ "contingent_tidy_lifted", &generateContingentTidyLifted },
+		{ "contingent_strategic_classify", &generateContingentStrategicClassify },
+		{ "contingent_strategic_classify_lifted", &generateContingentStrategicClassifyLifted },
+		{ "contingent_tactical_classify", &generateContingentTacticalClassify },
+		{ "classical_tidy", &generateClassicalTidy },
+		{ "plan_to_sense", &generatePlanToSense },
+		{ "plan_to_ask", &generatePlanToAsk }
+	};
+	unsigned int nr_generators = sizeof(generators) / sizeof(generators[0]);
+
+	std::vector<Measurement> measurements;
+	for (unsigned int i = 0; i < nr_generators; ++i)
+	{
+		for (unsigned int size = 1; size <= max_size; ++size)
+		{
+			Measurement measurement = measure(generators[i], size, path, timeout);
+			measurements.push_back(measurement);
+			std::cerr << measurement.generator << " size " << size << ": " << measurement.status << ", " << measurement.time_ms << " ms, " << measurement.peak_rss_kb << " kB peak RSS, " << measurement.domain_bytes << " + " << measurement.problem_bytes << " bytes." << std::endl;
+
+			if (measurement.status != "ok")
+			{
+				break;
+			}
+		}
+	}
+
+	writeCSV(path + "generator_scaling.csv", measurements);
+	writeJSON(path + "generator_scaling.json", measurements);
+	return 0;
+}
@@ -1,6 +1,7 @@
 #include <map>
 #include <vector>
 #include <iostream>
+#include <boost/bind.hpp>
 #include <sstream>
 
 #include <std_msgs/Int8.h>
@@ -31,6 +32,22 @@ namespace KCL_rosplan {
 		dispatch_sub_ = node_handle.subscribe("/kcl_rosplan/action_dispatch", 1000, &KCL_rosplan::ExamineAreaPDDLAction::dispatchCallback, this);
 		
 		node_handle.getParam("/squirrel_planning_execution/simulated", is_simulated_);
+		
+		double plan_timeout = 0;
+		node_handle.getParam("/squirrel_planning_execution/sub_plan_timeout", plan_timeout);
+		plan_timeout_ = ros::Duration(plan_timeout);
+		
+		// The expanded encoding grows quadratically with the number of objects, so only a few objects can be 
+		// examined per plan. The lifted encoding does not have this problem.
+		std::string belief_encoding = "expanded";
+		node_handle.getParam("/squirrel_planning_execution/belief_encoding", belief_encoding);
+		belief_encoding_ = EXPANDED_BELIEF_ENCODING;
+		if (!parseBeliefEncoding(belief_encoding, belief_encoding_))
+		{
+			ROS_ERROR("KCL: (ExamineAreaPDDLAction) Unknown belief encoding %s, use 'expanded' or 'lifted'.", belief_encoding.c_str());
+		}
+		max_objects_ = belief_encoding_ == LIFTED_BELIEF_ENCODING ? 25 : 4;
+		node_handle.getParam("/squirrel_planning_execution/max_objects_to_examine", max_objects_);
 	}
 	
 	ExamineAreaPDDLAction::~ExamineAreaPDDLAction()
@@ -56,12 +73,19 @@ namespace KCL_rosplan {
 		}
 		objects_to_examine_.clear();
 
-		bool actionAchieved = false;
-		
 		ROS_INFO("KCL: (ExamineAreaPDDLAction) action recieved %s", action_name.c_str());
-		ros::ServiceServer pddl_generation_service = node_handle_->advertiseService("/kcl_rosplan/generate_planning_problem", &ExamineAreaPDDLAction::generatePDDLProblemFile, this);
+		pddl_generation_service_ = node_handle_->advertiseService("/kcl_rosplan/generate_planning_problem", &ExamineAreaPDDLAction::generatePDDLProblemFile, this);
 
-		PlannerInstance& planner_instance = PlannerInstance::createInstance(*node_handle_, "ff", false);
+		PlannerInstance* planner_instance = PlannerInstance::createInstance(*node_handle_, "ff", false);
+		if (planner_instance == NULL)
+		{
+			ROS_ERROR("KCL: (ExamineAreaPDDLAction) no planner instance is available for action name %s.", action_name.c_str());
+			rosplan_dispatch_msgs::ActionFeedback fb;
+			fb.action_id = msg->action_id;
+			fb.status = "action failed";
+			action_feedback_pub_.publish(fb);
+			return;
+		}
 		
 		// Lets start the planning process.
 		std::string data_path;
@@ -86,10 +110,12 @@ namespace KCL_rosplan {
 		if (!createPDDL())
 		{
 			ROS_ERROR("KCL: (ExamineAreaPDDLAction) failed to produce a domain at %s for action name %s.", domain_name.c_str(), action_name.c_str());
+			planner_instance->release();
+			pddl_generation_service_.shutdown();
 			return;
 		}
 
-		planner_instance.startPlanner(domain_name, problem_name, data_path, planner_command);
+		planner_instance->startPlanner(domain_name, problem_name, data_path, planner_command, boost::bind(&ExamineAreaPDDLAction::planFinished, this, _1, msg, planner_instance), plan_timeout_);
 		
 		// publish feedback (enabled)
 		rosplan_dispatch_msgs::ActionFeedback fb;
@@ -97,16 +123,14 @@ namespace KCL_rosplan {
 		fb.status = "action enabled";
 		action_feedback_pub_.publish(fb);
 
-		// wait for action to finish
-		ros::Rate loop_rate(1);
-		while (ros::ok() && (planner_instance.getState() == actionlib::SimpleClientGoalState::ACTIVE || planner_instance.getState() == actionlib::SimpleClientGoalState::PENDING)) {
-			ros::spinOnce();
-			loop_rate.sleep();
-		}
-//		pddl_generation_service.shutdown();
-
-
-		actionlib::SimpleClientGoalState state = planner_instance.getState();
+		// The sub-plan runs in the background, planFinished is called once it is done.
+	}
+	
+	void ExamineAreaPDDLAction::planFinished(const actionlib::SimpleClientGoalState& state, const rosplan_dispatch_msgs::ActionDispatch::ConstPtr& msg, PlannerInstance* planner_instance)
+	{
+		const std::string& action_name = g_action_name;
+		planner_instance->release();
+		pddl_generation_service_.shutdown();
 		ROS_INFO("KCL: (ExamineAreaPDDLAction) action finished: %s, %s", action_name.c_str(), state.toString().c_str());
 
 		if(state == actionlib::SimpleClientGoalState::SUCCEEDED)
@@ -214,7 +238,7 @@ namespace KCL_rosplan {
 		int max_objects = 0;
 		for (std::vector<rosplan_knowledge_msgs::KnowledgeItem>::const_iterator ci = objects.begin(); ci != objects.end(); ++ci) {
 
-			if(max_objects > 3) break;
+			if(max_objects >= max_objects_) break;
 
 			const rosplan_knowledge_msgs::KnowledgeItem& knowledge_item = *ci;
 			std::string object_predicate;
@@ -349,7 +373,7 @@ namespace KCL_rosplan {
 				objects_to_examine_.insert(ci->first);
 			}
 
-			ContingentStrategicClassifyPDDLGenerator::createPDDL(data_path, domain_name, problem_name, robot_location, object_to_location_mappings, near_waypoint_mappings, 1);
+			ContingentStrategicClassifyPDDLGenerator::createPDDL(data_path, domain_name, problem_name, robot_location, object_to_location_mappings, near_waypoint_mappings, 1, belief_encoding_);
 		}
 		return true;
 	}
@@ -3,11 +3,15 @@
 
 #include <ros/ros.h>
 #include <rosplan_dispatch_msgs/ActionDispatch.h>
+#include <actionlib/client/simple_action_client.h>
 #include <rosplan_knowledge_msgs/GenerateProblemService.h>
 
+#include "squirrel_planning_execution/BeliefEncoding.h"
+
 namespace KCL_rosplan
 {
 class KnowledgeBase;
+class PlannerInstance;
 
 /**
  * An instance of this class gets called whenever the PDDL action 'examine_area' (or variants thereof) is
@@ -38,6 +42,14 @@ public:
 	
 private:
 	
+	/**
+	 * Called when the sub-plan of a dispatched action is done.
+	 * @param state The final state of the sub-plan.
+	 * @param msg The dispatch message of the action.
+	 * @param planner_instance The planner that executed the sub-plan.
+	 */
+	void planFinished(const actionlib::SimpleClientGoalState& state, const rosplan_dispatch_msgs::ActionDispatch::ConstPtr& msg, PlannerInstance* planner_instance);
+	
 	/**
 	 * Create a PDDL domain.
 	 */
@@ -50,9 +62,13 @@ private:
 	ros::NodeHandle* node_handle_;				 // The ROS node.
 	KCL_rosplan::KnowledgeBase* knowledge_base_; // The knowledge base.
 	bool is_simulated_;							 // Whether this action is to be simulated.
+	ros::Duration plan_timeout_;				 // The sub-plan is cancelled if it takes longer than this, zero means no limit.
+	BeliefEncoding belief_encoding_;			 // How the generated domain moves knowledge between knowledge bases.
+	int max_objects_;							 // The maximum number of objects examined in one plan.
 	
 	ros::Publisher action_feedback_pub_;		 // Publisher that communicates feedback to ROSPlan.
 	ros::Subscriber dispatch_sub_;				 // Subscriber to the dispatch topic of ROSPlan.
+	ros::ServiceServer pddl_generation_service_; // Generates the problem while the sub-plan is planned.
 
 	std::set<std::string> objects_to_examine_;	 // Objects that are examined this round.
 };
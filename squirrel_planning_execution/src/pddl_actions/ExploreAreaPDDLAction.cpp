@@ -1,6 +1,7 @@
 #include <map>
 #include <vector>
 #include <iostream>
+#include <boost/bind.hpp>
 #include <sstream>
 //#include <boost/concept_check.hpp>
 #include <tf/tf.h>
@@ -46,6 +47,10 @@ namespace KCL_rosplan {
 		view_cone_generator_ = new ViewConeGenerator(node_handle, occupancyTopic);
 		
 		node_handle.getParam("/squirrel_planning_execution/simulated", is_simulated_);
+		
+		double plan_timeout = 0;
+		node_handle.getParam("/squirrel_planning_execution/sub_plan_timeout", plan_timeout);
+		plan_timeout_ = ros::Duration(plan_timeout);
 	}
 	
 	ExploreAreaPDDLAction::~ExploreAreaPDDLAction()
@@ -70,11 +75,18 @@ namespace KCL_rosplan {
 			return;
 		}
 
-		bool actionAchieved = false;
-		
 		ROS_INFO("KCL: (ExploreAreaPDDLAction) action recieved %s", action_name.c_str());
 		
-		PlannerInstance& planner_instance = PlannerInstance::createInstance(*node_handle_, "ff", true);
+		PlannerInstance* planner_instance = PlannerInstance::createInstance(*node_handle_, "ff", true);
+		if (planner_instance == NULL)
+		{
+			ROS_ERROR("KCL: (ExploreAreaPDDLAction) no planner instance is available for action name %s.", action_name.c_str());
+			rosplan_dispatch_msgs::ActionFeedback fb;
+			fb.action_id = msg->action_id;
+			fb.status = "action failed";
+			action_feedback_pub_.publish(fb);
+			return;
+		}
 		
 		// Lets start the planning process.
 		std::string data_path;
@@ -99,10 +111,11 @@ namespace KCL_rosplan {
 		if (!createDomain())
 		{
 			ROS_ERROR("KCL: (ExploreAreaPDDLAction) failed to produce a domain at %s for action name %s.", domain_name.c_str(), action_name.c_str());
+			planner_instance->release();
 			return;
 		}
 		
-		planner_instance.startPlanner(domain_name, problem_name, data_path, planner_command);
+		planner_instance->startPlanner(domain_name, problem_name, data_path, planner_command, boost::bind(&ExploreAreaPDDLAction::planFinished, this, _1, msg, planner_instance), plan_timeout_);
 		
 		// publish feedback (enabled)
 		rosplan_dispatch_msgs::ActionFeedback fb;
@@ -110,14 +123,13 @@ namespace KCL_rosplan {
 		fb.status = "action enabled";
 		action_feedback_pub_.publish(fb);
 
-		// wait for action to finish
-		ros::Rate loop_rate(1);
-		while (ros::ok() && (planner_instance.getState() == actionlib::SimpleClientGoalState::ACTIVE || planner_instance.getState() == actionlib::SimpleClientGoalState::PENDING)) {
-			ros::spinOnce();
-			loop_rate.sleep();
-		}
-
-		actionlib::SimpleClientGoalState state = planner_instance.getState();
+		// The sub-plan runs in the background, planFinished is called once it is done.
+	}
+	
+	void ExploreAreaPDDLAction::planFinished(const actionlib::SimpleClientGoalState& state, const rosplan_dispatch_msgs::ActionDispatch::ConstPtr& msg, PlannerInstance* planner_instance)
+	{
+		const std::string& action_name = g_action_name;
+		planner_instance->release();
 		ROS_INFO("KCL: (ExploreAreaPDDLAction) action finished: %s, %s", action_name.c_str(), state.toString().c_str());
 		
 		std::vector<rosplan_knowledge_msgs::KnowledgeItem> all_facts;
@@ -5,6 +5,7 @@
 
 #include <ros/ros.h>
 #include <rosplan_dispatch_msgs/ActionDispatch.h>
+#include <actionlib/client/simple_action_client.h>
 
 #include "mongodb_store/message_store.h"
 
@@ -13,6 +14,7 @@ namespace KCL_rosplan
 
 class ViewConeGenerator;
 class KnowledgeBase;
+class PlannerInstance;
 
 /**
  * An instance of this class gets called whenever the PDDL action 'explore_area' (or variants thereof) is
@@ -43,6 +45,14 @@ public:
 	
 private:
 	
+	/**
+	 * Called when the sub-plan of a dispatched action is done.
+	 * @param state The final state of the sub-plan.
+	 * @param msg The dispatch message of the action.
+	 * @param planner_instance The planner that executed the sub-plan.
+	 */
+	void planFinished(const actionlib::SimpleClientGoalState& state, const rosplan_dispatch_msgs::ActionDispatch::ConstPtr& msg, PlannerInstance* planner_instance);
+	
 	/**
 	 * Create a PDDL domain.
 	 */
@@ -53,6 +63,7 @@ private:
 	ros::NodeHandle* node_handle_;               // The ROS node.
 	KCL_rosplan::KnowledgeBase* knowledge_base_; // The knowledge base.
 	bool is_simulated_;                          // Whether this action is to be simulated.
+	ros::Duration plan_timeout_;                 // The sub-plan is cancelled if it takes longer than this, zero means no limit.
 	
 	ros::ServiceClient get_instance_client_;     // Service client to get instances stored by ROSPlan.
 	ros::ServiceClient get_attribute_client_;    // Service client to get attributes of instances stored by ROSPlan.
@@ -7,6 +7,7 @@
 #include <rosplan_dispatch_msgs/ActionFeedback.h>
 #include <squirrel_object_perception_msgs/SceneObject.h>
 #include <squirrel_planning_execution/KnowledgeBase.h>
+#include <squirrel_planning_execution/WaypointIndex.h>
 #include <geometry_msgs/PoseStamped.h>
 
 #include "ExploreWaypointPDDLAction.h"
@@ -14,8 +15,8 @@
 namespace KCL_rosplan
 {
 
-ExploreWaypointPDDLAction::ExploreWaypointPDDLAction(ros::NodeHandle& node_handle, mongodb_store::MessageStoreProxy& message_store, KnowledgeBase& knowledge_base)
-	: message_store_(&message_store), knowledge_base_(&knowledge_base)
+ExploreWaypointPDDLAction::ExploreWaypointPDDLAction(ros::NodeHandle& node_handle, WaypointIndex& waypoint_index, KnowledgeBase& knowledge_base)
+	: waypoint_index_(&waypoint_index), knowledge_base_(&knowledge_base)
 {
 	action_feedback_pub_ = node_handle.advertise<rosplan_dispatch_msgs::ActionFeedback>("/kcl_rosplan/action_feedback", 10, true);
 
@@ -97,12 +98,12 @@ void ExploreWaypointPDDLAction::dispatchCallback(const rosplan_dispatch_msgs::Ac
 		so.pose.orientation.w = 1;
 		so.bounding_cylinder.height = 0.2;
 		so.bounding_cylinder.diameter = 0.3;
-		message_store_->insertNamed(object_name, so);
+		waypoint_index_->insertNamed(object_name, so, "object");
 		
 		geometry_msgs::PoseStamped ps;
 		ps.header = so.header;
 		ps.pose = so.pose;
-		message_store_->insertNamed(waypoint_name, so);
+		waypoint_index_->insertNamed(waypoint_name, ps, "waypoint");
 	}
 	
 	ROS_INFO("KCL: (ExploreWaypointPDDLAction) Added %d new objects!", new_objects);
@@ -3,11 +3,11 @@
 
 #include <ros/ros.h>
 #include <rosplan_dispatch_msgs/ActionDispatch.h>
-#include <mongodb_store/message_store.h>
 
 namespace KCL_rosplan
 {
 class KnowledgeBase;
+class WaypointIndex;
 /**
  * An instance of this class gets called whenever the PDDL action 'goto' (or variants thereof) is
  * dispatched. It is an action that makes the robot move to a certain location.
@@ -19,10 +19,10 @@ public:
 	/**
 	 * Constructor.
 	 * @param node_handle An existing and initialised ros node handle.
-	 * @param message_store The message_store.
+	 * @param waypoint_index The index through which new objects are stored in the message store.
 	 * @param knowledge_base The knowledge base interface.
 	 */
-	ExploreWaypointPDDLAction(ros::NodeHandle& node_handle, mongodb_store::MessageStoreProxy& message_store, KnowledgeBase& knowledge_base);
+	ExploreWaypointPDDLAction(ros::NodeHandle& node_handle, WaypointIndex& waypoint_index, KnowledgeBase& knowledge_base);
 	
 	/**
 	 * Destructor
@@ -37,7 +37,7 @@ public:
 	void dispatchCallback(const rosplan_dispatch_msgs::ActionDispatch::ConstPtr& msg);
 	
 private:
-	mongodb_store::MessageStoreProxy* message_store_;
+	WaypointIndex* waypoint_index_;
 	KnowledgeBase* knowledge_base_;
 	
 	ros::Publisher action_feedback_pub_;         // Publisher that communicates feedback to ROSPlan.
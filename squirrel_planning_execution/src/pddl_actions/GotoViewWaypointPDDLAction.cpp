@@ -20,7 +20,7 @@ namespace KCL_rosplan
 {
 
 GotoViewWaypointPDDLAction::GotoViewWaypointPDDLAction(ros::NodeHandle& node_handle, const std::string &actionserver)
-	 : message_store_(node_handle), action_client_(actionserver, true)
+	 : message_store_(node_handle), action_client_(actionserver, true), occupancy_threshold_(20)
 	{
 	// costmap client
 	clear_costmaps_client_ = node_handle.serviceClient<std_srvs::Empty>("/move_base/clear_costmaps");
@@ -33,6 +33,12 @@ GotoViewWaypointPDDLAction::GotoViewWaypointPDDLAction(ros::NodeHandle& node_han
 
 	// Subscribe to the action feedback topic.
 	dispatch_sub_ = node_handle.subscribe("/kcl_rosplan/action_dispatch", 1000, &KCL_rosplan::GotoViewWaypointPDDLAction::dispatchCallback, this);
+	
+	// The occupancy grid is used to check whether a box can be seen from its view waypoint.
+	std::string occupancy_topic("/map");
+	node_handle.param("/squirrel_planning_execution/occupancy_topic", occupancy_topic, occupancy_topic);
+	node_handle.param("/squirrel_planning_execution/occupancy_threshold", occupancy_threshold_, occupancy_threshold_);
+	occupancy_grid_sub_ = node_handle.subscribe(occupancy_topic, 1, &KCL_rosplan::GotoViewWaypointPDDLAction::storeOccupancyGrid, this);
 }
 
 GotoViewWaypointPDDLAction::~GotoViewWaypointPDDLAction()
@@ -40,6 +46,40 @@ GotoViewWaypointPDDLAction::~GotoViewWaypointPDDLAction()
 	
 }
 
+void GotoViewWaypointPDDLAction::storeOccupancyGrid(const nav_msgs::OccupancyGrid::ConstPtr& msg)
+{
+	occupancy_grid_ = msg;
+}
+
+bool GotoViewWaypointPDDLAction::isBoxVisible(const std::string& box, const geometry_msgs::PoseStamped& box_pose)
+{
+	if (!occupancy_grid_)
+	{
+		return true;
+	}
+	
+	// The view waypoints of the boxes do not move, so each one is only looked up once.
+	std::map<std::string, geometry_msgs::Point>::const_iterator ci = view_points_.find(box);
+	if (ci == view_points_.end())
+	{
+		std::stringstream ss;
+		ss << "near_" << box;
+		std::vector< boost::shared_ptr<geometry_msgs::PoseStamped> > results;
+		if (!message_store_.queryNamed<geometry_msgs::PoseStamped>(ss.str(), results) || results.empty())
+		{
+			return true;
+		}
+		ci = view_points_.insert(std::make_pair(box, results[0]->pose.position)).first;
+	}
+	
+	const geometry_msgs::Point& view_point = ci->second;
+	float dx = box_pose.pose.position.x - view_point.x;
+	float dy = box_pose.pose.position.y - view_point.y;
+	unsigned int radius = ceil(sqrt(dx * dx + dy * dy) / occupancy_grid_->info.resolution) + 1;
+	visibility_field_.compute(*occupancy_grid_, occupancy_grid_utils::pointCell(occupancy_grid_->info, view_point), radius, occupancy_threshold_);
+	return visibility_field_.isVisible(box_pose.pose.position);
+}
+
 void GotoViewWaypointPDDLAction::dispatchCallback(const rosplan_dispatch_msgs::ActionDispatch::ConstPtr& msg)
 {
 	std::string normalised_action_name = msg->name;
@@ -147,6 +187,11 @@ void GotoViewWaypointPDDLAction::dispatchCallback(const rosplan_dispatch_msgs::A
 		}
 	}
 	
+	if (!closest_box.empty() && !isBoxVisible(closest_box, closest_box_pose))
+	{
+		ROS_WARN("KCL: (GotoViewWaypointPDDLAction) Box %s cannot be seen from its view waypoint.", closest_box.c_str());
+	}
+	
 	// Send a movebase goal to get to this box.
 	std::stringstream ss;
 	ss << "near_" << closest_box;
@@ -1,11 +1,17 @@
 #ifndef SQUIRRELPLANNINGEXECUTION_PDDLACTIONS_GOTOVIEWWAYPOINTPDDLCOMMAND_H
 #define SQUIRRELPLANNINGEXECUTION_PDDLACTIONS_GOTOVIEWWAYPOINTPDDLCOMMAND_H
 
+#include <map>
+#include <string>
+
 #include <ros/ros.h>
 #include <rosplan_dispatch_msgs/ActionDispatch.h>
 #include "actionlib/client/simple_action_client.h"
 #include "move_base_msgs/MoveBaseAction.h"
 #include "mongodb_store/message_store.h"
+#include <nav_msgs/OccupancyGrid.h>
+#include <geometry_msgs/PoseStamped.h>
+#include <squirrel_planning_execution/VisibilityField.h>
 
 namespace KCL_rosplan
 {
@@ -37,7 +43,23 @@ public:
 	 */
 	void dispatchCallback(const rosplan_dispatch_msgs::ActionDispatch::ConstPtr& msg);
 	
+	/**
+	 * Callback function of the occupancy grid subscriber, the grid is used to check if a box can be seen. The
+	 * message is shared with the subscriber, it is not copied.
+	 * @param msg A pointer to the occupancy grid.
+	 */
+	void storeOccupancyGrid(const nav_msgs::OccupancyGrid::ConstPtr& msg);
+	
 private:
+	
+	/**
+	 * Check if a box can be seen from its view waypoint. The view waypoint is looked up the first time a box is checked.
+	 * @param box The name of the box.
+	 * @param box_pose The pose of the box.
+	 * @return False if the view of the box is blocked, true if it is visible or if this cannot be determined.
+	 */
+	bool isBoxVisible(const std::string& box, const geometry_msgs::PoseStamped& box_pose);
+	
 	ros::ServiceClient update_knowledge_client_; // Service client to update the knowledge base.
 	ros::ServiceClient get_instance_client_;     // Service client to get instances stored by ROSPlan.
 	ros::ServiceClient get_attribute_client_;    // Service client to get attributes of instances stored by ROSPlan.
@@ -47,6 +69,12 @@ private:
 	mongodb_store::MessageStoreProxy message_store_; // Message store to lookup real data.
 	actionlib::SimpleActionClient<move_base_msgs::MoveBaseAction> action_client_; // Action client of move_base
 	ros::ServiceClient clear_costmaps_client_;       // Message to clear the costmap.
+	
+	ros::Subscriber occupancy_grid_sub_;             // Subscriber to the occupancy grid.
+	nav_msgs::OccupancyGrid::ConstPtr occupancy_grid_; // The last received occupancy grid, NULL until one is received.
+	int occupancy_threshold_;                        // Cells above this value block the view.
+	VisibilityField visibility_field_;               // Determines which cells can be seen from a view waypoint.
+	std::map<std::string, geometry_msgs::Point> view_points_; // The view waypoint of every box that was checked.
 };
 
 };
@@ -3,12 +3,14 @@
 
 #include <ros/ros.h>
 #include <rosplan_dispatch_msgs/ActionDispatch.h>
+#include <actionlib/client/simple_action_client.h>
 
 #include "mongodb_store/message_store.h"
 
 namespace KCL_rosplan
 {
 class KnowledgeBase;
+class PlannerInstance;
 /**
  * An instance of this class gets called whenever the PDDL action 'observe-classifiable_on_attempt' (or variants thereof) is
  * dispatched. It is an action that makes the robot examine all objects in the given area.
@@ -37,6 +39,14 @@ public:
 	
 private:
 	
+	/**
+	 * Called when the sub-plan of a dispatched action is done.
+	 * @param state The final state of the sub-plan.
+	 * @param msg The dispatch message of the action.
+	 * @param planner_instance The planner that executed the sub-plan.
+	 */
+	void planFinished(const actionlib::SimpleClientGoalState& state, const rosplan_dispatch_msgs::ActionDispatch::ConstPtr& msg, PlannerInstance* planner_instance);
+	
 	/**
 	 * Create a PDDL domain.
 	 * @param object The object to be classified.
@@ -47,6 +57,7 @@ private:
 	
 	ros::NodeHandle* node_handle_;                       // The ROS node.
 	bool is_simulated_;                                  // Whether this action is to be simulated.
+	ros::Duration plan_timeout_;                         // The sub-plan is cancelled if it takes longer than this, zero means no limit.
 	
 	ros::Publisher action_feedback_pub_;                 // Publisher that communicates feedback to ROSPlan.
 	ros::Subscriber dispatch_sub_;                       // Subscriber to the dispatch topic of ROSPlan.
@@ -1,19 +1,128 @@
 #include "PlannerInstance.h"
-#include <iostream>	 	
+#include <iostream>
+#include <boost/bind.hpp>
+#include <cstdio>
+#include <signal.h>
 
 namespace KCL_rosplan
 {
 
+std::vector<PlannerInstance*> PlannerInstance::pool_;
+unsigned int PlannerInstance::max_instances_ = 8;
+ros::Duration PlannerInstance::start_timeout_(30.0);
 unsigned int PlannerInstance::total_planner_instances_ = 0;
-	
-PlannerInstance& PlannerInstance::createInstance(ros::NodeHandle& node_handle, const std::string& parser, bool generate_default_problem)
+unsigned int PlannerInstance::total_plans_ = 0;
+boost::mutex PlannerInstance::pool_mutex_;
+
+PlannerInstance* PlannerInstance::createInstance(ros::NodeHandle& node_handle, const std::string& parser, bool generate_default_problem)
+{
+	PlannerInstance* planner_instance = NULL;
+	{
+		boost::mutex::scoped_lock lock(pool_mutex_);
+		
+		// Reuse an idle instance that was started with the same settings.
+		PlannerInstance* idle_instance = NULL;
+		for (std::vector<PlannerInstance*>::const_iterator ci = pool_.begin(); ci != pool_.end(); ++ci)
+		{
+			PlannerInstance* candidate = *ci;
+			if (candidate->in_use_) continue;
+			if (candidate->parser_ == parser && candidate->generate_default_problem_ == generate_default_problem)
+			{
+				planner_instance = candidate;
+				break;
+			}
+			idle_instance = candidate;
+		}
+		
+		if (planner_instance == NULL)
+		{
+			// Make room by stopping an idle instance with other settings.
+			if (pool_.size() >= max_instances_ && idle_instance != NULL)
+			{
+				retire(*idle_instance);
+			}
+			
+			// Waiting for a release would block the spinner that delivers it.
+			if (pool_.size() >= max_instances_)
+			{
+				ROS_WARN("KCL: (PlannerInstance) All %u planner instances are in use.", max_instances_);
+				return NULL;
+			}
+			planner_instance = spawn(node_handle, parser, generate_default_problem);
+		}
+		planner_instance->in_use_ = true;
+	}
+
+	// Only a freshly started planning system has to be waited for, the action client spins its own thread.
+	if (!planner_instance->plan_action_client_->isServerConnected())
+	{
+		ROS_INFO("KCL: (PlannerInstance) Waiting for action server to start.");
+		ros::Duration start_timeout;
+		{
+			boost::mutex::scoped_lock lock(pool_mutex_);
+			start_timeout = start_timeout_;
+		}
+		if (!planner_instance->plan_action_client_->waitForServer(start_timeout))
+		{
+			ROS_ERROR("KCL: (PlannerInstance) The planning system %s did not start within %f seconds.", planner_instance->planning_instance_name_.c_str(), start_timeout.toSec());
+			boost::mutex::scoped_lock lock(pool_mutex_);
+			retire(*planner_instance);
+			return NULL;
+		}
+		ROS_INFO("KCL: (PlannerInstance) Action server started.");
+	}
+	return planner_instance;
+}
+
+void PlannerInstance::warmUp(ros::NodeHandle& node_handle, const std::string& parser, bool generate_default_problem, unsigned int count)
+{
+	boost::mutex::scoped_lock lock(pool_mutex_);
+	unsigned int idle_instances = 0;
+	for (std::vector<PlannerInstance*>::const_iterator ci = pool_.begin(); ci != pool_.end(); ++ci)
+	{
+		const PlannerInstance* planner_instance = *ci;
+		if (!planner_instance->in_use_ && planner_instance->parser_ == parser && planner_instance->generate_default_problem_ == generate_default_problem)
+		{
+			++idle_instances;
+		}
+	}
+
+	for (; idle_instances < count && pool_.size() < max_instances_; ++idle_instances)
+	{
+		spawn(node_handle, parser, generate_default_problem);
+	}
+	ROS_INFO("KCL: (PlannerInstance) %u idle %s planner instances, %lu in total.", idle_instances, parser.c_str(), pool_.size());
+}
+
+void PlannerInstance::setMaxInstances(unsigned int max_instances)
+{
+	boost::mutex::scoped_lock lock(pool_mutex_);
+	max_instances_ = max_instances;
+}
+
+void PlannerInstance::setStartTimeout(const ros::Duration& start_timeout)
+{
+	boost::mutex::scoped_lock lock(pool_mutex_);
+	start_timeout_ = start_timeout;
+}
+
+void PlannerInstance::shutdown()
+{
+	boost::mutex::scoped_lock lock(pool_mutex_);
+	while (!pool_.empty())
+	{
+		retire(*pool_.back());
+	}
+}
+
+PlannerInstance* PlannerInstance::spawn(ros::NodeHandle& node_handle, const std::string& parser, bool generate_default_problem)
 {
 	++total_planner_instances_;
-	
+
 	// Create a new planning system.
 	std::stringstream nspace;
 	nspace << "instance" << total_planner_instances_;
-	
+
 	std::stringstream commandLine;
 	commandLine << "rosrun rosplan_planning_system planner ";
 	commandLine << "parser=" << parser << " ";
@@ -26,23 +135,51 @@ PlannerInstance& PlannerInstance::createInstance(ros::NodeHandle& node_handle, c
 	commandLine << "/kcl_rosplan/planning_server:=/kcl_rosplan/" << nspace.str() << "/planning_server ";
 	commandLine << "/kcl_rosplan/planning_server_params:=/kcl_rosplan/" << nspace.str() << "/planning_server_params ";
 	commandLine << "/kcl_rosplan/start_planning:=/kcl_rosplan/" << nspace.str() << "/start_planning ";
-	commandLine << "&";
-	int return_value = system(commandLine.str().c_str());
+	commandLine << "1>&2 & echo $!";
 
-	PlannerInstance* planning_instance = new PlannerInstance(node_handle, nspace.str(), total_planner_instances_);
-	return *planning_instance;
+	// Remember the process ID so the planning system can be stopped when it is retired. Its output is sent
+	// to stderr so it does not end up in the pipe that is closed once the process ID is read.
+	PlannerInstance* planning_instance = new PlannerInstance(node_handle, nspace.str(), parser, generate_default_problem);
+	FILE* process = popen(commandLine.str().c_str(), "r");
+	if (process == NULL || fscanf(process, "%d", &planning_instance->process_id_) != 1)
+	{
+		ROS_ERROR("KCL: (PlannerInstance) Failed to start the planning system %s.", nspace.str().c_str());
+	}
+	if (process != NULL)
+	{
+		pclose(process);
+	}
+
+	pool_.push_back(planning_instance);
+	return planning_instance;
+}
+
+void PlannerInstance::retire(PlannerInstance& planner_instance)
+{
+	for (std::vector<PlannerInstance*>::iterator i = pool_.begin(); i != pool_.end(); ++i)
+	{
+		if (*i == &planner_instance)
+		{
+			pool_.erase(i);
+			break;
+		}
+	}
+
+	if (planner_instance.process_id_ > 0)
+	{
+		kill(planner_instance.process_id_, SIGINT);
+	}
+	ROS_INFO("KCL: (PlannerInstance) Stopped the planning system %s.", planner_instance.planning_instance_name_.c_str());
+	delete &planner_instance;
 }
 
-PlannerInstance::PlannerInstance(ros::NodeHandle& node_handle, const std::string& planning_instance_name, unsigned int planner_instance_id)
-	: node_handle_(&node_handle), planning_instance_name_(planning_instance_name), planner_instance_id_(planner_instance_id)
+PlannerInstance::PlannerInstance(ros::NodeHandle& node_handle, const std::string& planning_instance_name, const std::string& parser, bool generate_default_problem)
+	: node_handle_(&node_handle), planning_instance_name_(planning_instance_name), parser_(parser), generate_default_problem_(generate_default_problem), in_use_(false), has_goal_(false), process_id_(0)
 {
-	// Create action client
+	// Create action client, the server is waited for when the instance is leased.
 	std::stringstream commandPub;
 	commandPub << "/kcl_rosplan/" << planning_instance_name << "/start_planning";
 	plan_action_client_ = new actionlib::SimpleActionClient<rosplan_dispatch_msgs::PlanAction>(commandPub.str(), true);
-	ROS_INFO("KCL: (PlannerInstance) Waiting for action server to start.");
-	plan_action_client_->waitForServer();
-	ROS_INFO("KCL: (PlannerInstance) Action server started.");
 }
 
 PlannerInstance::~PlannerInstance()
@@ -51,15 +188,61 @@ PlannerInstance::~PlannerInstance()
 }
 
 void PlannerInstance::startPlanner(const std::string& domain_path, const std::string& problem_path, const std::string& data_path, const std::string& planner_command)
+{
+	startPlanner(domain_path, problem_path, data_path, planner_command, CompletionCallback());
+}
+
+void PlannerInstance::startPlanner(const std::string& domain_path, const std::string& problem_path, const std::string& data_path, const std::string& planner_command, const CompletionCallback& on_completion, const ros::Duration& timeout)
 {
 	rosplan_dispatch_msgs::PlanGoal psrv;
 	psrv.domain_path = domain_path;
 	psrv.problem_path = problem_path;
 	psrv.data_path = data_path;
 	psrv.planner_command = planner_command;
-	psrv.start_action_id = total_planner_instances_ * 1000;
+	{
+		boost::mutex::scoped_lock lock(pool_mutex_);
+		psrv.start_action_id = ++total_plans_ * 1000;
+	}
+
+	on_completion_ = on_completion;
+	plan_action_client_->sendGoal(psrv, boost::bind(&PlannerInstance::planDone, this, _1, _2));
+	has_goal_ = true;
 	
-	plan_action_client_->sendGoal(psrv);
+	timeout_timer_.stop();
+	if (timeout > ros::Duration(0))
+	{
+		timeout_timer_ = node_handle_->createTimer(timeout, &PlannerInstance::timeoutCallback, this, true);
+	}
+}
+
+void PlannerInstance::cancel()
+{
+	if (!has_goal_) return;
+	actionlib::SimpleClientGoalState state = plan_action_client_->getState();
+	if (state == actionlib::SimpleClientGoalState::ACTIVE || state == actionlib::SimpleClientGoalState::PENDING)
+	{
+		ROS_INFO("KCL: (PlannerInstance) Cancel the plan of %s.", planning_instance_name_.c_str());
+		plan_action_client_->cancelGoal();
+	}
+}
+
+void PlannerInstance::planDone(const actionlib::SimpleClientGoalState& state, const rosplan_dispatch_msgs::PlanResultConstPtr& result)
+{
+	timeout_timer_.stop();
+	
+	// The callback may release this instance, so it must not be touched afterwards.
+	CompletionCallback on_completion = on_completion_;
+	on_completion_.clear();
+	if (on_completion)
+	{
+		on_completion(state);
+	}
+}
+
+void PlannerInstance::timeoutCallback(const ros::TimerEvent& event)
+{
+	ROS_WARN("KCL: (PlannerInstance) The plan of %s timed out.", planning_instance_name_.c_str());
+	cancel();
 }
 
 actionlib::SimpleClientGoalState PlannerInstance::getState() const
@@ -67,4 +250,26 @@ actionlib::SimpleClientGoalState PlannerInstance::getState() const
 	return plan_action_client_->getState();
 }
 
+void PlannerInstance::release()
+{
+	// Reset the planning system so the next user starts with a clean slate, a cancelled plan no longer 
+	// reports back to the previous user.
+	timeout_timer_.stop();
+	on_completion_.clear();
+	if (has_goal_)
+	{
+		actionlib::SimpleClientGoalState state = plan_action_client_->getState();
+		if (state == actionlib::SimpleClientGoalState::ACTIVE || state == actionlib::SimpleClientGoalState::PENDING)
+		{
+			ROS_INFO("KCL: (PlannerInstance) Cancel the plan of %s.", planning_instance_name_.c_str());
+			plan_action_client_->cancelGoal();
+			plan_action_client_->stopTrackingGoal();
+		}
+		has_goal_ = false;
+	}
+
+	boost::mutex::scoped_lock lock(pool_mutex_);
+	in_use_ = false;
+}
+
 };
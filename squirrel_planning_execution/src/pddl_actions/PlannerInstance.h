@@ -1,6 +1,11 @@
 #ifndef SQUIRRELPLANNINGEXECUTION_PDDLACTIONS_PLANNERINSTANCE_H
 #define SQUIRRELPLANNINGEXECUTION_PDDLACTIONS_PLANNERINSTANCE_H
 
+#include <vector>
+
+#include <boost/function.hpp>
+#include <boost/thread/mutex.hpp>
+
 #include <ros/ros.h>
 #include <rosplan_dispatch_msgs/ActionDispatch.h>
 #include <rosplan_dispatch_msgs/PlanAction.h>
@@ -11,30 +16,69 @@ namespace KCL_rosplan
 {
 
 /**
- * This factory creates a new ROSPlan instance so we can have multiple instances running at the same time.
+ * This factory creates ROSPlan instances so we can have multiple instances running at the same time.
+ *
+ * Starting a new planning system takes seconds, so instances are kept in a pool. An instance is leased
+ * with @ref{createInstance} and given back with @ref{release}, after which it is reused by the next
+ * caller that asks for the same parser. The number of instances is capped, when all of them are in use
+ * no instance is returned. Leasing never blocks: the actions lease instances from their dispatch callback
+ * and instances are released from completion callbacks, both run on the same spinner. Note that a recursive
+ * action holds on to its instance while its sub-plan runs, so the cap must be larger than the depth of the
+ * plan hierarchy.
  */
 class PlannerInstance
 {
 public:
-	
+
 	/**
-	 * Create an instance of the ROS Planner.
+	 * Called once when a plan started with @ref{startPlanner} has finished, failed, timed out, or was cancelled.
+	 */
+	typedef boost::function<void (const actionlib::SimpleClientGoalState&)> CompletionCallback;
+
+	/**
+	 * Lease an instance of the ROS Planner, a new instance is only started if there is no idle one.
 	 * @param node_handle A ROS node handle.
 	 * @param parser Should be: "ff", "popf", or "popf3".
      * @param generate_default_problem If true then ROSPlan generate its own problem, otherwise it does not.
+	 * @return An instance that is reserved for the caller until @ref{release} is called, NULL if all instances are
+	 * in use or a new planning system did not start in time.
+	 */
+	static PlannerInstance* createInstance(ros::NodeHandle& node_handle, const std::string& parser, bool generate_default_problem);
+
+	/**
+	 * Start instances in the background so they are ready by the time they are leased.
+	 * @param node_handle A ROS node handle.
+	 * @param parser Should be: "ff", "popf", or "popf3".
+	 * @param generate_default_problem If true then ROSPlan generate its own problem, otherwise it does not.
+	 * @param count The number of idle instances with these settings that should be available.
+	 */
+	static void warmUp(ros::NodeHandle& node_handle, const std::string& parser, bool generate_default_problem, unsigned int count);
+
+	/**
+	 * @param max_instances The maximum number of instances that are running at the same time.
 	 */
-	static PlannerInstance& createInstance(ros::NodeHandle& node_handle, const std::string& parser, bool generate_default_problem);
-	
+	static void setMaxInstances(unsigned int max_instances);
+
+	/**
+	 * @param start_timeout The time a new planning system gets to start, if it does not it is stopped and no instance is leased.
+	 */
+	static void setStartTimeout(const ros::Duration& start_timeout);
+
+	/**
+	 * Stop all instances, none of them may be in use.
+	 */
+	static void shutdown();
+
 	/**
 	 * Destructor
 	 */
 	~PlannerInstance();
-	
+
 	/**
 	 * @return The state of the planning system.
 	 */
 	actionlib::SimpleClientGoalState getState() const;
-	
+
 	/**
 	 * Start the planner.
 	 * @param domain_path The PDDL domain path.
@@ -43,23 +87,87 @@ public:
 	 * @param planner_command The planner command that gets executed.
 	 */
 	void startPlanner(const std::string& domain_path, const std::string& problem_path, const std::string& data_path, const std::string& planner_command);
-	
+
+	/**
+	 * Start the planner and return immediately, the callback is called from the ROS spinner when the plan is done.
+	 * @param domain_path The PDDL domain path.
+	 * @param problem_path The PDDL problem path.
+	 * @param data_path The data path.
+	 * @param planner_command The planner command that gets executed.
+	 * @param on_completion Called with the final state of the plan.
+	 * @param timeout The plan is cancelled if it takes longer than this, zero means there is no time limit.
+	 */
+	void startPlanner(const std::string& domain_path, const std::string& problem_path, const std::string& data_path, const std::string& planner_command, const CompletionCallback& on_completion, const ros::Duration& timeout = ros::Duration(0));
+
+	/**
+	 * Cancel the running plan, the completion callback is called once the planning system has stopped.
+	 */
+	void cancel();
+
+	/**
+	 * Give the instance back to the pool, a plan that is still running is cancelled. The instance may not be
+	 * used after this call.
+	 */
+	void release();
+
 private:
-	
+
 	/**
 	 * Constructor.
 	 * @param node_handle An existing and initialised ros node handle.
+	 * @param planning_instance_name The namespace of the topics and services of the planning system.
+	 * @param parser The parser the planning system was started with.
+	 * @param generate_default_problem Whether the planning system generates its own problem.
 	 */
-	PlannerInstance(ros::NodeHandle& node_handle, const std::string& planning_instance_name, unsigned int planning_instance_id);
-	
+	PlannerInstance(ros::NodeHandle& node_handle, const std::string& planning_instance_name, const std::string& parser, bool generate_default_problem);
+
+	/**
+	 * Start a new planning system and add it to the pool, the caller must hold pool_mutex_.
+	 * @param node_handle A ROS node handle.
+	 * @param parser Should be: "ff", "popf", or "popf3".
+	 * @param generate_default_problem If true then ROSPlan generate its own problem, otherwise it does not.
+	 * @return The new instance, which is idle.
+	 */
+	static PlannerInstance* spawn(ros::NodeHandle& node_handle, const std::string& parser, bool generate_default_problem);
+
+	/**
+	 * Stop the planning system of an idle instance and remove it from the pool, the caller must hold pool_mutex_.
+	 * @param planner_instance The instance to stop.
+	 */
+	static void retire(PlannerInstance& planner_instance);
+
+	/**
+	 * Called by the action client when the plan is done.
+	 * @param state The final state of the plan.
+	 * @param result The result of the planning system.
+	 */
+	void planDone(const actionlib::SimpleClientGoalState& state, const rosplan_dispatch_msgs::PlanResultConstPtr& result);
+
+	/**
+	 * Called when a plan takes longer than its timeout.
+	 * @param event The timer event.
+	 */
+	void timeoutCallback(const ros::TimerEvent& event);
+
 	ros::NodeHandle* node_handle_;       // ROS Node handle.
 	std::string planning_instance_name_; // The name of the planning instance, it is used to make sure the names of the topics / services are unique.
-	unsigned int planner_instance_id_;   // The planner instance ID, it is used to make sure the action IDs are unique.
-	
+	std::string parser_;                 // The parser this planning system was started with.
+	bool generate_default_problem_;      // Whether this planning system generates its own problem.
+	bool in_use_;                        // Whether this instance is leased.
+	bool has_goal_;                      // Whether a plan was started since the instance was leased.
+	int process_id_;                     // The process ID of the planning system.
+	CompletionCallback on_completion_;   // Called when the current plan is done.
+	ros::Timer timeout_timer_;           // Cancels the current plan when it takes too long.
+
 	// The action client that communicates with the ROS Planner.
 	actionlib::SimpleActionClient<rosplan_dispatch_msgs::PlanAction>* plan_action_client_;
-	
-	static unsigned int total_planner_instances_;
+
+	static std::vector<PlannerInstance*> pool_;            // All running instances.
+	static unsigned int max_instances_;                    // The maximum size of the pool.
+	static ros::Duration start_timeout_;                   // The time a new planning system gets to start.
+	static unsigned int total_planner_instances_;          // The number of instances started, used to create unique names.
+	static unsigned int total_plans_;                      // The number of plans started, it is used to make sure the action IDs are unique.
+	static boost::mutex pool_mutex_;                       // Guards all static members.
 };
 
 };
@@ -1,6 +1,6 @@
 #include <sstream>
 #include <complex>
-#include <limits>
+#include <map>
 #include <set>
 
 #include <tf/tf.h>
@@ -12,13 +12,17 @@
 #include <rosplan_dispatch_msgs/ActionFeedback.h>
 #include <rosplan_knowledge_msgs/KnowledgeQueryService.h>
 #include <squirrel_object_perception_msgs/SceneObject.h>
+#include <squirrel_planning_execution/WaypointIndex.h>
 #include "SimulatedObservePDDLAction.h"
 
 namespace KCL_rosplan
 {
 
-SimulatedObservePDDLAction::SimulatedObservePDDLAction(ros::NodeHandle& node_handle)
-	: message_store_(node_handle)
+// Toys closer than this to a box (in meters) are considered to be at that box.
+static const float g_near_box_radius = 1.2247f;
+
+SimulatedObservePDDLAction::SimulatedObservePDDLAction(ros::NodeHandle& node_handle, WaypointIndex& waypoint_index)
+	: waypoint_index_(&waypoint_index)
 {
 	// knowledge interface
 	update_knowledge_client_ = node_handle.serviceClient<rosplan_knowledge_msgs::KnowledgeUpdateService>("/kcl_rosplan/update_knowledge_base");
@@ -125,10 +129,6 @@ void SimulatedObservePDDLAction::dispatchCallback(const rosplan_dispatch_msgs::A
 			return;
 		}
 		
-		std::string closest_box;
-		geometry_msgs::PoseStamped closest_box_pose;
-		float min_distance_from_robot = std::numeric_limits<float>::max();
-		
 		// Get all boxes and their poses, pick the one that is closest.
 		rosplan_knowledge_msgs::GetInstanceService getInstances;
 		getInstances.request.type_name = "box";
@@ -141,42 +141,47 @@ void SimulatedObservePDDLAction::dispatchCallback(const rosplan_dispatch_msgs::A
 		}
 
 		ROS_INFO("KCL: (SimulatedObservePDDLAction) Received all the box instances %zd.", getInstances.response.instances.size());
+		std::map<std::string, std::string> location_to_box;
 		for (std::vector<std::string>::const_iterator ci = getInstances.response.instances.begin(); ci != getInstances.response.instances.end(); ++ci)
 		{
-			// fetch position of the box from message store
-			std::stringstream ss;
-			ss << *ci << "_location";
-			std::string box_loc = ss.str();
-
-			std::vector< boost::shared_ptr<geometry_msgs::PoseStamped> > results;
-			if(message_store_.queryNamed<geometry_msgs::PoseStamped>(box_loc, results)) {
-				if(results.size()<1) {
-					ROS_ERROR("KCL: (SimulatedObservePDDLAction) aborting waypoint request; no matching boxID %s", box_loc.c_str());
-					fb.action_id = msg->action_id;
-					fb.status = "action failed";
-					action_feedback_pub_.publish(fb);
-					return;
-				}
-			} else {
-				ROS_ERROR("KCL: (SimulatedObservePDDLAction) could not query message store to fetch box pose %s", box_loc.c_str());
+			// Only fetched from the message store the first time this box is seen.
+			std::string box_loc = *ci + "_location";
+			if (!waypoint_index_->loadPose(box_loc, "box")) {
+				ROS_ERROR("KCL: (SimulatedObservePDDLAction) could not fetch box pose %s", box_loc.c_str());
 				fb.action_id = msg->action_id;
 				fb.status = "action failed";
 				action_feedback_pub_.publish(fb);
 				return;
 			}
+			location_to_box[box_loc] = *ci;
+		}
 
-			// request manipulation waypoints for object
-			geometry_msgs::PoseStamped &box_pose = *results[0];
-			float distance = (box_pose.pose.position.x - transform.getOrigin().getX()) * (box_pose.pose.position.x - transform.getOrigin().getX()) +
-			                 (box_pose.pose.position.y - transform.getOrigin().getY()) * (box_pose.pose.position.y - transform.getOrigin().getY());
-			
-			if (distance < min_distance_from_robot)
+		// The index can hold boxes that are no longer in the knowledge base, skip those.
+		geometry_msgs::Point robot_position;
+		robot_position.x = transform.getOrigin().getX();
+		robot_position.y = transform.getOrigin().getY();
+		std::vector<std::string> boxes_by_distance;
+		waypoint_index_->findNearest(robot_position, location_to_box.size(), "box", boxes_by_distance);
+
+		std::string closest_box;
+		geometry_msgs::Point closest_box_position;
+		for (std::vector<std::string>::const_iterator ci = boxes_by_distance.begin(); ci != boxes_by_distance.end(); ++ci)
+		{
+			std::map<std::string, std::string>::const_iterator box = location_to_box.find(*ci);
+			if (box != location_to_box.end())
 			{
-				min_distance_from_robot = distance;
-				closest_box = *ci;
-				closest_box_pose = box_pose;
+				closest_box = box->second;
+				waypoint_index_->getPosition(*ci, closest_box_position);
+				break;
 			}
 		}
+		if (closest_box.empty()) {
+			ROS_ERROR("KCL: (SimulatedObservePDDLAction) Could not find the closest box.");
+			fb.action_id = msg->action_id;
+			fb.status = "action failed";
+			action_feedback_pub_.publish(fb);
+			return;
+		}
 
 		ROS_INFO("KCL: (SimulatedObservePDDLAction) Closest box is: %s.", closest_box.c_str());
 		
@@ -215,6 +220,7 @@ void SimulatedObservePDDLAction::dispatchCallback(const rosplan_dispatch_msgs::A
 			}
 		}
 		
+		std::set<std::string> untidied_objects;
 		for (std::vector<std::string>::const_iterator ci = getInstances.response.instances.begin(); ci != getInstances.response.instances.end(); ++ci)
 		{
 			const std::string& object_name = *ci;
@@ -226,83 +232,81 @@ void SimulatedObservePDDLAction::dispatchCallback(const rosplan_dispatch_msgs::A
 				continue;
 			}
 			
-			// fetch position of the box from message store
-			std::vector< boost::shared_ptr<squirrel_object_perception_msgs::SceneObject> > results;
-			if(message_store_.queryNamed<squirrel_object_perception_msgs::SceneObject>(*ci, results)) {
-				if(results.size()<1) {
-					ROS_ERROR("KCL: (SimulatedObservePDDLAction) aborting waypoint request; no matching object %s", (*ci).c_str());
-					fb.action_id = msg->action_id;
-					fb.status = "action failed";
-					action_feedback_pub_.publish(fb);
-					return;
-				}
-			} else {
-				ROS_ERROR("KCL: (SimulatedObservePDDLAction) could not query message store to fetch object pose for %s", ci->c_str());
+			// Only fetched if the pose is not in the index, or was dropped because the knowledge base said the toy moved.
+			if (!waypoint_index_->loadSceneObject(object_name, "object")) {
+				ROS_ERROR("KCL: (SimulatedObservePDDLAction) could not fetch object pose for %s", object_name.c_str());
 				fb.action_id = msg->action_id;
 				fb.status = "action failed";
 				action_feedback_pub_.publish(fb);
 				return;
 			}
+			untidied_objects.insert(object_name);
+		}
 
-			// check whether it is close enough to the box we are interested in to be relevant.
-			geometry_msgs::Pose &object_pose = results[0]->pose;
-			if ((object_pose.position.x - closest_box_pose.pose.position.x) * (object_pose.position.x - closest_box_pose.pose.position.x) -
-			    (object_pose.position.y - closest_box_pose.pose.position.y) * (object_pose.position.y - closest_box_pose.pose.position.y) < 1.5f)
+		// Only the toys that are close enough to the box we are interested in are relevant.
+		std::vector<std::string> objects_near_box;
+		waypoint_index_->findWithinRadius(closest_box_position, g_near_box_radius, "object", objects_near_box);
+		for (std::vector<std::string>::const_iterator ci = objects_near_box.begin(); ci != objects_near_box.end(); ++ci)
+		{
+			const std::string& object_name = *ci;
+			if (untidied_objects.find(object_name) == untidied_objects.end())
 			{
-				// Check if the untidied toy belong in this box.
-				rosplan_knowledge_msgs::KnowledgeQueryService knowledge_query;
-	
-				rosplan_knowledge_msgs::KnowledgeItem knowledge_item;
-				knowledge_item.knowledge_type = rosplan_knowledge_msgs::KnowledgeItem::FACT;
-				knowledge_item.attribute_name = "belongs_in";
-				
-				diagnostic_msgs::KeyValue kv;
-				kv.key = "o";
-				kv.value = object_name;
-				knowledge_item.values.push_back(kv);
-				
-				kv.key = "b";
-				kv.value = closest_box;
-				knowledge_item.values.push_back(kv);
-				
-				knowledge_query.request.knowledge.push_back(knowledge_item);
-				
-				// Check if any of these facts are true.
-				if (!query_knowledge_client_.call(knowledge_query))
-				{
-					ROS_ERROR("KCL: (SimulatedObservePDDLAction) Could not call the query knowledge server.");
-					exit(1);
-				}
-				knowledge_item.values.clear();
-				
-				// Add the new knowledge.
-				rosplan_knowledge_msgs::KnowledgeUpdateService knowledge_update_service;
-				knowledge_update_service.request.update_type = rosplan_knowledge_msgs::KnowledgeUpdateService::Request::ADD_KNOWLEDGE;
-				
-				knowledge_item.knowledge_type = rosplan_knowledge_msgs::KnowledgeItem::FACT;
-				knowledge_item.attribute_name = "toy_at_right_box";
-				
-				knowledge_item.is_negative = knowledge_query.response.results[0] == 0;
-				
-				knowledge_update_service.request.knowledge = knowledge_item;
-				if (!update_knowledge_client_.call(knowledge_update_service)) {
-					ROS_ERROR("KCL: (SimulatedObservePDDLAction) Could not add the toy_at_right_box predicate to the knowledge base.");
-					exit(-1);
-				}
-				ROS_INFO("KCL: (SimulatedObservePDDLAction) Added %s (toy_at_right_box) to the knowledge base.", knowledge_item.is_negative ? "NOT" : "");
-				
-				// Remove the opposite option from the knowledge base.
-				knowledge_update_service.request.update_type = rosplan_knowledge_msgs::KnowledgeUpdateService::Request::REMOVE_KNOWLEDGE;
-				knowledge_item.is_negative = !knowledge_item.is_negative;
-				knowledge_update_service.request.knowledge = knowledge_item;
-				if (!update_knowledge_client_.call(knowledge_update_service)) {
-					ROS_ERROR("KCL: (SimulatedObservePDDLAction) Could not remove the toy_at_right_box predicate to the knowledge base.");
-			 		exit(-1);
-				}
-				ROS_INFO("KCL: (SimulatedObservePDDLAction) Removed %s (toy_at_right_box) to the knowledge base.", knowledge_item.is_negative ? "NOT" : "");
-				
-				knowledge_item.values.clear();
+				continue;
+			}
+			
+			// Check if the untidied toy belong in this box.
+			rosplan_knowledge_msgs::KnowledgeQueryService knowledge_query;
+
+			rosplan_knowledge_msgs::KnowledgeItem knowledge_item;
+			knowledge_item.knowledge_type = rosplan_knowledge_msgs::KnowledgeItem::FACT;
+			knowledge_item.attribute_name = "belongs_in";
+			
+			diagnostic_msgs::KeyValue kv;
+			kv.key = "o";
+			kv.value = object_name;
+			knowledge_item.values.push_back(kv);
+			
+			kv.key = "b";
+			kv.value = closest_box;
+			knowledge_item.values.push_back(kv);
+			
+			knowledge_query.request.knowledge.push_back(knowledge_item);
+			
+			// Check if any of these facts are true.
+			if (!query_knowledge_client_.call(knowledge_query))
+			{
+				ROS_ERROR("KCL: (SimulatedObservePDDLAction) Could not call the query knowledge server.");
+				exit(1);
+			}
+			knowledge_item.values.clear();
+			
+			// Add the new knowledge.
+			rosplan_knowledge_msgs::KnowledgeUpdateService knowledge_update_service;
+			knowledge_update_service.request.update_type = rosplan_knowledge_msgs::KnowledgeUpdateService::Request::ADD_KNOWLEDGE;
+			
+			knowledge_item.knowledge_type = rosplan_knowledge_msgs::KnowledgeItem::FACT;
+			knowledge_item.attribute_name = "toy_at_right_box";
+			
+			knowledge_item.is_negative = knowledge_query.response.results[0] == 0;
+			
+			knowledge_update_service.request.knowledge = knowledge_item;
+			if (!update_knowledge_client_.call(knowledge_update_service)) {
+				ROS_ERROR("KCL: (SimulatedObservePDDLAction) Could not add the toy_at_right_box predicate to the knowledge base.");
+				exit(-1);
 			}
+			ROS_INFO("KCL: (SimulatedObservePDDLAction) Added %s (toy_at_right_box) to the knowledge base.", knowledge_item.is_negative ? "NOT" : "");
+			
+			// Remove the opposite option from the knowledge base.
+			knowledge_update_service.request.update_type = rosplan_knowledge_msgs::KnowledgeUpdateService::Request::REMOVE_KNOWLEDGE;
+			knowledge_item.is_negative = !knowledge_item.is_negative;
+			knowledge_update_service.request.knowledge = knowledge_item;
+			if (!update_knowledge_client_.call(knowledge_update_service)) {
+				ROS_ERROR("KCL: (SimulatedObservePDDLAction) Could not remove the toy_at_right_box predicate to the knowledge base.");
+		 		exit(-1);
+			}
+			ROS_INFO("KCL: (SimulatedObservePDDLAction) Removed %s (toy_at_right_box) to the knowledge base.", knowledge_item.is_negative ? "NOT" : "");
+			
+			knowledge_item.values.clear();
 		}
 	}
 	
@@ -3,10 +3,10 @@
 
 #include <ros/ros.h>
 #include <rosplan_dispatch_msgs/ActionDispatch.h>
-#include "mongodb_store/message_store.h"
 
 namespace KCL_rosplan
 {
+class WaypointIndex;
 
 /**
  * An instance of this class gets called whenever the PDDL action 'observe-*' gets executed
@@ -19,8 +19,9 @@ public:
 	/**
 	 * Constructor.
 	 * @param node_handle An existing and initialised ros node handle.
+	 * @param waypoint_index The index used to find the poses of boxes and objects.
 	 */
-	SimulatedObservePDDLAction(ros::NodeHandle& node_handle);
+	SimulatedObservePDDLAction(ros::NodeHandle& node_handle, WaypointIndex& waypoint_index);
 	
 	/**
 	 * Destructor
@@ -41,7 +42,7 @@ private:
 	ros::ServiceClient query_knowledge_client_;     // Service to query the knowledge base.
 	ros::Publisher action_feedback_pub_;            // Publisher that communicates feedback to ROSPlan.
 	ros::Subscriber dispatch_sub_;                  // Subscriber to the dispatch topic of ROSPlan.
-	mongodb_store::MessageStoreProxy message_store_;// Message store.
+	WaypointIndex* waypoint_index_;                 // The poses of all boxes and objects.
 
 	int sort_for_;                                  // Number of time it should sort a toy before moving on.
 };
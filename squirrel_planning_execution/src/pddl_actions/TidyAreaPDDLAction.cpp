@@ -1,6 +1,7 @@
 #include <map>
 #include <vector>
 #include <iostream>
+#include <boost/bind.hpp>
 #include <sstream>
 
 #include <std_msgs/Int8.h>
@@ -22,6 +23,7 @@
 
 #include <squirrel_planning_execution/ClassicalTidyPDDLGenerator.h>
 #include <squirrel_planning_execution/KnowledgeBase.h>
+#include <squirrel_planning_execution/WaypointIndex.h>
 
 #include "TidyAreaPDDLAction.h"
 #include "PlannerInstance.h"
@@ -32,8 +34,8 @@ namespace KCL_rosplan {
 
 	std::string TidyAreaPDDLAction::g_action_name = "tidy_area";
 	
-	TidyAreaPDDLAction::TidyAreaPDDLAction(ros::NodeHandle& node_handle, KCL_rosplan::KnowledgeBase& kb)
-		: node_handle_(&node_handle), knowledge_base_(&kb), message_store_(node_handle)
+	TidyAreaPDDLAction::TidyAreaPDDLAction(ros::NodeHandle& node_handle, KCL_rosplan::KnowledgeBase& kb, KCL_rosplan::WaypointIndex& waypoint_index)
+		: node_handle_(&node_handle), knowledge_base_(&kb), waypoint_index_(&waypoint_index), message_store_(node_handle)
 	{
 		// create the action feedback publisher
 		action_feedback_pub_ = node_handle.advertise<rosplan_dispatch_msgs::ActionFeedback>("/kcl_rosplan/action_feedback", 10, true);
@@ -44,6 +46,10 @@ namespace KCL_rosplan {
 		dispatch_sub_ = node_handle.subscribe("/kcl_rosplan/action_dispatch", 1000, &KCL_rosplan::TidyAreaPDDLAction::dispatchCallback, this);
 		
 		node_handle.getParam("/squirrel_planning_execution/simulated", is_simulated_);
+		
+		double plan_timeout = 0;
+		node_handle.getParam("/squirrel_planning_execution/sub_plan_timeout", plan_timeout);
+		plan_timeout_ = ros::Duration(plan_timeout);
 	}
 	
 	
@@ -69,11 +75,18 @@ namespace KCL_rosplan {
 			return;
 		}
 
-		bool actionAchieved = false;
-		
 		ROS_INFO("KCL: (TidyAreaPDDLAction) action recieved %s", action_name.c_str());
 		
-		PlannerInstance& planner_instance = PlannerInstance::createInstance(*node_handle_, "ff", true);
+		PlannerInstance* planner_instance = PlannerInstance::createInstance(*node_handle_, "ff", true);
+		if (planner_instance == NULL)
+		{
+			ROS_ERROR("KCL: (TidyAreaPDDLAction) no planner instance is available for action name %s.", action_name.c_str());
+			rosplan_dispatch_msgs::ActionFeedback fb;
+			fb.action_id = msg->action_id;
+			fb.status = "action failed";
+			action_feedback_pub_.publish(fb);
+			return;
+		}
 		
 		// Lets start the planning process.
 		std::string data_path;
@@ -98,10 +111,11 @@ namespace KCL_rosplan {
 		if (!createDomain())
 		{
 			ROS_ERROR("KCL: (TidyAreaPDDLAction) failed to produce a domain at %s for action name %s.", domain_name.c_str(), action_name.c_str());
+			planner_instance->release();
 			return;
 		}
 		
-		planner_instance.startPlanner(domain_name, problem_name, data_path, planner_command);
+		planner_instance->startPlanner(domain_name, problem_name, data_path, planner_command, boost::bind(&TidyAreaPDDLAction::planFinished, this, _1, msg, planner_instance), plan_timeout_);
 		
 		// publish feedback (enabled)
 		rosplan_dispatch_msgs::ActionFeedback fb;
@@ -109,14 +123,13 @@ namespace KCL_rosplan {
 		fb.status = "action enabled";
 		action_feedback_pub_.publish(fb);
 
-		// wait for action to finish
-		ros::Rate loop_rate(1);
-		while (ros::ok() && (planner_instance.getState() == actionlib::SimpleClientGoalState::ACTIVE || planner_instance.getState() == actionlib::SimpleClientGoalState::PENDING)) {
-			ros::spinOnce();
-			loop_rate.sleep();
-		}
-
-		actionlib::SimpleClientGoalState state = planner_instance.getState();
+		// The sub-plan runs in the background, planFinished is called once it is done.
+	}
+	
+	void TidyAreaPDDLAction::planFinished(const actionlib::SimpleClientGoalState& state, const rosplan_dispatch_msgs::ActionDispatch::ConstPtr& msg, PlannerInstance* planner_instance)
+	{
+		const std::string& action_name = g_action_name;
+		planner_instance->release();
 		ROS_INFO("KCL: (TidyAreaPDDLAction) action finished: %s, %s", action_name.c_str(), state.toString().c_str());
 
 		if(state == actionlib::SimpleClientGoalState::SUCCEEDED)
@@ -170,6 +183,9 @@ namespace KCL_rosplan {
 		// TODO For now we assume there is only one area, so all objects in the knowledge base are relevant (unless already tidied).
 		rosplan_knowledge_msgs::GetAttributeService get_attribute;
 		
+		// All waypoints and facts created for this domain are sent to the knowledge base in one go.
+		KCL_rosplan::KnowledgeBase::Transaction transaction(*knowledge_base_);
+		
 		// Get the location of the boxes.
 		// (box_at ?b - box ?wp - waypoint)
 		get_attribute.request.predicate_name = "box_at";
@@ -195,33 +211,25 @@ namespace KCL_rosplan {
 				}
 			}
 			
-			// Get the actual location of this box.
-			std::vector< boost::shared_ptr<geometry_msgs::PoseStamped> > results;
-			
+			// Get the actual location of this box, boxes do not move so it is only fetched once.
 			std::stringstream ss;
 			ss << "near_" << box_location_predicate;
 			
 			if (!is_simulated_)
 			{
-				if(message_store_.queryNamed<geometry_msgs::PoseStamped>(box_location_predicate, results))
+				geometry_msgs::Point box_position;
+				if (!waypoint_index_->loadPose(box_location_predicate, "box") || !waypoint_index_->getPosition(box_location_predicate, box_position))
 				{
-					if (results.size() < 1)
-					{
-						ROS_ERROR("KCL: (TidyAreaPDDLAction) aborting waypoint request; no matching wpID %s", box_location_predicate.c_str());
-						exit(-1);
-					}
-				} else {
-					ROS_ERROR("KCL: (TidyAreaPDDLAction) could not query message store to fetch waypoint pose");
+					ROS_ERROR("KCL: (TidyAreaPDDLAction) aborting waypoint request; no matching wpID %s", box_location_predicate.c_str());
 					exit(-1);
 				}
-				const geometry_msgs::PoseStamped &box_wp = *results[0];
-				box_to_pose_mapping[box_predicate] = box_wp.pose;
+				box_to_pose_mapping[box_predicate].position = box_position;
 				
 				// Create a waypoint 44 cm from this box at a random angle.
 				float angle = ((float)rand() / (float)RAND_MAX) * 360.0f;
 				tf::Vector3 v(0.44f, 0.0f, 0.0f);
 				v.rotate(tf::Vector3(0, 0, 1), angle);
-				v += tf::Vector3(box_wp.pose.position.x, box_wp.pose.position.y, 0.0f);
+				v += tf::Vector3(box_position.x, box_position.y, 0.0f);
 				
 				tf::Quaternion v_rotation(tf::Vector3(0, 0, 1), angle + 180.0f);
 				
@@ -239,7 +247,7 @@ namespace KCL_rosplan {
 				near_pose.pose.orientation.z = v_rotation.z();
 				near_pose.pose.orientation.w = v_rotation.w();
 				
-				std::string near_waypoint_mongodb_id(message_store_.insertNamed(ss.str(), near_pose));
+				std::string near_waypoint_mongodb_id(waypoint_index_->insertNamed(ss.str(), near_pose, "waypoint"));
 			}
 			
 			box_to_location_mapping[box_predicate] = box_location_predicate;
@@ -248,20 +256,12 @@ namespace KCL_rosplan {
 			
 			waypoints_near_box.push_back(ss.str());
 			
-			if (!knowledge_base_->addInstance("waypoint", ss.str()))
-			{
-				ROS_ERROR("KCL: (TidyAreaPDDLAction) Could not add the waypoint %s to the knowledge base.", ss.str().c_str());
-				exit(-1);
-			}
+			transaction.addInstance("waypoint", ss.str());
 			
 			std::map<std::string, std::string> parameters;
 			parameters["wp1"] = ss.str();
 			parameters["wp2"] = box_location_predicate;
-			if (!knowledge_base_->addFact("near_for_dropping", parameters, true, KCL_rosplan::KnowledgeBase::KB_ADD_KNOWLEDGE))
-			{
-				ROS_ERROR("KCL: (TidyAreaPDDLAction) Could not add the fact (near %s %s) to the knowledge base.", ss.str().c_str(), box_location_predicate.c_str());
-				exit(-1);
-			}
+			transaction.addFact("near_for_dropping", parameters, true, KCL_rosplan::KnowledgeBase::KB_ADD_KNOWLEDGE);
 			near_box_location_mapping[box_location_predicate] = waypoints_near_box;
 		}
 		
@@ -431,11 +431,7 @@ namespace KCL_rosplan {
 				std::vector<std::string> grasping_waypoints;
 				grasping_waypoints.push_back(ss.str());
 				
-				if (!knowledge_base_->addInstance("waypoint", ss.str()))
-				{
-					ROS_ERROR("KCL: (TidyAreaPDDLAction) Could not add the waypoint %s to the knowledge base.", ss.str().c_str());
-					exit(-1);
-				}
+				transaction.addInstance("waypoint", ss.str());
 				
 				if (!is_simulated_)
 				{
@@ -461,17 +457,13 @@ namespace KCL_rosplan {
 					near_pose.pose.orientation.z = v_rotation.z();
 					near_pose.pose.orientation.w = v_rotation.w();
 					
-					std::string near_waypoint_mongodb_id(message_store_.insertNamed(ss.str(), near_pose));
+					std::string near_waypoint_mongodb_id(waypoint_index_->insertNamed(ss.str(), near_pose, "waypoint"));
 				}
 				
 				std::map<std::string, std::string> parameters;
 				parameters["wp1"] = ss.str();
 				parameters["wp2"] = object_to_location_mapping[object_predicate];
-				if (!knowledge_base_->addFact("near_for_grasping", parameters, true, KCL_rosplan::KnowledgeBase::KB_ADD_KNOWLEDGE))
-				{
-					ROS_ERROR("KCL: (TidyAreaPDDLAction) Could not add the fact (near %s %s) to the knowledge base.", ss.str().c_str(), object_predicate.c_str());
-					exit(-1);
-				}
+				transaction.addFact("near_for_grasping", parameters, true, KCL_rosplan::KnowledgeBase::KB_ADD_KNOWLEDGE);
 				/*
 				kenny_knowledge.knowledge_type = rosplan_knowledge_msgs::KnowledgeItem::FACT;
 				kenny_knowledge.attribute_name = "near_for_grasping";
@@ -529,7 +521,7 @@ namespace KCL_rosplan {
 					near_pose.pose.orientation.z = behind_robot_rotation.z();
 					near_pose.pose.orientation.w = behind_robot_rotation.w();
 					
-					std::string behind_robot_waypoint_mongodb_id(message_store_.insertNamed(ss.str(), near_pose));
+					std::string behind_robot_waypoint_mongodb_id(waypoint_index_->insertNamed(ss.str(), near_pose, "waypoint"));
 				}
 				std::vector<std::string> pushing_waypoints;
 				pushing_waypoints.push_back(ss.str());
@@ -564,20 +556,12 @@ namespace KCL_rosplan {
 				kenny_knowledge.values.clear();
 				*/
 				
-				if (!knowledge_base_->addInstance("waypoint", ss.str()))
-				{
-					ROS_ERROR("KCL: (TidyAreaPDDLAction) Could not add the waypoint %s to the knowledge base.", ss.str().c_str());
-					exit(-1);
-				}
+				transaction.addInstance("waypoint", ss.str());
 				
 				parameters.clear();
 				parameters["wp1"] = ss.str();
 				parameters["wp2"] = object_to_location_mapping[object_predicate];
-				if (!knowledge_base_->addFact("near_for_grasping", parameters, true, KCL_rosplan::KnowledgeBase::KB_ADD_KNOWLEDGE))
-				{
-					ROS_ERROR("KCL: (TidyAreaPDDLAction) Could not add the fact (near %s %s) to the knowledge base.", ss.str().c_str(), object_predicate.c_str());
-					exit(-1);
-				}
+				transaction.addFact("near_for_grasping", parameters, true, KCL_rosplan::KnowledgeBase::KB_ADD_KNOWLEDGE);
 
 				pushing_waypoint_mappings[object_to_location_mapping[object_predicate]] = pushing_waypoints;
 			}
@@ -595,6 +579,13 @@ namespace KCL_rosplan {
 			}
 		}
 		
+		if (!transaction.commit())
+		{
+			ROS_ERROR("KCL: (TidyAreaPDDLAction) Could not add the near waypoints to the knowledge base.");
+			exit(-1);
+		}
+		
 		ClassicalTidyPDDLGenerator::createPDDL(data_path, domain_name, problem_name, robot_location, object_to_location_mapping, grasping_waypoint_mappings, pushing_waypoint_mappings, object_to_type_mapping, box_to_location_mapping, box_to_type_mapping, near_box_location_mapping);
+		return true;
 	}
 };
@@ -3,12 +3,15 @@
 
 #include <ros/ros.h>
 #include <rosplan_dispatch_msgs/ActionDispatch.h>
+#include <actionlib/client/simple_action_client.h>
 
 #include "mongodb_store/message_store.h"
 
 namespace KCL_rosplan
 {
 class KnowledgeBase;
+class PlannerInstance;
+class WaypointIndex;
 
 /**
  * An instance of this class gets called whenever the PDDL action 'tidy_area' (or variants thereof) is
@@ -22,8 +25,9 @@ public:
 	 * Constructor.
 	 * @param node_handle An existing and initialised ros node handle.
 	 * @param kb The knowledge base to store all information in.
+	 * @param waypoint_index The index that holds the poses of the boxes and the waypoints near them.
 	 */
-	TidyAreaPDDLAction(ros::NodeHandle& node_handle, KCL_rosplan::KnowledgeBase& kb);
+	TidyAreaPDDLAction(ros::NodeHandle& node_handle, KCL_rosplan::KnowledgeBase& kb, KCL_rosplan::WaypointIndex& waypoint_index);
 	
 	/**
 	 * Destructor
@@ -39,6 +43,14 @@ public:
 	
 private:
 	
+	/**
+	 * Called when the sub-plan of a dispatched action is done.
+	 * @param state The final state of the sub-plan.
+	 * @param msg The dispatch message of the action.
+	 * @param planner_instance The planner that executed the sub-plan.
+	 */
+	void planFinished(const actionlib::SimpleClientGoalState& state, const rosplan_dispatch_msgs::ActionDispatch::ConstPtr& msg, PlannerInstance* planner_instance);
+	
 	/**
 	 * Create a PDDL domain.
 	 */
@@ -48,7 +60,9 @@ private:
 	
 	ros::NodeHandle* node_handle_;               // The ROS node.
 	KCL_rosplan::KnowledgeBase* knowledge_base_; // The knowledge base.
+	KCL_rosplan::WaypointIndex* waypoint_index_; // The poses of the boxes and the waypoints near them.
 	bool is_simulated_;                          // Whether this action is to be simulated.
+	ros::Duration plan_timeout_;                 // The sub-plan is cancelled if it takes longer than this, zero means no limit.
 	
 	ros::ServiceClient get_instance_client_;     // Service client to get instances stored by ROSPlan.
 	ros::ServiceClient get_attribute_client_;    // Service client to get attributes of instances stored by ROSPlan.
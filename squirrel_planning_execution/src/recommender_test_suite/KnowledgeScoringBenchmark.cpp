@@ -0,0 +1,122 @@
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cmath>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include <squirrel_planning_execution/KnowledgeScorer.h>
+
+/**
+ * Measures how long it takes to calculate the knowledge value of the output of the recommender. The output is
+ * simulated the same way RecommenderSystem::runRecommender creates it: a fact for every predicate and every
+ * ordered pair of objects. The knowledge value is the sum of the probabilities of all (belongs_in object box)
+ * facts. It compares the original approach, which visits every predicted fact and looks it up in the list of
+ * interesting facts, against the KnowledgeScorer.
+ */
+
+// A predicted fact, as seen by the original approach.
+struct SimulatedFact
+{
+	std::string predicate;
+	std::string first_type;
+	std::string second_type;
+};
+
+float scoreByLookup(const std::map<unsigned int, float>& results, const std::vector<SimulatedFact>& facts, const std::vector<unsigned int>& interesting_facts)
+{
+	float value = 0;
+	for (std::map<unsigned int, float>::const_iterator ci = results.begin(); ci != results.end(); ++ci)
+	{
+		const SimulatedFact& fact = facts[ci->first];
+		if (fact.predicate != "belongs_in") continue;
+		if (fact.first_type != "object") continue;
+		if (fact.second_type != "box") continue;
+
+		for (unsigned int i = 0; i < interesting_facts.size(); ++i)
+		{
+			if (interesting_facts[i] == ci->first)
+			{
+				value += ci->second;
+			}
+		}
+	}
+	return value;
+}
+
+int main(int argc, char **argv) {
+
+	unsigned int nr_objects = 50;
+	unsigned int nr_boxes = 10;
+	unsigned int iterations = 1000;
+	if (argc > 1) nr_objects = ::atoi(argv[1]);
+	if (argc > 2) nr_boxes = ::atoi(argv[2]);
+	if (argc > 3) iterations = ::atoi(argv[3]);
+
+	const char* predicate_names[] = { "belongs_in", "near", "similar", "is_of_type" };
+	unsigned int nr_predicates = sizeof(predicate_names) / sizeof(predicate_names[0]);
+	unsigned int nr_all_objects = nr_objects + nr_boxes;
+
+	// Create a fact for every predicate and every ordered pair of objects, the boxes come after the objects.
+	srand(0);
+	std::vector<SimulatedFact> facts;
+	std::map<unsigned int, float> results;
+	std::vector<float> probabilities;
+	std::vector<unsigned int> interesting_facts;
+	KCL_rosplan::KnowledgeScorer scorer;
+	for (unsigned int o1 = 0; o1 < nr_all_objects; ++o1)
+	{
+		for (unsigned int o2 = 0; o2 < nr_all_objects; ++o2)
+		{
+			for (unsigned int p = 0; p < nr_predicates; ++p)
+			{
+				SimulatedFact fact;
+				fact.predicate = predicate_names[p];
+				fact.first_type = o1 < nr_objects ? "object" : "box";
+				fact.second_type = o2 < nr_objects ? "object" : "box";
+
+				unsigned int id = facts.size();
+				float probability = (float)rand() / (float)RAND_MAX;
+				facts.push_back(fact);
+				results[id] = probability;
+				probabilities.push_back(probability);
+
+				if (p == 0 && o1 < nr_objects && o2 >= nr_objects)
+				{
+					interesting_facts.push_back(id);
+					scorer.addFact(id);
+				}
+			}
+		}
+	}
+
+	std::cout << nr_objects << " objects, " << nr_boxes << " boxes, " << facts.size() << " predicted facts, " << interesting_facts.size() << " interesting facts, " << iterations << " iterations." << std::endl;
+
+	float lookup_value = 0;
+	boost::posix_time::ptime start = boost::posix_time::microsec_clock::local_time();
+	for (unsigned int i = 0; i < iterations; ++i)
+	{
+		lookup_value += scoreByLookup(results, facts, interesting_facts);
+	}
+	double lookup_time = (boost::posix_time::microsec_clock::local_time() - start).total_microseconds() / (double)iterations;
+
+	float scorer_value = 0;
+	start = boost::posix_time::microsec_clock::local_time();
+	for (unsigned int i = 0; i < iterations; ++i)
+	{
+		scorer_value += scorer.score(probabilities);
+	}
+	double scorer_time = (boost::posix_time::microsec_clock::local_time() - start).total_microseconds() / (double)iterations;
+
+	std::cout << "Lookup: " << lookup_time << " us per score (value " << lookup_value / iterations << ")." << std::endl;
+	std::cout << "Scorer: " << scorer_time << " us per score (value " << scorer_value / iterations << ")." << std::endl;
+
+	if (std::fabs(lookup_value - scorer_value) > 1e-3f * std::fabs(lookup_value))
+	{
+		std::cout << "The scores differ!" << std::endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,81 @@
+#include <cmath>
+
+#include <boost/thread/mutex.hpp>
+
+#include <ros/ros.h>
+#include <geometry_msgs/PoseStamped.h>
+#include <squirrel_planning_knowledge_msgs/TaskPoseService.h>
+
+/**
+ * Stands in for the manipulation waypoint service, so RPSquirrelRoadmap can be tested without the manipulation
+ * planner. For every request it returns poses on a circle around the target, after waiting for a fixed delay to
+ * mimic the time the planner needs. Requests are served by several threads, like the real service, so concurrent
+ * requests overlap.
+ *
+ * Parameters (private):
+ * - number_of_poses: The number of poses per request (default 4).
+ * - radius: The distance of the poses to the target in meters (default 0.5).
+ * - delay: The time a request takes in seconds (default 0.5).
+ * - fail_every: Fail every n-th request, 0 never fails (default 0).
+ * - threads: The number of requests that are served at the same time (default 8).
+ */
+
+int g_number_of_poses = 4;
+double g_radius = 0.5;
+double g_delay = 0.5;
+int g_fail_every = 0;
+unsigned int g_nr_requests = 0;
+boost::mutex g_nr_requests_mutex;
+
+bool getTaskPoses(squirrel_planning_knowledge_msgs::TaskPoseService::Request &req, squirrel_planning_knowledge_msgs::TaskPoseService::Response &res)
+{
+	unsigned int request_nr;
+	{
+		boost::mutex::scoped_lock lock(g_nr_requests_mutex);
+		request_nr = ++g_nr_requests;
+	}
+
+	ros::Duration(g_delay).sleep();
+	if (g_fail_every > 0 && request_nr % g_fail_every == 0)
+	{
+		ROS_INFO("KCL: (MockTaskPoseService) Fail request %u.", request_nr);
+		return false;
+	}
+
+	for (int i = 0; i < g_number_of_poses; ++i)
+	{
+		double angle = 2 * M_PI * i / g_number_of_poses;
+		geometry_msgs::PoseStamped pose;
+		pose.header = req.target.header;
+		pose.pose.position.x = req.target.point.x + g_radius * cos(angle);
+		pose.pose.position.y = req.target.point.y + g_radius * sin(angle);
+		pose.pose.position.z = 0;
+		pose.pose.orientation.w = 1.0;
+		res.poses.push_back(pose);
+	}
+	ROS_INFO("KCL: (MockTaskPoseService) Returned %d poses for request %u.", g_number_of_poses, request_nr);
+	return true;
+}
+
+int main(int argc, char **argv) {
+
+	ros::init(argc, argv, "mock_task_pose_service");
+	ros::NodeHandle nh("~");
+
+	std::string service_topic("/squirrel_manipulation/waypoint_request");
+	int threads = 8;
+	nh.param("service_topic", service_topic, service_topic);
+	nh.param("number_of_poses", g_number_of_poses, g_number_of_poses);
+	nh.param("radius", g_radius, g_radius);
+	nh.param("delay", g_delay, g_delay);
+	nh.param("fail_every", g_fail_every, g_fail_every);
+	nh.param("threads", threads, threads);
+
+	ros::ServiceServer service = nh.advertiseService(service_topic, getTaskPoses);
+
+	ROS_INFO("KCL: (MockTaskPoseService) Ready to receive on %s.", service_topic.c_str());
+	ros::AsyncSpinner spinner(threads);
+	spinner.start();
+	ros::waitForShutdown();
+	return 0;
+}